@@ -8,6 +8,9 @@ WITH_FUSE_OPT=false
 WITH_ZK_INIT=false
 WITH_RDMA=false
 WITH_PROMETHEUS=false
+WITH_IO_URING=false
+WITH_LZ4=false
+WITH_ZSTD=false
 CREATE_SOFT_LINK=true
 
 FALCONFS_INSTALL_DIR="${FALCONFS_INSTALL_DIR:-/usr/local/falconfs}"
@@ -106,6 +109,9 @@ build_falconfs() {
         -DWITH_ZK_INIT="$WITH_ZK_INIT" \
         -DWITH_RDMA="$WITH_RDMA" \
         -DWITH_PROMETHEUS="$WITH_PROMETHEUS" \
+        -DWITH_IO_URING="$WITH_IO_URING" \
+        -DWITH_LZ4="$WITH_LZ4" \
+        -DWITH_ZSTD="$WITH_ZSTD" \
         -DBUILD_TEST=$BUILD_TEST &&
         cd "$BUILD_DIR" && ninja
 
@@ -314,6 +320,15 @@ build)
             --with-prometheus)
                 WITH_PROMETHEUS=true
                 ;;
+            --with-io-uring)
+                WITH_IO_URING=true
+                ;;
+            --with-lz4)
+                WITH_LZ4=true
+                ;;
+            --with-zstd)
+                WITH_ZSTD=true
+                ;;
             --help | -h)
                 echo "Usage: $0 build falcon [options]"
                 echo ""
@@ -327,6 +342,9 @@ build)
                 echo "  --with-zk-init Enable Zookeeper initialization for containerized deployment"
                 echo "  --with-rdma     Enable RDMA support"
                 echo "  --with-prometheus Enable Prometheus metrics"
+                echo "  --with-io-uring Enable io_uring local io engine"
+                echo "  --with-lz4      Enable lz4 compression of stored objects"
+                echo "  --with-zstd     Enable zstd compression of stored objects"
                 exit 0
                 ;;
             *)
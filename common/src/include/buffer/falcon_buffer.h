@@ -6,6 +6,9 @@
 
 #include <cstddef>
 
+/* buffers, offsets and sizes of O_DIRECT io are aligned to this */
+constexpr size_t ALIGNMENT = 512;
+
 struct FalconWriteBuffer
 {
     const char *ptr = nullptr;
@@ -5,11 +5,39 @@
 #pragma once
 
 #include <pthread.h>
+#include <unistd.h>
 #include <atomic>
 #include <cstdlib>
-#include <queue>
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "stats/falcon_stats.h"
+
+/* size classes, each half of the one above, the largest is the block size */
+#define MEMPOOL_SIZE_CLASSES 4
+#define MEMPOOL_MIN_CLASS_SIZE (64 * 1024)
+/* blocks a thread keeps for itself, and moves between its cache and the depot at once */
+#define MEMPOOL_THREAD_CACHE 8
+#define MEMPOOL_BATCH 4
+#define MEMPOOL_MAX_POOLS 8
+#define MEMPOOL_MAX_NUMA_NODES 8
+#define MEMPOOL_STATS_BATCH 64
+/* depot operations of a thread between lookups of its NUMA node */
+#define MEMPOOL_NODE_REFRESH 1024
+#define MEMPOOL_ALIGN 512
+#define MEMPOOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/*
+ * Pool of aligned IO buffers.
+ *
+ * Blocks come in size classes from the block size down to MEMPOOL_MIN_CLASS_SIZE. Every thread
+ * keeps a few blocks of each class for itself, so the common alloc/free pair takes no lock.
+ * Threads exchange blocks in batches through a global depot, one per NUMA node if enabled.
+ * The pool keeps up to capacity blocks of each class; blocks beyond it, and requests larger
+ * than the block size, are plain heap allocations counted as fallbacks.
+ */
 class MemPool {
   public:
     static MemPool &GetInstance()
@@ -20,60 +48,165 @@ class MemPool {
 
     MemPool() = default;
 
-    MemPool(size_t blockSize, size_t capacity)
+    MemPool(size_t blockSize, size_t capacity) { init(blockSize, capacity); }
+
+    ~MemPool()
     {
-        if (!m_init.exchange(true)) {
-            m_blockSize = blockSize;
-            m_capacity = capacity;
-            m_memLock = new (std::nothrow) pthread_spinlock_t;
-            if (m_memLock != nullptr) {
-                pthread_spin_init(m_memLock, 0);
+        if (!m_init.exchange(false)) {
+            return;
+        }
+        if (m_id >= 0 && m_id < MEMPOOL_MAX_POOLS) {
+            /* blocks still in thread caches are dropped, pools are meant to live as long as the process */
+            s_pools[m_id].store(nullptr);
+        }
+        for (int cls = 0; cls < m_numClasses; ++cls) {
+            for (Depot &depot : m_classes[cls].depots) {
+                for (void *block : depot.blocks) {
+                    if (!inArena(block)) {
+                        ::free(block);
+                    }
+                }
+                depot.blocks.clear();
+                pthread_spin_destroy(&depot.lock);
+            }
+        }
+        if (m_arena) {
+            if (m_arenaMapped) {
+                munmap(m_arena, m_arenaMapSize);
             } else {
-                m_init.store(false);
+                ::free(m_arena);
             }
+            m_arena = nullptr;
         }
     }
 
-    ~MemPool()
+    void init(size_t blockSize, size_t capacity)
     {
-        while (!m_freeBlocks.empty()) {
-            free(m_freeBlocks.front());
-            m_freeBlocks.pop();
+        if (m_init.load() || m_initing.exchange(true)) {
+            return;
+        }
+        m_blockSize = blockSize;
+        m_capacity = capacity;
+        m_numClasses = 0;
+        for (size_t size = blockSize; m_numClasses < MEMPOOL_SIZE_CLASSES; size /= 2) {
+            m_classes[m_numClasses].size = size;
+            for (Depot &depot : m_classes[m_numClasses].depots) {
+                pthread_spin_init(&depot.lock, 0);
+            }
+            m_numClasses++;
+            if (size / 2 < MEMPOOL_MIN_CLASS_SIZE || size % 2 != 0 || (size / 2) % MEMPOOL_ALIGN != 0) {
+                break;
+            }
         }
-        if (m_memLock) {
-            delete m_memLock;
-            m_memLock = nullptr;
+        static std::atomic<int> s_nextId = 0;
+        m_id = s_nextId.fetch_add(1);
+        if (m_id < MEMPOOL_MAX_POOLS) {
+            s_pools[m_id].store(this);
         }
+        m_init.store(true);
     }
 
-    void init(size_t blockSize, size_t capacity)
+    /* back large blocks and the arena with huge pages, set before init */
+    void SetHugePage(bool enable) { m_hugePage = enable; }
+
+    /* keep freed blocks on the NUMA node of the freeing thread */
+    void SetNuma(bool enable) { m_numa = enable; }
+
+    /*
+     * Carve all capacity blocks out of one contiguous region, so the whole pool can be
+     * registered once with the kernel (e.g. io_uring fixed buffers). Arena blocks never
+     * leave the pool: free() always gives them back.
+     */
+    bool initArena()
     {
-        if (!m_init.exchange(true)) {
-            m_blockSize = blockSize;
-            m_capacity = capacity;
-            m_memLock = new (std::nothrow) pthread_spinlock_t;
-            if (m_memLock != nullptr) {
-                pthread_spin_init(m_memLock, 0);
+        if (!m_init.load() || m_arena != nullptr || m_capacity == 0) {
+            return false;
+        }
+        size_t arenaSize = m_blockSize * m_capacity;
+        char *arena = nullptr;
+        if (m_hugePage) {
+            size_t mapSize = (arenaSize + MEMPOOL_HUGE_PAGE_SIZE - 1) / MEMPOOL_HUGE_PAGE_SIZE * MEMPOOL_HUGE_PAGE_SIZE;
+            void *mapped = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (mapped != MAP_FAILED) {
+                arena = (char *)mapped;
+                m_arenaMapped = true;
+                m_arenaMapSize = mapSize;
             } else {
-                m_init.store(false);
+                /* no reserved huge pages, let transparent huge pages back it */
+                arena = (char *)aligned_alloc(MEMPOOL_HUGE_PAGE_SIZE, mapSize);
+                if (arena != nullptr) {
+                    madvise(arena, mapSize, MADV_HUGEPAGE);
+                }
             }
+        } else {
+            arena = (char *)aligned_alloc(4096, (arenaSize + 4095) / 4096 * 4096);
+        }
+        if (arena == nullptr) {
+            return false;
         }
+        m_arena = arena;
+        m_arenaSize = arenaSize;
+        Depot &depot = m_classes[0].depots[0];
+        pthread_spin_lock(&depot.lock);
+        for (size_t i = 0; i < m_capacity; ++i) {
+            depot.blocks.push_back(arena + i * m_blockSize);
+        }
+        pthread_spin_unlock(&depot.lock);
+        m_classes[0].created += m_capacity;
+        return true;
+    }
+
+    void *arena() { return m_arena; }
+
+    size_t arenaSize() { return m_arenaSize; }
+
+    size_t blockSize() { return m_blockSize; }
+
+    bool inArena(const void *buf)
+    {
+        return m_arena != nullptr && (const char *)buf >= m_arena && (const char *)buf < m_arena + m_arenaSize;
     }
 
-    void *alloc()
+    void *alloc() { return alloc(m_blockSize); }
+
+    /*
+     * Get a block of at least size bytes, aligned to MEMPOOL_ALIGN. Give it back with free(buf, size).
+     */
+    void *alloc(size_t size)
     {
         if (!m_init.load()) {
             return nullptr;
         }
-        void *block = nullptr;
-        pthread_spin_lock(m_memLock);
-        if (!m_freeBlocks.empty()) {
-            block = m_freeBlocks.front();
-            m_freeBlocks.pop();
+        int cls = ClassOf(size);
+        if (cls < 0) {
+            FalconStats::GetInstance().stats[MEMPOOL_FALLBACK]++;
+            return aligned_alloc(MEMPOOL_ALIGN, (size + MEMPOOL_ALIGN - 1) / MEMPOOL_ALIGN * MEMPOOL_ALIGN);
+        }
+
+        ThreadCache *cache = Cache();
+        if (cache != nullptr && !cache->blocks[cls].empty()) {
+            void *block = cache->blocks[cls].back();
+            cache->blocks[cls].pop_back();
+            if (++cache->hits >= MEMPOOL_STATS_BATCH) {
+                FalconStats::GetInstance().stats[MEMPOOL_HIT] += cache->hits;
+                cache->hits = 0;
+            }
+            return block;
+        }
+
+        void *block = TakeFromDepot(cls, cache);
+        if (block != nullptr) {
+            FalconStats::GetInstance().stats[MEMPOOL_HIT]++;
+            return block;
+        }
+
+        size_t created = m_classes[cls].created.fetch_add(1);
+        block = NewBlock(m_classes[cls].size);
+        if (block == nullptr) {
+            m_classes[cls].created--;
+            return nullptr;
         }
-        pthread_spin_unlock(m_memLock);
-        block = block ? block : aligned_alloc(512, m_blockSize);
-        m_size += block ? 1 : 0;
+        FalconStats::GetInstance().stats[created < m_capacity ? MEMPOOL_MISS : MEMPOOL_FALLBACK]++;
         return block;
     }
 
@@ -83,35 +216,24 @@ class MemPool {
             return {};
         }
         std::vector<void *> bulkMem;
-
-        pthread_spin_lock(m_memLock);
-        while (!m_freeBlocks.empty() && num--) {
-            bulkMem.emplace_back(m_freeBlocks.front());
-            m_freeBlocks.pop();
-        }
-        pthread_spin_unlock(m_memLock);
-        while (num > 0) {
-            void *mem = aligned_alloc(512, m_blockSize);
+        while (num-- > 0) {
+            void *mem = alloc();
             if (mem == nullptr) {
+                /* error */
+                for (auto &m : bulkMem) {
+                    free(m);
+                }
+                bulkMem.clear();
                 break;
             }
             bulkMem.emplace_back(mem);
-            num--;
         }
-
-        if (num > 0) {
-            /* error */
-            for (auto &m : bulkMem) {
-                /* how to free? */
-                ::free(m);
-            }
-            bulkMem.clear();
-        }
-        m_size += bulkMem.size();
         return bulkMem;
     }
 
-    void free(void *buf)
+    void free(void *buf) { free(buf, m_blockSize); }
+
+    void free(void *buf, size_t size)
     {
         if (!m_init.load()) {
             return;
@@ -119,20 +241,181 @@ class MemPool {
         if (buf == nullptr) {
             return;
         }
-        if (m_size-- < m_capacity) {
-            pthread_spin_lock(m_memLock);
-            m_freeBlocks.push(buf);
-            pthread_spin_unlock(m_memLock);
-        } else {
+        int cls = ClassOf(size);
+        if (cls < 0) {
+            ::free(buf);
+            return;
+        }
+        SizeClass &sizeClass = m_classes[cls];
+        if (!inArena(buf) && sizeClass.created.load() > m_capacity) {
+            /* the pool is over capacity, give the block back to the system */
+            sizeClass.created--;
             ::free(buf);
+            return;
+        }
+
+        ThreadCache *cache = Cache();
+        if (cache == nullptr) {
+            PutToDepot(cls, &buf, 1, nullptr);
+            return;
+        }
+        std::vector<void *> &blocks = cache->blocks[cls];
+        blocks.push_back(buf);
+        if (blocks.size() > MEMPOOL_THREAD_CACHE) {
+            PutToDepot(cls, blocks.data() + blocks.size() - MEMPOOL_BATCH, MEMPOOL_BATCH, cache);
+            blocks.resize(blocks.size() - MEMPOOL_BATCH);
         }
     }
 
   private:
+    struct Depot {
+        pthread_spinlock_t lock;
+        std::vector<void *> blocks;
+    };
+
+    struct SizeClass {
+        size_t size = 0;
+        /* blocks of this class that exist, in depots, thread caches or in use */
+        std::atomic<size_t> created = 0;
+        Depot depots[MEMPOOL_MAX_NUMA_NODES];
+    };
+
+    struct ThreadCache {
+        MemPool *owner = nullptr;
+        int id = -1;
+        std::vector<void *> blocks[MEMPOOL_SIZE_CLASSES];
+        size_t hits = 0;
+        int node = -1;
+        uint32_t nodeUses = 0;
+
+        ~ThreadCache()
+        {
+            /* the thread is gone, hand its blocks to the other threads if the pool is still there */
+            if (owner == nullptr || s_pools[id].load() != owner) {
+                return;
+            }
+            for (int cls = 0; cls < owner->m_numClasses; ++cls) {
+                owner->PutToDepot(cls, blocks[cls].data(), blocks[cls].size(), this);
+            }
+            FalconStats::GetInstance().stats[MEMPOOL_HIT] += hits;
+        }
+    };
+
+    static inline std::atomic<MemPool *> s_pools[MEMPOOL_MAX_POOLS];
+    static thread_local ThreadCache t_caches[MEMPOOL_MAX_POOLS];
+
+    ThreadCache *Cache()
+    {
+        if (m_id < 0 || m_id >= MEMPOOL_MAX_POOLS) {
+            return nullptr;
+        }
+        ThreadCache *cache = &t_caches[m_id];
+        cache->owner = this;
+        cache->id = m_id;
+        return cache;
+    }
+
+    int ClassOf(size_t size)
+    {
+        if (size > m_blockSize) {
+            return -1;
+        }
+        int cls = m_numClasses - 1;
+        while (cls > 0 && m_classes[cls].size < size) {
+            cls--;
+        }
+        return cls;
+    }
+
+    /*
+     * The node of a thread with a cache is looked up once every MEMPOOL_NODE_REFRESH calls, threads
+     * seldom move between nodes.
+     */
+    int Node(ThreadCache *cache)
+    {
+        if (!m_numa) {
+            return 0;
+        }
+        if (cache != nullptr && cache->node >= 0 && ++cache->nodeUses < MEMPOOL_NODE_REFRESH) {
+            return cache->node;
+        }
+        unsigned cpu = 0;
+        unsigned node = 0;
+        int found = syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? node % MEMPOOL_MAX_NUMA_NODES : 0;
+        if (cache != nullptr) {
+            cache->node = found;
+            cache->nodeUses = 0;
+        }
+        return found;
+    }
+
+    /*
+     * Take a block from the depot of this node, or of any node before allocating a new one.
+     * With a thread cache, a batch is taken and the rest kept in the cache.
+     */
+    void *TakeFromDepot(int cls, ThreadCache *cache)
+    {
+        int node = Node(cache);
+        int nodes = m_numa ? MEMPOOL_MAX_NUMA_NODES : 1;
+        for (int i = 0; i < nodes; ++i) {
+            Depot &depot = m_classes[cls].depots[(node + i) % nodes];
+            pthread_spin_lock(&depot.lock);
+            if (depot.blocks.empty()) {
+                pthread_spin_unlock(&depot.lock);
+                continue;
+            }
+            void *block = depot.blocks.back();
+            depot.blocks.pop_back();
+            for (int n = 1; cache != nullptr && n < MEMPOOL_BATCH && !depot.blocks.empty(); ++n) {
+                cache->blocks[cls].push_back(depot.blocks.back());
+                depot.blocks.pop_back();
+            }
+            pthread_spin_unlock(&depot.lock);
+            return block;
+        }
+        return nullptr;
+    }
+
+    void PutToDepot(int cls, void *const *blocks, size_t num, ThreadCache *cache)
+    {
+        if (num == 0) {
+            return;
+        }
+        Depot &depot = m_classes[cls].depots[Node(cache)];
+        pthread_spin_lock(&depot.lock);
+        depot.blocks.insert(depot.blocks.end(), blocks, blocks + num);
+        pthread_spin_unlock(&depot.lock);
+    }
+
+    /*
+     * New blocks are not touched here, the first write by the using thread places them on its
+     * NUMA node.
+     */
+    void *NewBlock(size_t size)
+    {
+        if (m_hugePage && size >= MEMPOOL_HUGE_PAGE_SIZE && size % MEMPOOL_HUGE_PAGE_SIZE == 0) {
+            void *block = aligned_alloc(MEMPOOL_HUGE_PAGE_SIZE, size);
+            if (block != nullptr) {
+                madvise(block, size, MADV_HUGEPAGE);
+            }
+            return block;
+        }
+        return aligned_alloc(MEMPOOL_ALIGN, size);
+    }
+
     std::atomic<bool> m_init = false;
+    std::atomic<bool> m_initing = false;
+    int m_id = -1;
     size_t m_blockSize = 0;
     size_t m_capacity = 0;
-    std::atomic<size_t> m_size = 0;
-    std::queue<void *> m_freeBlocks;
-    pthread_spinlock_t *m_memLock = nullptr;
+    int m_numClasses = 0;
+    SizeClass m_classes[MEMPOOL_SIZE_CLASSES];
+    bool m_hugePage = false;
+    bool m_numa = false;
+    char *m_arena = nullptr;
+    size_t m_arenaSize = 0;
+    bool m_arenaMapped = false;
+    size_t m_arenaMapSize = 0;
 };
+
+inline thread_local MemPool::ThreadCache MemPool::t_caches[MEMPOOL_MAX_POOLS];
@@ -7,10 +7,14 @@
 #include <atomic>
 #include <memory>
 #include <shared_mutex>
+#include <vector>
 
 #include "read_stream/read_stream.h"
 #include "write_stream/stream_assembler.h"
 
+class CacheVerifier;
+class FileDownload;
+
 struct OpenInstance
 {
     OpenInstance() = default;
@@ -48,10 +52,18 @@ struct OpenInstance
     std::atomic<bool> readFail = false;
     // mark is call from server
     bool isRemoteCall = false;
+    // fail with ENOENT on a cache miss instead of loading storage, used while files migrate
+    bool cacheOnly = false;
     // mark call to remote fail, allow to be non atomic
     std::atomic<bool> remoteFailed = false;
     // is flush called
     bool isFlushed = false;
+    // stripes of a striped file opened so far, indexed by stripe, see StripeLayout
+    std::vector<std::shared_ptr<OpenInstance>> stripes;
+    // download of the cache file this read only open joined, reads wait for their range to land
+    std::shared_ptr<FileDownload> download = nullptr;
+    // checks the blocks of a sealed cache file this read only open reads, unset if it has no checksums
+    std::shared_ptr<CacheVerifier> verifier = nullptr;
     // is closed called for rpc server
     std::atomic<bool> isClosed = false;
     std::shared_mutex closeMutex;
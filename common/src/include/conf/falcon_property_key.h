@@ -81,4 +81,145 @@ class FalconPropertyKey : public PropertyKey {
 
     inline static const auto FALCON_PROMETHEUS_PORT =
         PropertyKey::Builder("main", "falcon_prometheus_port", FALCON, FALCON_STRING).build();
+
+    inline static const auto FALCON_IO_ENGINE =
+        PropertyKey::Builder("main", "falcon_io_engine", FALCON, FALCON_STRING).build();
+
+    inline static const auto FALCON_IO_URING_DEPTH =
+        PropertyKey::Builder("main", "falcon_io_uring_depth", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_IO_URING_SQPOLL =
+        PropertyKey::Builder("main", "falcon_io_uring_sqpoll", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_READAHEAD_MAX_BLOCKS =
+        PropertyKey::Builder("main", "falcon_readahead_max_blocks", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_READAHEAD_BUDGET_MB =
+        PropertyKey::Builder("main", "falcon_readahead_budget_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_STREAM_READ =
+        PropertyKey::Builder("main", "falcon_stream_read", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_WRITE_WINDOW =
+        PropertyKey::Builder("main", "falcon_write_window", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_WRITE_DIRTY_MB =
+        PropertyKey::Builder("main", "falcon_write_dirty_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_MEMPOOL_HUGEPAGE =
+        PropertyKey::Builder("main", "falcon_mempool_hugepage", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_MEMPOOL_NUMA =
+        PropertyKey::Builder("main", "falcon_mempool_numa", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_NODE_WEIGHTS =
+        PropertyKey::Builder("main", "falcon_node_weights", FALCON, FALCON_ARRAY).build();
+
+    inline static const auto FALCON_MIGRATE_BANDWIDTH_MB =
+        PropertyKey::Builder("main", "falcon_migrate_bandwidth_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_MIGRATE_FORWARD_S =
+        PropertyKey::Builder("main", "falcon_migrate_forward_s", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_REPLICAS =
+        PropertyKey::Builder("main", "falcon_replicas", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_HEDGE_PERCENTILE =
+        PropertyKey::Builder("main", "falcon_hedge_percentile", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_TRANSFER_PART_MB =
+        PropertyKey::Builder("main", "falcon_transfer_part_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_TRANSFER_CONCURRENCY =
+        PropertyKey::Builder("main", "falcon_transfer_concurrency", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_STORAGE_BACKEND =
+        PropertyKey::Builder("main", "falcon_storage_backend", FALCON, FALCON_STRING).build();
+
+    inline static const auto FALCON_STORAGE_PATH =
+        PropertyKey::Builder("main", "falcon_storage_path", FALCON, FALCON_STRING).build();
+
+    inline static const auto FALCON_MOCK_STORAGE_LATENCY_US =
+        PropertyKey::Builder("main", "falcon_mock_storage_latency_us", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_MOCK_STORAGE_BANDWIDTH_MB =
+        PropertyKey::Builder("main", "falcon_mock_storage_bandwidth_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_MOCK_STORAGE_ERROR_PERCENT =
+        PropertyKey::Builder("main", "falcon_mock_storage_error_percent", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_WRITEBACK_THREADS =
+        PropertyKey::Builder("main", "falcon_writeback_threads", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_COMPRESS =
+        PropertyKey::Builder("main", "falcon_compress", FALCON, FALCON_STRING).build();
+
+    inline static const auto FALCON_COMPRESS_BLOCK_KB =
+        PropertyKey::Builder("main", "falcon_compress_block_kb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_COMPRESS_DIRS =
+        PropertyKey::Builder("main", "falcon_compress_dirs", FALCON, FALCON_ARRAY).build();
+
+    inline static const auto FALCON_DEDUP =
+        PropertyKey::Builder("main", "falcon_dedup", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_DEDUP_CHUNK_KB =
+        PropertyKey::Builder("main", "falcon_dedup_chunk_kb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_PEER_FILL =
+        PropertyKey::Builder("main", "falcon_peer_fill", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_PIN_QUOTA_MB =
+        PropertyKey::Builder("main", "falcon_pin_quota_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_PREFETCH_DISTANCE =
+        PropertyKey::Builder("main", "falcon_prefetch_distance", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_PREFETCH_THREADS =
+        PropertyKey::Builder("main", "falcon_prefetch_threads", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_PREFETCH_MEMORY =
+        PropertyKey::Builder("main", "falcon_prefetch_memory", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_DOWNLOAD_BLOCK_KB =
+        PropertyKey::Builder("main", "falcon_download_block_kb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_STRIPE_WIDTH =
+        PropertyKey::Builder("main", "falcon_stripe_width", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_STRIPE_UNIT_KB =
+        PropertyKey::Builder("main", "falcon_stripe_unit_kb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_STRIPE_DIRS =
+        PropertyKey::Builder("main", "falcon_stripe_dirs", FALCON, FALCON_ARRAY).build();
+
+    /*
+     * crc32c of cache files, transfers and storage objects, off unless set. With storage on it
+     * writes a sidecar object dir/.falcon_crc.name next to every object dir/name uploaded, costing
+     * a delete and a put of the sidecar on each upload and a get of it on the first read of each
+     * object, the last CHECKSUM_SIDECAR_CACHE objects read are remembered.
+     */
+    inline static const auto FALCON_CHECKSUM =
+        PropertyKey::Builder("main", "falcon_checksum", FALCON, FALCON_BOOL).build();
+
+    inline static const auto FALCON_EC_DATA_SHARDS =
+        PropertyKey::Builder("main", "falcon_ec_data_shards", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_EC_PARITY_SHARDS =
+        PropertyKey::Builder("main", "falcon_ec_parity_shards", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_EC_REPAIR_S =
+        PropertyKey::Builder("main", "falcon_ec_repair_s", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_KV_BLOCK_KB =
+        PropertyKey::Builder("main", "falcon_kv_block_kb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_KV_DRAM_MB =
+        PropertyKey::Builder("main", "falcon_kv_dram_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_KV_SSD_MB =
+        PropertyKey::Builder("main", "falcon_kv_ssd_mb", FALCON, FALCON_UINT).build();
+
+    inline static const auto FALCON_KV_TTL_S =
+        PropertyKey::Builder("main", "falcon_kv_ttl_s", FALCON, FALCON_UINT).build();
 };
@@ -54,6 +54,9 @@ int startPrometheusMonitor(const std::string &endpoint, std::stop_token stoken)
     auto &truncate_ops = ops.Add({{"category", "meta"}, {"name", "truncate-ops"}});
     auto &flush_ops = ops.Add({{"category", "meta"}, {"name", "flush-ops"}});
     auto &fsync_ops = ops.Add({{"category", "meta"}, {"name", "fsync-ops"}});
+    auto &mempool_hit_ops = ops.Add({{"category", "mempool"}, {"name", "mempool-hit-ops"}});
+    auto &mempool_miss_ops = ops.Add({{"category", "mempool"}, {"name", "mempool-miss-ops"}});
+    auto &mempool_fallback_ops = ops.Add({{"category", "mempool"}, {"name", "mempool-fallback-ops"}});
 
     // latency metrics
     auto &latency = prometheus::BuildGauge()
@@ -89,6 +92,16 @@ int startPrometheusMonitor(const std::string &endpoint, std::stop_token stoken)
     auto &blockcache_write_throughput = throughput.Add({{"category", "blockcache"}, {"name", "blockcache-write-throughput"}});
     auto &object_read_throughput = throughput.Add({{"category", "object"}, {"name", "object-read-throughput"}});
     auto &object_write_throughput = throughput.Add({{"category", "object"}, {"name", "object-write-throughput"}});
+    auto &remote_read_throughput = throughput.Add({{"category", "remote"}, {"name", "remote-read-throughput"}});
+    auto &remote_read_copy_throughput = throughput.Add({{"category", "remote"}, {"name", "remote-read-copy-throughput"}});
+    auto &compress_in_throughput = throughput.Add({{"category", "compress"}, {"name", "compress-in-throughput"}});
+    auto &compress_out_throughput = throughput.Add({{"category", "compress"}, {"name", "compress-out-throughput"}});
+    auto &dedup_scanned_throughput = throughput.Add({{"category", "dedup"}, {"name", "dedup-scanned-throughput"}});
+    auto &dedup_shared_throughput = throughput.Add({{"category", "dedup"}, {"name", "dedup-shared-throughput"}});
+    auto &dedup_upload_saved_throughput =
+        throughput.Add({{"category", "dedup"}, {"name", "dedup-upload-saved-throughput"}});
+    auto &peer_fill_throughput = throughput.Add({{"category", "peer"}, {"name", "peer-fill-throughput"}});
+    auto &prefetch_throughput = throughput.Add({{"category", "prefetch"}, {"name", "prefetch-throughput"}});
 
     // system status metrics
     auto &status = prometheus::BuildGauge()
@@ -96,6 +109,23 @@ int startPrometheusMonitor(const std::string &endpoint, std::stop_token stoken)
                            .Help("Current system status")
                            .Register(*registry);
     auto &current_fds = status.Add({{"category", "overall"}, {"name", "current-fds"}});
+    auto &compress_cpu = status.Add({{"category", "compress"}, {"name", "compress-cpu-us"}});
+    auto &decompress_cpu = status.Add({{"category", "compress"}, {"name", "decompress-cpu-us"}});
+    auto &dedup_cpu = status.Add({{"category", "dedup"}, {"name", "dedup-cpu-us"}});
+    auto &peer_fill_miss = status.Add({{"category", "peer"}, {"name", "peer-fill-miss"}});
+    auto &prefetch_hit = status.Add({{"category", "prefetch"}, {"name", "prefetch-hit"}});
+    auto &prefetch_late = status.Add({{"category", "prefetch"}, {"name", "prefetch-late"}});
+    auto &download_join = status.Add({{"category", "download"}, {"name", "download-join"}});
+    auto &checksum_mismatch = status.Add({{"category", "checksum"}, {"name", "checksum-mismatch"}});
+    auto &checksum_refetch = status.Add({{"category", "checksum"}, {"name", "checksum-refetch"}});
+    auto &ec_encode = status.Add({{"category", "erasure-coding"}, {"name", "ec-encode"}});
+    auto &ec_reconstruct = status.Add({{"category", "erasure-coding"}, {"name", "ec-reconstruct"}});
+    auto &ec_repair = status.Add({{"category", "erasure-coding"}, {"name", "ec-repair"}});
+    auto &kv_put = status.Add({{"category", "kv"}, {"name", "kv-put"}});
+    auto &kv_get = status.Add({{"category", "kv"}, {"name", "kv-get"}});
+    auto &kv_miss = status.Add({{"category", "kv"}, {"name", "kv-miss"}});
+    auto &kv_spill = status.Add({{"category", "kv"}, {"name", "kv-spill"}});
+    auto &kv_evict = status.Add({{"category", "kv"}, {"name", "kv-evict"}});
 
     // Register the gauge with the registry
     exposer.RegisterCollectable(registry);
@@ -128,6 +158,9 @@ int startPrometheusMonitor(const std::string &endpoint, std::stop_token stoken)
         truncate_ops.Set(currentStats[META_TRUNCATE]);
         flush_ops.Set(currentStats[META_FLUSH]);
         fsync_ops.Set(currentStats[META_FSYNC]);
+        mempool_hit_ops.Set(currentStats[MEMPOOL_HIT]);
+        mempool_miss_ops.Set(currentStats[MEMPOOL_MISS]);
+        mempool_fallback_ops.Set(currentStats[MEMPOOL_FALLBACK]);
 
         overall_latency.Set(averageMS(currentStats[FUSE_LAT], currentStats[FUSE_OPS]));
         read_latency.Set(averageMS(currentStats[FUSE_READ_LAT], currentStats[FUSE_READ_OPS]));
@@ -153,8 +186,34 @@ int startPrometheusMonitor(const std::string &endpoint, std::stop_token stoken)
         blockcache_write_throughput.Set(currentStats[BLOCKCACHE_WRITE]);
         object_read_throughput.Set(currentStats[OBJ_GET]);
         object_write_throughput.Set(currentStats[OBJ_PUT]);
+        remote_read_throughput.Set(currentStats[REMOTE_READ]);
+        remote_read_copy_throughput.Set(currentStats[REMOTE_READ_COPY]);
+        compress_in_throughput.Set(currentStats[COMPRESS_IN]);
+        compress_out_throughput.Set(currentStats[COMPRESS_OUT]);
+        dedup_scanned_throughput.Set(currentStats[DEDUP_SCANNED]);
+        dedup_shared_throughput.Set(currentStats[DEDUP_SHARED]);
+        dedup_upload_saved_throughput.Set(currentStats[DEDUP_UPLOAD_SAVED]);
+        peer_fill_throughput.Set(currentStats[PEER_FILL]);
+        prefetch_throughput.Set(currentStats[PREFETCH]);
 
         current_fds.Set(FalconFd::GetInstance()->GetCurrentOpenInstanceCount());
+        compress_cpu.Set(currentStats[COMPRESS_CPU_US]);
+        decompress_cpu.Set(currentStats[DECOMPRESS_CPU_US]);
+        dedup_cpu.Set(currentStats[DEDUP_CPU_US]);
+        peer_fill_miss.Set(currentStats[PEER_FILL_MISS]);
+        prefetch_hit.Set(currentStats[PREFETCH_HIT]);
+        prefetch_late.Set(currentStats[PREFETCH_LATE]);
+        download_join.Set(currentStats[DOWNLOAD_JOIN]);
+        checksum_mismatch.Set(currentStats[CHECKSUM_MISMATCH]);
+        checksum_refetch.Set(currentStats[CHECKSUM_REFETCH]);
+        ec_encode.Set(currentStats[EC_ENCODE]);
+        ec_reconstruct.Set(currentStats[EC_RECONSTRUCT]);
+        ec_repair.Set(currentStats[EC_REPAIR]);
+        kv_put.Set(currentStats[KV_PUT]);
+        kv_get.Set(currentStats[KV_GET]);
+        kv_miss.Set(currentStats[KV_MISS]);
+        kv_spill.Set(currentStats[KV_SPILL]);
+        kv_evict.Set(currentStats[KV_EVICT]);
     }
 
     return 0;
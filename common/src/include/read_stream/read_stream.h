@@ -5,42 +5,138 @@
 #pragma once
 
 #include <securec.h>
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
-#define QUEUE_SIZE 3
+#include <brpc/stream.h>
+#include <bthread/countdown_event.h>
+#include <butil/iobuf.h>
+
+/* pipes filled ahead of the reader when a stream starts, doubled on each window consumed in order */
+#define READAHEAD_MIN_WINDOW 3
+#define READAHEAD_DEFAULT_MAX_WINDOW 16
+#define READAHEAD_BUDGET_RETRY_MS 10
+/* consecutive accesses of the same shape before a stream is (re)started */
+#define READ_PATTERN_HITS 2
 
 struct OpenInstance;
 
+enum class ReadPattern { RANDOM, SEQUENTIAL, STRIDED };
+
+/*
+ * Memory shared by the read streams of all open files in this mount. Only blocks filled
+ * ahead of the reader are charged, the block the reader is waiting for is never held back.
+ */
+class ReadaheadBudget {
+  public:
+    static ReadaheadBudget &GetInstance()
+    {
+        static ReadaheadBudget instance;
+        return instance;
+    }
+
+    void Init(int initMaxWindow, size_t initLimit)
+    {
+        maxWindow = std::max(initMaxWindow, 1);
+        limit = initLimit;
+    }
+
+    bool TryAcquire(size_t bytes)
+    {
+        size_t cur = used.load();
+        do {
+            if (cur + bytes > limit) {
+                return false;
+            }
+        } while (!used.compare_exchange_weak(cur, cur + bytes));
+        return true;
+    }
+
+    void Release(size_t bytes) { used -= bytes; }
+
+    int MaxWindow() { return maxWindow; }
+
+    void SetStreamRead(bool enable) { streamRead = enable; }
+
+    bool StreamRead() { return streamRead; }
+
+  private:
+    int maxWindow = READAHEAD_DEFAULT_MAX_WINDOW;
+    /* remote sequential streams are pushed by the owner node over a brpc stream */
+    bool streamRead = false;
+    size_t limit = SIZE_MAX;
+    std::atomic<size_t> used = 0;
+};
+
 class Pipe {
   public:
     bool Init(size_t initSize);
     void Init(size_t initSize, std::shared_ptr<char> initMem);
     ssize_t WaitPop(char *buf, size_t popSize, bool &end);
-    ssize_t WaitPush(OpenInstance *openInstance, off_t offset);
+    ssize_t WaitPush(OpenInstance *openInstance, off_t offset, bool charged = false);
+    bool Fill(butil::IOBuf &buf, ssize_t result);
+    void ReleaseMem();
     void Destroy();
 
     std::mutex mutex;
     std::condition_variable readCV;
     std::condition_variable writeCV;
     std::shared_ptr<char> mem = nullptr;
+    /* data pushed by a remote stream, popped instead of mem when not empty */
+    butil::IOBuf data;
     size_t capacity = 0;
     ssize_t size = 0;
     ssize_t index = 0;
+    /* mem is charged to ReadaheadBudget */
+    bool charged = false;
     std::atomic<bool> stop = true;
 };
 
+class ReadStream;
+
+/*
+ * Receives the blocks pushed by the owner node of a remote file for a ReadStream.
+ */
+class ReadStreamFeeder : public brpc::StreamInputHandler {
+  public:
+    explicit ReadStreamFeeder(ReadStream *stream)
+        : stream(stream)
+    {
+    }
+
+    int on_received_messages(brpc::StreamId id, butil::IOBuf *const messages[], size_t size) override;
+    void on_idle_timeout(brpc::StreamId /*id*/) override {}
+    void on_closed(brpc::StreamId id) override;
+
+  private:
+    ReadStream *stream;
+};
+
+/*
+ * Segment k of the stream is the pipeCap bytes at base + k * step, and lives in pipe
+ * k % pipeNum. step == pipeCap is a sequential stream, step > pipeCap a strided one.
+ * At most window segments beyond the one being popped are in flight.
+ * A sequential stream of a remote file is pushed by the owner node when stream read is
+ * enabled, every popped segment returns one credit to it. Otherwise threads pull the segments.
+ */
 class ReadStream {
   public:
-    bool Init(OpenInstance *instance, int blocks, size_t pipeSize);
+    bool Init(OpenInstance *instance, int blocks, size_t pipeSize, off_t initBase = 0, off_t initStep = 0);
     ssize_t WaitPop(char *buf, size_t popSize);
     void StartPushThreaded();
     void StopPushThreaded();
+    void Pause();
     void WaitPushEnded();
+    ReadPattern Track(off_t offset, size_t size);
+    bool Strided() { return step != (off_t)pipeCap; }
+    void Feed(butil::IOBuf &msg);
+    void OnStreamClosed();
 
     void addPipeIndex();
     ~ReadStream();
@@ -51,8 +147,49 @@ class ReadStream {
     int fileBlocks = 0;
     OpenInstance *openInstance;
     int pipeNum = 0;
-    Pipe pipes[QUEUE_SIZE];
+    std::unique_ptr<Pipe[]> pipes;
+    int pipeAlloc = 0;
     std::mutex pipeMutex;
     std::atomic<bool> stop = true;
+    /* a pusher thread per pipe, kept across restarts of the stream */
     std::vector<std::thread> threads;
+
+    /* remote push, streamId is guarded by pipeMutex */
+    ReadStreamFeeder feeder{this};
+    brpc::StreamId streamId = brpc::INVALID_STREAM_ID;
+    bool streamed = false;
+    bthread::CountdownEvent streamClosed{1};
+
+    off_t base = 0;
+    off_t step = 0;
+    /* readahead window, guarded by windowMutex */
+    int window = 0;
+    size_t popSegments = 0;
+    size_t nextGrow = 0;
+    std::mutex windowMutex;
+    std::condition_variable windowCV;
+
+    /* access history of the reader, guarded by the fileMutex of the open instance */
+    off_t lastOffset = -1;
+    size_t lastSize = 0;
+    off_t lastStride = 0;
+    int seqHits = 0;
+    int strideHits = 0;
+
+    /* rounds of the pusher threads, a round is a start of the stream, guarded by pushMutex */
+    std::mutex pushMutex;
+    std::condition_variable pushCV;
+    uint64_t pushRound = 0;
+    int pushPipes = 0;
+    int pushBusy = 0;
+    bool pushExit = false;
+
+  private:
+    void PushLoop(int pipe);
+    void PushSegments(int pipe);
+    bool StartPushStreamed();
+    void CloseStream();
+    void WaitStreamClosed();
+    bool WaitWindow(size_t segment);
+    bool ChargeBudget(size_t segment);
 };
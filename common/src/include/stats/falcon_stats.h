@@ -59,6 +59,46 @@ enum {
     BLOCKCACHE_WRITE,
     OBJ_GET,
     OBJ_PUT,
+    /* bytes read from remote nodes, and bytes copied in user space on their way to the reader */
+    REMOTE_READ,
+    REMOTE_READ_COPY,
+    /* io buffer allocations served from the pool, newly created within capacity, and beyond it */
+    MEMPOOL_HIT,
+    MEMPOOL_MISS,
+    MEMPOOL_FALLBACK,
+    /* bytes given to the storage compressor, bytes it stored, and cpu microseconds spent both ways */
+    COMPRESS_IN,
+    COMPRESS_OUT,
+    COMPRESS_CPU_US,
+    DECOMPRESS_CPU_US,
+    /* bytes fingerprinted, shared with equal cache file chunks, copied in storage instead of uploaded, and cpu
+       microseconds spent fingerprinting */
+    DEDUP_SCANNED,
+    DEDUP_SHARED,
+    DEDUP_UPLOAD_SAVED,
+    DEDUP_CPU_US,
+    /* bytes of cache misses filled from another node, and misses no other node could fill */
+    PEER_FILL,
+    PEER_FILL_MISS,
+    /* bytes staged ahead of registered reads, files read after and before they were staged */
+    PREFETCH,
+    PREFETCH_HIT,
+    PREFETCH_LATE,
+    /* cache misses served by a download of the file already in flight */
+    DOWNLOAD_JOIN,
+    /* blocks that failed their checksum, and damaged blocks and chunks fetched again */
+    CHECKSUM_MISMATCH,
+    CHECKSUM_REFETCH,
+    /* bytes of erasure coded shards written, bytes of files rebuilt from parity, and lost shards rebuilt */
+    EC_ENCODE,
+    EC_RECONSTRUCT,
+    EC_REPAIR,
+    /* bytes of kv blocks put and got, gets of absent blocks, bytes spilled from memory to disk, and blocks evicted */
+    KV_PUT,
+    KV_GET,
+    KV_MISS,
+    KV_SPILL,
+    KV_EVICT,
     STATS_END
 };
 
@@ -7,7 +7,10 @@
 #include <securec.h>
 #include <unistd.h>
 #include <algorithm>
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <shared_mutex>
 #include <vector>
@@ -18,6 +21,56 @@
 #include "log/logging.h"
 
 #define FALCON_STORE_STREAM_MAX_SIZE (256 * 1024)
+#define WRITE_DEFAULT_WINDOW 8
+/* writes are gathered in pages of this size, the blocks of writeMemPool */
+#define WRITE_PAGE_SIZE ((size_t)64 * 1024)
+#define WRITE_POOL_PAGES 2000
+
+/*
+ * Limits of the asynchronous remote writes. window is the number of writes in flight per open
+ * file, 1 keeps remote writes synchronous. Data of the writes in flight of all open files in this
+ * mount is bounded by limit, a writer waits for completions beyond it.
+ */
+class WriteBudget {
+  public:
+    static WriteBudget &GetInstance()
+    {
+        static WriteBudget instance;
+        return instance;
+    }
+
+    void Init(uint32_t initWindow, size_t initLimit)
+    {
+        window = std::max(initWindow, 1U);
+        limit = initLimit;
+    }
+
+    void Acquire(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        /* a write larger than the limit goes alone */
+        cv.wait(lock, [&]() { return used == 0 || used + bytes <= limit; });
+        used += bytes;
+    }
+
+    void Release(size_t bytes)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            used -= bytes;
+        }
+        cv.notify_all();
+    }
+
+    uint32_t Window() { return window; }
+
+  private:
+    uint32_t window = WRITE_DEFAULT_WINDOW;
+    size_t limit = SIZE_MAX;
+    size_t used = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
 
 class ExpandableMemory {
   public:
@@ -117,42 +170,77 @@ class ExpandableMemory {
     size_t capacity = 0;
 };
 
+/*
+ * Data of consecutive writes, gathered in aligned pages of writeMemPool taken as it grows. The
+ * pages are sent as they are, a multi-block IOBuf of them is the attachment of the remote write.
+ */
 class FixMemory {
   public:
     FixMemory() = default;
+    FixMemory(const FixMemory &) = delete;
+    FixMemory &operator=(const FixMemory &) = delete;
     ~FixMemory()
     {
-        if (mem) {
-            writeMemPool.free(mem);
+        for (char *page : pages) {
+            writeMemPool.free(page);
         }
     }
     bool Append(const char *buf, size_t appendSize)
     {
-        if (mem == nullptr) {
-            mem = (char *)writeMemPool.alloc();
+        if (size + appendSize > capacity) {
+            FALCON_LOG(LOG_ERROR) << "FixMemory append data too large";
+            return false;
+        }
+        /* pages first, so a failed append leaves the data as it was */
+        while (pages.size() * WRITE_PAGE_SIZE < size + appendSize) {
+            char *mem = (char *)writeMemPool.alloc();
             if (mem == nullptr) {
                 FALCON_LOG(LOG_ERROR) << "FixMemory get allocated nullptr";
                 return false;
             }
+            pages.push_back(mem);
         }
-        if (size + appendSize > capacity) {
-            FALCON_LOG(LOG_ERROR) << "FixMemory append data too large";
-            return false;
-        }
-        errno_t err = memcpy_s(mem + size, capacity - size, buf, appendSize);
-        if (err != 0) {
-            FALCON_LOG(LOG_ERROR) << "Secure func failed: " << err;
-            return false;
+        while (appendSize > 0) {
+            size_t page = size / WRITE_PAGE_SIZE;
+            size_t used = size % WRITE_PAGE_SIZE;
+            size_t copySize = std::min(appendSize, WRITE_PAGE_SIZE - used);
+            errno_t err = memcpy_s(pages[page] + used, WRITE_PAGE_SIZE - used, buf, copySize);
+            if (err != 0) {
+                FALCON_LOG(LOG_ERROR) << "Secure func failed: " << err;
+                return false;
+            }
+            buf += copySize;
+            appendSize -= copySize;
+            size += copySize;
         }
-        size += appendSize;
         return true;
     }
-    char *c_str() { return mem; }
+    /*
+     * Hand the data over to out, the pages holding it go along and are given back to writeMemPool
+     * once out is done with them. Pages not used are kept for the next appends.
+     */
+    void MoveTo(butil::IOBuf &out)
+    {
+        size_t used = (size + WRITE_PAGE_SIZE - 1) / WRITE_PAGE_SIZE;
+        for (size_t i = 0; i < used; ++i) {
+            size_t pageSize = std::min(size - i * WRITE_PAGE_SIZE, WRITE_PAGE_SIZE);
+#ifdef USE_RDMA
+            /* rdma sends from registered memory only */
+            out.append(pages[i], pageSize);
+#else
+            out.append_user_data(pages[i], pageSize, [](void *page) { writeMemPool.free(page); });
+            pages[i] = nullptr;
+#endif
+        }
+        pages.erase(std::remove(pages.begin(), pages.end(), nullptr), pages.end());
+        size = 0;
+    }
     void Clear() { size = 0; }
-    char *mem = nullptr;
+    std::vector<char *> pages;
     size_t size = 0;
     size_t capacity = FALCON_STORE_STREAM_MAX_SIZE;
 
+    /* set up by FalconStore::InitStore, with the huge page and NUMA settings of MemPool */
     static MemPool writeMemPool;
 };
 
@@ -258,10 +346,13 @@ class WriteStream {
     };
 
     WriteStream() = default;
-    ~WriteStream() = default;
+    ~WriteStream();
 
     int Push(FalconWriteBuffer buf, off_t offset, uint64_t currentSize);
     int PersistToFile(const char *buf, size_t size, off_t offset, uint64_t currentSize);
+    int PersistIOBuf(const butil::IOBuf &buf, off_t offset);
+    int PersistAsync(butil::IOBuf &buf, off_t offset);
+    int WaitAsyncWrites();
     int Persist(uint64_t currentSize);
 
     int Complete(uint64_t currentSize, bool isFlush, bool isSync = false);
@@ -271,9 +362,13 @@ class WriteStream {
     void SetDirect(bool isDirect) { direct = isDirect; }
     void SetClient(std::shared_ptr<FalconIOClient> falconIOClient);
     uint64_t GetSize();
+    uint64_t GetInflightSize();
 
   private:
     int64_t Merge(MergedSlice &&slice); // can return negative
+    bool Async() { return client != nullptr && WriteBudget::GetInstance().Window() > 1; }
+    bool Overlaps(off_t offset, size_t size);
+    void OnAsyncWriteDone(uint64_t seq, int ret);
 
     std::set<MergedSlice> stream; // (offset, size, content)
     uint64_t physicalFd = UINT64_MAX;
@@ -282,4 +377,14 @@ class WriteStream {
     SerialData data;
     uint64_t inodeId = 0;
     bool direct = false;
+
+    /* remote writes in flight by sequence number, (offset, size), guarded by asyncMutex */
+    std::mutex asyncMutex;
+    std::condition_variable asyncCV;
+    std::map<uint64_t, std::pair<off_t, size_t>> inflight;
+    uint64_t nextSeq = 0;
+    size_t inflightBytes = 0;
+    /* error of the earliest failed write, reported by the next flush or close */
+    int asyncError = 0;
+    uint64_t asyncErrorSeq = 0;
 };
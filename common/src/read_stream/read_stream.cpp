@@ -5,6 +5,8 @@
 #include "read_stream/read_stream.h"
 
 #include "buffer/open_instance.h"
+#include "connection/falcon_io_client.h"
+#include "connection/node.h"
 #include "falcon_store/falcon_store.h"
 
 /*---------------------- Pipe ----------------------*/
@@ -29,12 +31,13 @@ bool Pipe::Init(size_t initSize)
     return true;
 }
 
+/*
+ * Reset the pipe. initMem may be nullptr, then mem is taken from MemPool on first push.
+ */
 void Pipe::Init(size_t initSize, std::shared_ptr<char> initMem)
 {
     std::unique_lock<std::mutex> xlock(mutex);
-    if (mem != nullptr) {
-        return;
-    }
+    ReleaseMem();
     mem = initMem;
     capacity = initSize;
     size = initSize;
@@ -70,16 +73,24 @@ ssize_t Pipe::WaitPop(char *buf, size_t popSize, bool &end)
     }
 
     ssize_t readSize = std::min(popSize, (size_t)size - index);
-    errno_t err = memcpy_s(buf, popSize, mem.get() + index, readSize);
-    if (err != 0) {
-        FALCON_LOG(LOG_ERROR) << "Secure func failed: " << err;
-        return -EIO;
+    /* pipes are only pushed for remote files */
+    FalconStats::GetInstance().stats[REMOTE_READ_COPY] += readSize;
+    if (!data.empty()) {
+        data.cutn(buf, readSize);
+    } else {
+        errno_t err = memcpy_s(buf, popSize, mem.get() + index, readSize);
+        if (err != 0) {
+            FALCON_LOG(LOG_ERROR) << "Secure func failed: " << err;
+            return -EIO;
+        }
     }
     index += readSize;
     if (index == size) {
-        /* all data popped in pipe */
+        /* all data popped in pipe, give the memory back until next push */
         if (stop) {
             Destroy();
+        } else {
+            ReleaseMem();
         }
         end = true;
         writeCV.notify_all();
@@ -91,17 +102,43 @@ ssize_t Pipe::WaitPop(char *buf, size_t popSize, bool &end)
  * Wait to read data of size capacity to mem.
  * Use ReadFileLR to read data, other than pass data to pipe.
  */
-ssize_t Pipe::WaitPush(OpenInstance *openInstance, off_t offset)
+ssize_t Pipe::WaitPush(OpenInstance *openInstance, off_t offset, bool charged)
 {
     std::unique_lock<std::mutex> xlock(mutex);
     /* wait for pipe empty, or no need to push */
     writeCV.wait(xlock, [this]() { return index == size || stop; });
     if (stop) {
+        if (charged) {
+            ReadaheadBudget::GetInstance().Release(capacity);
+        }
         readCV.notify_all();
         return 0;
     }
+    this->charged = charged;
 
-    ssize_t readSize = FalconStore::GetInstance()->ReadFileLR(mem.get(), offset, openInstance, capacity);
+    /* data from the remote node stays in its IOBuf and is copied once, to the reader */
+    data.clear();
+    ssize_t readSize = -EIO;
+    bool remote = !StoreNode::GetInstance()->IsLocal(openInstance->nodeId) && !openInstance->remoteFailed;
+    if (remote) {
+        readSize = FalconStore::GetInstance()->ReadFileLR(nullptr, offset, openInstance, capacity, &data);
+    }
+    if (readSize >= 0) {
+        mem = nullptr;
+    } else {
+        /* mem is only taken when the block is read into it, from the cache file or obs */
+        if (mem == nullptr) {
+            std::function<void(char *)> freeFunc = [](char *ptr) { MemPool::GetInstance().free(ptr); };
+            mem = std::shared_ptr<char>((char *)MemPool::GetInstance().alloc(), freeFunc);
+        }
+        if (mem == nullptr) {
+            FALCON_LOG(LOG_ERROR) << "In WaitPush(): alloc mem failed";
+            readSize = -ENOMEM;
+        } else {
+            data.clear();
+            readSize = FalconStore::GetInstance()->ReadFileLR(mem.get(), offset, openInstance, capacity);
+        }
+    }
     if (readSize < 0) {
         FALCON_LOG(LOG_ERROR) << "In WaitPush(): ReadFileLR() failed";
     }
@@ -113,38 +150,83 @@ ssize_t Pipe::WaitPush(OpenInstance *openInstance, off_t offset)
     return readSize;
 }
 
+/*
+ * Hand a block pushed by the remote stream to the pipe. Credits keep the remote at most a
+ * window ahead, so the pipe has always been popped empty when its next segment arrives.
+ */
+bool Pipe::Fill(butil::IOBuf &buf, ssize_t result)
+{
+    std::unique_lock<std::mutex> xlock(mutex);
+    if (stop) {
+        return false;
+    }
+    if (index != size) {
+        FALCON_LOG(LOG_ERROR) << "Pipe::Fill(): pipe is not popped yet";
+        result = -EIO;
+    }
+    data.clear();
+    if (result > 0) {
+        buf.cutn(&data, result);
+    }
+    index = 0;
+    size = result;
+    readCV.notify_all();
+    return true;
+}
+
+void Pipe::ReleaseMem()
+{
+    mem = nullptr;
+    data.clear();
+    if (charged) {
+        ReadaheadBudget::GetInstance().Release(capacity);
+        charged = false;
+    }
+}
+
 void Pipe::Destroy()
 {
+    ReleaseMem();
     capacity = 0;
     size = 0;
     index = 0;
     stop = true;
-    mem = nullptr;
 }
 
 /*---------------------- ReadStream ----------------------*/
 
 /*
- * Init pipes under stream.
+ * Init pipes under stream. Segment memory is taken lazily when a segment is pushed.
  */
-bool ReadStream::Init(OpenInstance *instance, int blocks, size_t pipeSize)
+bool ReadStream::Init(OpenInstance *instance, int blocks, size_t pipeSize, off_t initBase, off_t initStep)
 {
     std::unique_lock<std::mutex> xlock(pipeMutex);
 
     openInstance = instance;
     fileBlocks = blocks;
-    pipeNum = std::min(blocks, QUEUE_SIZE);
-    pipeCap = pipeSize;
-    stop = false;
-
-    std::function<void(char *)> freeFunc = [](char *ptr) { MemPool::GetInstance().free(ptr); };
-    std::vector<void *> mem = MemPool::GetInstance().calloc(pipeNum);
-    if (mem.empty()) {
-        FALCON_LOG(LOG_ERROR) << "ReadStream::Init: calloc mem failed";
+    pipeNum = std::min(blocks, ReadaheadBudget::GetInstance().MaxWindow());
+    if (pipeNum <= 0) {
+        FALCON_LOG(LOG_ERROR) << "ReadStream::Init: no block to read";
         return false;
     }
+    pipeCap = pipeSize;
+    base = initBase;
+    step = initStep > 0 ? initStep : (off_t)pipeSize;
+    pipeIndex = 0;
+    stopOffset = -1;
+    if (pipeAlloc < pipeNum) {
+        pipes = std::make_unique<Pipe[]>(pipeNum);
+        pipeAlloc = pipeNum;
+    }
+    {
+        std::unique_lock<std::mutex> windowLock(windowMutex);
+        popSegments = 0;
+        window = std::min(std::max(window, READAHEAD_MIN_WINDOW), pipeNum);
+        nextGrow = window;
+        stop = false;
+    }
     for (int i = 0; i < pipeNum; i++) {
-        pipes[i].Init(pipeCap, std::shared_ptr<char>((char *)mem[i], freeFunc));
+        pipes[i].Init(pipeCap, nullptr);
     }
 
     return true;
@@ -183,37 +265,230 @@ ssize_t ReadStream::WaitPop(char *buf, size_t popSize)
 }
 
 /*
- * Switch the pipe that gives out data to next one
+ * Switch the pipe that gives out data to next one.
+ * A whole window popped in order means the access is sustained, so the window doubles.
+ */
+void ReadStream::addPipeIndex()
+{
+    pipeIndex = (pipeIndex + 1) % pipeNum;
+
+    uint32_t credits = 1;
+    {
+        std::unique_lock<std::mutex> windowLock(windowMutex);
+        popSegments++;
+        if (popSegments >= nextGrow && window < pipeNum) {
+            credits += std::min(window * 2, pipeNum) - window;
+            window += credits - 1;
+            nextGrow = popSegments + window;
+        }
+    }
+    windowCV.notify_all();
+    if (streamId != brpc::INVALID_STREAM_ID) {
+        /* the popped segment and the window growth let as many more segments out */
+        FalconIOClient::GrantReadStreamCredits(streamId, credits);
+    }
+}
+
+/*
+ * Wait until segment is inside the readahead window.
  */
-void ReadStream::addPipeIndex() { pipeIndex = (pipeIndex + 1) % pipeNum; }
+bool ReadStream::WaitWindow(size_t segment)
+{
+    std::unique_lock<std::mutex> windowLock(windowMutex);
+    windowCV.wait(windowLock, [&]() { return stop.load() || segment < popSegments + window; });
+    return !stop.load();
+}
+
+/*
+ * Charge a segment pushed ahead of the reader to the mount budget, waiting while the budget
+ * is used up. Returns whether the segment was charged.
+ */
+bool ReadStream::ChargeBudget(size_t segment)
+{
+    ReadaheadBudget &budget = ReadaheadBudget::GetInstance();
+    std::unique_lock<std::mutex> windowLock(windowMutex);
+    while (!stop.load()) {
+        if (segment <= popSegments) {
+            return false;
+        }
+        if (budget.TryAcquire(pipeCap)) {
+            return true;
+        }
+        windowCV.wait_for(windowLock, std::chrono::milliseconds(READAHEAD_BUDGET_RETRY_MS));
+    }
+    return false;
+}
 
 /*
  * Called by user.
- * Start max of threadNum and pipeNum number of threads to concurrently fills in the pipes.
+ * Start a round of the pusher threads to concurrently fill in the pipes, each keeps to the segments
+ * of its pipe. Threads are started once per pipe and wait for the next round when theirs ends, the
+ * previous round must have ended, see WaitPushEnded.
  */
 void ReadStream::StartPushThreaded()
 {
     std::unique_lock<std::mutex> xlock(pipeMutex);
-    for (int i = 0; i < pipeNum; i++) {
-        threads.emplace_back([=, this]() {
-            size_t offset = i * pipeCap;
-            while (!stop.load() && offset < stopOffset) {
-                ssize_t retSize = pipes[i].WaitPush(openInstance, offset);
-                if (retSize != (ssize_t)pipes[i].capacity) {
-                    /* Read data not equals capacity, means error or read end. Mark end for other reading threads */
-                    /* stopOffset will be small than offset for other threads because pipes are popped in order */
-                    stopOffset = offset;
-                    break;
-                }
-                offset += pipeNum * pipeCap;
+    if (StartPushStreamed()) {
+        return;
+    }
+    std::unique_lock<std::mutex> pushLock(pushMutex);
+    while ((int)threads.size() < pipeNum) {
+        threads.emplace_back(&ReadStream::PushLoop, this, (int)threads.size());
+    }
+    pushRound++;
+    pushPipes = pipeNum;
+    pushBusy = pipeNum;
+    pushCV.notify_all();
+}
+
+void ReadStream::PushLoop(int pipe)
+{
+    uint64_t round = 0;
+    std::unique_lock<std::mutex> pushLock(pushMutex);
+    while (true) {
+        pushCV.wait(pushLock, [&]() { return pushExit || pushRound != round; });
+        if (pushExit) {
+            return;
+        }
+        round = pushRound;
+        if (pipe >= pushPipes) {
+            continue;
+        }
+        pushLock.unlock();
+        PushSegments(pipe);
+        pushLock.lock();
+        if (--pushBusy == 0) {
+            pushCV.notify_all();
+        }
+    }
+}
+
+void ReadStream::PushSegments(int pipe)
+{
+    for (size_t segment = pipe; !stop.load(); segment += pipeNum) {
+        size_t offset = base + segment * step;
+        if (offset >= stopOffset || !WaitWindow(segment)) {
+            break;
+        }
+        ssize_t retSize = pipes[pipe].WaitPush(openInstance, offset, ChargeBudget(segment));
+        if (retSize != (ssize_t)pipes[pipe].capacity) {
+            /* Read data not equals capacity, means error or read end. Mark end for other reading threads */
+            /* stopOffset will be small than offset for other threads because pipes are popped in order */
+            stopOffset = offset;
+            break;
+        }
+    }
+    /* no data will be pushed to pipe later, wake up reader */
+    pipes[pipe].stop = true;
+    pipes[pipe].readCV.notify_all();
+}
+
+/*
+ * Ask the owner node to push a sequential stream of a remote file, the first window of
+ * segments is granted up front. Returns false if the stream should be pulled by threads.
+ */
+bool ReadStream::StartPushStreamed()
+{
+    if (!ReadaheadBudget::GetInstance().StreamRead() || Strided() || openInstance->remoteFailed ||
+        StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
+        return false;
+    }
+    std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(openInstance->nodeId);
+    if (falconIOClient == nullptr || base >= (off_t)openInstance->currentSize.load()) {
+        return false;
+    }
+    int credits = 0;
+    {
+        std::unique_lock<std::mutex> windowLock(windowMutex);
+        credits = window;
+    }
+    int ret = falconIOClient->OpenReadStream(openInstance->physicalFd,
+                                             base,
+                                             openInstance->currentSize - base,
+                                             pipeCap,
+                                             credits,
+                                             &feeder,
+                                             streamId);
+    if (ret != 0) {
+        FALCON_LOG(LOG_WARNING) << "ReadStream: open remote stream failed (" << ret << "), pull by threads";
+        streamId = brpc::INVALID_STREAM_ID;
+        return false;
+    }
+    streamed = true;
+    return true;
+}
+
+/*
+ * Called by the feeder for every block of the remote stream, blocks arrive in order.
+ */
+void ReadStream::Feed(butil::IOBuf &msg)
+{
+    StreamReadHeader header;
+    if (msg.cutn(&header, sizeof(header)) != sizeof(header) || header.offset < (uint64_t)base) {
+        FALCON_LOG(LOG_ERROR) << "ReadStream::Feed(): bad block header";
+        return;
+    }
+    FalconStats::GetInstance().stats[REMOTE_READ] += std::max<int64_t>(header.result, 0);
+    size_t segment = (header.offset - base) / step;
+    pipes[segment % pipeNum].Fill(msg, header.result);
+    if (header.result != (int64_t)pipeCap) {
+        /* error or read end, readers of the pipes behind it stop there */
+        stopOffset = header.offset;
+        for (int i = 0; i < pipeNum; i++) {
+            pipes[i].stop = true;
+            pipes[i].readCV.notify_all();
+        }
+    }
+}
+
+/*
+ * Called by the feeder once the remote stream is gone. Closed before its last block means the
+ * connection failed, readers waiting on the stream get -EPIPE and read directly instead.
+ */
+void ReadStream::OnStreamClosed()
+{
+    if (stopOffset == (size_t)-1) {
+        for (int i = 0; i < pipeNum; i++) {
+            std::unique_lock<std::mutex> pipelock(pipes[i].mutex);
+            if (!pipes[i].stop && pipes[i].index == pipes[i].size) {
+                pipes[i].index = 0;
+                pipes[i].size = -EPIPE;
             }
-            /* no data will be pushed to pipe later, wake up reader */
             pipes[i].stop = true;
             pipes[i].readCV.notify_all();
-        });
+        }
     }
+    streamClosed.signal();
 }
 
+void ReadStream::CloseStream()
+{
+    if (streamId != brpc::INVALID_STREAM_ID) {
+        brpc::StreamClose(streamId);
+        streamId = brpc::INVALID_STREAM_ID;
+    }
+}
+
+void ReadStream::WaitStreamClosed()
+{
+    if (streamed) {
+        /* no block is fed after the stream is closed */
+        streamClosed.wait();
+        streamClosed.reset(1);
+        streamed = false;
+    }
+}
+
+int ReadStreamFeeder::on_received_messages(brpc::StreamId /*id*/, butil::IOBuf *const messages[], size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        stream->Feed(*messages[i]);
+    }
+    return 0;
+}
+
+void ReadStreamFeeder::on_closed(brpc::StreamId /*id*/) { stream->OnStreamClosed(); }
+
 /*
  * Called by user.
  * Stop all threads pushing the pipes started by StartPushThreaded.
@@ -222,7 +497,12 @@ void ReadStream::StartPushThreaded()
 void ReadStream::StopPushThreaded()
 {
     std::unique_lock<std::mutex> xlock(pipeMutex);
-    stop = true;
+    {
+        std::unique_lock<std::mutex> windowLock(windowMutex);
+        stop = true;
+    }
+    windowCV.notify_all();
+    CloseStream();
     for (int i = 0; i < pipeNum; i++) {
         std::unique_lock<std::mutex> pipelock(pipes[i].mutex);
         pipes[i].Destroy();
@@ -230,27 +510,85 @@ void ReadStream::StopPushThreaded()
     }
 }
 
+/*
+ * Called when the access no longer matches the stream. The stream may be started again by
+ * Init once a new pattern is found, with half of the window it had.
+ */
+void ReadStream::Pause()
+{
+    StopPushThreaded();
+    std::unique_lock<std::mutex> windowLock(windowMutex);
+    window = std::max(window / 2, READAHEAD_MIN_WINDOW);
+}
+
 void ReadStream::WaitPushEnded()
 {
-    for (auto &th : threads) {
-        if (th.joinable()) {
-            th.join();
-        }
+    WaitStreamClosed();
+    std::unique_lock<std::mutex> pushLock(pushMutex);
+    pushCV.wait(pushLock, [this]() { return pushBusy == 0; });
+}
+
+/*
+ * Record an access and classify it against the previous ones.
+ * Sequential: each access starts where the last one ended.
+ * Strided: same size, and the same gap larger than the size between starts.
+ */
+ReadPattern ReadStream::Track(off_t offset, size_t size)
+{
+    off_t delta = offset - lastOffset;
+    if (lastOffset >= 0 && delta == (off_t)lastSize) {
+        seqHits++;
+        strideHits = 0;
+    } else if (lastOffset >= 0 && delta > (off_t)size && delta == lastStride && size == lastSize) {
+        strideHits++;
+        seqHits = 0;
+    } else {
+        seqHits = 0;
+        strideHits = 0;
     }
+    lastStride = delta;
+    lastOffset = offset;
+    lastSize = size;
+
+    if (seqHits >= READ_PATTERN_HITS) {
+        return ReadPattern::SEQUENTIAL;
+    }
+    if (strideHits >= READ_PATTERN_HITS) {
+        return ReadPattern::STRIDED;
+    }
+    return ReadPattern::RANDOM;
 }
 
 /*
- * Wait for all threads pushing to join
+ * Wait for all threads pushing to end their round and join
  */
 ReadStream::~ReadStream()
 {
+    {
+        std::unique_lock<std::mutex> windowLock(windowMutex);
+        stop = true;
+    }
+    windowCV.notify_all();
     for (int i = 0; i < pipeNum; i++) {
         pipes[i].stop = true;
         pipes[i].writeCV.notify_all();
     }
+    {
+        std::unique_lock<std::mutex> xlock(pipeMutex);
+        CloseStream();
+    }
+    WaitStreamClosed();
+    {
+        std::unique_lock<std::mutex> pushLock(pushMutex);
+        pushExit = true;
+    }
+    pushCV.notify_all();
     for (auto &th : threads) {
         if (th.joinable()) {
             th.join();
         }
     }
+    for (int i = 0; i < pipeNum; i++) {
+        pipes[i].ReleaseMem();
+    }
 }
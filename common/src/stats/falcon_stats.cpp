@@ -160,6 +160,70 @@ void PrintStats(std::string_view mountPath, std::stop_token stoken)
         outFile << "  Gets: " << currentStats[OBJ_GET] << "\n";
         outFile << "  Puts: " << currentStats[OBJ_PUT] << "\n";
 
+        outFile << "\nRemote Read:\n";
+        outFile << "  Reads: " << formatU64(currentStats[REMOTE_READ]) << "\n";
+        outFile << "  Copied: " << formatU64(currentStats[REMOTE_READ_COPY]) << "\n";
+        outFile << "  Copies Per Byte: "
+                << (currentStats[REMOTE_READ] == 0
+                        ? 0
+                        : (double)currentStats[REMOTE_READ_COPY] / currentStats[REMOTE_READ])
+                << "\n";
+
+        outFile << "\nMemory Pool:\n";
+        outFile << "  Hits: " << currentStats[MEMPOOL_HIT] << "\n";
+        outFile << "  Misses: " << currentStats[MEMPOOL_MISS] << "\n";
+        outFile << "  Fallbacks: " << currentStats[MEMPOOL_FALLBACK] << "\n";
+
+        outFile << "\nCompression:\n";
+        outFile << "  In: " << formatU64(currentStats[COMPRESS_IN]) << "\n";
+        outFile << "  Out: " << formatU64(currentStats[COMPRESS_OUT]) << "\n";
+        outFile << "  Ratio: "
+                << (currentStats[COMPRESS_OUT] == 0 ? 0
+                                                    : (double)currentStats[COMPRESS_IN] / currentStats[COMPRESS_OUT])
+                << "\n";
+        outFile << "  Compress CPU us: " << currentStats[COMPRESS_CPU_US] << "\n";
+        outFile << "  Decompress CPU us: " << currentStats[DECOMPRESS_CPU_US] << "\n";
+
+        outFile << "\nDedup:\n";
+        outFile << "  Scanned: " << formatU64(currentStats[DEDUP_SCANNED]) << "\n";
+        outFile << "  Shared: " << formatU64(currentStats[DEDUP_SHARED]) << "\n";
+        outFile << "  Ratio: "
+                << (currentStats[DEDUP_SCANNED] <= currentStats[DEDUP_SHARED]
+                        ? 0
+                        : (double)currentStats[DEDUP_SCANNED] /
+                              (currentStats[DEDUP_SCANNED] - currentStats[DEDUP_SHARED]))
+                << "\n";
+        outFile << "  Upload Saved: " << formatU64(currentStats[DEDUP_UPLOAD_SAVED]) << "\n";
+        outFile << "  Fingerprint CPU us: " << currentStats[DEDUP_CPU_US] << "\n";
+
+        outFile << "\nPeer Fill:\n";
+        outFile << "  Filled: " << formatU64(currentStats[PEER_FILL]) << "\n";
+        outFile << "  Misses: " << currentStats[PEER_FILL_MISS] << "\n";
+
+        outFile << "\nPrefetch:\n";
+        outFile << "  Staged: " << formatU64(currentStats[PREFETCH]) << "\n";
+        outFile << "  Hits: " << currentStats[PREFETCH_HIT] << "\n";
+        outFile << "  Late: " << currentStats[PREFETCH_LATE] << "\n";
+
+        outFile << "\nDownload:\n";
+        outFile << "  Joined: " << currentStats[DOWNLOAD_JOIN] << "\n";
+
+        outFile << "\nChecksum:\n";
+        outFile << "  Mismatches: " << currentStats[CHECKSUM_MISMATCH] << "\n";
+        outFile << "  Refetched: " << currentStats[CHECKSUM_REFETCH] << "\n";
+
+        outFile << "\nErasure coding:\n";
+        outFile << "  Encoded: " << formatU64(currentStats[EC_ENCODE]) << "\n";
+        outFile << "  Reconstructed: " << formatU64(currentStats[EC_RECONSTRUCT]) << "\n";
+        outFile << "  Repaired shards: " << currentStats[EC_REPAIR] << "\n";
+
+        outFile << "\nKV blocks:\n";
+        outFile << "  Put: " << formatU64(currentStats[KV_PUT]) << "\n";
+        outFile << "  Got: " << formatU64(currentStats[KV_GET]) << "\n";
+        outFile << "  Misses: " << currentStats[KV_MISS] << "\n";
+        outFile << "  Spilled to disk: " << formatU64(currentStats[KV_SPILL]) << "\n";
+        outFile << "  Evicted: " << currentStats[KV_EVICT] << "\n";
+
         outFile.close();
         {
             std::unique_lock lock(mtx);
@@ -203,6 +267,35 @@ std::vector<std::string> convertStatstoString(const std::vector<size_t> &stats)
     stringStats[BLOCKCACHE_WRITE] = formatU64(stats[BLOCKCACHE_WRITE]);
     stringStats[OBJ_GET] = formatU64(stats[OBJ_GET]);
     stringStats[OBJ_PUT] = formatU64(stats[OBJ_PUT]);
+    stringStats[REMOTE_READ] = formatU64(stats[REMOTE_READ]);
+    stringStats[REMOTE_READ_COPY] = formatU64(stats[REMOTE_READ_COPY]);
+    stringStats[MEMPOOL_HIT] = formatOp(stats[MEMPOOL_HIT]);
+    stringStats[MEMPOOL_MISS] = formatOp(stats[MEMPOOL_MISS]);
+    stringStats[MEMPOOL_FALLBACK] = formatOp(stats[MEMPOOL_FALLBACK]);
+    stringStats[COMPRESS_IN] = formatU64(stats[COMPRESS_IN]);
+    stringStats[COMPRESS_OUT] = formatU64(stats[COMPRESS_OUT]);
+    stringStats[COMPRESS_CPU_US] = formatOp(stats[COMPRESS_CPU_US]);
+    stringStats[DECOMPRESS_CPU_US] = formatOp(stats[DECOMPRESS_CPU_US]);
+    stringStats[DEDUP_SCANNED] = formatU64(stats[DEDUP_SCANNED]);
+    stringStats[DEDUP_SHARED] = formatU64(stats[DEDUP_SHARED]);
+    stringStats[DEDUP_UPLOAD_SAVED] = formatU64(stats[DEDUP_UPLOAD_SAVED]);
+    stringStats[DEDUP_CPU_US] = formatOp(stats[DEDUP_CPU_US]);
+    stringStats[PEER_FILL] = formatU64(stats[PEER_FILL]);
+    stringStats[PEER_FILL_MISS] = formatOp(stats[PEER_FILL_MISS]);
+    stringStats[PREFETCH] = formatU64(stats[PREFETCH]);
+    stringStats[PREFETCH_HIT] = formatOp(stats[PREFETCH_HIT]);
+    stringStats[PREFETCH_LATE] = formatOp(stats[PREFETCH_LATE]);
+    stringStats[DOWNLOAD_JOIN] = formatOp(stats[DOWNLOAD_JOIN]);
+    stringStats[CHECKSUM_MISMATCH] = formatOp(stats[CHECKSUM_MISMATCH]);
+    stringStats[CHECKSUM_REFETCH] = formatOp(stats[CHECKSUM_REFETCH]);
+    stringStats[EC_ENCODE] = formatU64(stats[EC_ENCODE]);
+    stringStats[EC_RECONSTRUCT] = formatU64(stats[EC_RECONSTRUCT]);
+    stringStats[EC_REPAIR] = formatOp(stats[EC_REPAIR]);
+    stringStats[KV_PUT] = formatU64(stats[KV_PUT]);
+    stringStats[KV_GET] = formatU64(stats[KV_GET]);
+    stringStats[KV_MISS] = formatOp(stats[KV_MISS]);
+    stringStats[KV_SPILL] = formatU64(stats[KV_SPILL]);
+    stringStats[KV_EVICT] = formatOp(stats[KV_EVICT]);
 
     return stringStats;
 }
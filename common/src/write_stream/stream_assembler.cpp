@@ -5,9 +5,15 @@
 #include "write_stream/stream_assembler.h"
 
 #include "disk_cache/disk_cache.h"
+#include "io_engine/io_engine.h"
 #include "stats/falcon_stats.h"
 
-MemPool FixMemory::writeMemPool(FALCON_STORE_STREAM_MAX_SIZE, 500);
+MemPool FixMemory::writeMemPool;
+
+/*
+ * Writes in flight refer to this stream, wait for them
+ */
+WriteStream::~WriteStream() { WaitAsyncWrites(); }
 
 int WriteStream::Push(FalconWriteBuffer buf, off_t offset, uint64_t currentSize)
 {
@@ -17,16 +23,25 @@ int WriteStream::Push(FalconWriteBuffer buf, off_t offset, uint64_t currentSize)
 
     /* align the buffer if write to loacl */
     if (client == nullptr) {
-        if (!direct) {
+        /* buffers already aligned for direct io are written in place */
+        if (!direct || ((uintptr_t)buf.ptr % ALIGNMENT == 0 && buf.size % ALIGNMENT == 0 &&
+                        offset % ALIGNMENT == 0)) {
             return PersistToFile(buf.ptr, buf.size, offset, currentSize);
         } else {
-            int alignedNum = buf.size / 512 + static_cast<int>(buf.size % 512 != 0);
-            char *alignedBuf = (char *)aligned_alloc(512, 512 * alignedNum);
+            /* a MemPool block is aligned and registered with io_uring, larger writes take heap memory */
+            size_t alignedSize = (buf.size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            MemPool &memPool = MemPool::GetInstance();
+            bool pooled = alignedSize <= memPool.blockSize();
+            char *alignedBuf = pooled ? (char *)memPool.alloc() : nullptr;
+            if (alignedBuf == nullptr) {
+                pooled = false;
+                alignedBuf = (char *)aligned_alloc(ALIGNMENT, alignedSize);
+            }
             if (alignedBuf == nullptr) {
                 FALCON_LOG(LOG_ERROR) << "aligned_alloc failed: " << strerror(errno);
                 return -ENOMEM;
             }
-            int err = memcpy_s(alignedBuf, 512 * alignedNum, buf.ptr, buf.size);
+            int err = memcpy_s(alignedBuf, alignedSize, buf.ptr, buf.size);
             int ret = 0;
             if (err != 0) {
                 FALCON_LOG(LOG_ERROR) << "Secure func failed: " << err;
@@ -34,7 +49,11 @@ int WriteStream::Push(FalconWriteBuffer buf, off_t offset, uint64_t currentSize)
             } else {
                 ret = PersistToFile(alignedBuf, buf.size, offset, currentSize);
             }
-            free(alignedBuf);
+            if (pooled) {
+                memPool.free(alignedBuf);
+            } else {
+                free(alignedBuf);
+            }
             return ret;
         }
     }
@@ -51,6 +70,12 @@ int WriteStream::Push(FalconWriteBuffer buf, off_t offset, uint64_t currentSize)
 
     /* Large data, persist incoming data */
     if (buf.size >= FALCON_STORE_STREAM_MAX_SIZE) {
+        if (Async()) {
+            /* the caller's buffer is gone once we return, send a copy */
+            butil::IOBuf iobuf;
+            iobuf.append(buf.ptr, buf.size);
+            return PersistAsync(iobuf, offset);
+        }
         xlock.unlock();
         return PersistToFile(buf.ptr, buf.size, offset, currentSize);
     }
@@ -104,12 +129,11 @@ int WriteStream::PersistToFile(const char *buf, size_t size, off_t offset, uint6
             return -ENOSPC;
         }
         FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += size;
-        retSize = pwrite(physicalFd, buf, size, offset);
+        retSize = IoEngine::GetInstance().Pwrite(physicalFd, buf, size, offset);
         if (retSize < 0) {
-            int err = errno;
-            FALCON_LOG(LOG_ERROR) << "In WriteStream::persistToFile(): pwrite failed" << strerror(err);
+            FALCON_LOG(LOG_ERROR) << "In WriteStream::persistToFile(): pwrite failed" << strerror(-retSize);
             DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
-            return -err;
+            return retSize;
         }
         if (!DiskCache::GetInstance().Add(inodeId, sizeToAdd)) {
             DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
@@ -122,6 +146,94 @@ int WriteStream::PersistToFile(const char *buf, size_t size, off_t offset, uint6
     return 0;
 }
 
+/*
+ * Write data to the remote file and wait for it.
+ */
+int WriteStream::PersistIOBuf(const butil::IOBuf &buf, off_t offset)
+{
+    int ret = -ETIMEDOUT;
+    for (int i = 0; i < BRPC_RETRY_NUM && ret == -ETIMEDOUT; ++i) {
+        ret = client->WriteFile(physicalFd, buf, offset);
+        if (ret == -ETIMEDOUT) {
+            sleep(BRPC_RETRY_DELEY);
+            FALCON_LOG(LOG_ERROR) << "Reach timeout, retry num is " << i;
+        }
+    }
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "In WriteStream::PersistIOBuf(): remote persist failed";
+    }
+    return ret;
+}
+
+/*
+ * Send data to the remote file without waiting. Up to the window of writes are in flight, a
+ * write overlapping one in flight waits for it so the remote file sees them in order.
+ * Returns the error of an earlier write, if any.
+ */
+int WriteStream::PersistAsync(butil::IOBuf &buf, off_t offset)
+{
+    size_t size = buf.size();
+    uint64_t seq = 0;
+    {
+        std::unique_lock<std::mutex> lock(asyncMutex);
+        asyncCV.wait(lock, [&]() {
+            return asyncError != 0 ||
+                   (inflight.size() < WriteBudget::GetInstance().Window() && !Overlaps(offset, size));
+        });
+        if (asyncError != 0) {
+            return asyncError;
+        }
+        seq = nextSeq++;
+        inflight.emplace(seq, std::make_pair(offset, size));
+        inflightBytes += size;
+    }
+    WriteBudget::GetInstance().Acquire(size);
+    client->WriteFileAsync(physicalFd, buf, offset, [this, seq](int ret) { OnAsyncWriteDone(seq, ret); });
+    return 0;
+}
+
+bool WriteStream::Overlaps(off_t offset, size_t size)
+{
+    for (auto &[seq, range] : inflight) {
+        if (offset < range.first + (off_t)range.second && range.first < offset + (off_t)size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WriteStream::OnAsyncWriteDone(uint64_t seq, int ret)
+{
+    {
+        std::unique_lock<std::mutex> lock(asyncMutex);
+        auto it = inflight.find(seq);
+        WriteBudget::GetInstance().Release(it->second.second);
+        inflightBytes -= it->second.second;
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "In WriteStream: remote write at offset " << it->second.first
+                                  << " failed: " << strerror(-ret);
+            if (asyncError == 0 || seq < asyncErrorSeq) {
+                asyncError = ret;
+                asyncErrorSeq = seq;
+            }
+        }
+        inflight.erase(it);
+    }
+    asyncCV.notify_all();
+}
+
+/*
+ * Wait for all writes in flight. Returns the error of the earliest failed one and clears it.
+ */
+int WriteStream::WaitAsyncWrites()
+{
+    std::unique_lock<std::mutex> lock(asyncMutex);
+    asyncCV.wait(lock, [&]() { return inflight.empty(); });
+    int ret = asyncError;
+    asyncError = 0;
+    return ret;
+}
+
 /*
  * Called by CloseTmpFile. Write data in m_data buffer to file. Call close file rpc.
  */
@@ -129,19 +241,25 @@ int WriteStream::Complete(uint64_t currentSize, bool isFlush, bool isSync)
 {
     std::unique_lock<std::shared_mutex> xlock(mutex);
     if (client != nullptr) {
+        /* writes sent earlier must land before the file is flushed or closed */
+        int asyncRet = WaitAsyncWrites();
+        int ret = 0;
         if (!data.Empty()) {
-            int ret = -ETIMEDOUT;
+            butil::IOBuf iobuf;
+            data.buf.MoveTo(iobuf);
+            ret = -ETIMEDOUT;
             for (int i = 0; i < BRPC_RETRY_NUM && ret == -ETIMEDOUT; ++i) {
-                ret = client->CloseFile(physicalFd, isFlush, isSync, data.buf.c_str(), data.size, data.offset);
+                ret = client->CloseFile(physicalFd, isFlush, isSync, iobuf, data.offset);
                 if (ret == -ETIMEDOUT) {
                     sleep(BRPC_RETRY_DELEY);
                     FALCON_LOG(LOG_ERROR) << "Reach timeout, retry num is " << i;
                 }
             }
             data.Clear();
-            return ret;
+        } else {
+            ret = client->CloseFile(physicalFd, isFlush, isSync, nullptr, 0, 0);
         }
-        return client->CloseFile(physicalFd, isFlush, isSync, nullptr, 0, 0);
+        return asyncRet != 0 ? asyncRet : ret;
     }
 
     return Persist(currentSize);
@@ -219,9 +337,13 @@ int WriteStream::Persist(uint64_t currentSize)
         return -EBADF;
     }
 
+    /* only writes to a remote file are gathered, local ones are written as they come */
     int ret = 0;
     if (!data.Empty()) {
-        ret = PersistToFile(data.buf.c_str(), data.size, data.offset, currentSize);
+        /* the pages go out with the write, the next appends take new ones */
+        butil::IOBuf iobuf;
+        data.buf.MoveTo(iobuf);
+        ret = Async() ? PersistAsync(iobuf, data.offset) : PersistIOBuf(iobuf, data.offset);
     }
     data.Clear();
 
@@ -236,3 +358,12 @@ uint64_t WriteStream::GetSize()
     std::shared_lock<std::shared_mutex> lock(mutex);
     return data.size;
 }
+
+/*
+ * Get size of data sent to the remote file and not yet acknowledged
+ */
+uint64_t WriteStream::GetInflightSize()
+{
+    std::unique_lock<std::mutex> lock(asyncMutex);
+    return inflightBytes;
+}
@@ -25,6 +25,9 @@
 #include "stats/falcon_stats.h"
 #include "connection/falcon_io_client.h"
 #include "buffer/dir_open_instance.h"
+#ifdef ZK_INIT
+#include "cm/falcon_cm.h"
+#endif
 #ifdef WITH_PROMETHEUS
 #include "prometheus/prometheus.h"
 #endif
@@ -430,6 +433,82 @@ DEFINE_string(f, "", "fuse ops, unneeded");
 DEFINE_string(o, "", "fuse ops, unneeded");
 DEFINE_string(d, "", "fuse ops, unneeded");
 DEFINE_string(brpc, "", "optional ops, unneeded");
+DEFINE_uint32(warmup_concurrency, 8, "files warmed up at once");
+DEFINE_uint64(warmup_bandwidth_mb, 0, "MB loaded per second by warmup, 0 for no limit");
+
+/* cli warmup, pin and unpin, every file is handed to the store at rpc_endpoint which routes it to its owner */
+static int RunWarmup(const std::string &command, std::vector<std::string> &paths)
+{
+    CacheAction action = CacheAction::WARMUP;
+    if (command == "pin") {
+        action = CacheAction::PIN;
+    } else if (command == "unpin") {
+        action = CacheAction::UNPIN;
+    }
+    if (paths.empty()) {
+        std::cerr << "usage: " << command << " <path>... [-rpc_endpoint=<store>]" << std::endl;
+        return 1;
+    }
+    if (GetInit().Init() != FALCON_SUCCESS) {
+        std::cerr << "Falcon init failed" << std::endl;
+        return 1;
+    }
+    auto &config = GetInit().GetFalconConfig();
+#ifdef ZK_INIT
+    const char *zkEndPoint = std::getenv("zk_endpoint");
+    if (zkEndPoint == nullptr) {
+        std::cerr << "Fetch zk endpoint failed!" << std::endl;
+        return 1;
+    }
+    std::string serverIp;
+    int port = 0;
+    int ret = FalconCM::GetInstance(zkEndPoint, 10000, "/falcon")->FetchCoordinatorInfo(serverIp, port);
+    if (ret == FALCON_SUCCESS) {
+        ret = FalconInitMeta(serverIp, port);
+    }
+#else
+    std::string serverIp = config->GetString(FalconPropertyKey::FALCON_SERVER_IP);
+    std::string serverPort = config->GetString(FalconPropertyKey::FALCON_SERVER_PORT);
+    int ret = FalconInitMeta(serverIp, std::stoi(serverPort));
+#endif
+    if (ret != FALCON_SUCCESS) {
+        std::cerr << "Falcon cluster init failed" << std::endl;
+        return 1;
+    }
+
+    auto channel = std::make_shared<brpc::Channel>();
+    brpc::ChannelOptions options;
+    if (channel->Init(FLAGS_rpc_endpoint.c_str(), &options) != 0) {
+        std::cerr << "Falied to initialize channel" << std::endl;
+        return 1;
+    }
+    auto client = std::make_shared<FalconIOClient>(channel);
+    FalconWarmupOptions warmupOptions;
+    warmupOptions.action = action;
+    warmupOptions.concurrency = FLAGS_warmup_concurrency;
+    warmupOptions.bytesPerSecond = FLAGS_warmup_bandwidth_mb * 1024 * 1024;
+    warmupOptions.send = [client](uint64_t inodeId, const std::string &path, uint64_t size, CacheAction fileAction) {
+        return client->WarmupFile(inodeId, path, size, (int)fileAction, true);
+    };
+    warmupOptions.progress = [&command](const FalconWarmupProgress &progress) {
+        printf("\r%s: %lu/%lu files, %lu/%lu MB, %lu failed",
+               command.c_str(),
+               progress.doneFiles,
+               progress.files,
+               progress.doneBytes >> 20,
+               progress.bytes >> 20,
+               progress.failedFiles);
+        fflush(stdout);
+    };
+    FalconWarmupProgress progress;
+    ret = FalconWarmup(paths, warmupOptions, &progress);
+    printf("\n");
+    if (ret != 0) {
+        std::cerr << command << " failed: " << strerror(ret > 0 ? ErrorCodeToErrno(ret) : -ret) << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -492,6 +571,14 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    /* cli warmup */
+    if (strcmp(argv[1], "warmup") == 0 || strcmp(argv[1], "pin") == 0 || strcmp(argv[1], "unpin") == 0) {
+        std::string command = argv[1];
+        gflags::ParseCommandLineFlags(&argc, &argv, true);
+        std::vector<std::string> paths(argv + 2, argv + argc);
+        return RunWarmup(command, paths);
+    }
+
     gflags::ParseCommandLineFlags(&argc, &argv, false);
 
     falcon::brpc_io::RemoteIOServer &server = falcon::brpc_io::RemoteIOServer::GetInstance();
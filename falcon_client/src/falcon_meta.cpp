@@ -10,6 +10,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <mutex>
+#include <random>
+#include <thread>
 #include <unordered_map>
 
 #include <sys/stat.h>
@@ -20,10 +22,12 @@
 #include "falcon_store/falcon_store.h"
 #include "inner_falcon_meta.h"
 #include "router.h"
+#include "util/rate_limiter.h"
 #include "utils.h"
 
 constexpr int FILE_NUMBER_PER_EPOCH = 1048576;
 constexpr int FILE_NUMBER_PER_WORKER = 4096;
+constexpr uint32_t PREFETCH_STAT_CONCURRENCY = 16;
 
 std::shared_ptr<Router> router;
 
@@ -38,6 +42,17 @@ int FalconInit(std::string &coordinatorIp, int coordinatorPort)
     return 0;
 }
 
+int FalconInitMeta(std::string &coordinatorIp, int coordinatorPort)
+{
+    try {
+        router = std::make_shared<Router>(ServerIdentifier(coordinatorIp, coordinatorPort));
+    } catch (const std::exception &e) {
+        FALCON_LOG(LOG_ERROR) << "FalconInitMeta failed: " << e.what();
+        return SERVER_FAULT;
+    }
+    return 0;
+}
+
 int FalconInitWithZK(std::string zkEndPoint, const std::string &zkPath)
 {
     int ret = FalconCM::GetInstance(zkEndPoint, 10000, zkPath)->GetInitStatus();
@@ -728,3 +743,184 @@ int FalconTruncate(const std::string &path, off_t size)
 
     return ret;
 }
+
+struct WarmupEntry
+{
+    std::string path;
+    uint64_t inodeId;
+    uint64_t size;
+};
+
+/* add the regular file path, or the ones under directory path, to entries */
+static int CollectWarmupFiles(const std::string &path, std::vector<WarmupEntry> &entries)
+{
+    struct stat st;
+    int ret = FalconGetStat(path, &st);
+    if (ret != SUCCESS) {
+        return ret;
+    }
+    if (S_ISREG(st.st_mode)) {
+        entries.push_back({path, (uint64_t)st.st_ino, (uint64_t)st.st_size});
+        return SUCCESS;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return SUCCESS;
+    }
+
+    FalconFuseInfo fi{};
+    ret = FalconOpenDir(path, &fi);
+    if (ret != SUCCESS) {
+        return ret;
+    }
+    std::vector<std::string> names;
+    auto filler = [](void *buf, const char *name, const struct stat * /*stbuf*/, off_t /*offset*/) -> int {
+        static_cast<std::vector<std::string> *>(buf)->emplace_back(name);
+        return 0;
+    };
+    /* every call returns the next batch of entries until none are left */
+    size_t offset = 0;
+    while (true) {
+        ret = FalconReadDir(path, &names, filler, offset, &fi);
+        if (ret != SUCCESS || names.size() == offset) {
+            break;
+        }
+        offset = names.size();
+    }
+    FalconCloseDir(fi.fh);
+    if (ret != SUCCESS) {
+        return ret;
+    }
+
+    std::string prefix = path.back() == '/' ? path : path + "/";
+    for (const std::string &name : names) {
+        if (name == "." || name == "..") {
+            continue;
+        }
+        int err = CollectWarmupFiles(prefix + name, entries);
+        if (err != SUCCESS) {
+            FALCON_LOG(LOG_WARNING) << "FalconWarmup: skip " << prefix + name << ", error code: " << err;
+            ret = ret == SUCCESS ? err : ret;
+        }
+    }
+    return ret;
+}
+
+/* call fn with every index below count from up to concurrency threads */
+static void ParallelFor(size_t count, uint32_t concurrency, const std::function<void(size_t)> &fn)
+{
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+    size_t threadNum = std::min<size_t>(std::max<uint32_t>(concurrency, 1), count);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < threadNum; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+int FalconWarmup(const std::vector<std::string> &paths,
+                 const FalconWarmupOptions &options,
+                 FalconWarmupProgress *progress)
+{
+    std::vector<WarmupEntry> entries;
+    int ret = SUCCESS;
+    for (const std::string &path : paths) {
+        int err = CollectWarmupFiles(path, entries);
+        if (err != SUCCESS) {
+            FALCON_LOG(LOG_ERROR) << "FalconWarmup failed to list " << path << ", error code: " << err;
+            ret = ret == SUCCESS ? err : ret;
+        }
+    }
+
+    FalconWarmupProgress state;
+    state.files = entries.size();
+    for (const WarmupEntry &entry : entries) {
+        state.bytes += entry.size;
+    }
+    auto send = options.send ? options.send : InnerFalconWarmupFile;
+    /* nothing is loaded to unpin a file. Files are paced as a whole before they are sent */
+    RateLimiter limiter(options.action == CacheAction::UNPIN ? 0 : options.bytesPerSecond);
+    std::mutex mutex;
+    ParallelFor(entries.size(), options.concurrency, [&](size_t i) {
+        const WarmupEntry &entry = entries[i];
+        limiter.Acquire(entry.size);
+        int err = send(entry.inodeId, entry.path, entry.size, options.action);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (err != 0) {
+            FALCON_LOG(LOG_ERROR) << "FalconWarmup failed for path: " << entry.path << ", error code: " << err;
+            state.failedFiles++;
+            ret = ret == SUCCESS ? err : ret;
+        } else {
+            state.doneFiles++;
+            state.doneBytes += entry.size;
+        }
+        if (options.progress) {
+            options.progress(state);
+        }
+    });
+    if (progress != nullptr) {
+        *progress = state;
+    }
+    return ret;
+}
+
+int FalconRegisterPrefetch(std::vector<std::string> &paths, uint64_t seed, uint32_t distance, uint64_t &streamId)
+{
+    streamId = 0;
+    if (seed != 0) {
+        std::mt19937_64 engine(seed);
+        std::shuffle(paths.begin(), paths.end(), engine);
+    }
+    std::vector<PrefetchEntry> order(paths.size());
+    ParallelFor(paths.size(), PREFETCH_STAT_CONCURRENCY, [&](size_t i) {
+        struct stat st;
+        if (FalconGetStat(paths[i], &st) == SUCCESS && S_ISREG(st.st_mode)) {
+            order[i] = {(uint64_t)st.st_ino, paths[i], (uint64_t)st.st_size};
+        }
+    });
+    /* files that could not be looked up are read without prefetching */
+    std::erase_if(order, [](const PrefetchEntry &entry) { return entry.inodeId == 0; });
+    streamId = InnerFalconRegisterPrefetch(std::move(order), distance);
+    return streamId == 0 ? -ENOTSUP : SUCCESS;
+}
+
+int FalconUnregisterPrefetch(uint64_t streamId)
+{
+    InnerFalconUnregisterPrefetch(streamId);
+    return SUCCESS;
+}
+
+int FalconKvPut(const std::vector<std::string> &keys,
+                const std::vector<const char *> &blocks,
+                const std::vector<uint64_t> &sizes,
+                uint32_t ttlSeconds,
+                bool near,
+                std::vector<int64_t> &results)
+{
+    return InnerFalconKvPut(keys, blocks, sizes, ttlSeconds, near, results);
+}
+
+int FalconKvGet(const std::vector<std::string> &keys,
+                const std::vector<char *> &blocks,
+                uint64_t bufSize,
+                bool near,
+                std::vector<int64_t> &results)
+{
+    return InnerFalconKvGet(keys, blocks, bufSize, near, results);
+}
+
+int FalconKvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    return InnerFalconKvExists(keys, near, results);
+}
+
+int FalconKvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    return InnerFalconKvDelete(keys, near, results);
+}
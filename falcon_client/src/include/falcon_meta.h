@@ -5,8 +5,12 @@
 #pragma once
 
 #include <stdint.h>
+#include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "falcon_store/falcon_store.h"
 #include "router.h"
 
 extern std::shared_ptr<Router> router;
@@ -38,6 +42,28 @@ struct FalconFuseInfo
 
 using FalconFuseFiller = int (*)(void *, const char *, const struct stat *, off_t);
 
+struct FalconWarmupProgress
+{
+    uint64_t files = 0;
+    uint64_t doneFiles = 0;
+    uint64_t failedFiles = 0;
+    uint64_t bytes = 0;
+    uint64_t doneBytes = 0;
+};
+
+struct FalconWarmupOptions
+{
+    CacheAction action = CacheAction::WARMUP;
+    /* files sent at once */
+    uint32_t concurrency = 8;
+    /* bytes loaded per second over all files, 0 for no limit */
+    uint64_t bytesPerSecond = 0;
+    /* called after every file */
+    std::function<void(const FalconWarmupProgress &)> progress;
+    /* hands a file to the store node that owns it, the store of this process by default */
+    std::function<int(uint64_t inodeId, const std::string &path, uint64_t size, CacheAction action)> send;
+};
+
 int FalconMkdir(const std::string &path);
 
 int FalconCreate(const std::string &path, uint64_t &fd, int oflags, struct stat *stbuf);
@@ -60,6 +86,9 @@ int FalconInitWithZK(std::string zkEndPoint, const std::string &zkPath = "/falco
 
 int FalconInit(std::string &coordinatorIp, int coordinatorPort);
 
+/* metadata only, without a store in this process, e.g. for tools talking to a running store over rpc */
+int FalconInitMeta(std::string &coordinatorIp, int coordinatorPort);
+
 int FalconDestroy();
 
 int FalconRmDir(const std::string &path);
@@ -85,3 +114,36 @@ int FalconChmod(const std::string &path, mode_t mode);
 int FalconTruncate(const std::string &path, off_t size);
 
 int FalconRenamePersist(const std::string &srcName, const std::string &dstName);
+
+/* warm up, pin or unpin the files in paths and under the directories in paths on the nodes that own
+ * them. Files failing do not stop the others, the first error is returned */
+int FalconWarmup(const std::vector<std::string> &paths,
+                 const FalconWarmupOptions &options,
+                 FalconWarmupProgress *progress = nullptr);
+
+/* tell the store the files are about to be read in the order of paths, which is shuffled first if
+ * seed is not 0, so the files are staged ahead of the reads. distance 0 keeps the configured one */
+int FalconRegisterPrefetch(std::vector<std::string> &paths, uint64_t seed, uint32_t distance, uint64_t &streamId);
+
+int FalconUnregisterPrefetch(uint64_t streamId);
+
+/* put, get, look for and drop blocks keyed by opaque ids, e.g. the KV cache an inference engine offloads.
+ * results hold 0 or -errno per key, for FalconKvGet the size of the block read into blocks[i], each of
+ * bufSize bytes. near keeps blocks on the store of this process, only clients of that store find them,
+ * see FalconStore::KvPut */
+int FalconKvPut(const std::vector<std::string> &keys,
+                const std::vector<const char *> &blocks,
+                const std::vector<uint64_t> &sizes,
+                uint32_t ttlSeconds,
+                bool near,
+                std::vector<int64_t> &results);
+
+int FalconKvGet(const std::vector<std::string> &keys,
+                const std::vector<char *> &blocks,
+                uint64_t bufSize,
+                bool near,
+                std::vector<int64_t> &results);
+
+int FalconKvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
+
+int FalconKvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
@@ -9,6 +9,8 @@
 #include <sys/time.h>
 
 #include "buffer/open_instance.h"
+#include "falcon_store/falcon_store.h"
+#include "falcon_store/prefetcher.h"
 
 struct BatchCreatePrams
 {
@@ -32,3 +34,19 @@ int InnerFalconCopydata(const std::string &srcName, const std::string &dstName);
 int InnerFalconDeleteDataAfterRename(const std::string &objectName);
 int InnerFalconTruncateOpenInstance(OpenInstance *openInstance, off_t size);
 int InnerFalconTruncateFile(OpenInstance *openInstance, off_t size);
+int InnerFalconWarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, CacheAction action);
+uint64_t InnerFalconRegisterPrefetch(std::vector<PrefetchEntry> order, uint32_t distance);
+void InnerFalconUnregisterPrefetch(uint64_t streamId);
+int InnerFalconKvPut(const std::vector<std::string> &keys,
+                     const std::vector<const char *> &blocks,
+                     const std::vector<uint64_t> &sizes,
+                     uint32_t ttlSeconds,
+                     bool near,
+                     std::vector<int64_t> &results);
+int InnerFalconKvGet(const std::vector<std::string> &keys,
+                     const std::vector<char *> &blocks,
+                     uint64_t bufSize,
+                     bool near,
+                     std::vector<int64_t> &results);
+int InnerFalconKvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
+int InnerFalconKvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
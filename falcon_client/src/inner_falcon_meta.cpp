@@ -52,6 +52,47 @@ int InnerFalconTruncateFile(OpenInstance *openInstance, off_t size)
     return FalconStore::GetInstance()->TruncateFile(openInstance, size);
 }
 
+int InnerFalconWarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, CacheAction action)
+{
+    return FalconStore::GetInstance()->WarmupFile(inodeId, path, size, action, true);
+}
+
+uint64_t InnerFalconRegisterPrefetch(std::vector<PrefetchEntry> order, uint32_t distance)
+{
+    return Prefetcher::GetInstance().Register(std::move(order), distance);
+}
+
+void InnerFalconUnregisterPrefetch(uint64_t streamId) { Prefetcher::GetInstance().Unregister(streamId); }
+
+int InnerFalconKvPut(const std::vector<std::string> &keys,
+                     const std::vector<const char *> &blocks,
+                     const std::vector<uint64_t> &sizes,
+                     uint32_t ttlSeconds,
+                     bool near,
+                     std::vector<int64_t> &results)
+{
+    return FalconStore::GetInstance()->KvPut(keys, blocks, sizes, ttlSeconds, near, results);
+}
+
+int InnerFalconKvGet(const std::vector<std::string> &keys,
+                     const std::vector<char *> &blocks,
+                     uint64_t bufSize,
+                     bool near,
+                     std::vector<int64_t> &results)
+{
+    return FalconStore::GetInstance()->KvGet(keys, blocks, bufSize, near, results);
+}
+
+int InnerFalconKvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    return FalconStore::GetInstance()->KvExists(keys, near, results);
+}
+
+int InnerFalconKvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    return FalconStore::GetInstance()->KvDelete(keys, near, results);
+}
+
 int InnerFalconUnlink(uint64_t inodeId, int nodeId, std::string path)
 {
     return FalconStore::GetInstance()->DeleteFiles(inodeId, nodeId, path);
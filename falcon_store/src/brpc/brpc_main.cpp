@@ -6,23 +6,51 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <functional>
 #include <iostream>
 
 #include <brpc/server.h>
+#include <brpc/stream.h>
+#include <bthread/bthread.h>
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
 #include <bthread/unstable.h>
 #include <butil/iobuf.h>
 #include <memory_resource>
 
 #include "buffer/dir_open_instance.h"
+#include "buffer/mem_pool.h"
 #include "buffer/open_instance.h"
+#include "connection/falcon_io_client.h"
 #include "connection/node.h"
+#include "falcon_store/erasure_coder.h"
 #include "falcon_store/falcon_store.h"
+#include "falcon_store/kv_store.h"
+#include "falcon_store/rebalancer.h"
 #include "log/logging.h"
 #include "util/utils.h"
 
 namespace falcon::brpc_io
 {
-constexpr size_t ALIGNMENT = 512;
+/*
+ * Buffer a cache file read lands in. It is handed to the response as user data, so the data is
+ * never staged through a second buffer. Reads up to a block take a MemPool block, which is
+ * aligned for O_DIRECT and registered with io_uring; larger reads take heap memory.
+ */
+static char *AllocReadBuffer(size_t readSize, bool direct, size_t &allocSize, std::function<void(void *)> &deleter)
+{
+    allocSize = direct ? (readSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT : readSize;
+    MemPool &memPool = MemPool::GetInstance();
+    if (allocSize <= memPool.blockSize()) {
+        char *buffer = static_cast<char *>(memPool.alloc());
+        if (buffer != nullptr) {
+            deleter = [](void *buf) { MemPool::GetInstance().free(buf); };
+            return buffer;
+        }
+    }
+    deleter = [](void *buf) { free(buf); };
+    return static_cast<char *>(direct ? aligned_alloc(ALIGNMENT, allocSize) : malloc(allocSize));
+}
 
 void RemoteIOServiceImpl::OpenFile(google::protobuf::RpcController * /*cntl_base*/,
                                    const OpenRequest *request,
@@ -36,6 +64,7 @@ void RemoteIOServiceImpl::OpenFile(google::protobuf::RpcController * /*cntl_base
     int oflags = request->oflags();
     const std::string &path = request->path();
     bool nodeFail = request->node_fail();
+    bool cacheOnly = request->cache_only();
     FALCON_LOG(LOG_INFO) << "Receive OpenFile rpc request, path = " << path << ", file size = " << size;
 
     std::shared_ptr<OpenInstance> openInstance = FalconFd::GetInstance()->WaitGetNewOpenInstance(false);
@@ -56,6 +85,7 @@ void RemoteIOServiceImpl::OpenFile(google::protobuf::RpcController * /*cntl_base
     openInstance->nodeId = StoreNode::GetInstance()->GetNodeId();
     openInstance->isRemoteCall = true;
     openInstance->nodeFail = nodeFail;
+    openInstance->cacheOnly = cacheOnly;
 
     int ret = FalconStore::GetInstance()->OpenFile(openInstance.get());
     if (ret != 0) {
@@ -155,14 +185,9 @@ void RemoteIOServiceImpl::ReadFile(google::protobuf::RpcController *cntl_base,
         return;
     }
 
-    char *buffer;
-    size_t allocSize = readSize;
-    if (openInstance->oflags & __O_DIRECT) {
-        allocSize = (readSize / ALIGNMENT + (readSize % ALIGNMENT != 0)) * ALIGNMENT;
-        buffer = static_cast<char *>(aligned_alloc(ALIGNMENT, allocSize));
-    } else {
-        buffer = static_cast<char *>(malloc(allocSize));
-    }
+    size_t allocSize = 0;
+    std::function<void(void *)> deleter;
+    char *buffer = AllocReadBuffer(readSize, openInstance->oflags & __O_DIRECT, allocSize, deleter);
     if (buffer == nullptr) {
         FALCON_LOG(LOG_ERROR) << "Allocation failed for size " << allocSize;
         response->set_error_code(-ENOMEM);
@@ -171,7 +196,7 @@ void RemoteIOServiceImpl::ReadFile(google::protobuf::RpcController *cntl_base,
 
     int retSize = FalconStore::GetInstance()->ReadFileLR(buffer, offset, openInstance.get(), allocSize);
     if (retSize < 0) {
-        free(buffer);
+        deleter(buffer);
         FALCON_LOG(LOG_ERROR) << "ReadFile rpc failed, fd = " << fd << ", error = " << retSize;
         response->set_error_code(retSize);
         return;
@@ -180,9 +205,9 @@ void RemoteIOServiceImpl::ReadFile(google::protobuf::RpcController *cntl_base,
     response->set_error_code(0);
 #ifdef USE_RDMA
     cntl->response_attachment().append(buffer, retSize);
-    free(buffer);
+    deleter(buffer);
 #else
-    cntl->response_attachment().append_user_data(buffer, retSize, [](void *buf) { free(buf); });
+    cntl->response_attachment().append_user_data(buffer, retSize, deleter);
 #endif
 }
 
@@ -199,6 +224,7 @@ void RemoteIOServiceImpl::ReadSmallFile(google::protobuf::RpcController *cntl_ba
     const std::string &path = request->path();
     int32_t oflags = request->oflags();
     bool nodeFail = request->node_fail();
+    bool cacheOnly = request->cache_only();
     FALCON_LOG(LOG_INFO) << "Receive ReadSmallFile rpc request, inode = " << inodeId << ", size = " << readSize;
 
     if (readSize < 0 || readSize > (int)READ_BIGFILE_SIZE) {
@@ -230,7 +256,8 @@ void RemoteIOServiceImpl::ReadSmallFile(google::protobuf::RpcController *cntl_ba
         return;
     }
 
-    int ret = FalconStore::GetInstance()->ReadSmallFilesForBrpc(inodeId, path, buffer, readSize, oflags, nodeFail);
+    int ret =
+        FalconStore::GetInstance()->ReadSmallFilesForBrpc(inodeId, path, buffer, readSize, oflags, nodeFail, cacheOnly);
     if (ret < 0) {
         FALCON_LOG(LOG_ERROR) << "ReadSmallFile rpc failed, inodeId = " << inodeId << ", error = " << ret;
         response->set_error_code(ret);
@@ -250,6 +277,205 @@ void RemoteIOServiceImpl::ReadSmallFile(google::protobuf::RpcController *cntl_ba
 #endif
 }
 
+/*
+ * Server side of a StreamRead. Pushes the requested range block by block, each message is a
+ * StreamReadHeader followed by the block data. The reader returns uint32 credit messages, one
+ * credit lets one more block out, so the in-flight data is bounded by the reader's readahead window.
+ * Owned jointly by the push bthread and the stream, freed when both are done.
+ */
+class ReadStreamSender : public brpc::StreamInputHandler {
+  public:
+    ReadStreamSender(std::shared_ptr<OpenInstance> openInstance,
+                     uint64_t offset,
+                     uint64_t size,
+                     uint32_t blockSize,
+                     uint32_t credits)
+        : openInstance(std::move(openInstance)),
+          offset(offset),
+          end(offset + size),
+          blockSize(blockSize),
+          credits(credits)
+    {
+    }
+
+    static void *RunThread(void *arg)
+    {
+        static_cast<ReadStreamSender *>(arg)->Run();
+        return nullptr;
+    }
+
+    void Run()
+    {
+        bool direct = openInstance->oflags & __O_DIRECT;
+        while (true) {
+            {
+                std::unique_lock<bthread::Mutex> lock(mutex);
+                while (credits == 0 && !closed) {
+                    cv.wait(lock);
+                }
+                if (closed) {
+                    break;
+                }
+                --credits;
+            }
+
+            size_t allocSize = 0;
+            std::function<void(void *)> deleter;
+            char *buffer = AllocReadBuffer(blockSize, direct, allocSize, deleter);
+            StreamReadHeader header{.offset = offset, .result = -ENOMEM};
+            if (buffer != nullptr) {
+                std::shared_lock<std::shared_mutex> closeLock(openInstance->closeMutex);
+                if (openInstance->isClosed) {
+                    header.result = -ETIMEDOUT;
+                } else if (offset >= end) {
+                    /* range read in whole blocks, an empty block marks the end */
+                    header.result = 0;
+                } else {
+                    header.result = FalconStore::GetInstance()->ReadFileLR(buffer, offset, openInstance.get(),
+                                                                           allocSize);
+                    header.result = std::min<int64_t>(header.result, blockSize);
+                }
+            }
+
+            butil::IOBuf msg;
+            msg.append(&header, sizeof(header));
+            if (header.result > 0) {
+#ifdef USE_RDMA
+                msg.append(buffer, header.result);
+                deleter(buffer);
+#else
+                msg.append_user_data(buffer, header.result, deleter);
+#endif
+            } else if (buffer != nullptr) {
+                deleter(buffer);
+            }
+            if (!Write(msg) || header.result != (int64_t)blockSize) {
+                /* error, eof or a short block: the reader stops at this block */
+                break;
+            }
+            offset += blockSize;
+        }
+        brpc::StreamClose(streamId);
+        Unref();
+    }
+
+    int on_received_messages(brpc::StreamId /*id*/, butil::IOBuf *const messages[], size_t size) override
+    {
+        uint32_t granted = 0;
+        for (size_t i = 0; i < size; ++i) {
+            uint32_t credit = 0;
+            while (messages[i]->cutn(&credit, sizeof(credit)) == sizeof(credit)) {
+                granted += credit;
+            }
+        }
+        std::lock_guard<bthread::Mutex> lock(mutex);
+        credits += granted;
+        cv.notify_one();
+        return 0;
+    }
+
+    void on_idle_timeout(brpc::StreamId /*id*/) override {}
+
+    void on_closed(brpc::StreamId /*id*/) override
+    {
+        {
+            std::lock_guard<bthread::Mutex> lock(mutex);
+            closed = true;
+            cv.notify_one();
+        }
+        Unref();
+    }
+
+    void Unref()
+    {
+        if (refs.fetch_sub(1) == 1) {
+            delete this;
+        }
+    }
+
+    brpc::StreamId streamId = brpc::INVALID_STREAM_ID;
+
+  private:
+    bool Write(butil::IOBuf &msg)
+    {
+        while (true) {
+            int ret = brpc::StreamWrite(streamId, msg);
+            if (ret == 0) {
+                return true;
+            }
+            if (ret != EAGAIN || brpc::StreamWait(streamId, nullptr) != 0) {
+                FALCON_LOG(LOG_ERROR) << "ReadStreamSender: stream write failed: " << strerror(ret);
+                return false;
+            }
+        }
+    }
+
+    std::shared_ptr<OpenInstance> openInstance;
+    uint64_t offset;
+    uint64_t end;
+    uint32_t blockSize;
+    uint32_t credits;
+    bool closed = false;
+    bthread::Mutex mutex;
+    bthread::ConditionVariable cv;
+    std::atomic<int> refs{2};
+};
+
+void RemoteIOServiceImpl::StreamRead(google::protobuf::RpcController *cntl_base,
+                                     const StreamReadRequest *request,
+                                     ErrorCodeOnlyReply *response,
+                                     google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    uint64_t fd = request->physical_fd();
+    uint64_t offset = request->offset();
+    uint64_t size = request->size();
+    int blockSize = request->block_size();
+    int credits = request->credits();
+    FALCON_LOG(LOG_INFO) << "Receive StreamRead rpc request, fd = " << fd << ", offset = " << offset
+                         << ", size = " << size << ", block size = " << blockSize;
+
+    if (blockSize <= 0 || credits <= 0) {
+        response->set_error_code(-EINVAL);
+        return;
+    }
+
+    std::shared_ptr<OpenInstance> openInstance = FalconFd::GetInstance()->GetOpenInstanceByFd(fd);
+    if (openInstance == nullptr) {
+        FALCON_LOG(LOG_ERROR) << "StreamRead(): impossibly, fd " << fd << " not found";
+        response->set_error_code(-EBADF);
+        return;
+    }
+    {
+        std::shared_lock<std::shared_mutex> closeLock(openInstance->closeMutex);
+        if (openInstance->isClosed) {
+            response->set_error_code(-ETIMEDOUT);
+            return;
+        }
+    }
+
+    auto *sender = new ReadStreamSender(openInstance, offset, size, blockSize, credits);
+    brpc::StreamOptions options;
+    options.handler = sender;
+    options.max_buf_size = 0;
+    if (brpc::StreamAccept(&sender->streamId, *cntl, &options) != 0) {
+        FALCON_LOG(LOG_ERROR) << "StreamRead(): accept stream failed";
+        delete sender;
+        response->set_error_code(-EIO);
+        return;
+    }
+
+    /* the stream is usable once the response is out, push from a separate bthread */
+    response->set_error_code(0);
+    doneGuard.release()->Run();
+    bthread_t tid;
+    if (bthread_start_background(&tid, nullptr, ReadStreamSender::RunThread, sender) != 0) {
+        sender->Run();
+    }
+}
+
 void RemoteIOServiceImpl::WriteFile(google::protobuf::RpcController *cntl_base,
                                     const WriteRequest *request,
                                     WriteReply *response,
@@ -416,6 +642,228 @@ void RemoteIOServiceImpl::StatCluster(google::protobuf::RpcController *cntl_base
     response->set_error_code(ret);
 }
 
+void RemoteIOServiceImpl::MigrateFile(google::protobuf::RpcController *cntl_base,
+                                      const MigrateFileRequest *request,
+                                      ErrorCodeOnlyReply *response,
+                                      google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    uint64_t inodeId = request->inode_id();
+    off_t offset = request->offset();
+    FALCON_LOG(LOG_INFO) << "Receive MigrateFile rpc request, inode = " << inodeId << ", offset = " << offset;
+
+    int ret = FalconStore::GetInstance()->ReceiveMigratedFile(inodeId,
+                                                              request->placement_key(),
+                                                              request->has_key(),
+                                                              offset,
+                                                              request->total_size(),
+                                                              request->last(),
+                                                              request->replica(),
+                                                              request->has_crc(),
+                                                              request->crc(),
+                                                              request->fingerprint(),
+                                                              request->patch(),
+                                                              request->base_fingerprint(),
+                                                              cntl->request_attachment());
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::DropCache(google::protobuf::RpcController * /*cntl_base*/,
+                                    const DropCacheRequest *request,
+                                    ErrorCodeOnlyReply *response,
+                                    google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+
+    uint64_t inodeId = request->inode_id();
+    FALCON_LOG(LOG_INFO) << "Receive DropCache rpc request, inode = " << inodeId;
+
+    int ret = FalconStore::GetInstance()->DropCachedFile(inodeId);
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::LocateCache(google::protobuf::RpcController * /*cntl_base*/,
+                                      const LocateCacheRequest *request,
+                                      ErrorCodeOnlyReply *response,
+                                      google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+
+    int ret = FalconStore::GetInstance()->LocateCachedFile(request->inode_id(), request->size(),
+                                                           request->check_fingerprint(), request->fingerprint());
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::WarmupFile(google::protobuf::RpcController * /*cntl_base*/,
+                                     const WarmupFileRequest *request,
+                                     ErrorCodeOnlyReply *response,
+                                     google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+
+    FALCON_LOG(LOG_INFO) << "Receive WarmupFile rpc request, inode = " << request->inode_id()
+                         << ", action = " << request->action();
+    if (request->action() < (int)CacheAction::WARMUP || request->action() > (int)CacheAction::PREFETCH) {
+        response->set_error_code(-EINVAL);
+        return;
+    }
+    int ret = FalconStore::GetInstance()->WarmupFile(request->inode_id(),
+                                                     request->path(),
+                                                     request->size(),
+                                                     (CacheAction)request->action(),
+                                                     request->route());
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::PutShard(google::protobuf::RpcController *cntl_base,
+                                   const PutShardRequest *request,
+                                   ErrorCodeOnlyReply *response,
+                                   google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    ShardInfo info;
+    info.index = request->index();
+    info.dataShards = request->data_shards();
+    info.parityShards = request->parity_shards();
+    info.owner = request->owner();
+    info.fileSize = request->file_size();
+    info.version = request->version();
+    if (info.dataShards == 0 || info.index >= info.dataShards + info.parityShards) {
+        response->set_error_code(-EINVAL);
+        return;
+    }
+    int ret = ErasureCoder::GetInstance().ReceiveShard(request->inode_id(),
+                                                       info,
+                                                       request->offset(),
+                                                       request->last(),
+                                                       request->crc(),
+                                                       cntl->request_attachment());
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::ReadShard(google::protobuf::RpcController *cntl_base,
+                                    const ReadShardRequest *request,
+                                    ReadShardReply *response,
+                                    google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    ShardInfo info;
+    butil::IOBuf &data = cntl->response_attachment();
+    int ret =
+        ErasureCoder::GetInstance().ReadShard(request->inode_id(), request->offset(), request->size(), info, data);
+    response->set_error_code(ret);
+    if (ret != 0) {
+        data.clear();
+        return;
+    }
+    response->set_index(info.index);
+    response->set_data_shards(info.dataShards);
+    response->set_parity_shards(info.parityShards);
+    response->set_owner(info.owner);
+    response->set_file_size(info.fileSize);
+    response->set_version(info.version);
+    response->set_crc(IOBufCrc32c(data));
+}
+
+void RemoteIOServiceImpl::DropShard(google::protobuf::RpcController * /*cntl_base*/,
+                                    const DropCacheRequest *request,
+                                    ErrorCodeOnlyReply *response,
+                                    google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    response->set_error_code(ErasureCoder::GetInstance().DropShard(request->inode_id()));
+}
+
+void RemoteIOServiceImpl::KvPut(google::protobuf::RpcController *cntl_base,
+                                const KvPutRequest *request,
+                                KvReply *response,
+                                google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    butil::IOBuf &data = cntl->request_attachment();
+    if (request->sizes_size() != request->keys_size()) {
+        response->set_error_code(-EINVAL);
+        return;
+    }
+    int ret = 0;
+    for (int i = 0; i < request->keys_size(); ++i) {
+        uint64_t size = request->sizes(i);
+        if (size > data.size()) {
+            response->set_error_code(-EINVAL);
+            return;
+        }
+        std::string block;
+        data.cutn(&block, size);
+        int result = KvStore::GetInstance().Put(request->keys(i), std::move(block), request->ttl_s());
+        response->add_results(result);
+        ret = ret == 0 ? result : ret;
+    }
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::KvGet(google::protobuf::RpcController *cntl_base,
+                                const KvKeysRequest *request,
+                                KvReply *response,
+                                google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+    auto *cntl = static_cast<brpc::Controller *>(cntl_base);
+
+    int ret = 0;
+    for (const std::string &key : request->keys()) {
+        std::shared_ptr<const std::string> block;
+        int result = KvStore::GetInstance().Get(key, block);
+        if (result == 0) {
+            cntl->response_attachment().append(block->data(), block->size());
+            response->add_results(block->size());
+        } else {
+            response->add_results(result);
+            ret = ret == 0 ? result : ret;
+        }
+    }
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::KvExists(google::protobuf::RpcController * /*cntl_base*/,
+                                   const KvKeysRequest *request,
+                                   KvReply *response,
+                                   google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+
+    int ret = 0;
+    for (const std::string &key : request->keys()) {
+        int result = KvStore::GetInstance().Exists(key) ? 0 : -ENOENT;
+        response->add_results(result);
+        ret = ret == 0 ? result : ret;
+    }
+    response->set_error_code(ret);
+}
+
+void RemoteIOServiceImpl::KvDelete(google::protobuf::RpcController * /*cntl_base*/,
+                                   const KvKeysRequest *request,
+                                   KvReply *response,
+                                   google::protobuf::Closure *done)
+{
+    brpc::ClosureGuard doneGuard(done);
+
+    int ret = 0;
+    for (const std::string &key : request->keys()) {
+        int result = KvStore::GetInstance().Delete(key);
+        response->add_results(result);
+        ret = ret == 0 ? result : ret;
+    }
+    response->set_error_code(ret);
+}
+
 int RemoteIOServer::Run()
 {
     falcon::brpc_io::RemoteIOServiceImpl remoteIOServiceImpl;
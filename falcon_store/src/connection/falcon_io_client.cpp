@@ -4,6 +4,10 @@
 
 #include "connection/falcon_io_client.h"
 
+#include <bthread/bthread.h>
+#include <bthread/unstable.h>
+#include <butil/time.h>
+
 #include "log/logging.h"
 
 static int BrpcErrorCodeToFuseErrno(int brpcErrorCode)
@@ -34,7 +38,8 @@ int FalconIOClient::OpenFile(uint64_t inodeId,
                              uint64_t &physicalFd,
                              uint64_t originalSize,
                              const std::string &path,
-                             bool nodeFail)
+                             bool nodeFail,
+                             bool cacheOnly)
 {
     falcon::brpc_io::OpenRequest request;
     request.set_inode_id(inodeId);
@@ -42,6 +47,7 @@ int FalconIOClient::OpenFile(uint64_t inodeId,
     request.set_path(path);
     request.set_size(originalSize);
     request.set_node_fail(nodeFail);
+    request.set_cache_only(cacheOnly);
     falcon::brpc_io::OpenReply response;
     brpc::Controller cntl;
     cntl.set_timeout_ms(10000);
@@ -69,6 +75,18 @@ int FalconIOClient::CloseFile(uint64_t physicalFd,
                               const char *buf,
                               size_t size,
                               off_t offset)
+{
+    butil::IOBuf data;
+#ifdef USE_RDMA
+    data.append((void *)buf, size);
+#else
+    auto dummyDeleter = [](void *) -> void {};
+    data.append_user_data((void *)buf, size, dummyDeleter);
+#endif
+    return CloseFile(physicalFd, isFlush, isSync, data, offset);
+}
+
+int FalconIOClient::CloseFile(uint64_t physicalFd, bool isFlush, bool isSync, const butil::IOBuf &data, off_t offset)
 {
     falcon::brpc_io::CloseRequest request;
     request.set_physical_fd(physicalFd);
@@ -79,12 +97,7 @@ int FalconIOClient::CloseFile(uint64_t physicalFd,
     falcon::brpc_io::ErrorCodeOnlyReply response;
     brpc::Controller cntl;
     cntl.set_timeout_ms(10000);
-#ifdef USE_RDMA
-    cntl.request_attachment().append((void *)buf, size);
-#else
-    auto dummyDeleter = [](void *) -> void {};
-    cntl.request_attachment().append_user_data((void *)buf, size, dummyDeleter);
-#endif
+    cntl.request_attachment() = data;
 
     stub->CloseFile(&cntl, &request, &response, nullptr);
     if (cntl.Failed()) {
@@ -102,13 +115,18 @@ int FalconIOClient::CloseFile(uint64_t physicalFd,
 }
 
 // return positive: read length, return negative error of both network and IO
+/*
+ * The response attachment is cut straight into readBuffer. If data is given the attachment is
+ * moved there instead and readBuffer is left untouched, for callers that copy it out later.
+ */
 int FalconIOClient::ReadFile(uint64_t /*inodeId*/,
                              int /*oflags*/,
                              char *readBuffer,
                              uint64_t &physicalFd,
                              int bufferSize,
                              off_t offset,
-                             const std::string &path)
+                             const std::string &path,
+                             butil::IOBuf *data)
 {
     // have to open file before call this method
     falcon::brpc_io::ReadRequest request;
@@ -137,7 +155,14 @@ int FalconIOClient::ReadFile(uint64_t /*inodeId*/,
         return -EIO;
     }
 
-    cntl.response_attachment().cutn(readBuffer, retLen);
+    FalconStats::GetInstance().stats[REMOTE_READ] += retLen;
+    if (data != nullptr) {
+        data->clear();
+        data->swap(cntl.response_attachment());
+    } else {
+        cntl.response_attachment().cutn(readBuffer, retLen);
+        FalconStats::GetInstance().stats[REMOTE_READ_COPY] += retLen;
+    }
     FALCON_LOG(LOG_INFO) << "In FalconIOClient::ReadFile(): read file successfully! you have read: " << retLen
                          << " bytes";
     return retLen;
@@ -149,7 +174,8 @@ ssize_t FalconIOClient::ReadSmallFile(uint64_t inodeId,
                                       std::string &path,
                                       char *readBuffer,
                                       int oflags,
-                                      bool nodeFail)
+                                      bool nodeFail,
+                                      bool cacheOnly)
 {
     falcon::brpc_io::ReadSmallFileRequest request;
     request.set_inode_id(inodeId);
@@ -157,6 +183,7 @@ ssize_t FalconIOClient::ReadSmallFile(uint64_t inodeId,
     request.set_path(path);
     request.set_oflags(oflags);
     request.set_node_fail(nodeFail);
+    request.set_cache_only(cacheOnly);
     falcon::brpc_io::ErrorCodeOnlyReply response;
     brpc::Controller cntl;
     cntl.set_timeout_ms(10000);
@@ -187,6 +214,21 @@ ssize_t FalconIOClient::ReadSmallFile(uint64_t inodeId,
 
 // return 0: OK, return negative: error of both network and IO
 int FalconIOClient::WriteFile(uint64_t physicalFd, const char *writeBuffer, uint64_t size, off_t offset)
+{
+    butil::IOBuf data;
+#ifdef USE_RDMA
+    data.append((void *)writeBuffer, size);
+#else
+    auto dummyDeleter = [](void *) -> void {};
+    data.append_user_data((void *)writeBuffer, size, dummyDeleter);
+#endif
+    return WriteFile(physicalFd, data, offset);
+}
+
+/*
+ * The blocks of data are sent as they are, e.g. the pages a WriteStream gathered writes in.
+ */
+int FalconIOClient::WriteFile(uint64_t physicalFd, const butil::IOBuf &data, off_t offset)
 {
     falcon::brpc_io::WriteRequest request;
     request.set_physical_fd(physicalFd);
@@ -194,12 +236,8 @@ int FalconIOClient::WriteFile(uint64_t physicalFd, const char *writeBuffer, uint
     falcon::brpc_io::WriteReply response;
     brpc::Controller cntl;
     cntl.set_timeout_ms(10000);
-#ifdef USE_RDMA
-    cntl.request_attachment().append((void *)writeBuffer, size);
-#else
-    auto dummyDeleter = [](void *) -> void {};
-    cntl.request_attachment().append_user_data((void *)writeBuffer, size, dummyDeleter);
-#endif
+    cntl.request_attachment() = data;
+    uint64_t size = data.size();
 
     stub->WriteFile(&cntl, &request, &response, nullptr);
     if (cntl.Failed()) {
@@ -223,6 +261,140 @@ int FalconIOClient::WriteFile(uint64_t physicalFd, const char *writeBuffer, uint
     return 0;
 }
 
+/*
+ * One WriteFileAsync call. Issued again on timeout, up to BRPC_RETRY_NUM times, like WriteStream
+ * does for synchronous writes.
+ */
+class AsyncWriteCall : public google::protobuf::Closure {
+  public:
+    AsyncWriteCall(falcon::brpc_io::RemoteIOService_Stub *stub,
+                   uint64_t physicalFd,
+                   butil::IOBuf &data,
+                   off_t offset,
+                   FalconIOClient::Done done)
+        : stub(stub),
+          done(std::move(done))
+    {
+        request.set_physical_fd(physicalFd);
+        request.set_offset(offset);
+        this->data.swap(data);
+    }
+
+    void Start()
+    {
+        cntl.Reset();
+        cntl.set_timeout_ms(10000);
+        cntl.request_attachment() = data;
+        response.Clear();
+        stub->WriteFile(&cntl, &request, &response, this);
+    }
+
+    void Run() override
+    {
+        int ret = 0;
+        if (cntl.Failed()) {
+            FALCON_LOG(LOG_ERROR) << "WriteFileAsync by brpc failed " << cntl.ErrorText()
+                                  << "error code: " << cntl.ErrorCode();
+            ret = -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+        } else if (response.error_code() != 0) {
+            FALCON_LOG(LOG_ERROR) << "FalconIOClient::WriteFileAsync failed: " << strerror(-response.error_code());
+            ret = response.error_code();
+        } else if ((size_t)response.write_size() != data.size()) {
+            FALCON_LOG(LOG_ERROR) << "Write size doesn't equal to requested.";
+            ret = -EIO;
+        }
+        if (ret == -ETIMEDOUT && ++retries < BRPC_RETRY_NUM) {
+            FALCON_LOG(LOG_ERROR) << "Reach timeout, retry num is " << retries;
+            /* issued again from a timer, this runs on a brpc worker that must not sleep */
+            bthread_timer_t timer;
+            if (bthread_timer_add(&timer, butil::seconds_from_now(BRPC_RETRY_DELEY), Retry, this) == 0) {
+                return;
+            }
+            FALCON_LOG(LOG_ERROR) << "WriteFileAsync: add retry timer failed";
+        }
+        done(ret);
+        delete this;
+    }
+
+  private:
+    static void Retry(void *arg) { static_cast<AsyncWriteCall *>(arg)->Start(); }
+
+    falcon::brpc_io::RemoteIOService_Stub *stub;
+    falcon::brpc_io::WriteRequest request;
+    falcon::brpc_io::WriteReply response;
+    brpc::Controller cntl;
+    butil::IOBuf data;
+    FalconIOClient::Done done;
+    int retries = 0;
+};
+
+/*
+ * Send data to the remote file without waiting, done is called once the write completes.
+ * data is taken over by the call.
+ */
+void FalconIOClient::WriteFileAsync(uint64_t physicalFd, butil::IOBuf &data, off_t offset, Done done)
+{
+    auto *call = new AsyncWriteCall(stub.get(), physicalFd, data, offset, std::move(done));
+    call->Start();
+}
+
+/*
+ * One ReadSmallFileAsync call. Not retried on timeout, the caller hedges to another replica.
+ */
+class AsyncReadSmallFileCall : public google::protobuf::Closure {
+  public:
+    AsyncReadSmallFileCall(ssize_t size, FalconIOClient::ReadDone done)
+        : size(size),
+          done(std::move(done))
+    {
+    }
+
+    void Run() override
+    {
+        int ret = 0;
+        if (cntl.Failed()) {
+            FALCON_LOG(LOG_ERROR) << "ReadSmallFileAsync by brpc failed " << cntl.ErrorText()
+                                  << "error code: " << cntl.ErrorCode();
+            ret = -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+        } else if (response.error_code() != 0) {
+            ret = response.error_code();
+        } else if ((ssize_t)cntl.response_attachment().size() != size) {
+            FALCON_LOG(LOG_ERROR) << "Return bytes doesn't equal to requested.";
+            ret = -EIO;
+        }
+        done(ret, cntl.response_attachment());
+        delete this;
+    }
+
+    falcon::brpc_io::ReadSmallFileRequest request;
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+
+  private:
+    ssize_t size;
+    FalconIOClient::ReadDone done;
+};
+
+/*
+ * ReadSmallFile without waiting, done is called with 0 and the file content, or -errno.
+ */
+void FalconIOClient::ReadSmallFileAsync(uint64_t inodeId,
+                                        ssize_t size,
+                                        const std::string &path,
+                                        int oflags,
+                                        bool cacheOnly,
+                                        ReadDone done)
+{
+    auto *call = new AsyncReadSmallFileCall(size, std::move(done));
+    call->request.set_inode_id(inodeId);
+    call->request.set_read_size(size);
+    call->request.set_path(path);
+    call->request.set_oflags(oflags);
+    call->request.set_cache_only(cacheOnly);
+    call->cntl.set_timeout_ms(10000);
+    stub->ReadSmallFile(&call->cntl, &call->request, &call->response, call);
+}
+
 // return 0: OK, return negative: error of both network and IO
 int FalconIOClient::DeleteFile(uint64_t inodeId, int nodeId, std::string &path)
 {
@@ -378,4 +550,436 @@ int FalconIOClient::StatCluster(int nodeId, std::vector<size_t> &stats, bool sca
     stats.assign(response.stats().begin(), response.stats().end());
 
     return 0;
-}
\ No newline at end of file
+}
+/*
+ * Ask the owner node to push [offset, offset + size) back-to-back as blocks of blockSize on a
+ * brpc stream. At most credits blocks are pushed before the reader grants more.
+ */
+int FalconIOClient::OpenReadStream(uint64_t physicalFd,
+                                   off_t offset,
+                                   uint64_t size,
+                                   uint32_t blockSize,
+                                   uint32_t credits,
+                                   brpc::StreamInputHandler *handler,
+                                   brpc::StreamId &streamId)
+{
+    falcon::brpc_io::StreamReadRequest request;
+    request.set_physical_fd(physicalFd);
+    request.set_offset(offset);
+    request.set_size(size);
+    request.set_block_size(blockSize);
+    request.set_credits(credits);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+
+    brpc::StreamOptions options;
+    options.handler = handler;
+    /* flow is bounded by credits, not by the stream buffer */
+    options.max_buf_size = 0;
+    if (brpc::StreamCreate(&streamId, cntl, &options) != 0) {
+        FALCON_LOG(LOG_ERROR) << "OpenReadStream: create stream failed";
+        return -EIO;
+    }
+
+    stub->StreamRead(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "OpenReadStream by brpc failed " << cntl.ErrorText()
+                              << "error code: " << cntl.ErrorCode();
+        brpc::StreamClose(streamId);
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+
+    if (response.error_code() != 0) {
+        FALCON_LOG(LOG_ERROR) << "FalconIOClient::OpenReadStream failed: " << strerror(-response.error_code());
+        brpc::StreamClose(streamId);
+        return response.error_code();
+    }
+    return 0;
+}
+
+int FalconIOClient::GrantReadStreamCredits(brpc::StreamId streamId, uint32_t credits)
+{
+    butil::IOBuf msg;
+    msg.append(&credits, sizeof(credits));
+    return -brpc::StreamWrite(streamId, msg);
+}
+
+/* push one chunk of a cached file to its new owner, data is consumed. -EEXIST: the owner has it already */
+int FalconIOClient::MigrateFile(uint64_t inodeId,
+                                uint64_t placementKey,
+                                bool hasKey,
+                                off_t offset,
+                                uint64_t totalSize,
+                                bool last,
+                                bool replica,
+                                uint32_t crc,
+                                uint32_t fingerprint,
+                                bool patch,
+                                uint32_t baseFingerprint,
+                                butil::IOBuf &data)
+{
+    falcon::brpc_io::MigrateFileRequest request;
+    request.set_inode_id(inodeId);
+    request.set_placement_key(placementKey);
+    request.set_has_key(hasKey);
+    request.set_offset(offset);
+    request.set_total_size(totalSize);
+    request.set_last(last);
+    request.set_replica(replica);
+    request.set_has_crc(true);
+    request.set_crc(crc);
+    request.set_fingerprint(fingerprint);
+    request.set_patch(patch);
+    request.set_base_fingerprint(baseFingerprint);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+    cntl.request_attachment().swap(data);
+
+    stub->MigrateFile(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "MigrateFile by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    return response.error_code();
+}
+
+int FalconIOClient::DropCache(uint64_t inodeId)
+{
+    falcon::brpc_io::DropCacheRequest request;
+    request.set_inode_id(inodeId);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+
+    stub->DropCache(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "DropCache by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    return response.error_code();
+}
+
+/*
+ * One LocateCacheAsync call. Not retried, a node that does not answer in time is taken as not
+ * holding the file.
+ */
+class AsyncLocateCacheCall : public google::protobuf::Closure {
+  public:
+    explicit AsyncLocateCacheCall(FalconIOClient::Done done)
+        : done(std::move(done))
+    {
+    }
+
+    void Run() override
+    {
+        int ret = 0;
+        if (cntl.Failed()) {
+            ret = -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+        } else {
+            ret = response.error_code();
+        }
+        done(ret);
+        delete this;
+    }
+
+    falcon::brpc_io::LocateCacheRequest request;
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+
+  private:
+    FalconIOClient::Done done;
+};
+
+/*
+ * Ask whether the node holds inodeId cached with size bytes, and the content of fingerprint if
+ * checkFingerprint, without waiting, done is called with 0 if it does, or -errno.
+ */
+void FalconIOClient::LocateCacheAsync(
+    uint64_t inodeId, uint64_t size, bool checkFingerprint, uint32_t fingerprint, int timeoutMs, Done done)
+{
+    auto *call = new AsyncLocateCacheCall(std::move(done));
+    call->request.set_inode_id(inodeId);
+    call->request.set_size(size);
+    call->request.set_check_fingerprint(checkFingerprint);
+    call->request.set_fingerprint(fingerprint);
+    call->cntl.set_timeout_ms(timeoutMs);
+    stub->LocateCache(&call->cntl, &call->request, &call->response, call);
+}
+
+int FalconIOClient::WarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, int action, bool route)
+{
+    falcon::brpc_io::WarmupFileRequest request;
+    request.set_inode_id(inodeId);
+    request.set_path(path);
+    request.set_size(size);
+    request.set_action(action);
+    request.set_route(route);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    /* the owner loads the whole file from storage before it answers */
+    cntl.set_timeout_ms(-1);
+
+    stub->WarmupFile(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "WarmupFile by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    return response.error_code();
+}
+
+/* push one chunk of an erasure coded shard, data is consumed. -EBADMSG: the chunk arrived damaged */
+int FalconIOClient::PutShard(uint64_t inodeId,
+                             const ShardInfo &info,
+                             uint64_t offset,
+                             bool last,
+                             uint32_t crc,
+                             butil::IOBuf &data)
+{
+    falcon::brpc_io::PutShardRequest request;
+    request.set_inode_id(inodeId);
+    request.set_index(info.index);
+    request.set_data_shards(info.dataShards);
+    request.set_parity_shards(info.parityShards);
+    request.set_owner(info.owner);
+    request.set_file_size(info.fileSize);
+    request.set_version(info.version);
+    request.set_offset(offset);
+    request.set_last(last);
+    request.set_crc(crc);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+    cntl.request_attachment().swap(data);
+
+    stub->PutShard(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "PutShard by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    return response.error_code();
+}
+
+/*
+ * One ReadShardAsync call. Not retried, the caller rebuilds from other shards instead.
+ */
+class AsyncReadShardCall : public google::protobuf::Closure {
+  public:
+    explicit AsyncReadShardCall(FalconIOClient::ShardDone done)
+        : done(std::move(done))
+    {
+    }
+
+    void Run() override
+    {
+        int ret = 0;
+        ShardInfo info;
+        if (cntl.Failed()) {
+            ret = -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+        } else {
+            ret = response.error_code();
+            info.index = response.index();
+            info.dataShards = response.data_shards();
+            info.parityShards = response.parity_shards();
+            info.owner = response.owner();
+            info.fileSize = response.file_size();
+            info.version = response.version();
+        }
+        done(ret, info, response.crc(), cntl.response_attachment());
+        delete this;
+    }
+
+    falcon::brpc_io::ReadShardRequest request;
+    falcon::brpc_io::ReadShardReply response;
+    brpc::Controller cntl;
+
+  private:
+    FalconIOClient::ShardDone done;
+};
+
+/*
+ * Read size bytes at offset of the shard of inodeId the node holds without waiting, size 0 only
+ * asks which shard it is. done is called with 0, the shard and the data, or -errno.
+ */
+void FalconIOClient::ReadShardAsync(uint64_t inodeId, uint64_t offset, uint64_t size, int timeoutMs, ShardDone done)
+{
+    auto *call = new AsyncReadShardCall(std::move(done));
+    call->request.set_inode_id(inodeId);
+    call->request.set_offset(offset);
+    call->request.set_size(size);
+    call->cntl.set_timeout_ms(timeoutMs);
+    stub->ReadShard(&call->cntl, &call->request, &call->response, call);
+}
+
+int FalconIOClient::DropShard(uint64_t inodeId, int timeoutMs)
+{
+    falcon::brpc_io::DropCacheRequest request;
+    request.set_inode_id(inodeId);
+    falcon::brpc_io::ErrorCodeOnlyReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(timeoutMs);
+
+    stub->DropShard(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "DropShard by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    return response.error_code();
+}
+
+/* the blocks of keys are in data back to back, data is consumed */
+int FalconIOClient::KvPut(const std::vector<std::string> &keys,
+                          const std::vector<uint64_t> &sizes,
+                          uint32_t ttlSeconds,
+                          butil::IOBuf &data,
+                          std::vector<int64_t> &results)
+{
+    falcon::brpc_io::KvPutRequest request;
+    request.mutable_keys()->Add(keys.begin(), keys.end());
+    request.mutable_sizes()->Add(sizes.begin(), sizes.end());
+    request.set_ttl_s(ttlSeconds);
+    falcon::brpc_io::KvReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+    cntl.request_attachment().swap(data);
+
+    stub->KvPut(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "KvPut by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    results.assign(response.results().begin(), response.results().end());
+    return response.error_code();
+}
+
+int FalconIOClient::KvGet(const std::vector<std::string> &keys, std::vector<int64_t> &results, butil::IOBuf &data)
+{
+    falcon::brpc_io::KvKeysRequest request;
+    request.mutable_keys()->Add(keys.begin(), keys.end());
+    falcon::brpc_io::KvReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+
+    stub->KvGet(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "KvGet by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    results.assign(response.results().begin(), response.results().end());
+    data.swap(cntl.response_attachment());
+    return response.error_code();
+}
+
+int FalconIOClient::KvExists(const std::vector<std::string> &keys, std::vector<int64_t> &results)
+{
+    falcon::brpc_io::KvKeysRequest request;
+    request.mutable_keys()->Add(keys.begin(), keys.end());
+    falcon::brpc_io::KvReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+
+    stub->KvExists(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "KvExists by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    results.assign(response.results().begin(), response.results().end());
+    return response.error_code();
+}
+
+int FalconIOClient::KvDelete(const std::vector<std::string> &keys, std::vector<int64_t> &results)
+{
+    falcon::brpc_io::KvKeysRequest request;
+    request.mutable_keys()->Add(keys.begin(), keys.end());
+    falcon::brpc_io::KvReply response;
+    brpc::Controller cntl;
+    cntl.set_timeout_ms(10000);
+
+    stub->KvDelete(&cntl, &request, &response, nullptr);
+    if (cntl.Failed()) {
+        FALCON_LOG(LOG_ERROR) << "KvDelete by brpc failed " << cntl.ErrorText() << "error code: " << cntl.ErrorCode();
+        return -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+    }
+    results.assign(response.results().begin(), response.results().end());
+    return response.error_code();
+}
+
+/*
+ * One asynchronous kv call. Not retried, the caller reports the keys of a batch that failed.
+ */
+template <typename Request>
+class AsyncKvCall : public google::protobuf::Closure {
+  public:
+    AsyncKvCall(const char *name, FalconIOClient::KvDone done)
+        : name(name),
+          done(std::move(done))
+    {
+        cntl.set_timeout_ms(10000);
+    }
+
+    void Run() override
+    {
+        int ret = 0;
+        std::vector<int64_t> results;
+        if (cntl.Failed()) {
+            FALCON_LOG(LOG_ERROR) << name << " by brpc failed " << cntl.ErrorText()
+                                  << "error code: " << cntl.ErrorCode();
+            ret = -BrpcErrorCodeToFuseErrno(cntl.ErrorCode());
+        } else {
+            ret = response.error_code();
+            results.assign(response.results().begin(), response.results().end());
+        }
+        done(ret, results, cntl.response_attachment());
+        delete this;
+    }
+
+    Request request;
+    falcon::brpc_io::KvReply response;
+    brpc::Controller cntl;
+
+  private:
+    const char *name;
+    FalconIOClient::KvDone done;
+};
+
+static AsyncKvCall<falcon::brpc_io::KvKeysRequest> *
+NewKvKeysCall(const char *name, const std::vector<std::string> &keys, FalconIOClient::KvDone done)
+{
+    auto *call = new AsyncKvCall<falcon::brpc_io::KvKeysRequest>(name, std::move(done));
+    call->request.mutable_keys()->Add(keys.begin(), keys.end());
+    return call;
+}
+
+/* as KvPut, done is called with the reply */
+void FalconIOClient::KvPutAsync(const std::vector<std::string> &keys,
+                                const std::vector<uint64_t> &sizes,
+                                uint32_t ttlSeconds,
+                                butil::IOBuf &data,
+                                KvDone done)
+{
+    auto *call = new AsyncKvCall<falcon::brpc_io::KvPutRequest>("KvPut", std::move(done));
+    call->request.mutable_keys()->Add(keys.begin(), keys.end());
+    call->request.mutable_sizes()->Add(sizes.begin(), sizes.end());
+    call->request.set_ttl_s(ttlSeconds);
+    call->cntl.request_attachment().swap(data);
+    stub->KvPut(&call->cntl, &call->request, &call->response, call);
+}
+
+void FalconIOClient::KvGetAsync(const std::vector<std::string> &keys, KvDone done)
+{
+    auto *call = NewKvKeysCall("KvGet", keys, std::move(done));
+    stub->KvGet(&call->cntl, &call->request, &call->response, call);
+}
+
+void FalconIOClient::KvExistsAsync(const std::vector<std::string> &keys, KvDone done)
+{
+    auto *call = NewKvKeysCall("KvExists", keys, std::move(done));
+    stub->KvExists(&call->cntl, &call->request, &call->response, call);
+}
+
+void FalconIOClient::KvDeleteAsync(const std::vector<std::string> &keys, KvDone done)
+{
+    auto *call = NewKvKeysCall("KvDelete", keys, std::move(done));
+    stub->KvDelete(&call->cntl, &call->request, &call->response, call);
+}
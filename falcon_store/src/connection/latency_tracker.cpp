@@ -0,0 +1,49 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "connection/latency_tracker.h"
+
+#include <bit>
+
+void LatencyTracker::Record(uint64_t us)
+{
+    int bucket = us == 0 ? 0 : std::bit_width(us) - 1;
+    if (bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    buckets[bucket]++;
+    total++;
+    if (++sinceDecay >= LATENCY_DECAY_SAMPLES) {
+        total = 0;
+        for (uint64_t &count : buckets) {
+            count /= 2;
+            total += count;
+        }
+        sinceDecay = 0;
+    }
+    uint64_t old = mean.load(std::memory_order_relaxed);
+    mean.store(old == 0 ? us : (old * 7 + us) / 8, std::memory_order_relaxed);
+}
+
+uint64_t LatencyTracker::Percentile(uint32_t p)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (total < LATENCY_MIN_SAMPLES) {
+        return 0;
+    }
+    double target = (double)total * p / 100;
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        if (buckets[i] == 0 || seen + buckets[i] < target) {
+            seen += buckets[i];
+            continue;
+        }
+        /* spread evenly inside the bucket */
+        uint64_t lower = i == 0 ? 0 : 1ULL << i;
+        uint64_t upper = 1ULL << (i + 1);
+        return lower + (uint64_t)((upper - lower) * ((target - seen) / buckets[i]));
+    }
+    return 1ULL << LATENCY_BUCKETS;
+}
@@ -4,6 +4,7 @@
 
 #include "connection/node.h"
 
+#include <algorithm>
 #include <chrono>
 #include <ranges>
 #include <thread>
@@ -53,6 +54,7 @@ int StoreNode::SetNodeConfig(int initNodeId, std::string &clusterView)
 #endif
         if (connected) {
             nodeMap.emplace(i, std::make_pair(rpcEndPoint, connection));
+            placement.AddNode(i, NodeWeight(i));
         } else {
             initStatus = 1;
         }
@@ -79,6 +81,8 @@ int StoreNode::UpdateNodeConfig()
 void StoreNode::UpdateNodeConfigByValue(std::unordered_map<int, std::string> &zkStoreNodes)
 {
     std::unique_lock<std::shared_mutex> nodeLock(nodeMutex);
+    NodePlacement oldPlacement = placement;
+    bool changed = false;
 
     std::vector<int> toDel;
     for (auto &kv : nodeMap) {
@@ -95,6 +99,8 @@ void StoreNode::UpdateNodeConfigByValue(std::unordered_map<int, std::string> &zk
     }
     for (auto &delNode : toDel) {
         nodeMap.erase(delNode);
+        placement.RemoveNode(delNode);
+        changed = true;
     }
     for (auto &newNodeKv : zkStoreNodes) {
         auto conn = CreateIOConnection(newNodeKv.second);
@@ -104,7 +110,101 @@ void StoreNode::UpdateNodeConfigByValue(std::unordered_map<int, std::string> &zk
         }
         std::shared_ptr<FalconIOClient> connection(conn);
         nodeMap.emplace(newNodeKv.first, std::make_pair(newNodeKv.second, connection));
+        placement.AddNode(newNodeKv.first, NodeWeight(newNodeKv.first));
+        changed = true;
     }
+    if (!changed || oldPlacement.Empty()) {
+        return;
+    }
+    previousPlacement = oldPlacement;
+    placementChangedAt = std::chrono::steady_clock::now();
+    generation++;
+    std::function<void()> listener = membershipListener;
+    nodeLock.unlock();
+    FALCON_LOG(LOG_INFO) << "StoreNode: membership changed, " << oldPlacement.Size() << " -> " << placement.Size()
+                         << " nodes";
+    if (listener) {
+        listener();
+    }
+}
+
+void StoreNode::SetMembershipListener(std::function<void()> listener)
+{
+    std::unique_lock<std::shared_mutex> nodeLock(nodeMutex);
+    membershipListener = std::move(listener);
+}
+
+void StoreNode::SetForwardSeconds(uint32_t seconds)
+{
+    std::unique_lock<std::shared_mutex> nodeLock(nodeMutex);
+    forwardSeconds = seconds;
+}
+
+int StoreNode::PreviousOwner(uint64_t key)
+{
+    std::shared_lock<std::shared_mutex> lock(nodeMutex);
+    if (previousPlacement.Empty() ||
+        std::chrono::steady_clock::now() - placementChangedAt > std::chrono::seconds(forwardSeconds)) {
+        return -1;
+    }
+    int previous = previousPlacement.Locate(key);
+    if (previous == placement.Locate(key) || nodeMap.find(previous) == nodeMap.end()) {
+        return -1;
+    }
+    return previous;
+}
+
+void StoreNode::SetReplicas(uint32_t count)
+{
+    std::unique_lock<std::shared_mutex> nodeLock(nodeMutex);
+    replicas = std::max(count, 1U);
+}
+
+std::vector<int> StoreNode::ReplicaNodes(int owner, uint64_t key)
+{
+    std::shared_lock<std::shared_mutex> lock(nodeMutex);
+    std::vector<int> nodes = {owner};
+    if (replicas <= 1) {
+        return nodes;
+    }
+    /* owner may differ from the top ranked node after a failover, it keeps its place first */
+    for (int node : placement.Rank(key, replicas + 1)) {
+        if (nodes.size() >= replicas) {
+            break;
+        }
+        if (node != owner) {
+            nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+std::vector<int> StoreNode::ShardNodes(int owner, uint64_t key, size_t count)
+{
+    std::shared_lock<std::shared_mutex> lock(nodeMutex);
+    std::vector<int> nodes;
+    for (int node : placement.Rank(key, count + 1)) {
+        if (node != owner && nodes.size() < count) {
+            nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+std::vector<int> StoreNode::RankedNodes(uint64_t key, size_t count)
+{
+    std::shared_lock<std::shared_mutex> lock(nodeMutex);
+    return placement.Rank(key, count);
+}
+
+LatencyTracker &StoreNode::Latency(int id)
+{
+    std::lock_guard<std::mutex> lock(latencyMutex);
+    std::unique_ptr<LatencyTracker> &tracker = latency[id];
+    if (tracker == nullptr) {
+        tracker = std::make_unique<LatencyTracker>();
+    }
+    return *tracker;
 }
 
 int StoreNode::SetNodeConfig(std::string &rootPath)
@@ -159,6 +259,7 @@ void StoreNode::Delete()
 {
     std::unique_lock<std::shared_mutex> lock(nodeMutex);
     nodeMap.clear();
+    placement.Clear();
 }
 
 FalconIOClient *StoreNode::CreateIOConnection(const std::string &rpcEndPoint)
@@ -255,41 +356,31 @@ int StoreNode::GetNumberofAllNodes()
     return nodeMap.size();
 }
 
-uint64_t hash64(uint64_t x)
-{
-    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
-    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
-    x = x ^ (x >> 31);
-    return x;
-}
-
 int StoreNode::AllocNode(uint64_t inodeId)
 {
     std::shared_lock<std::shared_mutex> lock(nodeMutex);
-    if (!nodeMap.empty()) {
-        int index = (hash64(inodeId)) % nodeMap.size();
-        auto it = nodeMap.begin();
-        std::advance(it, index);
-        return it->first;
+    if (!placement.Empty()) {
+        return placement.Locate(inodeId);
     }
     return nodeId;
 }
 
+/* the node ranked after nodeId for this inode, so failover of a file is the same on every client */
 int StoreNode::GetNextNode(int nodeId, uint64_t inodeId)
 {
     std::shared_lock<std::shared_mutex> lock(nodeMutex);
-    if (!nodeMap.empty()) {
-        auto it = nodeMap.find(nodeId);
-        if (it == nodeMap.end()) {
+    if (!placement.Empty()) {
+        std::vector<int> ranked = placement.Rank(inodeId, placement.Size());
+        auto it = std::find(ranked.begin(), ranked.end(), nodeId);
+        if (it == ranked.end()) {
             FALCON_LOG(LOG_WARNING) << "nodeId is not in nodeMap, rehash";
-            lock.unlock();
-            return AllocNode(inodeId);
+            return ranked.front();
         }
         it = std::next(it);
-        if (it == nodeMap.end()) {
-            it = nodeMap.begin();
+        if (it == ranked.end()) {
+            it = ranked.begin();
         }
-        return it->first;
+        return *it;
     }
     return nodeId;
 }
@@ -298,6 +389,35 @@ void StoreNode::DeleteNode(int nodeId)
 {
     std::unique_lock<std::shared_mutex> lock(nodeMutex);
     nodeMap.erase(nodeId);
+    placement.RemoveNode(nodeId);
+    generation++;
+}
+
+void StoreNode::SetNodeWeights(const std::string &weights)
+{
+    std::unique_lock<std::shared_mutex> lock(nodeMutex);
+    nodeWeights.clear();
+    int i = 0;
+    for (auto &&weight : weights | std::views::split(',') | std::views::transform([](auto &&rng) {
+             return std::string(&*rng.begin(), std::ranges::distance(rng));
+         })) {
+        char *end = nullptr;
+        double value = strtod(weight.c_str(), &end);
+        if (end != weight.c_str() && value > 0) {
+            nodeWeights[i] = value;
+        }
+        i++;
+    }
+    for (auto &kv : nodeMap) {
+        placement.AddNode(kv.first, NodeWeight(kv.first));
+    }
+    generation++;
+}
+
+double StoreNode::NodeWeight(int id)
+{
+    auto it = nodeWeights.find(id);
+    return it == nodeWeights.end() ? NODE_DEFAULT_WEIGHT : it->second;
 }
 
 std::vector<int> StoreNode::GetAllNodeId()
@@ -0,0 +1,78 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "connection/node_placement.h"
+
+#include <algorithm>
+#include <cmath>
+
+uint64_t hash64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    x = (x ^ (x >> 27)) * UINT64_C(0x94d049bb133111eb);
+    x = x ^ (x >> 31);
+    return x;
+}
+
+void NodePlacement::AddNode(int nodeId, double weight)
+{
+    if (weight <= 0) {
+        weight = NODE_DEFAULT_WEIGHT;
+    }
+    auto it = std::find_if(nodes.begin(), nodes.end(), [nodeId](const Node &node) { return node.nodeId == nodeId; });
+    if (it != nodes.end()) {
+        it->weight = weight;
+        return;
+    }
+    nodes.push_back(Node{.nodeId = nodeId, .weight = weight});
+}
+
+void NodePlacement::RemoveNode(int nodeId)
+{
+    std::erase_if(nodes, [nodeId](const Node &node) { return node.nodeId == nodeId; });
+}
+
+void NodePlacement::Clear() { nodes.clear(); }
+
+double NodePlacement::Score(uint64_t key, const Node &node)
+{
+    uint64_t h = hash64(hash64(key) ^ hash64(UINT64_C(0x9e3779b97f4a7c15) + (uint64_t)node.nodeId));
+    /* top 53 bits to a double in (0, 1) */
+    double u = ((double)(h >> 11) + 0.5) / (double)(UINT64_C(1) << 53);
+    return node.weight / -std::log(u);
+}
+
+int NodePlacement::Locate(uint64_t key) const
+{
+    int best = -1;
+    double bestScore = -1;
+    for (const Node &node : nodes) {
+        double score = Score(key, node);
+        /* ties go to the smaller id, so the order of nodes does not matter */
+        if (score > bestScore || (score == bestScore && node.nodeId < best)) {
+            best = node.nodeId;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+std::vector<int> NodePlacement::Rank(uint64_t key, size_t count) const
+{
+    std::vector<std::pair<double, int>> scores;
+    scores.reserve(nodes.size());
+    for (const Node &node : nodes) {
+        scores.emplace_back(Score(key, node), node.nodeId);
+    }
+    count = std::min(count, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + count, scores.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    std::vector<int> ranked;
+    ranked.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        ranked.push_back(scores[i].second);
+    }
+    return ranked;
+}
@@ -12,10 +12,14 @@
 
 #include <sys/statfs.h>
 #include <sys/time.h>
+#include <sys/xattr.h>
 
 #include "log/logging.h"
 #include "util/utils.h"
 
+/* set on the cache files of pinned items */
+#define PIN_XATTR "user.falcon.pinned"
+
 std::vector<CacheItem> DiskCache::initCacheVector;
 std::mutex DiskCache::initCacheMutex;
 
@@ -82,6 +86,10 @@ int DiskCache::ScanCache()
     });
     for (CacheItem cache : initCacheVector) {
         InsertAndUpdate(cache.inode, cache.size, false);
+        if (cache.pinned && SetPinned(cache.inode, true) != 0) {
+            FALCON_LOG(LOG_WARNING) << "Pin of inode " << cache.inode << " is over the quota, dropped";
+            removexattr(GetFilePath(cache.inode).c_str(), PIN_XATTR);
+        }
     }
     initCacheVector.clear();
     return RETURN_OK;
@@ -111,6 +119,7 @@ int DiskCache::Walk(std::string dirPath)
         cache.atime = static_cast<uint64_t>(st.st_atime);
         cache.size = st.st_size;
         cache.refs = 0;
+        cache.pinned = getxattr(filePath.c_str(), PIN_XATTR, nullptr, 0) >= 0;
         cacheVector.emplace_back(cache);
     }
     if (closedir(dir)) {
@@ -193,7 +202,7 @@ void DiskCache::CleanupForEvict(uint64_t preAllocSize)
     uint64_t freedInode = 0;
 
     for (auto it = cacheItems.begin(); it != cacheItems.end();) {
-        if (it->refs > 0) {
+        if (it->refs > 0 || it->pinned) {
             ++it;
             continue;
         }
@@ -204,10 +213,7 @@ void DiskCache::CleanupForEvict(uint64_t preAllocSize)
         if (ret == 0) {
             freedCap += size;
             freedInode++;
-            it = cacheItems.erase(it);
-            inodeToCacheIter.erase(key);
-            usedCap -= size;
-            freeCap += size;
+            Erase(it++);
             FALCON_LOG(LOG_WARNING) << "Evict file: " << fileName;
         } else {
             ++it;
@@ -249,7 +255,7 @@ void DiskCache::Cleanup()
     uint64_t freedInode = 0;
 
     for (auto it = cacheItems.begin(); it != cacheItems.end();) {
-        if (it->refs > 0) {
+        if (it->refs > 0 || it->pinned) {
             ++it;
             continue;
         }
@@ -260,10 +266,7 @@ void DiskCache::Cleanup()
         if (ret == 0) {
             freedCap += size;
             freedInode++;
-            it = cacheItems.erase(it);
-            inodeToCacheIter.erase(key);
-            usedCap -= size;
-            freeCap += size;
+            Erase(it++);
             FALCON_LOG(LOG_WARNING) << "Evict file: " << fileName;
         } else {
             ++it;
@@ -282,13 +285,15 @@ int DiskCache::Delete(uint64_t key)
     if (stop) {
         std::string fileName = GetFilePath(key);
         int ret = remove(fileName.c_str());
+        if (ret == 0) {
+            Removed(key);
+        }
         return ret;
     }
     std::lock_guard<std::mutex> lock(mutex);
     if (inodeToCacheIter.find(key) != inodeToCacheIter.end()) {
         int ret = 0;
         auto elem = inodeToCacheIter[key];
-        uint64_t size = elem->size;
         std::string fileName = GetFilePath(key);
         ret = remove(fileName.c_str());
         if (ret != 0) {
@@ -296,10 +301,7 @@ int DiskCache::Delete(uint64_t key)
             FALCON_LOG(LOG_ERROR) << "Delete file: " << fileName << " failed: " << strerror(err);
             return -err;
         }
-        cacheItems.erase(elem);
-        inodeToCacheIter.erase(key);
-        usedCap -= size;
-        freeCap += size;
+        Erase(elem);
         FALCON_LOG(LOG_INFO) << "Delete file: " << fileName;
     }
     return 0;
@@ -348,7 +350,6 @@ void DiskCache::DeleteOldCacheWithNoPin(uint64_t key)
         if (inodeToCacheIter[key]->refs <= 0) {
             int ret = 0;
             auto elem = inodeToCacheIter[key];
-            uint64_t size = elem->size;
             std::string fileName = GetFilePath(key);
             ret = remove(fileName.c_str());
             if (ret != 0) {
@@ -356,10 +357,7 @@ void DiskCache::DeleteOldCacheWithNoPin(uint64_t key)
                 FALCON_LOG(LOG_ERROR) << "DeleteOldCacheWithNoPin file: " << fileName << " failed: " << strerror(err);
                 return;
             }
-            cacheItems.erase(elem);
-            inodeToCacheIter.erase(key);
-            usedCap -= size;
-            freeCap += size;
+            Erase(elem);
         }
     }
 }
@@ -374,6 +372,9 @@ void DiskCache::InsertAndUpdate(uint64_t key, uint64_t size, bool needPin)
         // update
         usedCap += static_cast<int64_t>(size - inodeToCacheIter[key]->size);
         freeCap -= static_cast<int64_t>(size - inodeToCacheIter[key]->size);
+        if (inodeToCacheIter[key]->pinned) {
+            pinnedCap += size - inodeToCacheIter[key]->size;
+        }
         inodeToCacheIter[key]->atime = static_cast<uint64_t>(time(nullptr));
         inodeToCacheIter[key]->size = size;
         //
@@ -407,6 +408,9 @@ bool DiskCache::Update(uint64_t key, uint64_t size)
         }
         usedCap += static_cast<int64_t>(size - inodeToCacheIter[key]->size);
         freeCap -= static_cast<int64_t>(size - inodeToCacheIter[key]->size);
+        if (inodeToCacheIter[key]->pinned) {
+            pinnedCap += size - inodeToCacheIter[key]->size;
+        }
         inodeToCacheIter[key]->atime = static_cast<uint64_t>(time(nullptr));
         inodeToCacheIter[key]->size = size;
         // FALCON_LOG(LOG_INFO) << "Add Cache, inode =  " << key << ", size = " << size << ", usedCap = " << usedCap;
@@ -429,6 +433,9 @@ bool DiskCache::Add(uint64_t key, uint64_t size)
         freeCap -= static_cast<int64_t>(size);
         inodeToCacheIter[key]->atime = static_cast<uint64_t>(time(nullptr));
         inodeToCacheIter[key]->size += size;
+        if (inodeToCacheIter[key]->pinned) {
+            pinnedCap += size;
+        }
         // FALCON_LOG(LOG_INFO) << "Add Cache, inode =  " << key << ", size = " << size << ", usedCap = " << usedCap;
     } else {
         FALCON_LOG(LOG_ERROR) << "In DiskCache::Add(), inode " << key << " not found";
@@ -484,6 +491,118 @@ void DiskCache::FreePreAllocSpace(uint64_t size)
 
 bool DiskCache::HasFreeSpace() { return hasFreeSpace.load(); }
 
+void DiskCache::SetRemoveListener(std::function<void(uint64_t)> listener) { removeListener = std::move(listener); }
+
+void DiskCache::Erase(cacheIterator elem)
+{
+    uint64_t key = elem->inode;
+    usedCap -= elem->size;
+    freeCap += elem->size;
+    if (elem->pinned) {
+        pinnedCap -= elem->size;
+    }
+    cacheItems.erase(elem);
+    inodeToCacheIter.erase(key);
+    Removed(key);
+}
+
+void DiskCache::Removed(uint64_t key)
+{
+    if (removeListener) {
+        removeListener(key);
+    }
+}
+
+std::vector<uint64_t> DiskCache::IdleKeys()
+{
+    std::vector<uint64_t> keys;
+    if (stop) {
+        return keys;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    keys.reserve(cacheItems.size());
+    for (auto &item : cacheItems) {
+        if (item.refs == 0 && !item.pinned) {
+            keys.push_back(item.inode);
+        }
+    }
+    return keys;
+}
+
+bool DiskCache::TryPinIdle(uint64_t key)
+{
+    if (stop) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inodeToCacheIter.find(key);
+    if (it == inodeToCacheIter.end() || it->second->refs > 0 || it->second->pinned) {
+        return false;
+    }
+    it->second->refs += 1;
+    return true;
+}
+
+void DiskCache::SetPinQuota(uint64_t quota)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pinQuota = quota;
+}
+
+int DiskCache::SetPinned(uint64_t key, bool pinned)
+{
+    std::string fileName = GetFilePath(key);
+    if (stop) {
+        /* nothing is evicted without a cache limit */
+        return access(fileName.c_str(), F_OK) == 0 ? 0 : -ENOENT;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inodeToCacheIter.find(key);
+    if (it == inodeToCacheIter.end()) {
+        return -ENOENT;
+    }
+    CacheItem &item = *it->second;
+    if (item.pinned == pinned) {
+        return 0;
+    }
+    if (pinned && pinnedCap + item.size > pinQuota) {
+        return -EDQUOT;
+    }
+    item.pinned = pinned;
+    if (pinned) {
+        pinnedCap += item.size;
+    } else {
+        pinnedCap -= item.size;
+    }
+    /* the pin still holds until a restart if the file system has no xattrs */
+    int ret = pinned ? setxattr(fileName.c_str(), PIN_XATTR, "1", 1, 0) : removexattr(fileName.c_str(), PIN_XATTR);
+    if (ret != 0 && errno != ENODATA) {
+        FALCON_LOG(LOG_WARNING) << "Persist pin of " << fileName << " failed: " << strerror(errno);
+    }
+    return 0;
+}
+
+uint64_t DiskCache::PinnedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pinnedCap;
+}
+
+void DiskCache::Keep(int64_t size, bool written)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    keptCap += size;
+    if (written && !stop) {
+        freeCap -= size;
+    }
+}
+
+uint64_t DiskCache::KeptBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return keptCap;
+}
+
 int DiskCache::CheckSpaceEnough()
 {
     float blockRatio = (freeCap + usedCap) * 1.0 / totalCap;
@@ -0,0 +1,221 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/block_checksums.h"
+
+#include <sys/xattr.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "util/crc32c.h"
+
+static ssize_t ReadAll(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+BlockChecksums::BlockChecksums(uint64_t initFileSize)
+    : fileSize(initFileSize)
+{
+    while ((fileSize + blockSize - 1) / blockSize > CHECKSUM_MAX_BLOCKS) {
+        blockSize *= 2;
+    }
+    crcs.resize((fileSize + blockSize - 1) / blockSize);
+}
+
+uint64_t BlockChecksums::BlockLength(size_t block) const
+{
+    return std::min<uint64_t>(blockSize, fileSize - BlockOffset(block));
+}
+
+bool BlockChecksums::Check(size_t block, const char *data) const
+{
+    return Crc32c(data, BlockLength(block)) == crcs[block];
+}
+
+BlockChecksums BlockChecksums::OfBuffer(const char *buf, uint64_t size)
+{
+    BlockChecksums checksums(size);
+    for (size_t block = 0; block < checksums.Blocks(); ++block) {
+        checksums.crcs[block] = Crc32c(buf + checksums.BlockOffset(block), checksums.BlockLength(block));
+    }
+    return checksums;
+}
+
+int BlockChecksums::OfFile(int fd, uint64_t size, BlockChecksums &checksums)
+{
+    checksums = BlockChecksums(size);
+    std::vector<char> buf(checksums.blockSize);
+    for (size_t block = 0; block < checksums.Blocks(); ++block) {
+        uint64_t length = checksums.BlockLength(block);
+        ssize_t nread = ReadAll(fd, buf.data(), length, checksums.BlockOffset(block));
+        if (nread != (ssize_t)length) {
+            return nread < 0 ? (int)nread : -EIO;
+        }
+        checksums.crcs[block] = Crc32c(buf.data(), length);
+    }
+    return 0;
+}
+
+std::string BlockChecksums::Serialize() const
+{
+    std::string data(CHECKSUM_HEADER_SIZE + crcs.size() * sizeof(uint32_t), '\0');
+    uint32_t magic = CHECKSUM_MAGIC;
+    memcpy(data.data(), &magic, sizeof(magic));
+    memcpy(data.data() + 4, &blockSize, sizeof(blockSize));
+    memcpy(data.data() + 8, &fileSize, sizeof(fileSize));
+    if (!crcs.empty()) {
+        memcpy(data.data() + CHECKSUM_HEADER_SIZE, crcs.data(), crcs.size() * sizeof(uint32_t));
+    }
+    return data;
+}
+
+bool BlockChecksums::Parse(const std::string &data, BlockChecksums &checksums)
+{
+    uint32_t magic = 0;
+    if (data.size() < CHECKSUM_HEADER_SIZE) {
+        return false;
+    }
+    memcpy(&magic, data.data(), sizeof(magic));
+    BlockChecksums parsed;
+    memcpy(&parsed.blockSize, data.data() + 4, sizeof(parsed.blockSize));
+    memcpy(&parsed.fileSize, data.data() + 8, sizeof(parsed.fileSize));
+    if (magic != CHECKSUM_MAGIC || parsed.blockSize == 0) {
+        return false;
+    }
+    uint64_t blocks = (parsed.fileSize + parsed.blockSize - 1) / parsed.blockSize;
+    if (data.size() != CHECKSUM_HEADER_SIZE + blocks * sizeof(uint32_t)) {
+        return false;
+    }
+    parsed.crcs.resize(blocks);
+    if (blocks > 0) {
+        memcpy(parsed.crcs.data(), data.data() + CHECKSUM_HEADER_SIZE, blocks * sizeof(uint32_t));
+    }
+    checksums = std::move(parsed);
+    return true;
+}
+
+int BlockChecksums::Load(int fd, BlockChecksums &checksums)
+{
+    std::string data(CHECKSUM_HEADER_SIZE + CHECKSUM_MAX_BLOCKS * sizeof(uint32_t), '\0');
+    ssize_t size = fgetxattr(fd, CHECKSUM_XATTR, data.data(), data.size());
+    if (size < 0) {
+        return errno == ENODATA || errno == ENOTSUP ? -ENODATA : -errno;
+    }
+    data.resize(size);
+    return Parse(data, checksums) ? 0 : -ENODATA;
+}
+
+int BlockChecksums::Save(int fd) const
+{
+    std::string data = Serialize();
+    return fsetxattr(fd, CHECKSUM_XATTR, data.data(), data.size(), 0) == 0 ? 0 : -errno;
+}
+
+void BlockChecksums::Drop(int fd) { fremovexattr(fd, CHECKSUM_XATTR); }
+
+uint32_t BlockChecksums::Fingerprint() const
+{
+    std::string data = Serialize();
+    return Crc32c(data.data(), data.size());
+}
+
+int BlockChecksums::FingerprintOf(int fd, uint64_t size, uint32_t &fingerprint)
+{
+    BlockChecksums checksums;
+    if (Load(fd, checksums) != 0 || checksums.FileSize() != size) {
+        int ret = OfFile(fd, size, checksums);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    fingerprint = checksums.Fingerprint();
+    return 0;
+}
+
+std::vector<size_t> BlockChecksums::Mismatches(const char *buf, uint64_t offset, uint64_t size) const
+{
+    std::vector<size_t> bad;
+    uint64_t end = std::min(fileSize, offset + size);
+    for (size_t block = (offset + blockSize - 1) / blockSize; block < Blocks(); ++block) {
+        uint64_t start = BlockOffset(block);
+        if (start + BlockLength(block) > end) {
+            break;
+        }
+        if (!Check(block, buf + (start - offset))) {
+            bad.push_back(block);
+        }
+    }
+    return bad;
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> BlockChecksums::Changes(const BlockChecksums &older) const
+{
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    for (size_t block = 0; block < Blocks(); ++block) {
+        if (block < older.Blocks() && BlockLength(block) == older.BlockLength(block) &&
+            crcs[block] == older.crcs[block]) {
+            continue;
+        }
+        uint64_t offset = BlockOffset(block);
+        if (!ranges.empty() && ranges.back().first + ranges.back().second == offset) {
+            ranges.back().second += BlockLength(block);
+        } else {
+            ranges.emplace_back(offset, BlockLength(block));
+        }
+    }
+    return ranges;
+}
+
+CacheVerifier::CacheVerifier(BlockChecksums initChecksums)
+    : checksums(std::move(initChecksums)),
+      verified(checksums.Blocks(), false)
+{
+}
+
+int CacheVerifier::Verify(int fd, uint64_t offset, uint64_t size, size_t &badBlock)
+{
+    uint64_t end = std::min(checksums.FileSize(), offset + size);
+    if (disabled || offset >= end) {
+        return 0;
+    }
+    std::vector<char> buf;
+    for (size_t block = offset / checksums.BlockSize(); block * checksums.BlockSize() < end; ++block) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (verified[block]) {
+                continue;
+            }
+        }
+        uint64_t length = checksums.BlockLength(block);
+        buf.resize(length);
+        ssize_t nread = ReadAll(fd, buf.data(), length, checksums.BlockOffset(block));
+        if (nread != (ssize_t)length) {
+            return nread < 0 ? (int)nread : -EIO;
+        }
+        if (!checksums.Check(block, buf.data())) {
+            badBlock = block;
+            return -EBADMSG;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        verified[block] = true;
+    }
+    return 0;
+}
@@ -0,0 +1,342 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/dedup_index.h"
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include <openssl/evp.h>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+#include "storage/checksum_storage.h"
+#include "util/utils.h"
+
+/* chunks are shared in whole file system blocks */
+#define DEDUP_CHUNK_ALIGN 4096
+
+static ssize_t ReadAll(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+void DedupIndex::Init(uint32_t initChunkSize, Sharer sharer)
+{
+    chunkSize = initChunkSize == 0 ? 0 : std::max<uint32_t>(initChunkSize / DEDUP_CHUNK_ALIGN, 1) * DEDUP_CHUNK_ALIGN;
+    share = sharer ? std::move(sharer) : Dedupe;
+    shareSupported = true;
+    Clear();
+}
+
+int64_t DedupIndex::Dedupe(int srcFd, uint64_t srcOffset, int dstFd, uint64_t dstOffset, uint64_t length)
+{
+    std::vector<char> buf(sizeof(file_dedupe_range) + sizeof(file_dedupe_range_info));
+    auto *range = (file_dedupe_range *)buf.data();
+    uint64_t done = 0;
+    while (done < length) {
+        std::fill(buf.begin(), buf.end(), 0);
+        range->src_offset = srcOffset + done;
+        range->src_length = length - done;
+        range->dest_count = 1;
+        range->info[0].dest_fd = dstFd;
+        range->info[0].dest_offset = dstOffset + done;
+        if (ioctl(srcFd, FIDEDUPERANGE, range) != 0) {
+            return done > 0 ? (int64_t)done : -errno;
+        }
+        if (range->info[0].status != FILE_DEDUPE_RANGE_SAME) {
+            /* the data differs after all or the range can not be shared */
+            int status = range->info[0].status;
+            return done > 0 || status == FILE_DEDUPE_RANGE_DIFFERS ? (int64_t)done : status;
+        }
+        if (range->info[0].bytes_deduped == 0) {
+            break;
+        }
+        done += range->info[0].bytes_deduped;
+    }
+    return done;
+}
+
+int64_t DedupIndex::ShareChunk(const Fingerprint &fp, uint64_t inodeId, int fd, uint64_t offset, uint64_t length)
+{
+    std::vector<ChunkRef> refs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = chunks.find(fp);
+        if (it == chunks.end()) {
+            return 0;
+        }
+        refs = it->second;
+    }
+    for (const ChunkRef &ref : refs) {
+        if (ref.inodeId == inodeId) {
+            continue;
+        }
+        /* the holder may be gone or rewritten since, then the kernel finds the data differs */
+        int src = open(GetFilePath(ref.inodeId).c_str(), O_RDONLY);
+        if (src < 0) {
+            continue;
+        }
+        int64_t shared = share(src, (uint64_t)ref.chunk * chunkSize, fd, offset, length);
+        close(src);
+        if (shared == -EOPNOTSUPP || shared == -ENOTTY || shared == -EXDEV) {
+            if (shareSupported.exchange(false)) {
+                FALCON_LOG(LOG_WARNING) << "DedupIndex: cache file system can not share blocks (" << strerror(-shared)
+                                        << "), only uploads are deduplicated";
+            }
+            return 0;
+        }
+        if (shared > 0) {
+            return shared;
+        }
+    }
+    return 0;
+}
+
+int DedupIndex::Scan(uint64_t inodeId)
+{
+    if (!Enabled()) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ForgetChunksLocked(inodeId);
+    }
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_RDWR);
+    if (fd < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_WARNING) << "DedupIndex: open " << fileName << " failed: " << strerror(err);
+        return -err;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+    FileEntry entry;
+    entry.size = st.st_size;
+    std::vector<char> buf(chunkSize);
+    uint64_t shared = 0;
+    uint64_t cpuUs = 0;
+    int ret = 0;
+    for (uint64_t offset = 0; offset < entry.size; offset += chunkSize) {
+        uint64_t length = std::min<uint64_t>(chunkSize, entry.size - offset);
+        if (ReadAll(fd, buf.data(), length, offset) != (ssize_t)length) {
+            /* truncated meanwhile, it is scanned again once written */
+            ret = -EAGAIN;
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        Fingerprint fp;
+        EVP_Digest(buf.data(), length, fp.data(), nullptr, EVP_sha256(), nullptr);
+        cpuUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+                     .count();
+        entry.chunks.push_back(fp);
+        if (shareSupported) {
+            shared += ShareChunk(fp, inodeId, fd, offset, length);
+        }
+    }
+    close(fd);
+    FalconStats::GetInstance().stats[DEDUP_CPU_US] += cpuUs;
+    if (ret != 0) {
+        return ret;
+    }
+    FalconStats::GetInstance().stats[DEDUP_SCANNED] += entry.size;
+    FalconStats::GetInstance().stats[DEDUP_SHARED] += shared;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t i = 0; i < entry.chunks.size(); ++i) {
+        chunks[entry.chunks[i]].push_back({inodeId, i});
+    }
+    files[inodeId] = std::move(entry);
+    return 0;
+}
+
+void DedupIndex::Forget(uint64_t inodeId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ForgetChunksLocked(inodeId);
+    auto object = fileObjects.find(inodeId);
+    if (object != fileObjects.end()) {
+        DropObjectLocked(object->second);
+    }
+}
+
+void DedupIndex::ForgetChunksLocked(uint64_t inodeId)
+{
+    auto file = files.find(inodeId);
+    if (file == files.end()) {
+        return;
+    }
+    for (const Fingerprint &fp : file->second.chunks) {
+        auto it = chunks.find(fp);
+        if (it == chunks.end()) {
+            continue;
+        }
+        std::erase_if(it->second, [&](const ChunkRef &ref) { return ref.inodeId == inodeId; });
+        if (it->second.empty()) {
+            chunks.erase(it);
+        }
+    }
+    files.erase(file);
+}
+
+bool DedupIndex::StoredAs(const std::string &objectKey, const BlockChecksums &content)
+{
+    BlockChecksums stored;
+    return ChecksumStorage::GetInstance()->ReadChecksums(objectKey, stored) == 0 && stored == content;
+}
+
+int DedupIndex::CopyUploaded(Storage *storage, const std::string &objectKey, const BlockChecksums &content)
+{
+    if (!Enabled() || storage != ChecksumStorage::GetInstance() || content.FileSize() < DEDUP_MIN_COPY_SIZE) {
+        /* without sidecars a copy can not be told from an object replaced since */
+        return -ENOENT;
+    }
+    std::vector<std::string> sources;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = uploads.find(content.Fingerprint());
+        if (it != uploads.end()) {
+            sources = it->second;
+        }
+    }
+    for (const std::string &source : sources) {
+        if (source == objectKey) {
+            continue;
+        }
+        /* the source object may have been replaced through another node since it was uploaded */
+        if (!StoredAs(source, content)) {
+            FALCON_LOG(LOG_WARNING) << "DedupIndex: " << source << " no longer has the content of " << objectKey;
+            ForgetObject(source);
+            continue;
+        }
+        if (storage->CopyObject(source, objectKey) != 0) {
+            return -EIO;
+        }
+        /* the sidecar comes along, so a replace between the check and the copy shows there */
+        if (!StoredAs(objectKey, content)) {
+            FALCON_LOG(LOG_WARNING) << "DedupIndex: " << source << " changed while copied to " << objectKey;
+            ForgetObject(source);
+            return -EIO;
+        }
+        FalconStats::GetInstance().stats[DEDUP_UPLOAD_SAVED] += content.FileSize();
+        return 0;
+    }
+    return -ENOENT;
+}
+
+void DedupIndex::DropObjectLocked(const std::string &objectKey)
+{
+    auto it = objects.find(objectKey);
+    if (it == objects.end()) {
+        return;
+    }
+    auto upload = uploads.find(it->second.fingerprint);
+    if (upload != uploads.end()) {
+        std::erase(upload->second, objectKey);
+        if (upload->second.empty()) {
+            uploads.erase(upload);
+        }
+    }
+    auto file = fileObjects.find(it->second.inodeId);
+    if (file != fileObjects.end() && file->second == objectKey) {
+        fileObjects.erase(file);
+    }
+    objects.erase(it);
+}
+
+void DedupIndex::SetUploaded(uint64_t inodeId, const std::string &objectKey, const BlockChecksums &content)
+{
+    if (!Enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    DropObjectLocked(objectKey);
+    /* one object per cache file, it leaves the index with the file */
+    auto file = fileObjects.find(inodeId);
+    if (file != fileObjects.end()) {
+        DropObjectLocked(file->second);
+    }
+    uint32_t fingerprint = content.Fingerprint();
+    uploads[fingerprint].push_back(objectKey);
+    objects[objectKey] = {fingerprint, inodeId};
+    fileObjects[inodeId] = objectKey;
+}
+
+void DedupIndex::MoveObject(const std::string &from, const std::string &to)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    DropObjectLocked(to);
+    auto it = objects.find(from);
+    if (it == objects.end()) {
+        return;
+    }
+    Upload upload = it->second;
+    DropObjectLocked(from);
+    uploads[upload.fingerprint].push_back(to);
+    objects[to] = upload;
+    fileObjects[upload.inodeId] = to;
+}
+void DedupIndex::ForgetObject(const std::string &objectKey)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    DropObjectLocked(objectKey);
+}
+
+size_t DedupIndex::References(uint64_t inodeId, uint32_t chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto file = files.find(inodeId);
+    if (file == files.end() || chunk >= file->second.chunks.size()) {
+        return 0;
+    }
+    auto it = chunks.find(file->second.chunks[chunk]);
+    if (it == chunks.end()) {
+        return 0;
+    }
+    std::vector<uint64_t> holders;
+    for (const ChunkRef &ref : it->second) {
+        holders.push_back(ref.inodeId);
+    }
+    std::sort(holders.begin(), holders.end());
+    return std::unique(holders.begin(), holders.end()) - holders.begin();
+}
+
+size_t DedupIndex::Files()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return files.size();
+}
+
+void DedupIndex::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    chunks.clear();
+    files.clear();
+    uploads.clear();
+    objects.clear();
+    fileObjects.clear();
+}
@@ -0,0 +1,1020 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/erasure_coder.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#include "connection/node.h"
+#include "disk_cache/disk_cache.h"
+#include "falcon_store/block_checksums.h"
+#include "falcon_store/rebalancer.h"
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+#include "util/utils.h"
+
+/* magic, index, data and parity shards, owner, file size and version */
+#define EC_INFO_SIZE (5 * sizeof(uint32_t) + 2 * sizeof(uint64_t))
+
+static ssize_t ReadAll(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static ssize_t WriteAll(int fd, const char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pwrite(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static bool LoadInfo(int fd, ShardInfo &info)
+{
+    std::string data(EC_INFO_SIZE, '\0');
+    ssize_t size = fgetxattr(fd, EC_SHARD_XATTR, data.data(), data.size());
+    if (size < 0) {
+        return false;
+    }
+    data.resize(size);
+    return ErasureCoder::ParseInfo(data, info);
+}
+
+ErasureCoder::~ErasureCoder() { Stop(); }
+
+int ErasureCoder::Start(const std::string &rootPath,
+                        uint32_t initDataShards,
+                        uint32_t initParityShards,
+                        uint32_t initRepairSeconds)
+{
+    if (!ReedSolomon(initDataShards, initParityShards).Valid()) {
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: " << initDataShards << "+" << initParityShards
+                              << " shards are not a valid code";
+        return -EINVAL;
+    }
+    std::error_code ec;
+    shardDir = (std::filesystem::path(rootPath) / "shards").string();
+    if (!std::filesystem::create_directories(shardDir, ec) && ec) {
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: create " << shardDir << " failed: " << ec.message();
+        return -EIO;
+    }
+    /* shards half received before a restart are sent again by the repair pass */
+    int64_t kept = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(shardDir, ec)) {
+        if (entry.path().extension() == ".tmp") {
+            std::filesystem::remove(entry.path(), ec);
+        } else {
+            kept += entry.file_size(ec);
+        }
+    }
+    Kept(kept, false);
+    dataShards = initDataShards;
+    parityShards = initParityShards;
+    repairSeconds = initRepairSeconds;
+    stop = false;
+    worker = std::thread(&ErasureCoder::Run, this);
+    running = true;
+    FALCON_LOG(LOG_INFO) << "ErasureCoder: " << dataShards << "+" << parityShards << " shards under " << shardDir;
+    return 0;
+}
+
+void ErasureCoder::Stop()
+{
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        codings.clear();
+        queue.clear();
+    }
+    doneCv.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(locationMutex);
+        locations.clear();
+        locationOrder.clear();
+    }
+    Kept(-shardBytes.load(), false);
+}
+
+void ErasureCoder::Kick()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    cv.notify_all();
+}
+
+void ErasureCoder::Enqueue(uint64_t inodeId, uint64_t size)
+{
+    if (!Enabled() || size == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [it, added] = codings.try_emplace(inodeId);
+        it->second.size = size;
+        it->second.version++;
+        /* one in flight is queued again when it is over */
+        if (!added) {
+            return;
+        }
+        queue.push_back(inodeId);
+    }
+    cv.notify_all();
+}
+
+size_t ErasureCoder::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return codings.size();
+}
+
+std::string ErasureCoder::ShardPath(uint64_t inodeId) const { return shardDir + "/" + std::to_string(inodeId); }
+
+void ErasureCoder::Kept(int64_t size, bool written)
+{
+    shardBytes += size;
+    DiskCache::GetInstance().Keep(size, written);
+}
+
+void ErasureCoder::RemoveShardFile(const std::string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && unlink(path.c_str()) == 0) {
+        Kept(-st.st_size, false);
+    }
+}
+
+std::string ErasureCoder::SerializeInfo(const ShardInfo &info)
+{
+    std::string data(EC_INFO_SIZE, '\0');
+    uint32_t words[] = {EC_SHARD_MAGIC, info.index, info.dataShards, info.parityShards, (uint32_t)info.owner};
+    memcpy(data.data(), words, sizeof(words));
+    memcpy(data.data() + sizeof(words), &info.fileSize, sizeof(uint64_t));
+    memcpy(data.data() + sizeof(words) + sizeof(uint64_t), &info.version, sizeof(uint64_t));
+    return data;
+}
+
+bool ErasureCoder::ParseInfo(const std::string &data, ShardInfo &info)
+{
+    uint32_t words[5];
+    if (data.size() != EC_INFO_SIZE) {
+        return false;
+    }
+    memcpy(words, data.data(), sizeof(words));
+    if (words[0] != EC_SHARD_MAGIC || words[1] >= words[2] + words[3]) {
+        return false;
+    }
+    info.index = words[1];
+    info.dataShards = words[2];
+    info.parityShards = words[3];
+    info.owner = (int)words[4];
+    memcpy(&info.fileSize, data.data() + sizeof(words), sizeof(uint64_t));
+    memcpy(&info.version, data.data() + sizeof(words) + sizeof(uint64_t), sizeof(uint64_t));
+    return true;
+}
+
+/*---------------------- coding ----------------------*/
+
+int ErasureCoder::PushChunk(int nodeId,
+                            uint64_t inodeId,
+                            const ShardInfo &info,
+                            uint64_t offset,
+                            const char *buf,
+                            size_t len)
+{
+    std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+    if (falconIOClient == nullptr) {
+        return -EHOSTUNREACH;
+    }
+    bool last = offset + len >= info.ShardSize();
+    int ret = 0;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        butil::IOBuf data;
+        data.append(buf, len);
+        ret = falconIOClient->PutShard(inodeId, info, offset, last, IOBufCrc32c(data), data);
+        if (ret != -EBADMSG) {
+            break;
+        }
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: chunk at " << offset << " of shard " << info.index << " of inode "
+                                << inodeId << " arrived damaged at node " << nodeId << ", sending it again";
+        FalconStats::GetInstance().stats[CHECKSUM_REFETCH]++;
+    }
+    return ret;
+}
+
+int ErasureCoder::Encode(uint64_t inodeId, uint64_t size)
+{
+    if (!Enabled() || size == 0) {
+        return 0;
+    }
+    StoreNode *storeNode = StoreNode::GetInstance();
+    ShardInfo info;
+    info.dataShards = dataShards;
+    info.parityShards = parityShards;
+    info.owner = storeNode->GetNodeId();
+    info.fileSize = size;
+    info.version =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    uint32_t total = dataShards + parityShards;
+    std::vector<int> nodes = storeNode->ShardNodes(info.owner, inodeId, total);
+    if (nodes.size() < total) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: " << nodes.size() << " other nodes are too few for " << total
+                                << " shards, inode " << inodeId << " is not coded";
+        return -ENODEV;
+    }
+
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: open " << fileName << " failed: " << strerror(err);
+        return -err;
+    }
+    ReedSolomon code(dataShards, parityShards);
+    uint64_t shardSize = info.ShardSize();
+    size_t chunk = std::min<uint64_t>(EC_CHUNK_SIZE, shardSize);
+    std::vector<std::vector<char>> shards(total, std::vector<char>(chunk));
+    int ret = 0;
+    for (uint64_t offset = 0; ret == 0 && offset < shardSize; offset += chunk) {
+        size_t len = std::min<uint64_t>(chunk, shardSize - offset);
+        std::vector<const char *> data;
+        std::vector<char *> parity;
+        for (uint32_t j = 0; ret == 0 && j < dataShards; ++j) {
+            uint64_t fileOffset = j * shardSize + offset;
+            size_t valid = fileOffset >= size ? 0 : std::min<uint64_t>(len, size - fileOffset);
+            if (valid > 0 && ReadAll(fd, shards[j].data(), valid, fileOffset) != (ssize_t)valid) {
+                ret = -EIO;
+            }
+            /* the last shards run past the end of the file, they are padded with zeros */
+            memset(shards[j].data() + valid, 0, len - valid);
+            data.push_back(shards[j].data());
+        }
+        for (uint32_t i = 0; i < parityShards; ++i) {
+            parity.push_back(shards[dataShards + i].data());
+        }
+        if (ret == 0) {
+            code.Encode(data, parity, len);
+        }
+        for (uint32_t i = 0; ret == 0 && i < total; ++i) {
+            info.index = i;
+            ret = PushChunk(nodes[i], inodeId, info, offset, shards[i].data(), len);
+        }
+    }
+    close(fd);
+    if (ret != 0) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: coding inode " << inodeId << " failed: " << strerror(-ret);
+        return ret;
+    }
+    std::vector<Holder> holders;
+    for (uint32_t i = 0; i < total; ++i) {
+        info.index = i;
+        holders.push_back({nodes[i], info});
+    }
+    RememberHolders(inodeId, std::move(holders));
+    FalconStats::GetInstance().stats[EC_ENCODE] += shardSize * total;
+    return 0;
+}
+
+std::vector<ErasureCoder::Holder> ErasureCoder::Locate(uint64_t inodeId, std::vector<int> *reachable)
+{
+    struct LocateState
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int outstanding = 0;
+        std::vector<Holder> holders;
+        std::vector<int> reachable;
+    };
+    auto state = std::make_shared<LocateState>();
+    StoreNode *storeNode = StoreNode::GetInstance();
+
+    for (int nodeId : storeNode->GetAllNodeId()) {
+        if (storeNode->IsLocal(nodeId)) {
+            ShardInfo info;
+            butil::IOBuf none;
+            int ret = ReadShard(inodeId, 0, 0, info, none);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->reachable.push_back(nodeId);
+            if (ret == 0) {
+                state->holders.push_back({nodeId, info});
+            }
+            continue;
+        }
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodeId);
+        if (falconIOClient == nullptr) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->outstanding++;
+        }
+        falconIOClient->ReadShardAsync(
+            inodeId,
+            0,
+            0,
+            EC_PROBE_TIMEOUT_MS,
+            [state, nodeId](int ret, const ShardInfo &info, uint32_t /*crc*/, butil::IOBuf & /*data*/) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->outstanding--;
+                if (ret == 0) {
+                    state->holders.push_back({nodeId, info});
+                }
+                /* a node without the shard answers too */
+                if (ret == 0 || ret == -ENOENT) {
+                    state->reachable.push_back(nodeId);
+                }
+                state->cv.notify_all();
+            });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state]() { return state->outstanding == 0; });
+    if (reachable != nullptr) {
+        *reachable = state->reachable;
+    }
+    return state->holders;
+}
+
+std::vector<ErasureCoder::Holder> ErasureCoder::Holders(uint64_t inodeId, bool &remembered)
+{
+    {
+        std::lock_guard<std::mutex> lock(locationMutex);
+        auto it = locations.find(inodeId);
+        remembered = it != locations.end();
+        if (remembered) {
+            locationOrder.splice(locationOrder.end(), locationOrder, it->second.order);
+            return it->second.holders;
+        }
+    }
+    std::vector<Holder> holders = Latest(Locate(inodeId));
+    if (!holders.empty()) {
+        RememberHolders(inodeId, holders);
+    }
+    return holders;
+}
+
+void ErasureCoder::RememberHolders(uint64_t inodeId, std::vector<Holder> holders)
+{
+    std::lock_guard<std::mutex> lock(locationMutex);
+    auto it = locations.find(inodeId);
+    if (it == locations.end()) {
+        if (locations.size() >= EC_LOCATIONS_MAX) {
+            locations.erase(locationOrder.front());
+            locationOrder.pop_front();
+        }
+        it = locations.emplace(inodeId, Location{}).first;
+        it->second.order = locationOrder.insert(locationOrder.end(), inodeId);
+    } else {
+        locationOrder.splice(locationOrder.end(), locationOrder, it->second.order);
+    }
+    it->second.holders = std::move(holders);
+}
+
+void ErasureCoder::ForgetHolders(uint64_t inodeId)
+{
+    std::lock_guard<std::mutex> lock(locationMutex);
+    auto it = locations.find(inodeId);
+    if (it != locations.end()) {
+        locationOrder.erase(it->second.order);
+        locations.erase(it);
+    }
+}
+
+std::vector<ErasureCoder::Holder> ErasureCoder::Latest(const std::vector<Holder> &holders)
+{
+    uint64_t version = 0;
+    for (const Holder &holder : holders) {
+        version = std::max(version, holder.info.version);
+    }
+    std::vector<Holder> latest;
+    for (const Holder &holder : holders) {
+        if (holder.info.version != version ||
+            std::any_of(latest.begin(), latest.end(), [&holder](const Holder &other) {
+                return other.info.index == holder.info.index;
+            })) {
+            continue;
+        }
+        latest.push_back(holder);
+    }
+    std::sort(latest.begin(), latest.end(), [](const Holder &a, const Holder &b) {
+        return a.info.index < b.info.index;
+    });
+    return latest;
+}
+
+std::vector<int> ErasureCoder::ReadChunks(uint64_t inodeId,
+                                          const std::vector<Holder> &holders,
+                                          uint64_t offset,
+                                          size_t len,
+                                          const std::vector<char *> &bufs)
+{
+    struct ReadState
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int outstanding = 0;
+        std::vector<int> results;
+    };
+    auto state = std::make_shared<ReadState>();
+    state->results.assign(holders.size(), -EHOSTUNREACH);
+    StoreNode *storeNode = StoreNode::GetInstance();
+
+    for (size_t i = 0; i < holders.size(); ++i) {
+        uint64_t version = holders[i].info.version;
+        char *buf = bufs[i];
+        if (storeNode->IsLocal(holders[i].nodeId)) {
+            ShardInfo info;
+            butil::IOBuf data;
+            int ret = ReadShard(inodeId, offset, len, info, data);
+            if (ret == 0 && info.version != version) {
+                ret = -ESTALE;
+            }
+            if (ret == 0) {
+                data.copy_to(buf, len);
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->results[i] = ret;
+            continue;
+        }
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(holders[i].nodeId);
+        if (falconIOClient == nullptr) {
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->outstanding++;
+        }
+        falconIOClient->ReadShardAsync(
+            inodeId,
+            offset,
+            len,
+            EC_READ_TIMEOUT_MS,
+            [state, i, len, buf, version](int ret, const ShardInfo &info, uint32_t crc, butil::IOBuf &data) {
+                if (ret == 0 && info.version != version) {
+                    /* coded again since it was located */
+                    ret = -ESTALE;
+                } else if (ret == 0 && (data.size() != len || IOBufCrc32c(data) != crc)) {
+                    FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+                    ret = -EBADMSG;
+                }
+                if (ret == 0) {
+                    data.copy_to(buf, len);
+                }
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->results[i] = ret;
+                state->outstanding--;
+                state->cv.notify_all();
+            });
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&state]() { return state->outstanding == 0; });
+    return state->results;
+}
+
+int ErasureCoder::DecodeStripe(uint64_t inodeId,
+                               const ReedSolomon &code,
+                               std::vector<Holder> &holders,
+                               uint64_t offset,
+                               size_t len,
+                               const std::vector<bool> &want,
+                               std::vector<std::vector<char>> &shards,
+                               bool &rebuilt)
+{
+    uint32_t total = code.DataShards() + code.ParityShards();
+    while (true) {
+        std::vector<const Holder *> byIndex(total, nullptr);
+        for (const Holder &holder : holders) {
+            byIndex[holder.info.index] = &holder;
+        }
+        bool decode = false;
+        for (uint32_t i = 0; i < total; ++i) {
+            decode = decode || (want[i] && byIndex[i] == nullptr);
+        }
+        /* wanted shards are read as they are, unless one is lost, then the first others rebuild them */
+        std::vector<Holder> from;
+        for (uint32_t i = 0; i < total; ++i) {
+            if (byIndex[i] != nullptr && (decode ? from.size() < code.DataShards() : want[i])) {
+                from.push_back(*byIndex[i]);
+            }
+        }
+        if (decode && from.size() < code.DataShards()) {
+            return -EIO;
+        }
+
+        std::vector<char *> bufs;
+        for (const Holder &holder : from) {
+            bufs.push_back(shards[holder.info.index].data());
+        }
+        std::vector<int> results = ReadChunks(inodeId, from, offset, len, bufs);
+        bool failed = false;
+        for (size_t i = 0; i < from.size(); ++i) {
+            if (results[i] == 0) {
+                continue;
+            }
+            FALCON_LOG(LOG_WARNING) << "ErasureCoder: read shard " << from[i].info.index << " of inode " << inodeId
+                                    << " from node " << from[i].nodeId << " failed: " << strerror(-results[i]);
+            int nodeId = from[i].nodeId;
+            std::erase_if(holders, [nodeId](const Holder &holder) { return holder.nodeId == nodeId; });
+            failed = true;
+        }
+        if (failed) {
+            continue;
+        }
+        if (!decode) {
+            return 0;
+        }
+
+        std::vector<char *> all;
+        std::vector<bool> present(total, false);
+        for (uint32_t i = 0; i < total; ++i) {
+            all.push_back(shards[i].data());
+        }
+        for (const Holder &holder : from) {
+            present[holder.info.index] = true;
+        }
+        rebuilt = true;
+        return code.Reconstruct(all, present, len) == 0 ? 0 : -EIO;
+    }
+}
+
+int ErasureCoder::Fill(uint64_t inodeId, uint64_t size, int fd, char *buf)
+{
+    if (!Enabled() || size == 0) {
+        return -ENOENT;
+    }
+    bool remembered = false;
+    std::vector<Holder> holders = Holders(inodeId, remembered);
+    int ret = FillFrom(inodeId, size, fd, buf, holders);
+    if (ret != 0 && remembered) {
+        /* the holders remembered may have left or the file been coded again since */
+        ForgetHolders(inodeId);
+        holders = Holders(inodeId, remembered);
+        ret = FillFrom(inodeId, size, fd, buf, holders);
+    }
+    if (ret == 0) {
+        /* without the holders that failed */
+        RememberHolders(inodeId, std::move(holders));
+    }
+    return ret;
+}
+
+int ErasureCoder::FillFrom(uint64_t inodeId, uint64_t size, int fd, char *buf, std::vector<Holder> &holders)
+{
+    if (holders.empty()) {
+        return -ENOENT;
+    }
+    const ShardInfo info = holders.front().info;
+    if (info.fileSize != size) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: shards of inode " << inodeId << " hold " << info.fileSize
+                                << " bytes, not " << size;
+        return -ENOENT;
+    }
+    ReedSolomon code(info.dataShards, info.parityShards);
+    if (!code.Valid() || holders.size() < info.dataShards) {
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: " << holders.size() << " of " << info.dataShards << "+"
+                              << info.parityShards << " shards of inode " << inodeId << " are left, it is lost";
+        return -EIO;
+    }
+
+    uint64_t shardSize = info.ShardSize();
+    size_t chunk = std::min<uint64_t>(EC_CHUNK_SIZE, shardSize);
+    uint32_t total = info.dataShards + info.parityShards;
+    std::vector<std::vector<char>> shards(total, std::vector<char>(chunk));
+    std::vector<bool> want(total, false);
+    std::fill(want.begin(), want.begin() + info.dataShards, true);
+    bool rebuilt = false;
+    for (uint64_t offset = 0; offset < shardSize; offset += chunk) {
+        size_t len = std::min<uint64_t>(chunk, shardSize - offset);
+        int ret = DecodeStripe(inodeId, code, holders, offset, len, want, shards, rebuilt);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "ErasureCoder: too few shards of inode " << inodeId << " could be read";
+            return ret;
+        }
+        for (uint32_t j = 0; j < info.dataShards; ++j) {
+            uint64_t fileOffset = j * shardSize + offset;
+            if (fileOffset >= size) {
+                break;
+            }
+            size_t valid = std::min<uint64_t>(len, size - fileOffset);
+            if (buf != nullptr) {
+                memcpy(buf + fileOffset, shards[j].data(), valid);
+            }
+            if (fd >= 0 && WriteAll(fd, shards[j].data(), valid, fileOffset) != (ssize_t)valid) {
+                return -EIO;
+            }
+        }
+    }
+    if (rebuilt) {
+        FalconStats::GetInstance().stats[EC_RECONSTRUCT] += size;
+    }
+    FALCON_LOG(LOG_INFO) << "ErasureCoder: inode " << inodeId << " filled from its shards"
+                         << (rebuilt ? ", rebuilt from parity" : "");
+    return 0;
+}
+
+void ErasureCoder::Drop(uint64_t inodeId)
+{
+    if (!Enabled()) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = codings.find(inodeId);
+        if (it != codings.end() && it->second.encoding) {
+            /* the worker drops it when the coding is over, the shards it pushed are dropped below */
+            it->second.cancelled = true;
+            doneCv.wait(lock, [&]() { return stop || codings.count(inodeId) == 0; });
+        } else if (it != codings.end()) {
+            queue.erase(std::find(queue.begin(), queue.end(), inodeId));
+            codings.erase(it);
+        }
+    }
+    StoreNode *storeNode = StoreNode::GetInstance();
+    for (int nodeId : storeNode->GetAllNodeId()) {
+        if (storeNode->IsLocal(nodeId)) {
+            DropShard(inodeId);
+            continue;
+        }
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodeId);
+        /* a node that misses it keeps a shard of an older version, the next coding outdates it */
+        if (falconIOClient != nullptr) {
+            falconIOClient->DropShard(inodeId, EC_PROBE_TIMEOUT_MS);
+        }
+    }
+}
+
+/*---------------------- shard store ----------------------*/
+
+int ErasureCoder::ReceiveShard(uint64_t inodeId,
+                               const ShardInfo &info,
+                               uint64_t offset,
+                               bool last,
+                               uint32_t crc,
+                               butil::IOBuf &data)
+{
+    if (!Enabled()) {
+        return -EOPNOTSUPP;
+    }
+    if (IOBufCrc32c(data) != crc) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: chunk at " << offset << " of shard " << info.index << " of inode "
+                                << inodeId << " fails its checksum";
+        FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+        return -EBADMSG;
+    }
+    uint64_t shardSize = info.ShardSize();
+    if (offset + data.size() > shardSize) {
+        return -EINVAL;
+    }
+    /* whoever reads the file next may have learned its holders before this coding */
+    ForgetHolders(inodeId);
+    /* shards share the disk with the cache, cache files are evicted to make room for them */
+    size_t chunkSize = data.size();
+    if (!DiskCache::GetInstance().PreAllocSpace(chunkSize)) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: no room for shard " << info.index << " of inode " << inodeId;
+        return -ENOSPC;
+    }
+    std::string tmpName = ShardPath(inodeId) + "." + std::to_string(info.version) + ".tmp";
+    struct stat st;
+    int64_t before = stat(tmpName.c_str(), &st) == 0 ? st.st_size : 0;
+    int ret = 0;
+    int fd = open(tmpName.c_str(), O_RDWR | O_CREAT | (offset == 0 ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        ret = -errno;
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: open " << tmpName << " failed: " << strerror(-ret);
+    }
+    while (ret == 0 && !data.empty()) {
+        ssize_t nwrite = data.pcut_into_file_descriptor(fd, offset);
+        if (nwrite < 0) {
+            ret = -errno;
+            FALCON_LOG(LOG_ERROR) << "ErasureCoder: write " << tmpName << " failed: " << strerror(-ret);
+            break;
+        }
+        offset += nwrite;
+    }
+    if (fd >= 0 && fstat(fd, &st) == 0) {
+        Kept(st.st_size - before, true);
+    }
+    DiskCache::GetInstance().FreePreAllocSpace(chunkSize);
+    if (ret != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        RemoveShardFile(tmpName);
+        return ret;
+    }
+    if (!last) {
+        close(fd);
+        return 0;
+    }
+
+    std::string encoded = SerializeInfo(info);
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size != shardSize) {
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: shard " << info.index << " of inode " << inodeId << " is short";
+        ret = -EIO;
+    } else if (fsetxattr(fd, EC_SHARD_XATTR, encoded.data(), encoded.size(), 0) != 0) {
+        ret = -errno;
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: set xattr of " << tmpName << " failed: " << strerror(-ret);
+    } else {
+        /* the shard is read back unchecked if this fails */
+        BlockChecksums checksums;
+        if (BlockChecksums::OfFile(fd, shardSize, checksums) == 0) {
+            checksums.Save(fd);
+        }
+    }
+    close(fd);
+    if (ret != 0) {
+        RemoveShardFile(tmpName);
+        return ret;
+    }
+
+    std::string shardName = ShardPath(inodeId);
+    std::lock_guard<std::mutex> lock(shardMutex);
+    /* a later coding of the file may have landed first */
+    ShardInfo current;
+    int oldFd = open(shardName.c_str(), O_RDONLY);
+    if (oldFd >= 0) {
+        bool newer = LoadInfo(oldFd, current) && current.version > info.version;
+        close(oldFd);
+        if (newer) {
+            RemoveShardFile(tmpName);
+            return 0;
+        }
+    }
+    int64_t replaced = stat(shardName.c_str(), &st) == 0 ? st.st_size : 0;
+    if (rename(tmpName.c_str(), shardName.c_str()) != 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: rename to " << shardName << " failed: " << strerror(err);
+        RemoveShardFile(tmpName);
+        return -err;
+    }
+    Kept(-replaced, false);
+    return 0;
+}
+
+int ErasureCoder::ReadShard(uint64_t inodeId, uint64_t offset, uint64_t size, ShardInfo &info, butil::IOBuf &data)
+{
+    if (!Enabled()) {
+        return -ENOENT;
+    }
+    std::string shardName = ShardPath(inodeId);
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(shardMutex);
+        fd = open(shardName.c_str(), O_RDONLY);
+    }
+    if (fd < 0) {
+        return -errno;
+    }
+    int ret = 0;
+    if (!LoadInfo(fd, info)) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: " << shardName << " has no valid shard header";
+        ret = -EBADMSG;
+    } else if (offset + size > info.ShardSize()) {
+        ret = -EINVAL;
+    } else if (size > 0) {
+        std::vector<char> buf(size);
+        BlockChecksums checksums;
+        if (ReadAll(fd, buf.data(), size, offset) != (ssize_t)size) {
+            ret = -EIO;
+        } else if (BlockChecksums::Load(fd, checksums) == 0 && checksums.FileSize() == info.ShardSize() &&
+                   !checksums.Mismatches(buf.data(), offset, size).empty()) {
+            /* the reader rebuilds the chunk from other shards */
+            FALCON_LOG(LOG_ERROR) << "ErasureCoder: shard " << info.index << " of inode " << inodeId
+                                  << " fails its checksums";
+            FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+            ret = -EBADMSG;
+        } else {
+            data.append(buf.data(), size);
+        }
+    }
+    close(fd);
+    return ret;
+}
+
+int ErasureCoder::DropShard(uint64_t inodeId)
+{
+    /* every node is told when a file is written again, so none reads it from its old shards */
+    ForgetHolders(inodeId);
+    std::lock_guard<std::mutex> lock(shardMutex);
+    struct stat st;
+    int64_t size = stat(ShardPath(inodeId).c_str(), &st) == 0 ? st.st_size : 0;
+    if (unlink(ShardPath(inodeId).c_str()) != 0) {
+        return errno == ENOENT ? 0 : -errno;
+    }
+    Kept(-size, false);
+    return 0;
+}
+
+/*---------------------- repair ----------------------*/
+
+void ErasureCoder::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto nextRepair = std::chrono::steady_clock::now() + std::chrono::seconds(repairSeconds);
+    while (!stop) {
+        if (!queue.empty()) {
+            EncodeNext(lock);
+            continue;
+        }
+        if (!pending && (repairSeconds == 0 || std::chrono::steady_clock::now() < nextRepair)) {
+            if (repairSeconds > 0) {
+                cv.wait_until(lock, nextRepair);
+            } else {
+                cv.wait(lock);
+            }
+            continue;
+        }
+        pending = false;
+        lock.unlock();
+        RepairOnce();
+        lock.lock();
+        nextRepair = std::chrono::steady_clock::now() + std::chrono::seconds(repairSeconds);
+    }
+}
+
+void ErasureCoder::EncodeNext(std::unique_lock<std::mutex> &lock)
+{
+    uint64_t inodeId = queue.front();
+    queue.pop_front();
+    /* codings are only erased by this worker while encoding is set */
+    Coding &coding = codings[inodeId];
+    coding.encoding = true;
+    uint64_t version = coding.version;
+    uint64_t size = coding.size;
+
+    lock.unlock();
+    Encode(inodeId, size);
+    lock.lock();
+
+    coding.encoding = false;
+    if (coding.cancelled || coding.version == version) {
+        codings.erase(inodeId);
+        doneCv.notify_all();
+    } else {
+        /* flushed again while it was coded */
+        queue.push_back(inodeId);
+    }
+}
+
+int ErasureCoder::RepairOnce()
+{
+    std::vector<uint64_t> inodeIds;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(shardDir, ec)) {
+        std::string name = entry.path().filename().string();
+        char *end = nullptr;
+        uint64_t inodeId = strtoull(name.c_str(), &end, 10);
+        if (!name.empty() && *end == '\0') {
+            inodeIds.push_back(inodeId);
+        }
+    }
+    int repaired = 0;
+    for (uint64_t inodeId : inodeIds) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            /* flushed files are coded first, a pass over many shards takes long */
+            while (!stop && !queue.empty()) {
+                EncodeNext(lock);
+            }
+            if (stop) {
+                break;
+            }
+        }
+        int ret = Repair(inodeId);
+        if (ret > 0) {
+            repaired += ret;
+        }
+    }
+    if (repaired > 0) {
+        FALCON_LOG(LOG_INFO) << "ErasureCoder: rebuilt " << repaired << " lost shards";
+    }
+    return repaired;
+}
+
+int ErasureCoder::Repair(uint64_t inodeId)
+{
+    ShardInfo mine;
+    butil::IOBuf none;
+    if (ReadShard(inodeId, 0, 0, mine, none) != 0) {
+        return 0;
+    }
+    StoreNode *storeNode = StoreNode::GetInstance();
+    std::vector<int> reachable;
+    std::vector<Holder> holders = Latest(Locate(inodeId, &reachable));
+    if (holders.empty()) {
+        return 0;
+    }
+    if (holders.front().info.version > mine.version) {
+        /* left from an older coding of the file */
+        DropShard(inodeId);
+        return 0;
+    }
+    /* every holder sees the same shards, the one with the lowest index repairs them */
+    if (!storeNode->IsLocal(holders.front().nodeId)) {
+        return 0;
+    }
+    uint32_t total = mine.dataShards + mine.parityShards;
+    std::vector<bool> want(total, true);
+    for (const Holder &holder : holders) {
+        want[holder.info.index] = false;
+    }
+    std::vector<uint32_t> lost;
+    for (uint32_t i = 0; i < total; ++i) {
+        if (want[i]) {
+            lost.push_back(i);
+        }
+    }
+    if (lost.empty()) {
+        return 0;
+    }
+    ReedSolomon code(mine.dataShards, mine.parityShards);
+    if (!code.Valid() || holders.size() < mine.dataShards) {
+        FALCON_LOG(LOG_ERROR) << "ErasureCoder: " << holders.size() << " of " << total << " shards of inode "
+                              << inodeId << " are left, it cannot be repaired";
+        return -EIO;
+    }
+
+    /* rebuilt shards go to nodes that answered, hold no shard of the file and are not its owner */
+    std::vector<int> targets;
+    for (int node : storeNode->ShardNodes(mine.owner, inodeId, storeNode->GetNumberofAllNodes())) {
+        if (std::find(reachable.begin(), reachable.end(), node) != reachable.end() &&
+            std::none_of(holders.begin(), holders.end(), [node](const Holder &holder) {
+                return holder.nodeId == node;
+            })) {
+            targets.push_back(node);
+        }
+    }
+    if (targets.size() < lost.size()) {
+        FALCON_LOG(LOG_WARNING) << "ErasureCoder: " << targets.size() << " nodes are free for " << lost.size()
+                                << " lost shards of inode " << inodeId;
+        lost.resize(targets.size());
+        if (lost.empty()) {
+            return 0;
+        }
+    }
+
+    uint64_t shardSize = mine.ShardSize();
+    size_t chunk = std::min<uint64_t>(EC_CHUNK_SIZE, shardSize);
+    std::vector<std::vector<char>> shards(total, std::vector<char>(chunk));
+    bool rebuilt = false;
+    for (uint64_t offset = 0; offset < shardSize; offset += chunk) {
+        size_t len = std::min<uint64_t>(chunk, shardSize - offset);
+        int ret = DecodeStripe(inodeId, code, holders, offset, len, want, shards, rebuilt);
+        for (size_t i = 0; ret == 0 && i < lost.size(); ++i) {
+            ShardInfo info = mine;
+            info.index = lost[i];
+            ret = PushChunk(targets[i], inodeId, info, offset, shards[lost[i]].data(), len);
+        }
+        if (ret != 0) {
+            FALCON_LOG(LOG_WARNING) << "ErasureCoder: repair of inode " << inodeId << " failed: " << strerror(-ret);
+            return ret;
+        }
+    }
+    /* located again with the shards rebuilt on their new holders */
+    ForgetHolders(inodeId);
+    FalconStats::GetInstance().stats[EC_REPAIR] += lost.size();
+    return lost.size();
+}
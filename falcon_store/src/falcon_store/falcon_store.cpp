@@ -4,13 +4,35 @@
 
 #include "falcon_store/falcon_store.h"
 
+#include <sys/stat.h>
+#include <climits>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <numeric>
+
+#include <bthread/condition_variable.h>
+#include <bthread/mutex.h>
+
 #include "conf/falcon_property_key.h"
 #include "connection/node.h"
 #include "disk_cache/disk_cache.h"
 #include "falcon_code.h"
+#include "falcon_store/dedup_index.h"
+#include "falcon_store/erasure_coder.h"
+#include "falcon_store/kv_store.h"
+#include "falcon_store/prefetcher.h"
+#include "falcon_store/rebalancer.h"
+#include "falcon_store/replicator.h"
+#include "falcon_store/write_back.h"
 #include "init/falcon_init.h"
+#include "io_engine/io_engine.h"
 #include "stats/falcon_stats.h"
+#include "storage/checksum_storage.h"
+#include "storage/compressed_storage.h"
+#include "storage/mock_storage.h"
 #include "storage/obs_storage.h"
+#include "storage/posix_storage.h"
 #include "util/utils.h"
 
 void FalconStore::SetFalconStoreParam(std::string &newNodeConfig) { nodeConfig = newNodeConfig; }
@@ -23,6 +45,12 @@ FalconStore *FalconStore::GetInstance()
 
 void FalconStore::DeleteInstance()
 {
+    Prefetcher::GetInstance().Stop();
+    Rebalancer::GetInstance().Stop();
+    Replicator::GetInstance().Stop();
+    ErasureCoder::GetInstance().Stop();
+    KvStore::GetInstance().Stop();
+    WriteBack::GetInstance().Stop();
     StoreNode::DeleteInstance();
     if (storage) {
         storage->DeleteInstance();
@@ -54,12 +82,84 @@ int FalconStore::InitStore()
     isInference = config->GetBool(FalconPropertyKey::FALCON_IS_INFERENCE);
     toLocal = config->GetBool(FalconPropertyKey::FALCON_TO_LOCAL);
     std::string mountPath = config->GetString(FalconPropertyKey::FALCON_MOUNT_PATH);
+    std::string ioEngine = config->GetString(FalconPropertyKey::FALCON_IO_ENGINE);
+    uint32_t ioUringDepth = config->GetUint32(FalconPropertyKey::FALCON_IO_URING_DEPTH);
+    bool ioUringSqpoll = config->GetBool(FalconPropertyKey::FALCON_IO_URING_SQPOLL);
+    uint32_t readaheadMaxBlocks = config->GetUint32(FalconPropertyKey::FALCON_READAHEAD_MAX_BLOCKS);
+    uint32_t readaheadBudgetMb = config->GetUint32(FalconPropertyKey::FALCON_READAHEAD_BUDGET_MB);
+    bool streamRead = config->GetBool(FalconPropertyKey::FALCON_STREAM_READ);
+    uint32_t writeWindow = config->GetUint32(FalconPropertyKey::FALCON_WRITE_WINDOW);
+    uint32_t writeDirtyMb = config->GetUint32(FalconPropertyKey::FALCON_WRITE_DIRTY_MB);
+    bool memPoolHugePage = config->GetBool(FalconPropertyKey::FALCON_MEMPOOL_HUGEPAGE);
+    bool memPoolNuma = config->GetBool(FalconPropertyKey::FALCON_MEMPOOL_NUMA);
+    std::string nodeWeights = config->GetArray(FalconPropertyKey::FALCON_NODE_WEIGHTS);
+    uint32_t migrateBandwidthMb = config->GetUint32(FalconPropertyKey::FALCON_MIGRATE_BANDWIDTH_MB);
+    uint32_t migrateForwardSeconds = config->GetUint32(FalconPropertyKey::FALCON_MIGRATE_FORWARD_S);
+    uint32_t replicas = config->GetUint32(FalconPropertyKey::FALCON_REPLICAS);
+    hedgePercentile = config->GetUint32(FalconPropertyKey::FALCON_HEDGE_PERCENTILE);
+    uint32_t transferPartMb = config->GetUint32(FalconPropertyKey::FALCON_TRANSFER_PART_MB);
+    uint32_t transferConcurrency = config->GetUint32(FalconPropertyKey::FALCON_TRANSFER_CONCURRENCY);
+    std::string storageBackend = config->GetString(FalconPropertyKey::FALCON_STORAGE_BACKEND);
+    std::string storagePath = config->GetString(FalconPropertyKey::FALCON_STORAGE_PATH);
+    uint32_t mockLatencyUs = config->GetUint32(FalconPropertyKey::FALCON_MOCK_STORAGE_LATENCY_US);
+    uint32_t mockBandwidthMb = config->GetUint32(FalconPropertyKey::FALCON_MOCK_STORAGE_BANDWIDTH_MB);
+    uint32_t mockErrorPercent = config->GetUint32(FalconPropertyKey::FALCON_MOCK_STORAGE_ERROR_PERCENT);
+    uint32_t writeBackThreads = config->GetUint32(FalconPropertyKey::FALCON_WRITEBACK_THREADS);
+    std::string compress = config->GetString(FalconPropertyKey::FALCON_COMPRESS);
+    uint32_t compressBlockKb = config->GetUint32(FalconPropertyKey::FALCON_COMPRESS_BLOCK_KB);
+    std::string compressDirs = config->GetArray(FalconPropertyKey::FALCON_COMPRESS_DIRS);
+    bool dedup = config->GetBool(FalconPropertyKey::FALCON_DEDUP);
+    uint32_t dedupChunkKb = config->GetUint32(FalconPropertyKey::FALCON_DEDUP_CHUNK_KB);
+    peerFill = config->GetBool(FalconPropertyKey::FALCON_PEER_FILL);
+    uint32_t pinQuotaMb = config->GetUint32(FalconPropertyKey::FALCON_PIN_QUOTA_MB);
+    uint32_t prefetchDistance = config->GetUint32(FalconPropertyKey::FALCON_PREFETCH_DISTANCE);
+    uint32_t prefetchThreads = config->GetUint32(FalconPropertyKey::FALCON_PREFETCH_THREADS);
+    bool prefetchMemory = config->GetBool(FalconPropertyKey::FALCON_PREFETCH_MEMORY);
+    uint32_t downloadBlockKb = config->GetUint32(FalconPropertyKey::FALCON_DOWNLOAD_BLOCK_KB);
+    stripeWidth = config->GetUint32(FalconPropertyKey::FALCON_STRIPE_WIDTH);
+    uint32_t stripeUnitKb = config->GetUint32(FalconPropertyKey::FALCON_STRIPE_UNIT_KB);
+    std::string stripeDirList = config->GetArray(FalconPropertyKey::FALCON_STRIPE_DIRS);
+    checksum = config->GetBool(FalconPropertyKey::FALCON_CHECKSUM);
+    uint32_t ecDataShards = config->GetUint32(FalconPropertyKey::FALCON_EC_DATA_SHARDS);
+    uint32_t ecParityShards = config->GetUint32(FalconPropertyKey::FALCON_EC_PARITY_SHARDS);
+    uint32_t ecRepairSeconds = config->GetUint32(FalconPropertyKey::FALCON_EC_REPAIR_S);
+    uint64_t kvBlockSize = (uint64_t)config->GetUint32(FalconPropertyKey::FALCON_KV_BLOCK_KB) * 1024;
+    uint64_t kvDramBytes = (uint64_t)config->GetUint32(FalconPropertyKey::FALCON_KV_DRAM_MB) * 1024 * 1024;
+    uint64_t kvSsdBytes = (uint64_t)config->GetUint32(FalconPropertyKey::FALCON_KV_SSD_MB) * 1024 * 1024;
+    uint32_t kvTtlSeconds = config->GetUint32(FalconPropertyKey::FALCON_KV_TTL_S);
 
     FALCON_LOG(LOG_INFO) << "falcon_cache rootPath: " << rootPath;
 
     dataPath = rootPath;
     if (persistToStorage) {
-        storage = OBSStorage::GetInstance();
+        if (storageBackend.empty() || storageBackend == "obs") {
+            storage = OBSStorage::GetInstance();
+        } else if (storageBackend == "posix") {
+            PosixStorage::GetInstance()->SetRootPath(storagePath);
+            storage = PosixStorage::GetInstance();
+        } else if (storageBackend == "mock") {
+            MockStorage::GetInstance()->SetFaults(mockLatencyUs, mockBandwidthMb, mockErrorPercent);
+            storage = MockStorage::GetInstance();
+        } else {
+            FALCON_LOG(LOG_ERROR) << "unknown storage backend " << storageBackend;
+            return -EINVAL;
+        }
+        CodecType codec = CodecFromName(compress);
+        if (codec != CodecType::NONE) {
+            CompressedStorage::GetInstance()->Wrap(storage, codec, compressBlockKb * 1024, compressDirs,
+                                                   rootPath + "/compressing");
+            storage = CompressedStorage::GetInstance();
+        }
+        /* outermost, the checksums are of the data as the client sees it */
+        if (checksum) {
+            ChecksumStorage::GetInstance()->Wrap(storage);
+            storage = ChecksumStorage::GetInstance();
+        }
+        storage->SetTransferOptions((uint64_t)transferPartMb * 1024 * 1024, transferConcurrency);
+        if (downloadBlockKb > 0) {
+            downloadBlockSize = (uint64_t)downloadBlockKb * 1024;
+        }
+        downloadWorkers = std::max<uint32_t>(transferConcurrency, 1);
 
         ret = storage->Init();
         if (ret != FALCON_SUCCESS) {
@@ -69,6 +169,24 @@ int FalconStore::InitStore()
     }
 
     READ_BIGFILE_SIZE = bigFileReadSize;
+    stripeUnitSize = StripeLayout::Make(stripeWidth, (uint64_t)stripeUnitKb * 1024).unitSize;
+    stripeDirs.clear();
+    for (size_t begin = 0; begin <= stripeDirList.size();) {
+        size_t end = std::min(stripeDirList.find(',', begin), stripeDirList.size());
+        std::string dir = stripeDirList.substr(begin, end - begin);
+        begin = end + 1;
+        size_t last = dir.find_last_not_of('/');
+        if (last == std::string::npos) {
+            if (!dir.empty()) {
+                /* the root covers everything */
+                stripeDirs.clear();
+                break;
+            }
+            continue;
+        }
+        dir.resize(last + 1);
+        stripeDirs.push_back(dir[0] == '/' ? dir : "/" + dir);
+    }
     SetRootPath(rootPath);
     SetTotalDirectory(totalDirectory);
     float diskFreeRatio = 0;
@@ -77,17 +195,112 @@ int FalconStore::InitStore()
         diskFreeRatio = 1.0 - storageThreshold;
         bgDiskFreeRatio = 1.1 - storageThreshold;
     }
+    if (dedup) {
+        DedupIndex::GetInstance().Init(dedupChunkKb * 1024);
+        DiskCache::GetInstance().SetRemoveListener([](uint64_t inodeId) { DedupIndex::GetInstance().Forget(inodeId); });
+    }
+    DiskCache::GetInstance().SetPinQuota((uint64_t)pinQuotaMb * 1024 * 1024);
     ret = DiskCache::GetInstance().Start(rootPath, totalDirectory, diskFreeRatio, bgDiskFreeRatio);
     if (ret != 0) {
         FALCON_LOG(LOG_ERROR) << "DiskCache start failed";
         return 1;
     }
-    MemPool().GetInstance().init(FALCON_BLOCK_SIZE, preBlockNum);
+    MemPool::GetInstance().SetHugePage(memPoolHugePage);
+    MemPool::GetInstance().SetNuma(memPoolNuma);
+    MemPool::GetInstance().init(FALCON_BLOCK_SIZE, preBlockNum);
+    if (memPoolHugePage && !MemPool::GetInstance().initArena()) {
+        FALCON_LOG(LOG_WARNING) << "MemPool huge page arena init failed, use normal pages";
+    }
+    FixMemory::writeMemPool.SetHugePage(memPoolHugePage);
+    FixMemory::writeMemPool.SetNuma(memPoolNuma);
+    FixMemory::writeMemPool.init(WRITE_PAGE_SIZE, WRITE_POOL_PAGES);
+    if (memPoolHugePage && !FixMemory::writeMemPool.initArena()) {
+        FALCON_LOG(LOG_WARNING) << "write MemPool huge page arena init failed, use normal pages";
+    }
+    ReadaheadBudget::GetInstance().Init(readaheadMaxBlocks, (size_t)readaheadBudgetMb * 1024 * 1024);
+    ReadaheadBudget::GetInstance().SetStreamRead(streamRead);
+    WriteBudget::GetInstance().Init(writeWindow, (size_t)writeDirtyMb * 1024 * 1024);
+    ret = IoEngine::GetInstance().Init(ioEngine, ioUringDepth, ioUringSqpoll);
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "Falcon io engine init failed";
+        return 1;
+    }
     storeThreadPool = ThreadPool::CreateThreadPool(threadNum, 100000, "store thread pool");
     if (storeThreadPool == nullptr || storeThreadPool->Start() != 0) {
         FALCON_LOG(LOG_ERROR) << "Falcon threadpool init failed";
         return 1;
     }
+    if (persistToStorage && downloadWorkers > 1) {
+        downloadPool =
+            ThreadPool::CreateThreadPool((downloadWorkers - 1) * DOWNLOAD_POOL_FILES, 100000, "download thread pool");
+        if (downloadPool == nullptr || downloadPool->Start() != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon download threadpool init failed";
+            return 1;
+        }
+    }
+    StoreNode::GetInstance()->SetNodeWeights(nodeWeights);
+    StoreNode::GetInstance()->SetForwardSeconds(migrateForwardSeconds);
+    StoreNode::GetInstance()->SetReplicas(replicas);
+    ret = Rebalancer::GetInstance().Start(rootPath, migrateBandwidthMb, !isInference);
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "Falcon rebalancer start failed";
+        return 1;
+    }
+    if (replicas > 1) {
+        auto push = [this](uint64_t inodeId,
+                           uint64_t placementKey,
+                           int nodeId,
+                           const BlockChecksums *base,
+                           BlockChecksums &pushed) { return PushReplica(inodeId, placementKey, nodeId, base, pushed); };
+        ret = Replicator::GetInstance().Start(REPLICATE_THREADS, push);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon replicator start failed";
+            return 1;
+        }
+    }
+    /* only files whose cache is their one copy are coded */
+    if (ecDataShards > 0 && (!persistToStorage || toLocal)) {
+        ret = ErasureCoder::GetInstance().Start(rootPath, ecDataShards, ecParityShards, ecRepairSeconds);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon erasure coder start failed";
+            return 1;
+        }
+    }
+    if (kvDramBytes > 0 || kvSsdBytes > 0) {
+        ret = KvStore::GetInstance().Start(rootPath, kvBlockSize, kvDramBytes, kvSsdBytes, kvTtlSeconds);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon kv store start failed";
+            return 1;
+        }
+    }
+    /* with falcon_to_local a file stays on the node that wrote it whoever owns its placement key,
+     * so it is not moved on a membership change, the rebalancer only receives copies then */
+    StoreNode::GetInstance()->SetMembershipListener([this]() {
+        if (!toLocal) {
+            Rebalancer::GetInstance().Kick();
+        }
+        ErasureCoder::GetInstance().Kick();
+    });
+    /* also replays uploads queued before a restart when falcon_async is off now */
+    if (persistToStorage) {
+        auto upload = [this](uint64_t inodeId, const std::string &path) { return FlushToStorage(path, inodeId); };
+        ret = WriteBack::GetInstance().Start(rootPath, writeBackThreads, upload);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon write back start failed";
+            return 1;
+        }
+    }
+    if (prefetchDistance > 0) {
+        CacheAction action = prefetchMemory ? CacheAction::PREFETCH : CacheAction::WARMUP;
+        auto stage = [this, action](const PrefetchEntry &entry) {
+            return WarmupFile(entry.inodeId, entry.path, entry.size, action, true);
+        };
+        ret = Prefetcher::GetInstance().Start(prefetchThreads, prefetchDistance, stage);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "Falcon prefetcher start failed";
+            return 1;
+        }
+    }
 #ifdef ZK_INIT
     ret = StoreNode::GetInstance()->SetNodeConfig(rootPath);
     if (ret != 0) {
@@ -106,48 +319,9 @@ int FalconStore::InitStore()
     return 0;
 }
 
-std::string GetParentPath(const std::string &path, int level)
-{
-    // path start with '/'
-    std::string parentPath = "/";
-    if (level == -1) {
-        size_t endPos = path.size() - 1;
-        for (; endPos > 0; endPos--) {
-            if (path[endPos] == '/') {
-                break;
-            }
-        }
-        parentPath = path.substr(0, endPos);
-    } else {
-        char separator = '/';
-        std::stringstream ss(path);
-        std::string str;
-        std::vector<std::string> parentPathVec;
-        int tmpLevel = 1;
-        while (getline(ss, str, separator)) {
-            if (str.empty()) {
-                continue;
-            }
-            parentPathVec.push_back(str);
-            tmpLevel += 1;
-            if (tmpLevel >= level + 1) {
-                break;
-            }
-        };
-        if (tmpLevel == level + 1) {
-            for (int i = 0; i < level - 1; ++i) {
-                parentPath = parentPath + parentPathVec[i] + "/";
-            }
-        } else {
-            for (size_t i = 0; i < parentPathVec.size() - 1; ++i) {
-                parentPath = parentPath + parentPathVec[i] + "/";
-            }
-        }
-    }
-    return parentPath;
-}
+std::string GetParentPath(const std::string &path, int level) { return std::string(GetParentPathView(path, level)); }
 
-unsigned long myHash(std::string &str)
+unsigned long myHash(std::string_view str)
 {
     unsigned long hash = 5381;
     for (auto c : str) {
@@ -159,20 +333,53 @@ unsigned long myHash(std::string &str)
 
 int FalconStore::PathToNodeId(std::string &path)
 {
-    std::string parentPath = GetParentPath(path, parentPathLevel);
+    /* directories resolved before a membership change may belong to another node now */
+    uint64_t generation = StoreNode::GetInstance()->Generation();
+    if (nodeMapGeneration.exchange(generation) != generation) {
+        nodeMap.Clear();
+    }
+    std::string_view parentPath = GetParentPathView(path, parentPathLevel);
     if (!parentPath.empty()) {
-        std::unique_lock<std::mutex> lock(mutex);
-        if (nodeHash.count(parentPath) == 0) {
-            nodeHash[parentPath] = StoreNode::GetInstance()->AllocNode(myHash(parentPath));
-        }
-        return nodeHash[parentPath];
+        return nodeMap.GetOrAlloc(parentPath, [](std::string_view parent) {
+            return StoreNode::GetInstance()->AllocNode(myHash(parent));
+        });
     }
     return StoreNode::GetInstance()->AllocNode(myHash(parentPath));
 }
 
+/* the key AllocNodeId places a file by, so a cache file can be moved when its owner changes */
+uint64_t FalconStore::PlacementKey(uint64_t inodeId, std::string_view path)
+{
+    if (isInference && !StripeLayout::IsStripeInode(inodeId)) {
+        return myHash(GetParentPathView(path, parentPathLevel));
+    }
+    return inodeId;
+}
+
+/* the node a file opened now would be cached on */
+int FalconStore::OwnerNodeId(uint64_t inodeId, const std::string &path)
+{
+    /* stripes of a file are spread over the cluster whatever the placement of files */
+    if (StripeLayout::IsStripeInode(inodeId)) {
+        return StoreNode::GetInstance()->AllocNode(inodeId);
+    }
+    if (toLocal) {
+        return StoreNode::GetInstance()->GetNodeId();
+    }
+    if (isInference) {
+        std::string filePath = path;
+        return PathToNodeId(filePath);
+    }
+    return StoreNode::GetInstance()->AllocNode(inodeId);
+}
+
 void FalconStore::AllocNodeId(OpenInstance *openInstance)
 {
     if (openInstance->nodeId == -1) {
+        if (StripeLayout::IsStripeInode(openInstance->inodeId)) {
+            openInstance->nodeId = StoreNode::GetInstance()->AllocNode(openInstance->inodeId);
+            return;
+        }
         if (toLocal && DiskCache::GetInstance().HasFreeSpace()) {
             openInstance->nodeId = StoreNode::GetInstance()->GetNodeId();
             return;
@@ -204,8 +411,23 @@ int FalconStore::WriteLocalFileForBrpc(OpenInstance *openInstance, butil::IOBuf
         return -ENOSPC;
     }
     if (!isDirect) {
+        IoEngine &ioEngine = IoEngine::GetInstance();
         while (writeSize > 0) {
-            ssize_t nwrite = buf.pcut_into_file_descriptor(openInstance->physicalFd, offset, writeSize);
+            ssize_t nwrite = 0;
+            if (ioEngine.Type() == IoEngineType::IO_URING) {
+                /* hand the IOBuf blocks to the ring directly, the bthread is parked until done */
+                std::vector<struct iovec> iov;
+                for (size_t i = 0; i < buf.backing_block_num() && iov.size() < IOV_MAX; ++i) {
+                    butil::StringPiece block = buf.backing_block(i);
+                    iov.push_back({.iov_base = (void *)block.data(), .iov_len = block.size()});
+                }
+                nwrite = ioEngine.Pwritev(openInstance->physicalFd, iov.data(), iov.size(), offset);
+                if (nwrite > 0) {
+                    buf.pop_front(nwrite);
+                }
+            } else {
+                nwrite = buf.pcut_into_file_descriptor(openInstance->physicalFd, offset, writeSize);
+            }
             if (nwrite < 0 || nwrite > (ssize_t)writeSize) {
                 offset += nwrite > 0 ? nwrite : 0;
                 if ((uint64_t)offset > currentSize) {
@@ -224,27 +446,52 @@ int FalconStore::WriteLocalFileForBrpc(OpenInstance *openInstance, butil::IOBuf
             offset += nwrite;
         }
     } else {
-        int alignedNum = writeSize / 512 + static_cast<int>(writeSize % 512 != 0);
-        char *alignedBuf = (char *)aligned_alloc(512, 512 * alignedNum);
-        if (alignedBuf == nullptr) {
-            FALCON_LOG(LOG_ERROR) << "aligned_alloc failed: " << strerror(errno);
-            DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
-            return -ENOMEM;
+        /* blocks that are already aligned (e.g. received by rdma into registered memory) go as they are */
+        std::vector<struct iovec> iov;
+        bool aligned = offset % ALIGNMENT == 0 && buf.backing_block_num() <= IOV_MAX;
+        for (size_t i = 0; aligned && i < buf.backing_block_num(); ++i) {
+            butil::StringPiece block = buf.backing_block(i);
+            aligned = (uintptr_t)block.data() % ALIGNMENT == 0 && block.size() % ALIGNMENT == 0;
+            iov.push_back({.iov_base = (void *)block.data(), .iov_len = block.size()});
         }
-        size_t bytes_cut = buf.cutn(alignedBuf, writeSize);
-        if (bytes_cut < writeSize) {
-            FALCON_LOG(LOG_ERROR) << "WriteLocalFileForBrpc(): cntn not enough data in IOBuf";
-            DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
-            free(alignedBuf);
-            return -EIO;
+        ssize_t retSize = 0;
+        if (aligned) {
+            retSize = IoEngine::GetInstance().Pwritev(openInstance->physicalFd, iov.data(), iov.size(), offset);
+        } else {
+            size_t alignedSize = (writeSize + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            MemPool &memPool = MemPool::GetInstance();
+            bool pooled = alignedSize <= memPool.blockSize();
+            char *alignedBuf = pooled ? (char *)memPool.alloc() : nullptr;
+            if (alignedBuf == nullptr) {
+                pooled = false;
+                alignedBuf = (char *)aligned_alloc(ALIGNMENT, alignedSize);
+            }
+            if (alignedBuf == nullptr) {
+                FALCON_LOG(LOG_ERROR) << "aligned_alloc failed: " << strerror(errno);
+                DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
+                return -ENOMEM;
+            }
+            auto releaseBuf = [&]() {
+                if (pooled) {
+                    memPool.free(alignedBuf);
+                } else {
+                    free(alignedBuf);
+                }
+            };
+            size_t bytes_cut = buf.cutn(alignedBuf, writeSize);
+            if (bytes_cut < writeSize) {
+                FALCON_LOG(LOG_ERROR) << "WriteLocalFileForBrpc(): cntn not enough data in IOBuf";
+                DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
+                releaseBuf();
+                return -EIO;
+            }
+            retSize = IoEngine::GetInstance().Pwrite(openInstance->physicalFd, alignedBuf, writeSize, offset);
+            releaseBuf();
         }
-        ssize_t retSize = pwrite(openInstance->physicalFd, alignedBuf, writeSize, offset);
-        free(alignedBuf);
         if (retSize < 0) {
-            int err = errno;
-            FALCON_LOG(LOG_ERROR) << "WriteLocalFileForBrpc(): pwrite failed" << strerror(err);
+            FALCON_LOG(LOG_ERROR) << "WriteLocalFileForBrpc(): pwrite failed" << strerror(-retSize);
             DiskCache::GetInstance().FreePreAllocSpace(sizeToAdd);
-            return -err;
+            return retSize;
         }
         FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += retSize;
     }
@@ -262,6 +509,9 @@ int FalconStore::WriteLocalFileForBrpc(OpenInstance *openInstance, butil::IOBuf
 int FalconStore::WriteFile(OpenInstance *openInstance, const char *buf, size_t size, off_t offset)
 {
     FALCON_LOG(LOG_INFO) << "WriteFile(): called";
+    if (Striped(openInstance)) {
+        return StripedWrite(openInstance, buf, size, offset);
+    }
     int ret = 0;
     FalconWriteBuffer falconBuf{buf, size};
 
@@ -305,12 +555,17 @@ int FalconStore::WriteFile(OpenInstance *openInstance, const char *buf, size_t s
  */
 int FalconStore::ReadFile(OpenInstance *openInstance, char *buf, size_t size, off_t offset)
 {
+    /* a small striped file opened read only was read whole into its read buffer */
+    if (openInstance->readBuffer == nullptr && Striped(openInstance)) {
+        openInstance->isOpened = true;
+        return StripedRead(openInstance, buf, size, offset);
+    }
     int ret = 0;
     int err = 0;
     FalconReadBuffer falconBuf{buf, size};
 
     /* first persist the current write stream to let data to be read */
-    if (openInstance->writeStream.GetSize() > 0) {
+    if (openInstance->writeStream.GetSize() > 0 || openInstance->writeStream.GetInflightSize() > 0) {
         /* write will wait for local cache to be loaded from obs, so safe to call persist */
         FALCON_LOG(LOG_INFO) << "In ReadFile(): Persisting the written";
         ret = openInstance->writeStream.Complete(openInstance->currentSize.load(), true, false);
@@ -387,6 +642,41 @@ bool FalconStore::StartPreReadThreaded(OpenInstance *openInstance)
     return true;
 }
 
+/*
+ * Called by ReadToBuffer to start readStream again at offset, once the access shows a pattern
+ */
+bool FalconStore::RestartPreReadThreaded(OpenInstance *openInstance, ReadPattern pattern, off_t offset, size_t size)
+{
+    ReadStream &readStream = openInstance->readStream;
+    size_t pipeSize = FALCON_BLOCK_SIZE;
+    off_t step = FALCON_BLOCK_SIZE;
+    if (pattern == ReadPattern::STRIDED) {
+        pipeSize = size;
+        step = readStream.lastStride;
+    }
+    if (pipeSize > FALCON_BLOCK_SIZE || offset >= (off_t)openInstance->currentSize.load()) {
+        return false;
+    }
+    /* direct io on the remote side needs every segment aligned */
+    if ((openInstance->oflags & __O_DIRECT) && (offset % ALIGNMENT != 0 || pipeSize % ALIGNMENT != 0 || step % ALIGNMENT != 0)) {
+        return false;
+    }
+
+    int fileBlocks = (openInstance->currentSize - offset + step - 1) / step;
+    readStream.WaitPushEnded();
+    if (!readStream.Init(openInstance, fileBlocks, pipeSize, offset, step)) {
+        return false;
+    }
+    readStream.StartPushThreaded();
+    /* a write may have stopped the stream while it was being restarted */
+    if (openInstance->directReadFile.load()) {
+        readStream.StopPushThreaded();
+        return false;
+    }
+    openInstance->serialReadEnd = offset;
+    return true;
+}
+
 /*
  * Called by WriteFile to stop readStream in case of write
  */
@@ -412,12 +702,25 @@ int FalconStore::ReadToBuffer(FalconReadBuffer buf, OpenInstance *openInstance,
     /* for sequence read, make sure to read in order without concurrency */
     /* peek and store atomically */
     std::unique_lock<std::shared_mutex> offsetAndBuffLock(openInstance->fileMutex);
-    if (openInstance->directReadFile.load() || openInstance->serialReadEnd != offset) {
-        StopPreReadThreaded(openInstance);
+    if (openInstance->directReadFile.load()) {
         offsetAndBuffLock.unlock();
         return RandomRead(buf, openInstance, offset);
     }
-    return SequenceRead(buf, openInstance, offset);
+    ReadStream &readStream = openInstance->readStream;
+    ReadPattern pattern = readStream.Track(offset, buf.size);
+    if (!readStream.stop.load() && openInstance->serialReadEnd == offset &&
+        (!readStream.Strided() || buf.size == readStream.pipeCap)) {
+        return SequenceRead(buf, openInstance, offset);
+    }
+    /* access left the stream, pause it and read directly until a new pattern shows up */
+    if (!readStream.stop.load()) {
+        readStream.Pause();
+    }
+    if (pattern != ReadPattern::RANDOM && RestartPreReadThreaded(openInstance, pattern, offset, buf.size)) {
+        return SequenceRead(buf, openInstance, offset);
+    }
+    offsetAndBuffLock.unlock();
+    return RandomRead(buf, openInstance, offset);
 }
 
 /*
@@ -426,11 +729,12 @@ int FalconStore::ReadToBuffer(FalconReadBuffer buf, OpenInstance *openInstance,
 int FalconStore::RandomRead(FalconReadBuffer buf, OpenInstance *openInstance, off_t offset)
 {
     // read file directly, rather than from read stream
-    if ((openInstance->oflags & __O_DIRECT) == 0) {
+    /* only the local cache file needs an aligned buffer, the remote node aligns its own */
+    if ((openInstance->oflags & __O_DIRECT) == 0 || !StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
         return ReadFileLR(buf.ptr, offset, openInstance, buf.size);
     } else {
-        int alignedNum = buf.size / 512 + static_cast<int>(buf.size % 512 != 0);
-        char *alignedBuf = (char *)aligned_alloc(512, 512 * alignedNum);
+        size_t alignedSize = (buf.size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        char *alignedBuf = (char *)aligned_alloc(ALIGNMENT, alignedSize);
         if (alignedBuf == nullptr) {
             FALCON_LOG(LOG_ERROR) << "aligned_alloc failed: " << strerror(errno);
             return -ENOMEM;
@@ -453,12 +757,20 @@ int FalconStore::RandomRead(FalconReadBuffer buf, OpenInstance *openInstance, of
 /*
  * Called to read readStream
  */
-int FalconStore::SequenceRead(FalconReadBuffer buf, OpenInstance *openInstance, off_t /*offset*/)
+int FalconStore::SequenceRead(FalconReadBuffer buf, OpenInstance *openInstance, off_t offset)
 {
     // read file from read stream
-    int retSize = openInstance->readStream.WaitPop(buf.ptr, buf.size);
+    ReadStream &readStream = openInstance->readStream;
+    int retSize = readStream.WaitPop(buf.ptr, buf.size);
+    if (retSize == -EPIPE) {
+        /* remote stream lost, drop it and read the block directly */
+        FALCON_LOG(LOG_WARNING) << "SequenceRead(): remote stream closed early, read directly";
+        readStream.Pause();
+        return RandomRead(buf, openInstance, offset);
+    }
     if (retSize > 0) {
-        openInstance->serialReadEnd += retSize;
+        /* serialReadEnd is where the stream expects the next read */
+        openInstance->serialReadEnd = readStream.Strided() ? offset + readStream.step : offset + retSize;
     }
     return retSize;
 }
@@ -468,8 +780,14 @@ int FalconStore::SequenceRead(FalconReadBuffer buf, OpenInstance *openInstance,
  * local file read, if failed read obs
  * remote file read, if failed read obs
  * local file read called by rpc, if failed return failure
+ * with remoteData, data read from a remote node is left there instead of copied to readBuffer,
+ * readBuffer may then be nullptr and nothing is read from obs, the caller reads it with a buffer
  */
-ssize_t FalconStore::ReadFileLR(char *readBuffer, off_t offset, OpenInstance *openInstance, size_t readBufferSize)
+ssize_t FalconStore::ReadFileLR(char *readBuffer,
+                                off_t offset,
+                                OpenInstance *openInstance,
+                                size_t readBufferSize,
+                                butil::IOBuf *remoteData)
 {
     if (offset >= (ssize_t)openInstance->currentSize) {
         return 0;
@@ -478,25 +796,30 @@ ssize_t FalconStore::ReadFileLR(char *readBuffer, off_t offset, OpenInstance *op
     ssize_t checkReadLength = std::min(readBufferSize, openInstance->currentSize - offset);
 
     if (StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
-        if (openInstance->physicalFd != UINT64_MAX && !fileLock.TestLocked(openInstance->inodeId, LockMode::X)) {
+        /* a file still downloading is read once the range landed, or from obs if the download failed */
+        bool readable = openInstance->physicalFd != UINT64_MAX;
+        if (readable && openInstance->download != nullptr) {
+            readable = openInstance->download->Wait(offset, checkReadLength) == 0;
+        } else if (readable) {
+            readable = !fileLock.TestRangeLocked(openInstance->inodeId, offset, readBufferSize, LockMode::X);
+        }
+        /* a damaged range the cache file can not be repaired for is read from obs below */
+        if (readable && VerifyCacheRange(openInstance, offset, checkReadLength) != 0) {
+            readable = false;
+        }
+        if (readable) {
             /* not locked, read cache file */
             FalconStats::GetInstance().stats[BLOCKCACHE_READ] += checkReadLength;
-            retSize = pread(openInstance->physicalFd, readBuffer, readBufferSize, offset);
+            IoEngine &ioEngine = IoEngine::GetInstance();
+            retSize = ioEngine.Pread(openInstance->physicalFd, readBuffer, readBufferSize, offset);
+            if (retSize == -EAGAIN) {
+                retSize = ioEngine.Pread(openInstance->physicalFd, readBuffer, checkReadLength, offset);
+            }
             if (retSize != checkReadLength) {
-                int err = errno;
-                if (err == EAGAIN) {
-                    retSize = pread(openInstance->physicalFd, readBuffer, checkReadLength, offset);
-                    if (retSize != checkReadLength) {
-                        err = errno;
-                        FALCON_LOG(LOG_ERROR) << "In ReadFileLR(): pread fd = " << openInstance->physicalFd
-                                              << " failed : " << strerror(err);
-                        retSize = -err;
-                    }
-                } else {
-                    FALCON_LOG(LOG_ERROR)
-                        << "In ReadFileLR(): pread fd = " << openInstance->physicalFd << " failed : " << strerror(err);
-                    retSize = -err;
-                }
+                int err = retSize < 0 ? -retSize : EIO;
+                FALCON_LOG(LOG_ERROR) << "In ReadFileLR(): pread fd = " << openInstance->physicalFd
+                                      << " failed : " << strerror(err);
+                retSize = -err;
             }
         }
     } else {
@@ -513,7 +836,8 @@ ssize_t FalconStore::ReadFileLR(char *readBuffer, off_t offset, OpenInstance *op
                                                        openInstance->physicalFd,
                                                        readBufferSize,
                                                        offset,
-                                                       openInstance->path);
+                                                       openInstance->path,
+                                                       remoteData);
                     if (retSize == -ETIMEDOUT) {
                         sleep(BRPC_RETRY_DELEY);
                         FALCON_LOG(LOG_ERROR) << "Reach timeout, retry num is " << i;
@@ -530,7 +854,7 @@ ssize_t FalconStore::ReadFileLR(char *readBuffer, off_t offset, OpenInstance *op
         }
     }
     /* Read cache file failed and called by fuse not rpc -> read obs */
-    if (retSize < 0 && !openInstance->isRemoteCall && persistToStorage) {
+    if (retSize < 0 && !openInstance->isRemoteCall && persistToStorage && readBuffer != nullptr) {
         FALCON_LOG(LOG_DEBUG) << "ReadFile from obs : " << openInstance->path;
         retSize = storage->ReadObject(openInstance->path.substr(1), offset, readBufferSize, -1, readBuffer);
         if (retSize < 0) {
@@ -551,11 +875,20 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
     FALCON_LOG(LOG_INFO) << "OpenFile(): called by " << (openInstance->isRemoteCall ? "remote" : "fuse");
     int ret = 0;
     int err = 0;
+    /* a striped file has no cache file of its own, its stripes are opened as they are accessed */
+    if (StripeLayout::IsStriped(openInstance->nodeId)) {
+        return 0;
+    }
     if (openInstance->physicalFd == UINT64_MAX) {
         /* nodeId of a new file is allocated */
         AllocNodeId(openInstance);
+        if (!openInstance->isRemoteCall) {
+            Prefetcher::GetInstance().Accessed(openInstance->inodeId);
+        }
 
-        if (!StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
+        if (OpenDuringMigration(openInstance, true) == 0 || OpenReplica(openInstance, true) == 0) {
+            FALCON_LOG(LOG_INFO) << "OpenFile(): opened cached file at node " << openInstance->nodeId;
+        } else if (!StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
             /* file resides on remote node */
             bool largeFile = true;
             ret = OpenFileFromRemote(openInstance, largeFile);
@@ -569,6 +902,10 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
             if (openInstance->nodeFail) {
                 DiskCache::GetInstance().DeleteOldCacheWithNoPin(openInstance->inodeId);
             }
+            /* backups must not serve the old content while the file is written */
+            if ((openInstance->oflags & O_ACCMODE) != O_RDONLY) {
+                DropReplicas(openInstance->inodeId, openInstance->path);
+            }
             if (DiskCache::GetInstance().Find(openInstance->inodeId, true)) {
                 /* Cache Hits: read file from cache */
                 int localFd = open(fileName.c_str(), openInstance->oflags, 0755);
@@ -579,6 +916,13 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
                     return -err;
                 }
                 openInstance->physicalFd = static_cast<uint64_t>(localFd);
+                /* blocks are read back through the page cache to check them */
+                BlockChecksums checksums;
+                if (checksum && (openInstance->oflags & (O_ACCMODE | __O_DIRECT)) == O_RDONLY &&
+                    BlockChecksums::Load(localFd, checksums) == 0 &&
+                    checksums.FileSize() == openInstance->originalSize) {
+                    openInstance->verifier = std::make_shared<CacheVerifier>(std::move(checksums));
+                }
                 FALCON_LOG(LOG_INFO) << "OpenFile(): Opened existed local file " << fileName
                                      << " , fd = " << openInstance->physicalFd;
             } else {
@@ -586,7 +930,9 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
                 if ((openInstance->oflags & O_ACCMODE) != O_RDONLY) {
                     /* Cache Miss: WR/RDWR case, sync load file from obs */
                     if ((openInstance->oflags & O_CREAT) == 0 && openInstance->originalSize > 0) {
-                        if (!persistToStorage) {
+                        /* a file that just changed owner is taken from its previous owner first */
+                        ret = FetchFromPreviousOwner(openInstance);
+                        if (ret != 0 && !persistToStorage && !ErasureCoder::GetInstance().Enabled()) {
                             if (access(fileName.c_str(), F_OK) == 0) {
                                 FALCON_LOG(LOG_ERROR) << "OpenFile(): cache file " << fileName
                                                       << " missing in diskCache but exists in ext for write";
@@ -595,10 +941,12 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
                             }
                             return -ENOENT;
                         }
-                        FALCON_LOG(LOG_INFO) << "OpenFile(): Loading evicted write only cache file";
-                        ret = DownLoadFromStorage(openInstance, true);
                         if (ret != 0) {
-                            return ret;
+                            FALCON_LOG(LOG_INFO) << "OpenFile(): Loading evicted write only cache file";
+                            ret = DownLoadFromStorage(openInstance, true);
+                            if (ret != 0) {
+                                return ret;
+                            }
                         }
                         /* file is pinned in disk cache now */
                     }
@@ -612,13 +960,18 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
                     openInstance->physicalFd = static_cast<uint64_t>(localFd);
                     /* here insert the new file to disk cache and pin, visible to other user */
                     if (openInstance->originalSize == 0 || (openInstance->oflags & O_CREAT) != 0) {
+                        SetPlacementKey(localFd, PlacementKey(openInstance->inodeId, openInstance->path));
                         DiskCache::GetInstance().InsertAndUpdate(openInstance->inodeId, 0, true);
                     }
                     FALCON_LOG(LOG_INFO) << "OpenFile(): create local cache file " << fileName
                                          << " , fd = " << openInstance->physicalFd;
                 } else {
                     /* Cache Miss: RD case, background load file from obs */
-                    if (!persistToStorage) {
+                    if (openInstance->cacheOnly) {
+                        return -ENOENT;
+                    }
+                    /* a coded file is rebuilt from its shards */
+                    if (!persistToStorage && !ErasureCoder::GetInstance().Enabled()) {
                         if (access(fileName.c_str(), F_OK) == 0) {
                             FALCON_LOG(LOG_ERROR) << "OpenFile(): cache file " << fileName
                                                   << " missing in diskCache but exists in ext for read";
@@ -632,8 +985,22 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
                     if (ret != 0) {
                         return ret;
                     }
+                    /* reads are served from the cache file as their ranges land */
+                    if (openInstance->download != nullptr) {
+                        int localFd = open(fileName.c_str(), openInstance->oflags);
+                        if (localFd < 0) {
+                            openInstance->download = nullptr;
+                        } else {
+                            openInstance->physicalFd = static_cast<uint64_t>(localFd);
+                        }
+                    }
                 }
             }
+            /* the content is about to change, checksums and shards are made again when it is flushed */
+            if ((openInstance->oflags & O_ACCMODE) != O_RDONLY && openInstance->physicalFd != UINT64_MAX) {
+                BlockChecksums::Drop(openInstance->physicalFd);
+                ErasureCoder::GetInstance().Drop(openInstance->inodeId);
+            }
         }
         openInstance->writeStream.SetInodeId(openInstance->inodeId);
         openInstance->writeStream.SetDirect(openInstance->oflags & __O_DIRECT);
@@ -646,6 +1013,7 @@ int FalconStore::OpenFile(OpenInstance *openInstance)
 /*
  * Called by OpenFile and ReadSmallFile, sync or async load obs.
  * if toBuffer == true, isSync should be true, or buffer useless
+ * A miss of a file that is being downloaded already joins that download instead of starting one.
  */
 int FalconStore::DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bool toBuffer)
 {
@@ -656,6 +1024,11 @@ int FalconStore::DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bo
     std::shared_ptr<char> readBuffer = openInstance->readBuffer;
     size_t bufSize = openInstance->readBufferSize;
 
+    std::shared_ptr<FileDownload> download = downloads.Find(inodeId);
+    if (download != nullptr) {
+        return JoinDownload(openInstance, download, isSync, toBuffer);
+    }
+
     /* isSync == true will wait to get file lock. or it will try to get lock */
     auto lockerPtr = std::make_shared<FileLocker>(&fileLock, inodeId, LockMode::X, isSync);
     if (lockerPtr == nullptr) {
@@ -663,6 +1036,7 @@ int FalconStore::DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bo
     }
     if (!lockerPtr->isLocked()) {
         FALCON_LOG(LOG_INFO) << "DownLoadFromStorage(): No need to load obs, other acquired the lock, abort";
+        openInstance->download = downloads.Find(inodeId);
         return 0;
     }
 
@@ -677,36 +1051,72 @@ int FalconStore::DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bo
         return -ENOSPC;
     }
 
-    /* here cache file must not exist */
-    auto fd = open(fileName.c_str(), O_WRONLY | O_CREAT, 0755);
+    /* here cache file must not exist, it is read back to check it once it landed */
+    auto fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0755);
     if (fd < 0) {
         int err = errno;
         FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Create local file for loading failed: " << strerror(err);
         DiskCache::GetInstance().FreePreAllocSpace(fileSize);
         return -err;
     }
-
-    /* pass a copy of shared_ptr to make sure destructed */
-    auto loadObs = [=, this]() {
-        int size = 0;
-        if (toBuffer) {
-            size = storage->ReadObject(path.substr(1), 0, bufSize, fd, readBuffer.get());
+    SetPlacementKey(fd, PlacementKey(inodeId, path));
+    /* blocks of whole checksum blocks are checked as they land, readers never see unchecked data */
+    uint64_t blockSize = downloadBlockSize;
+    std::shared_ptr<const BlockChecksums> expected;
+    if (checksum && persistToStorage && storage == ChecksumStorage::GetInstance()) {
+        expected = ChecksumStorage::GetInstance()->GetChecksums(path.substr(1));
+        if (expected != nullptr && expected->FileSize() == fileSize) {
+            blockSize = (downloadBlockSize + expected->BlockSize() - 1) / expected->BlockSize() * expected->BlockSize();
         } else {
-            size = storage->ReadObject(path.substr(1), 0, 0, fd, nullptr);
+            /* a sidecar of another size is left from an upload that did not finish */
+            expected = nullptr;
+        }
+    }
+    /* published only after the cache file exists, so every download found can be read */
+    download = downloads.Start(inodeId, fileSize, blockSize);
+    if (!isSync) {
+        openInstance->download = download;
+    }
+
+    /* pass a copy of shared_ptr to make sure destructed, the lock is held until the download ends */
+    auto loadObs = [=, this, locker = lockerPtr]() {
+        int ret = 0;
+        uint64_t loadSize = toBuffer ? bufSize : fileSize;
+        char *buf = toBuffer ? readBuffer.get() : nullptr;
+        /* shards are tried before storage, they are closer */
+        bool fromPeer = FillFromPeer(inodeId, path, loadSize, fd, buf) == 0 ||
+                        ErasureCoder::GetInstance().Fill(inodeId, loadSize, fd, buf) == 0;
+        if (!fromPeer) {
+            if (!persistToStorage) {
+                ret = -ENOENT;
+            } else if (toBuffer) {
+                ret = storage->ReadObject(path.substr(1), 0, bufSize, fd, readBuffer.get()) < 0 ? -EIO : 0;
+                /* the buffer was checked, a block damaged on its way into the file is fetched again */
+                if (ret == 0 && expected != nullptr &&
+                    ChecksumStorage::GetInstance()->Verify(path.substr(1), fd, 0, bufSize, *expected) != 0) {
+                    ret = -EIO;
+                }
+            } else {
+                ret = FetchBlocks(path, fd, download, expected);
+            }
+        }
+        if (ret == 0 && checksum && loadSize == fileSize) {
+            /* storage reads were checked against expected, peer copies had its fingerprint */
+            SealCacheFile(fileName, fileSize, fromPeer ? nullptr : expected.get());
         }
 
         close(fd);
-        if (size < 0) {
+        if (ret != 0) {
             FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Loading file from obs failed";
             if (std::remove(fileName.c_str()) != 0) {
                 FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Delete obs tmp file failed" << strerror(errno);
             }
-            size = -EIO;
-        } else {
-            DiskCache::GetInstance().InsertAndUpdate(inodeId, fileSize, isSync);
         }
+        downloads.Finish(inodeId, download, ret, [&]() {
+            DiskCache::GetInstance().InsertAndUpdate(inodeId, fileSize, isSync);
+        });
         DiskCache::GetInstance().FreePreAllocSpace(fileSize);
-        return size < 0 ? size : 0;
+        return ret;
     };
 
     if (isSync) {
@@ -718,6 +1128,133 @@ int FalconStore::DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bo
     return 0;
 }
 
+/*
+ * Called by DownLoadFromStorage when the file is being downloaded already. A sync caller waits
+ * for the whole file and ends up with it pinned as if it had downloaded it, an async caller only
+ * keeps the download to wait for the ranges it reads.
+ */
+int FalconStore::JoinDownload(OpenInstance *openInstance,
+                              std::shared_ptr<FileDownload> download,
+                              bool isSync,
+                              bool toBuffer)
+{
+    FalconStats::GetInstance().stats[DOWNLOAD_JOIN]++;
+    if (!isSync) {
+        openInstance->download = download;
+        return 0;
+    }
+    int ret = download->WaitAll();
+    if (ret != 0) {
+        return ret;
+    }
+    if (!DiskCache::GetInstance().Find(openInstance->inodeId, true)) {
+        /* evicted as soon as it landed */
+        return DownLoadFromStorage(openInstance, isSync, toBuffer);
+    }
+    if (toBuffer) {
+        ret = ReadFromDownload(openInstance->inodeId,
+                               download,
+                               openInstance->readBuffer.get(),
+                               openInstance->readBufferSize);
+        if (ret != 0) {
+            DiskCache::GetInstance().Unpin(openInstance->inodeId);
+        }
+    }
+    return ret;
+}
+
+/*
+ * Called by DownLoadFromStorage to load the blocks of download from storage into fd, with up to
+ * downloadWorkers requests at once: this thread and helpers from downloadPool, which only join
+ * while the pool has threads free. Blocks are fetched in the order download hands them out. With
+ * expected, a block is checked against it before it is marked landed, so waiting readers only
+ * see checked data.
+ */
+int FalconStore::FetchBlocks(const std::string &path,
+                             int fd,
+                             const std::shared_ptr<FileDownload> &download,
+                             const std::shared_ptr<const BlockChecksums> &expected)
+{
+    struct FetchState
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int active = 0;
+        bool closed = false;
+        std::atomic<bool> failed{false};
+    };
+    auto state = std::make_shared<FetchState>();
+    auto fetchBlocks = [this, state, object = path.substr(1), fd, download, expected]() {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        while (!state->failed && download->NextBlock(offset, size)) {
+            ssize_t ret = storage->ReadObject(object, offset, size, fd, nullptr);
+            if (ret != (ssize_t)size) {
+                FALCON_LOG(LOG_ERROR) << "FetchBlocks(): " << object << " block at " << offset << " failed: read "
+                                      << ret << " of " << size;
+                state->failed = true;
+                break;
+            }
+            if (expected != nullptr &&
+                ChecksumStorage::GetInstance()->Verify(object, fd, offset, size, *expected) != 0) {
+                state->failed = true;
+                break;
+            }
+            download->Complete(offset);
+        }
+    };
+    auto helper = [state, fetchBlocks]() {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->closed) {
+                /* picked up after the download was over, fd may be closed */
+                return;
+            }
+            state->active++;
+        }
+        fetchBlocks();
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->active--;
+        state->cv.notify_all();
+    };
+    for (uint32_t i = 1; downloadPool != nullptr && i < downloadWorkers; ++i) {
+        downloadPool->Submit({.taskName = "", .task = helper});
+    }
+    fetchBlocks();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->closed = true;
+    state->cv.wait(lock, [&state]() { return state->active == 0; });
+    return state->failed ? -EIO : 0;
+}
+
+/*
+ * Read the first size bytes of inodeId into buf once download landed them, 0 or -errno
+ */
+int FalconStore::ReadFromDownload(uint64_t inodeId,
+                                  const std::shared_ptr<FileDownload> &download,
+                                  char *buf,
+                                  size_t size)
+{
+    int ret = download->Wait(0, size);
+    if (ret != 0) {
+        return ret;
+    }
+    int localFd = open(GetFilePath(inodeId).c_str(), O_RDONLY);
+    if (localFd < 0) {
+        return -errno;
+    }
+    ssize_t retSize = IoEngine::GetInstance().Pread(localFd, buf, size, 0);
+    if (retSize == -EAGAIN) {
+        retSize = IoEngine::GetInstance().Pread(localFd, buf, size, 0);
+    }
+    close(localFd);
+    if (retSize != (ssize_t)size) {
+        return retSize < 0 ? (int)retSize : -EIO;
+    }
+    FalconStats::GetInstance().stats[BLOCKCACHE_READ] += size;
+    return 0;
+}
+
 /*
  * Called by OpenFile and ReadSmallFile. Large file try open and return, small file read obs if failed
  */
@@ -758,8 +1295,9 @@ int FalconStore::OpenFileFromRemote(OpenInstance *openInstance, bool largeFile)
                 retryNum--;
                 continue;
             }
-            /* in inference scenario, do not switch node in non-create case */
-            if (!persistToStorage && (openInstance->oflags & O_CREAT) == 0) {
+            /* in inference scenario, do not switch node in non-create case, unless the next node can
+             * rebuild the file from its shards */
+            if (!persistToStorage && (openInstance->oflags & O_CREAT) == 0 && !ErasureCoder::GetInstance().Enabled()) {
                 break;
             }
             auto backupNode = openInstance->nodeId;
@@ -768,7 +1306,7 @@ int FalconStore::OpenFileFromRemote(OpenInstance *openInstance, bool largeFile)
                                     << openInstance->nodeId;
             openInstance->nodeFail = true;
             if (isInference) {
-                nodeHash[GetParentPath(openInstance->path, parentPathLevel)] = openInstance->nodeId;
+                nodeMap.Set(GetParentPathView(openInstance->path, parentPathLevel), openInstance->nodeId);
             }
             if (StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
                 return OpenFile(openInstance);
@@ -802,6 +1340,12 @@ int FalconStore::OpenFileFromRemote(OpenInstance *openInstance, bool largeFile)
             return -EIO;
         }
         ret = 0;
+    } else if (ErasureCoder::GetInstance().Fill(openInstance->inodeId,
+                                                openInstance->readBufferSize,
+                                                -1,
+                                                openInstance->readBuffer.get()) == 0) {
+        FALCON_LOG(LOG_WARNING) << "OpenFileFromRemote(): small read remote failed, rebuilt from shards instead";
+        ret = 0;
     } else {
         FALCON_LOG(LOG_ERROR) << "OpenFileFromRemote(): small read file remote failed";
     }
@@ -809,45 +1353,503 @@ int FalconStore::OpenFileFromRemote(OpenInstance *openInstance, bool largeFile)
     return ret > 0 ? -ret : ret;
 }
 
-/*---------------------- close ----------------------*/
-
 /*
- * Called by flush/close on large file or any file after write
+ * Open, or read for small files, only if nodeId has the file cached, storage is never loaded.
+ * On success the file is served by nodeId for the rest of this open.
  */
-int FalconStore::CloseTmpFiles(OpenInstance *openInstance, bool isFlush, bool isSync)
+int FalconStore::OpenCachedAt(OpenInstance *openInstance, int nodeId, bool largeFile)
 {
-    FALCON_LOG(LOG_INFO) << "FalconStore::CloseTmpFiles() called to " << (isFlush ? "flush" : "close") << " file "
-                         << openInstance->path;
+    int ret = 0;
+    int owner = openInstance->nodeId;
+    openInstance->nodeId = nodeId;
+    if (StoreNode::GetInstance()->IsLocal(nodeId)) {
+        openInstance->cacheOnly = true;
+        ret = largeFile ? OpenFile(openInstance) : ReadSmallFiles(openInstance);
+        openInstance->cacheOnly = false;
+    } else {
+        std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+        LatencyTracker &latency = StoreNode::GetInstance()->Latency(nodeId);
+        auto start = std::chrono::steady_clock::now();
+        latency.Begin();
+        if (falconIOClient == nullptr) {
+            ret = -EHOSTUNREACH;
+        } else if (largeFile) {
+            uint64_t physicalFd = UINT64_MAX;
+            ret = falconIOClient->OpenFile(openInstance->inodeId,
+                                           openInstance->oflags,
+                                           physicalFd,
+                                           openInstance->originalSize,
+                                           openInstance->path,
+                                           false,
+                                           true);
+            if (ret == 0) {
+                openInstance->physicalFd = physicalFd;
+                openInstance->writeStream.SetClient(falconIOClient);
+            }
+        } else {
+            ret = falconIOClient->ReadSmallFile(openInstance->inodeId,
+                                                openInstance->originalSize,
+                                                openInstance->path,
+                                                openInstance->readBuffer.get(),
+                                                openInstance->oflags,
+                                                false,
+                                                true);
+        }
+        latency.End();
+        if (ret <= 0) {
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            latency.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        }
+    }
+    if (ret != 0) {
+        openInstance->nodeId = owner;
+    }
+    return ret > 0 ? -ret : ret;
+}
 
-    /* physical file should be opened after RW */
-    if (openInstance->physicalFd == UINT64_MAX) {
-        FALCON_LOG(LOG_WARNING) << "FalconStore::CloseTmpFiles() fd not set";
-        return 0;
+/*
+ * Within the forward window after a membership change, a read of a file whose owner changed is
+ * served by the new owner if it has the file already and by the previous owner otherwise, so
+ * it neither reloads storage nor fails without storage while the rebalancer moves the file.
+ */
+int FalconStore::OpenDuringMigration(OpenInstance *openInstance, bool largeFile)
+{
+    if (openInstance->isRemoteCall || openInstance->cacheOnly || toLocal ||
+        (openInstance->oflags & O_ACCMODE) != O_RDONLY) {
+        return -ENOENT;
     }
-    /* nodeId should be allocated after RW */
-    if (openInstance->nodeId == -1) {
-        FALCON_LOG(LOG_WARNING) << "FalconStore::CloseTmpFiles() nodeId not set";
+    int previous = StoreNode::GetInstance()->PreviousOwner(PlacementKey(openInstance->inodeId, openInstance->path));
+    if (previous < 0 || previous == openInstance->nodeId) {
+        return -ENOENT;
+    }
+    if (OpenCachedAt(openInstance, openInstance->nodeId, largeFile) == 0) {
         return 0;
     }
-    /* Above only happens if open failed */
+    FALCON_LOG(LOG_INFO) << "OpenDuringMigration(): " << openInstance->path << " not at node "
+                         << openInstance->nodeId << " yet, forward to " << previous;
+    return OpenCachedAt(openInstance, previous, largeFile);
+}
 
-    /* close may be called without flush */
-    int ret = 0;
-    if (isFlush) {
-        openInstance->isFlushed = true;
-    } else if (!openInstance->isFlushed) {
-        FALCON_LOG(LOG_WARNING) << "CloseTmpFiles(): close called without flush";
-        ret = CloseTmpFiles(openInstance, true, isSync);
-        if (ret != 0) {
-            FALCON_LOG(LOG_ERROR) << "CloseTmpFiles(): call flush in close failed";
-            openInstance->writeFail = true;
-        }
+/*
+ * Called by OpenFile when a write open misses the cache of the new owner. The file is copied
+ * from its previous owner instead of storage and is pinned in disk cache on success.
+ */
+int FalconStore::FetchFromPreviousOwner(OpenInstance *openInstance)
+{
+    uint64_t inodeId = openInstance->inodeId;
+    uint64_t fileSize = openInstance->originalSize;
+    int previous = StoreNode::GetInstance()->PreviousOwner(PlacementKey(inodeId, openInstance->path));
+    if (previous < 0 || StoreNode::GetInstance()->IsLocal(previous)) {
+        return -ENOENT;
     }
 
-    /* stop the possible preRead thread */
-    if (!isFlush && !openInstance->isRemoteCall) {
-        StopPreReadThreaded(openInstance);
-        openInstance->readStream.WaitPushEnded();
+    FileLocker locker(&fileLock, inodeId, LockMode::X, true);
+    if (DiskCache::GetInstance().Find(inodeId, true)) {
+        return 0;
+    }
+    if (!DiskCache::GetInstance().PreAllocSpace(fileSize)) {
+        FALCON_LOG(LOG_ERROR) << "FetchFromPreviousOwner(): Can not pre-allocate enough space!";
+        return -ENOSPC;
+    }
+
+    int ret = 0;
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0) {
+        ret = -errno;
+    } else {
+        SetPlacementKey(fd, PlacementKey(inodeId, openInstance->path));
+        ret = CopyFromPeer(previous, inodeId, openInstance->path, fileSize, fd, nullptr);
+        close(fd);
+    }
+
+    if (ret != 0) {
+        FALCON_LOG(LOG_WARNING) << "FetchFromPreviousOwner(): copy " << openInstance->path << " from node "
+                                << previous << " failed: " << strerror(-ret);
+        std::remove(fileName.c_str());
+        DiskCache::GetInstance().FreePreAllocSpace(fileSize);
+        return ret;
+    }
+    DiskCache::GetInstance().InsertAndUpdate(inodeId, fileSize, true);
+    DiskCache::GetInstance().FreePreAllocSpace(fileSize);
+    FALCON_LOG(LOG_INFO) << "FetchFromPreviousOwner(): copied " << openInstance->path << " from node " << previous;
+    return 0;
+}
+
+/*
+ * Copy size bytes of inodeId from the cache of nodeId to fd, and to buf unless it is nullptr or
+ * fd to -1. Storage is never loaded, -ENOENT if nodeId does not hold the file.
+ */
+int FalconStore::CopyFromPeer(int nodeId, uint64_t inodeId, const std::string &path, uint64_t size, int fd, char *buf)
+{
+    std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+    if (falconIOClient == nullptr) {
+        return -EHOSTUNREACH;
+    }
+    uint64_t remoteFd = UINT64_MAX;
+    int ret = falconIOClient->OpenFile(inodeId, O_RDONLY, remoteFd, size, path, false, true);
+    if (ret != 0) {
+        return ret > 0 ? -ret : ret;
+    }
+
+    off_t offset = 0;
+    while (ret == 0 && (uint64_t)offset < size) {
+        butil::IOBuf data;
+        int readSize = std::min<uint64_t>(FALCON_BLOCK_SIZE, size - offset);
+        ssize_t nread =
+            falconIOClient->ReadFile(inodeId, O_RDONLY, nullptr, remoteFd, readSize, offset, path, &data);
+        if (nread <= 0 || (uint64_t)offset + data.size() > size) {
+            ret = nread < 0 ? nread : -EIO;
+            break;
+        }
+        if (buf != nullptr) {
+            data.copy_to(buf + offset, data.size());
+        }
+        if (fd < 0) {
+            offset += data.size();
+            continue;
+        }
+        while (!data.empty()) {
+            ssize_t nwrite = data.pcut_into_file_descriptor(fd, offset);
+            if (nwrite < 0) {
+                ret = -errno;
+                break;
+            }
+            offset += nwrite;
+        }
+    }
+    falconIOClient->CloseFile(remoteFd, false, false, nullptr, 0, 0);
+    return ret;
+}
+
+/*
+ * Another node holding inodeId cached with size bytes, and the content of fingerprint if
+ * checkFingerprint, or -1 when none answers so within PEER_LOCATE_TIMEOUT_MS. Only the nodes
+ * likely to hold it are asked, at once: its owner before the last membership change, and the
+ * nodes first in its placement order, which hold its backups or owned it in smaller clusters.
+ * The first to hold the file is taken.
+ */
+int FalconStore::LocateCachedPeer(
+    uint64_t inodeId, const std::string &path, uint64_t size, bool checkFingerprint, uint32_t fingerprint)
+{
+    struct LocateState
+    {
+        bthread::Mutex mutex;
+        bthread::ConditionVariable cv;
+        int outstanding = 0;
+        int nodeId = -1;
+    };
+    auto state = std::make_shared<LocateState>();
+    StoreNode *storeNode = StoreNode::GetInstance();
+    uint64_t key = PlacementKey(inodeId, path);
+    std::vector<int> nodes = storeNode->RankedNodes(key, storeNode->Replicas() + PEER_LOCATE_RANKED);
+    int previous = storeNode->PreviousOwner(key);
+    if (previous >= 0 && std::find(nodes.begin(), nodes.end(), previous) == nodes.end()) {
+        nodes.push_back(previous);
+    }
+
+    for (int nodeId : nodes) {
+        if (storeNode->IsLocal(nodeId)) {
+            continue;
+        }
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodeId);
+        if (falconIOClient == nullptr) {
+            continue;
+        }
+        {
+            std::lock_guard<bthread::Mutex> lock(state->mutex);
+            state->outstanding++;
+        }
+        falconIOClient->LocateCacheAsync(inodeId, size, checkFingerprint, fingerprint, PEER_LOCATE_TIMEOUT_MS,
+                                         [state, nodeId](int ret) {
+                                             std::lock_guard<bthread::Mutex> lock(state->mutex);
+                                             state->outstanding--;
+                                             if (ret == 0 && state->nodeId < 0) {
+                                                 state->nodeId = nodeId;
+                                             }
+                                             state->cv.notify_all();
+                                         });
+    }
+
+    /* a bthread condition, misses are also filled in brpc handlers */
+    std::unique_lock<bthread::Mutex> lock(state->mutex);
+    while (state->nodeId < 0 && state->outstanding > 0) {
+        state->cv.wait(lock);
+    }
+    return state->nodeId;
+}
+
+/*
+ * Called on a cache miss before storage is read. The file is copied from another node that
+ * still holds it, e.g. its owner before ownership moved, so storage is only read when no node
+ * does. With storage behind the cache a copy must have the content storage has, as its checksum
+ * sidecar tells, files without one are not filled from peers. fd and buf as in CopyFromPeer.
+ */
+int FalconStore::FillFromPeer(uint64_t inodeId, const std::string &path, uint64_t size, int fd, char *buf)
+{
+    if (!peerFill || size == 0 || StoreNode::GetInstance()->GetNumberofAllNodes() <= 1) {
+        return -ENOENT;
+    }
+    uint32_t fingerprint = 0;
+    if (persistToStorage) {
+        BlockChecksums current;
+        if (storage != ChecksumStorage::GetInstance() ||
+            ChecksumStorage::GetInstance()->ReadChecksums(path.substr(1), current) != 0 ||
+            current.FileSize() != size) {
+            return -ENOENT;
+        }
+        fingerprint = current.Fingerprint();
+    }
+    int nodeId = LocateCachedPeer(inodeId, path, size, persistToStorage, fingerprint);
+    if (nodeId < 0) {
+        FalconStats::GetInstance().stats[PEER_FILL_MISS]++;
+        return -ENOENT;
+    }
+    int ret = CopyFromPeer(nodeId, inodeId, path, size, fd, buf);
+    if (ret != 0) {
+        FALCON_LOG(LOG_WARNING) << "FillFromPeer(): copy " << path << " from node " << nodeId
+                                << " failed: " << strerror(-ret) << ", load storage instead";
+        FalconStats::GetInstance().stats[PEER_FILL_MISS]++;
+        return ret;
+    }
+    FalconStats::GetInstance().stats[PEER_FILL] += size;
+    FALCON_LOG(LOG_INFO) << "FillFromPeer(): filled " << path << " from node " << nodeId;
+    return 0;
+}
+
+/*
+ * Read opens of a replicated file go to the replica with the least load, a local copy first. A
+ * replica that misses the file or cannot be reached is skipped for the next, so reads survive a
+ * dead node. -ENOENT when no replica has the file cached, the owner then loads it as usual.
+ */
+int FalconStore::OpenReplica(OpenInstance *openInstance, bool largeFile)
+{
+    if (StoreNode::GetInstance()->Replicas() <= 1 || openInstance->isRemoteCall || openInstance->cacheOnly ||
+        toLocal || (openInstance->oflags & O_ACCMODE) != O_RDONLY) {
+        return -ENOENT;
+    }
+    StoreNode *storeNode = StoreNode::GetInstance();
+    std::vector<int> nodes =
+        storeNode->ReplicaNodes(openInstance->nodeId, PlacementKey(openInstance->inodeId, openInstance->path));
+    std::stable_sort(nodes.begin(), nodes.end(), [storeNode](int a, int b) {
+        bool localA = storeNode->IsLocal(a);
+        if (localA != storeNode->IsLocal(b)) {
+            return localA;
+        }
+        return storeNode->Latency(a).Load() < storeNode->Latency(b).Load();
+    });
+
+    if (!largeFile && hedgePercentile > 0) {
+        if (storeNode->IsLocal(nodes.front())) {
+            if (OpenCachedAt(openInstance, nodes.front(), largeFile) == 0) {
+                return 0;
+            }
+            nodes.erase(nodes.begin());
+        }
+        return HedgedReadSmallFile(openInstance, nodes);
+    }
+    for (int node : nodes) {
+        if (OpenCachedAt(openInstance, node, largeFile) == 0) {
+            return 0;
+        }
+    }
+    return -ENOENT;
+}
+
+/*
+ * Read a small file from the first remote replica in nodes. When it has not answered within the
+ * hedge percentile of its latency, the next replica is asked as well, and right away when it
+ * fails; the first complete answer wins.
+ */
+int FalconStore::HedgedReadSmallFile(OpenInstance *openInstance, const std::vector<int> &nodes)
+{
+    struct HedgeState
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int outstanding = 0;
+        bool done = false;
+        int nodeId = -1;
+        butil::IOBuf data;
+    };
+    auto state = std::make_shared<HedgeState>();
+    StoreNode *storeNode = StoreNode::GetInstance();
+
+    auto send = [&](int nodeId) {
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodeId);
+        if (falconIOClient == nullptr) {
+            return false;
+        }
+        LatencyTracker *latency = &storeNode->Latency(nodeId);
+        auto start = std::chrono::steady_clock::now();
+        latency->Begin();
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->outstanding++;
+        }
+        falconIOClient->ReadSmallFileAsync(
+            openInstance->inodeId,
+            openInstance->originalSize,
+            openInstance->path,
+            openInstance->oflags,
+            true,
+            [state, nodeId, latency, start](int ret, butil::IOBuf &data) {
+                latency->End();
+                if (ret <= 0) {
+                    latency->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+                                        std::chrono::steady_clock::now() - start)
+                                        .count());
+                }
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->outstanding--;
+                if (ret == 0 && !state->done) {
+                    state->done = true;
+                    state->nodeId = nodeId;
+                    state->data.swap(data);
+                }
+                state->cv.notify_all();
+            });
+        return true;
+    };
+
+    size_t next = 0;
+    auto deadline = std::chrono::steady_clock::now();
+    auto answered = [&state]() { return state->done || state->outstanding == 0; };
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->done) {
+        if ((state->outstanding == 0 || std::chrono::steady_clock::now() >= deadline) && next < nodes.size()) {
+            int nodeId = nodes[next++];
+            lock.unlock();
+            bool sent = send(nodeId);
+            uint64_t delayUs = storeNode->Latency(nodeId).Percentile(hedgePercentile);
+            lock.lock();
+            if (sent) {
+                deadline = std::chrono::steady_clock::now() +
+                           std::chrono::microseconds(delayUs > 0 ? delayUs : HEDGE_DEFAULT_DELAY_US);
+            }
+            continue;
+        }
+        if (state->outstanding == 0) {
+            break;
+        }
+        if (next < nodes.size()) {
+            state->cv.wait_until(lock, deadline, answered);
+        } else {
+            state->cv.wait(lock, answered);
+        }
+    }
+    if (!state->done) {
+        return -ENOENT;
+    }
+    state->data.copy_to(openInstance->readBuffer.get(), openInstance->originalSize);
+    openInstance->nodeId = state->nodeId;
+    return 0;
+}
+
+/*
+ * Called on the owner of a replicated file when it is opened for write or deleted, backups drop
+ * their copy so reads cannot see old content. Backups that cannot be reached are skipped.
+ */
+void FalconStore::DropReplicas(uint64_t inodeId, const std::string &path)
+{
+    StoreNode *storeNode = StoreNode::GetInstance();
+    if (storeNode->Replicas() <= 1) {
+        return;
+    }
+    /* a copy still in flight would land after the drop */
+    Replicator::GetInstance().Cancel(inodeId);
+    std::vector<int> nodes = storeNode->ReplicaNodes(storeNode->GetNodeId(), PlacementKey(inodeId, path));
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodes[i]);
+        int ret = falconIOClient ? falconIOClient->DropCache(inodeId) : -EHOSTUNREACH;
+        if (ret != 0) {
+            FALCON_LOG(LOG_WARNING) << "DropReplicas(): drop " << path << " at node " << nodes[i]
+                                    << " failed: " << strerror(std::abs(ret));
+        }
+    }
+}
+
+/*
+ * Called on the owner of a replicated file when a write is flushed, the file is queued to be
+ * copied to every backup in the background
+ */
+void FalconStore::PushReplicas(uint64_t inodeId, const std::string &path)
+{
+    StoreNode *storeNode = StoreNode::GetInstance();
+    if (storeNode->Replicas() <= 1) {
+        return;
+    }
+    uint64_t placementKey = PlacementKey(inodeId, path);
+    std::vector<int> nodes = storeNode->ReplicaNodes(storeNode->GetNodeId(), placementKey);
+    if (nodes.size() > 1) {
+        nodes.erase(nodes.begin());
+        Replicator::GetInstance().Enqueue(inodeId, placementKey, std::move(nodes));
+    }
+}
+
+/*
+ * Called by the replicator to copy a file to one backup. A backup that fails to take it drops
+ * the copy it has, it must not serve an older version.
+ */
+int FalconStore::PushReplica(
+    uint64_t inodeId, uint64_t placementKey, int nodeId, const BlockChecksums *base, BlockChecksums &pushed)
+{
+    int ret = PushCacheFile(nodeId, inodeId, placementKey, true, true, nullptr, base, &pushed);
+    if (ret == 0 || ret == -EEXIST) {
+        return 0;
+    }
+    FALCON_LOG(LOG_WARNING) << "PushReplica(): copy inode " << inodeId << " to node " << nodeId
+                            << " failed: " << strerror(std::abs(ret));
+    std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+    if (falconIOClient != nullptr) {
+        falconIOClient->DropCache(inodeId);
+    }
+    return ret;
+}
+
+/*---------------------- close ----------------------*/
+
+/*
+ * Called by flush/close on large file or any file after write
+ */
+int FalconStore::CloseTmpFiles(OpenInstance *openInstance, bool isFlush, bool isSync)
+{
+    FALCON_LOG(LOG_INFO) << "FalconStore::CloseTmpFiles() called to " << (isFlush ? "flush" : "close") << " file "
+                         << openInstance->path;
+
+    if (StripeLayout::IsStriped(openInstance->nodeId)) {
+        return CloseStripes(openInstance, isFlush, isSync);
+    }
+
+    /* physical file should be opened after RW */
+    if (openInstance->physicalFd == UINT64_MAX) {
+        FALCON_LOG(LOG_WARNING) << "FalconStore::CloseTmpFiles() fd not set";
+        return 0;
+    }
+    /* nodeId should be allocated after RW */
+    if (openInstance->nodeId == -1) {
+        FALCON_LOG(LOG_WARNING) << "FalconStore::CloseTmpFiles() nodeId not set";
+        return 0;
+    }
+    /* Above only happens if open failed */
+
+    /* close may be called without flush */
+    int ret = 0;
+    if (isFlush) {
+        openInstance->isFlushed = true;
+    } else if (!openInstance->isFlushed) {
+        FALCON_LOG(LOG_WARNING) << "CloseTmpFiles(): close called without flush";
+        ret = CloseTmpFiles(openInstance, true, isSync);
+        if (ret != 0) {
+            FALCON_LOG(LOG_ERROR) << "CloseTmpFiles(): call flush in close failed";
+            openInstance->writeFail = true;
+        }
+    }
+
+    /* stop the possible preRead thread */
+    if (!isFlush && !openInstance->isRemoteCall) {
+        StopPreReadThreaded(openInstance);
+        openInstance->readStream.WaitPushEnded();
     }
 
     /* first persist the writeStream, then rpc call remote to flush or close */
@@ -863,6 +1865,13 @@ int FalconStore::CloseTmpFiles(OpenInstance *openInstance, bool isFlush, bool is
 
     /* local cache file on this node */
     if (StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
+        /* a read only open of a file being downloaded neither pinned it nor has anything to flush */
+        if (openInstance->download != nullptr) {
+            if (!isFlush) {
+                close(openInstance->physicalFd);
+            }
+            return ret;
+        }
         /* close file */
         if (!isFlush) {
             close(openInstance->physicalFd);
@@ -877,24 +1886,75 @@ int FalconStore::CloseTmpFiles(OpenInstance *openInstance, bool isFlush, bool is
                 fsync(openInstance->physicalFd);
                 FALCON_LOG(LOG_INFO) << "CloseTmpFiles(): file " << openInstance->path << " fsync-ed";
             }
+            /* before the upload, which takes the checksums along */
+            SealCacheFile(GetFilePath(openInstance->inodeId), openInstance->currentSize);
+            PushReplicas(openInstance->inodeId, openInstance->path);
+            /* coded in the background, until then the cache copy is its only one as without coding */
+            ErasureCoder::GetInstance().Enqueue(openInstance->inodeId, openInstance->currentSize);
             /* flush file to storage, e.g. obs */
-            if (persistToStorage) {
+            if (persistToStorage && asyncToObs) {
+                /* the cache file is the only copy until it is uploaded */
+                if (!isSync) {
+                    fdatasync(openInstance->physicalFd);
+                }
+                ret = WriteBack::GetInstance().Enqueue(openInstance->inodeId, openInstance->path);
+                openInstance->writeFail = (ret != 0);
+            } else if (persistToStorage) {
                 ret = FlushToStorage(openInstance->path, openInstance->inodeId);
                 openInstance->writeFail = (ret != 0);
+            } else if (DedupIndex::GetInstance().Enabled()) {
+                /* uploads scan the file themselves */
+                uint64_t inodeId = openInstance->inodeId;
+                auto scan = [inodeId]() { DedupIndex::GetInstance().Scan(inodeId); };
+                storeThreadPool->Submit({.taskName = "", .task = scan});
             }
         }
+        /* fsync returns once storage has the file, an upload that failed is still retried */
+        if (isSync && persistToStorage && asyncToObs && ret == 0) {
+            ret = WriteBack::GetInstance().Wait(openInstance->inodeId);
+        }
     }
     return ret;
 }
 
 int FalconStore::FlushToStorage(std::string path, uint64_t inodeId)
 {
-    int ret = 0;
+    int ret = -ENOENT;
     std::string object = path.substr(1);
     std::string localFile = GetFilePath(inodeId);
 
-    ret = storage->PutFile(object, localFile);
+    DedupIndex &dedup = DedupIndex::GetInstance();
+    BlockChecksums content;
+    bool known = false;
+    /* copies are only checked with the checksum sidecars */
+    if (dedup.Enabled() && storage == ChecksumStorage::GetInstance()) {
+        int fd = open(localFile.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd >= 0 && fstat(fd, &st) == 0) {
+            /* sealed when the file was closed, unless it was written again since */
+            known = (BlockChecksums::Load(fd, content) == 0 && content.FileSize() == (uint64_t)st.st_size) ||
+                    BlockChecksums::OfFile(fd, st.st_size, content) == 0;
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (known) {
+        /* the same content was uploaded from another file */
+        ret = dedup.CopyUploaded(storage, object, content);
+    }
+    if (ret != 0) {
+        ret = storage->PutFile(object, localFile);
+    }
+    if (dedup.Enabled()) {
+        /* chunks are fingerprinted and shared off the upload path */
+        auto scan = [inodeId]() { DedupIndex::GetInstance().Scan(inodeId); };
+        storeThreadPool->Submit({.taskName = "", .task = scan});
+    }
     if (ret == 0) {
+        if (known) {
+            dedup.SetUploaded(inodeId, object, content);
+        }
         FALCON_LOG(LOG_INFO) << "Flush file " << object << " to obs succeeded!";
     } else {
         FALCON_LOG(LOG_ERROR) << "Flush file " << object << " to obs failed!";
@@ -918,8 +1978,22 @@ int FalconStore::ReadSmallFiles(OpenInstance *openInstance)
     std::string path = openInstance->path;
     int ret = 0;
 
+    if (StripeLayout::IsStriped(openInstance->nodeId) && !openInstance->isRemoteCall) {
+        ret = StripedRead(openInstance, readBuffer, bufSize, 0);
+        /* the stripes are read whole too and not needed any more */
+        CloseStripes(openInstance, false, false);
+        return ret < 0 ? ret : 0;
+    }
+
     /* nodeId of a new file is allocated */
     AllocNodeId(openInstance);
+    if (!openInstance->isRemoteCall) {
+        Prefetcher::GetInstance().Accessed(inodeId);
+    }
+
+    if (OpenDuringMigration(openInstance, false) == 0 || OpenReplica(openInstance, false) == 0) {
+        return 0;
+    }
 
     /* File resides on remote node */
     if (!StoreNode::GetInstance()->IsLocal(openInstance->nodeId)) {
@@ -945,28 +2019,32 @@ int FalconStore::ReadSmallFiles(OpenInstance *openInstance)
         }
         FalconStats::GetInstance().stats[BLOCKCACHE_READ] += bufSize;
         ssize_t retSize = pread(localFd, readBuffer, bufSize, 0);
+        if (retSize != (ssize_t)bufSize && errno == EAGAIN) {
+            retSize = pread(localFd, readBuffer, bufSize, 0);
+        }
         if (retSize != (ssize_t)bufSize) {
             int err = errno;
-            if (err == EAGAIN) {
-                retSize = pread(localFd, readBuffer, bufSize, 0);
-                if (retSize == (ssize_t)bufSize) {
-                    close(localFd);
-                    DiskCache::GetInstance().Unpin(inodeId);
-                    return 0;
-                }
-                err = errno;
-            }
             FALCON_LOG(LOG_ERROR) << "ReadSmallFiles(): Pread size is not equal to size: " << strerror(err);
             close(localFd);
             DiskCache::GetInstance().Unpin(inodeId);
             return -err;
         }
+        ret = VerifyCacheBuffer(inodeId, path, localFd, readBuffer, bufSize);
         close(localFd);
         /* unpin the file after close */
         DiskCache::GetInstance().Unpin(inodeId);
+        if (ret != 0 && persistToStorage) {
+            /* the cache file is damaged and could not be repaired, obs has the file */
+            ret = storage->ReadObject(path.substr(1), 0, bufSize, -1, readBuffer) == (ssize_t)bufSize ? 0 : -EIO;
+        }
+        return ret;
     } else {
         /* Cache Miss: load file from obs */
-        if (!persistToStorage) {
+        if (openInstance->cacheOnly) {
+            return -ENOENT;
+        }
+        /* a coded file is rebuilt from its shards */
+        if (!persistToStorage && !ErasureCoder::GetInstance().Enabled()) {
             FALCON_LOG(LOG_ERROR) << "ReadSmallFiles(): no local cache exists";
             return -ENOENT;
         }
@@ -980,9 +2058,16 @@ int FalconStore::ReadSmallFiles(OpenInstance *openInstance)
             return ret;
         }
 
+        /* O_RDONLY, a download in flight is waited for instead of reading obs again */
+        std::shared_ptr<FileDownload> download = downloads.Find(inodeId);
+        if (download != nullptr && ReadFromDownload(inodeId, download, readBuffer, bufSize) == 0) {
+            FalconStats::GetInstance().stats[DOWNLOAD_JOIN]++;
+            return 0;
+        }
+
         /* O_RDONLY, no need to wait for cache ready */
         /* Call is from rpc server. Async load obs and Return err to let caller read obs to buffer itself */
-        if (openInstance->isRemoteCall) {
+        if (openInstance->isRemoteCall && persistToStorage) {
             FALCON_LOG(LOG_INFO) << "ReadSmallFiles(): remote call, bg load obs and return failure";
             // bg load obs and return failure
             bool isSync = false;
@@ -990,16 +2075,23 @@ int FalconStore::ReadSmallFiles(OpenInstance *openInstance)
             return ret == 0 ? -ENOENT : ret;
         }
 
-        /* Call is from fuse user. Sync read obs to buffer and Async write to local file */
-        /* Sync read obs to read buffer */
-        ret = storage->ReadObject(path.substr(1), 0, bufSize, -1, readBuffer);
+        /* Call is from fuse user, or there is no obs. Sync read obs to buffer and Async write to local file */
+        /* Sync read another node's copy, the shards or obs to read buffer */
+        if (FillFromPeer(inodeId, path, bufSize, -1, readBuffer) != 0 &&
+            ErasureCoder::GetInstance().Fill(inodeId, bufSize, -1, readBuffer) != 0) {
+            if (!persistToStorage) {
+                FALCON_LOG(LOG_ERROR) << "ReadSmallFiles(): no local cache or shards exist";
+                return -ENOENT;
+            }
+            ret = storage->ReadObject(path.substr(1), 0, bufSize, -1, readBuffer);
+        }
         if (ret < 0) {
             FALCON_LOG(LOG_ERROR) << "Obs read failed";
             return -EIO;
         }
         /* Async write to local cache file */
         /* Read buffer is read only after initialization above */
-        return WriteToFileAsync(inodeId, fileName, openInstance->readBuffer, bufSize);
+        return WriteToFileAsync(inodeId, PlacementKey(inodeId, path), fileName, openInstance->readBuffer, bufSize);
     }
     return 0;
 }
@@ -1008,7 +2100,11 @@ int FalconStore::ReadSmallFiles(OpenInstance *openInstance)
  * Called by OpenFile and ReadSmallFile. Large file try open and return, small file read obs if failed
  * Use a shared_ptr from read buffer to store the file content
  */
-int FalconStore::WriteToFileAsync(uint64_t inodeId, std::string &fileName, std::shared_ptr<char> buf, size_t bufSize)
+int FalconStore::WriteToFileAsync(uint64_t inodeId,
+                                  uint64_t placementKey,
+                                  std::string &fileName,
+                                  std::shared_ptr<char> buf,
+                                  size_t bufSize)
 {
     auto lockerPtr = std::make_shared<FileLocker>(&fileLock, inodeId, LockMode::X, false);
     if (lockerPtr == nullptr) {
@@ -1036,13 +2132,17 @@ int FalconStore::WriteToFileAsync(uint64_t inodeId, std::string &fileName, std::
         DiskCache::GetInstance().FreePreAllocSpace(bufSize);
         return -err;
     }
+    SetPlacementKey(fd, placementKey);
 
     /* Async write the file to local file */
     ThreadTask task;
-    task.task = [fd, buf, bufSize, inodeId, lockerPtr]() {
+    task.task = [fd, buf, bufSize, inodeId, lockerPtr, seal = checksum]() {
         FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += bufSize;
         int retSize = pwrite(fd, buf.get(), bufSize, 0);
         int err = errno;
+        if (seal && retSize == (int)bufSize) {
+            BlockChecksums::OfBuffer(buf.get(), bufSize).Save(fd);
+        }
         close(fd);
         if (retSize < 0) {
             FALCON_LOG(LOG_ERROR) << "WriteToFileAsync(): pwrite failed : " << strerror(err);
@@ -1065,7 +2165,8 @@ int FalconStore::ReadSmallFilesForBrpc(uint64_t inodeId,
                                        char *buf,
                                        size_t size,
                                        int oflags,
-                                       bool nodeFail)
+                                       bool nodeFail,
+                                       bool cacheOnly)
 {
     int ret = 0;
 
@@ -1087,35 +2188,35 @@ int FalconStore::ReadSmallFilesForBrpc(uint64_t inodeId,
             return -err;
         }
         FalconStats::GetInstance().stats[BLOCKCACHE_READ] += size;
-        ssize_t retSize = pread(localFd, buf, size, 0);
+        ssize_t retSize = IoEngine::GetInstance().Pread(localFd, buf, size, 0);
+        if (retSize == -EAGAIN) {
+            retSize = IoEngine::GetInstance().Pread(localFd, buf, size, 0);
+        }
         if (retSize != (ssize_t)size) {
-            int err = errno;
-            if (err == EAGAIN) {
-                retSize = pread(localFd, buf, size, 0);
-                if (retSize == (ssize_t)size) {
-                    close(localFd);
-                    DiskCache::GetInstance().Unpin(inodeId);
-                    return 0;
-                }
-                err = errno;
-            }
+            int err = retSize < 0 ? -retSize : EIO;
             FALCON_LOG(LOG_ERROR) << "ReadSmallFilesForBrpc(): Pread size not equal: " << strerror(err);
             close(localFd);
             DiskCache::GetInstance().Unpin(inodeId);
             return -err;
         }
+        /* a damaged cache file that could not be repaired fails the read, the caller reads obs itself */
+        ret = VerifyCacheBuffer(inodeId, path, localFd, buf, size);
         close(localFd);
         /* unpin the file after close */
         DiskCache::GetInstance().Unpin(inodeId);
     } else {
         /* Cache Miss: load file from obs */
-        if (!persistToStorage) {
+        if (cacheOnly) {
+            return -ENOENT;
+        }
+        /* a coded file is rebuilt from its shards */
+        if (!persistToStorage && !ErasureCoder::GetInstance().Enabled()) {
             FALCON_LOG(LOG_ERROR) << "ReadSmallFilesForBrpc(): no local cache exists";
             return -ENOENT;
         }
 
-        /* may write, sync download file from obs to file and buffer */
-        if ((oflags & O_ACCMODE) != O_RDONLY) {
+        /* may write, or the caller has no obs to read itself, sync download file to file and buffer */
+        if ((oflags & O_ACCMODE) != O_RDONLY || !persistToStorage) {
             FALCON_LOG(LOG_INFO)
                 << "ReadSmallFilesForBrpc(): may write, sync download file from obs to file and buffer";
             bool isSync = true;
@@ -1124,6 +2225,13 @@ int FalconStore::ReadSmallFilesForBrpc(uint64_t inodeId,
             return ret;
         }
 
+        /* O_RDONLY, a download in flight is waited for instead of the caller reading obs again */
+        std::shared_ptr<FileDownload> download = downloads.Find(inodeId);
+        if (download != nullptr && ReadFromDownload(inodeId, download, buf, size) == 0) {
+            FalconStats::GetInstance().stats[DOWNLOAD_JOIN]++;
+            return 0;
+        }
+
         /* O_RDONLY, no need to wait for cache ready */
         /* Async load obs and Return err to let caller read obs to buffer itself */
         FALCON_LOG(LOG_INFO) << "ReadSmallFilesForBrpc(): remote call, bg load obs and return failure";
@@ -1145,80 +2253,33 @@ int FalconStore::DownLoadFromStorageForBrpc(uint64_t inodeId,
                                             bool isSync,
                                             bool toBuffer)
 {
-    std::string fileName = GetFilePath(inodeId);
-
-    /* isSync == true will wait to get file lock. or it will try to get lock */
-    auto lockerPtr = std::make_shared<FileLocker>(&fileLock, inodeId, LockMode::X, isSync);
-    if (lockerPtr == nullptr) {
-        return -ENOMEM;
-    }
-    if (!lockerPtr->isLocked()) {
-        FALCON_LOG(LOG_INFO) << "DownLoadFromStorage(): No need to load obs, other acquired the lock, abort";
-        return 0;
-    }
-
-    /* if file exists in disk cache, pin directly if it is sync */
-    if (DiskCache::GetInstance().Find(inodeId, isSync)) {
-        FALCON_LOG(LOG_INFO) << "DownLoadFromStorage(): No need to load obs, other created local file, abort";
-        return 0;
-    }
+    OpenInstance openInstance;
+    openInstance.inodeId = inodeId;
+    openInstance.path = path;
+    openInstance.originalSize = bufSize;
+    /* buf is owned by the rpc and only filled by a sync download */
+    openInstance.readBuffer = std::shared_ptr<char>(buf, [](char *) {});
+    openInstance.readBufferSize = bufSize;
+    openInstance.isRemoteCall = true;
+    return DownLoadFromStorage(&openInstance, isSync, toBuffer);
+}
 
-    if (!DiskCache::GetInstance().PreAllocSpace(bufSize)) {
-        FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Can not pre-allocate enough space!";
-        return -ENOSPC;
-    }
+/*---------------------- other func ----------------------*/
 
-    /* here cache file must not exist */
-    auto fd = open(fileName.c_str(), O_WRONLY | O_CREAT, 0755);
-    if (fd < 0) {
-        int err = errno;
-        FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Create local file for loading failed: " << strerror(err);
-        DiskCache::GetInstance().FreePreAllocSpace(bufSize);
-        return -err;
+int FalconStore::DeleteFiles(uint64_t inodeId, int nodeId, std::string path)
+{
+    int ret = 0;
+    if (StripeLayout::IsStriped(nodeId)) {
+        return DeleteStripes(inodeId, nodeId, path);
     }
-
-    /* pass a copy of shared_ptr to make sure destructed */
-    auto loadObs = [=, this]() {
-        int size = 0;
-        if (toBuffer) {
-            size = storage->ReadObject(path.substr(1), 0, bufSize, fd, buf);
-        } else {
-            size = storage->ReadObject(path.substr(1), 0, 0, fd, nullptr);
-        }
-
-        close(fd);
-        if (size < 0) {
-            FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Loading file from obs failed";
-            if (std::remove(fileName.c_str()) != 0) {
-                FALCON_LOG(LOG_ERROR) << "DownLoadFromStorage(): Delete obs tmp file failed" << strerror(errno);
-            }
-            size = -EIO;
-        } else {
-            DiskCache::GetInstance().InsertAndUpdate(inodeId, bufSize, isSync);
-        }
-        DiskCache::GetInstance().FreePreAllocSpace(bufSize);
-        return size < 0 ? size : 0;
-    };
-
-    if (isSync) {
-        return loadObs();
-    } else {
-        storeThreadPool->Submit({.taskName = "", .task = loadObs});
-    }
-
-    return 0;
-}
-
-/*---------------------- other func ----------------------*/
-
-int FalconStore::DeleteFiles(uint64_t inodeId, int nodeId, std::string path)
-{
-    int ret = 0;
-    if (nodeId == -1 || StoreNode::GetInstance()->IsLocal(nodeId)) {
-        if (DiskCache::GetInstance().Find(inodeId, false)) {
-            ret = DiskCache::GetInstance().Delete(inodeId);
-            if (ret != 0) {
-                return ret;
+    if (nodeId == -1 || StoreNode::GetInstance()->IsLocal(nodeId)) {
+        DropReplicas(inodeId, path);
+        ErasureCoder::GetInstance().Drop(inodeId);
+        WriteBack::GetInstance().Cancel(inodeId);
+        if (DiskCache::GetInstance().Find(inodeId, false)) {
+            ret = DiskCache::GetInstance().Delete(inodeId);
+            if (ret != 0) {
+                return ret;
             }
         } else if (!persistToStorage) {
             FALCON_LOG(LOG_ERROR) << "Delete file " << GetFilePath(inodeId) << " failed : " << strerror(ENOENT);
@@ -1245,6 +2306,7 @@ int FalconStore::DeleteFiles(uint64_t inodeId, int nodeId, std::string path)
             FALCON_LOG(LOG_ERROR) << "delete file from obs failed! ";
             return -EIO;
         }
+        DedupIndex::GetInstance().ForgetObject(path.substr(1));
     }
     return ret;
 }
@@ -1331,11 +2393,41 @@ int FalconStore::CopyData(const std::string &srcName, const std::string &dstName
 {
     std::string srcObject = srcName.substr(1);
     std::string dstObject = dstName.substr(1);
-    return storage->CopyObject(srcObject, dstObject);
+    /* the source may still be queued for upload here */
+    int ret = WriteBack::GetInstance().WaitPath(srcName);
+    if (ret != 0) {
+        return ret;
+    }
+    ret = storage->CopyObject(srcObject, dstObject);
+    if (ret == 0) {
+        DedupIndex::GetInstance().MoveObject(srcObject, dstObject);
+        return ret;
+    }
+    /* a striped file has an object per stripe and none of its own */
+    for (uint32_t stripe = 0; stripe < STRIPE_MAX_WIDTH; ++stripe) {
+        std::string srcStripe = StripeLayout::StripePath(srcName, stripe);
+        std::string dstStripe = StripeLayout::StripePath(dstName, stripe);
+        if (WriteBack::GetInstance().WaitPath(srcStripe) != 0 ||
+            storage->CopyObject(srcStripe.substr(1), dstStripe.substr(1)) != 0) {
+            return stripe == 0 ? ret : 0;
+        }
+        DedupIndex::GetInstance().MoveObject(srcStripe.substr(1), dstStripe.substr(1));
+    }
+    return 0;
 }
 
 int FalconStore::DeleteDataAfterRename(const std::string &objectName)
 {
+    char probe;
+    for (uint32_t stripe = 0; stripe < STRIPE_MAX_WIDTH; ++stripe) {
+        std::string stripeObject = StripeLayout::StripePath(objectName, stripe).substr(1);
+        if (storage->ReadObject(stripeObject, 0, 1, -1, &probe) < 0) {
+            break;
+        }
+        DedupIndex::GetInstance().ForgetObject(stripeObject);
+        storage->DeleteObject(stripeObject);
+    }
+    DedupIndex::GetInstance().ForgetObject(objectName.substr(1));
     return storage->DeleteObject(objectName.substr(1));
 }
 
@@ -1344,6 +2436,9 @@ int FalconStore::TruncateFile(OpenInstance *openInstance, off_t size)
 {
     FALCON_LOG(LOG_INFO) << "FalconStore::TruncateFile() called by " << (openInstance->isRemoteCall ? "rpc" : "fuse")
                          << " on " << openInstance->path << " to size = " << size;
+    if (Striped(openInstance)) {
+        return TruncateStripes(openInstance, size, false);
+    }
     int ret = 0;
 
     /* open file, init physical fd */
@@ -1386,10 +2481,13 @@ int FalconStore::TruncateFile(OpenInstance *openInstance, off_t size)
 /* truncate openInstance only, which means change size in memory not cache file */
 int FalconStore::TruncateOpenInstance(OpenInstance *openInstance, off_t size)
 {
+    if (StripeLayout::IsStriped(openInstance->nodeId)) {
+        return TruncateStripes(openInstance, size, true);
+    }
     int ret = 0;
 
     // persist the current write stream to let currentSize updated
-    if (openInstance->writeStream.GetSize() > 0) {
+    if (openInstance->writeStream.GetSize() > 0 || openInstance->writeStream.GetInflightSize() > 0) {
         // write will wait for local cache to be loaded from obs, so safe to call complete
         FALCON_LOG(LOG_INFO) << "In TruncateOpenInstance(): Persisting the written";
         ret = openInstance->writeStream.Complete(openInstance->currentSize.load(), true, false);
@@ -1465,3 +2563,933 @@ int FalconStore::StatCluster(int nodeId, std::vector<size_t> &currentStats, bool
     }
     return 0;
 }
+
+/*
+ * Called by brpc server for each chunk a previous owner or the owner of a replicated file pushes.
+ * Chunks are assembled aside and the last one moves the file into the cache, so a partial file
+ * is never visible. A copy here is compared with the one sent by size and fingerprint, -EEXIST
+ * tells the sender both are the same and nothing needs to be sent. Otherwise a replica replaces
+ * the copy here, and -ESTALE tells a previous owner they differ and it keeps its copy. A patch
+ * starts from a copy of the file here, -ESTALE if it is not the base the patch was made against.
+ */
+int FalconStore::ReceiveMigratedFile(uint64_t inodeId,
+                                     uint64_t placementKey,
+                                     bool hasKey,
+                                     off_t offset,
+                                     uint64_t totalSize,
+                                     bool last,
+                                     bool replica,
+                                     bool hasCrc,
+                                     uint32_t crc,
+                                     uint32_t fingerprint,
+                                     bool patch,
+                                     uint32_t baseFingerprint,
+                                     butil::IOBuf &data)
+{
+    if (offset == 0 && !patch) {
+        int ret = CompareCachedCopy(inodeId, totalSize, fingerprint);
+        if (ret == -EEXIST || (ret != 0 && !replica)) {
+            return ret;
+        }
+    }
+    /* the sender sends a chunk damaged on its way once more */
+    if (hasCrc && IOBufCrc32c(data) != crc) {
+        FALCON_LOG(LOG_WARNING) << "ReceiveMigratedFile(): chunk at " << offset << " of inode " << inodeId
+                                << " fails its checksum";
+        FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+        return -EBADMSG;
+    }
+    std::string tmpName = GetMigratingPath(inodeId);
+    if (offset == 0 && patch) {
+        int ret = CopyPatchBase(inodeId, baseFingerprint, tmpName);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    int fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | (offset == 0 && !patch ? O_TRUNC : 0), 0755);
+    if (fd < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): open " << tmpName << " failed: " << strerror(err);
+        return -err;
+    }
+    FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += data.size();
+    while (!data.empty()) {
+        ssize_t nwrite = data.pcut_into_file_descriptor(fd, offset);
+        if (nwrite < 0) {
+            int err = errno;
+            FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): write " << tmpName << " failed: " << strerror(err);
+            close(fd);
+            std::remove(tmpName.c_str());
+            return -err;
+        }
+        offset += nwrite;
+    }
+    if (!last) {
+        close(fd);
+        return 0;
+    }
+    if (hasKey) {
+        SetPlacementKey(fd, placementKey);
+    }
+    /* a file that got shorter keeps the tail of base otherwise */
+    if (patch && ftruncate(fd, totalSize) != 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): truncate " << tmpName << " failed: " << strerror(err);
+        close(fd);
+        std::remove(tmpName.c_str());
+        return -err;
+    }
+    close(fd);
+    if (!patch && (uint64_t)offset != totalSize) {
+        FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): got " << offset << " of " << totalSize << " bytes";
+        std::remove(tmpName.c_str());
+        return -EIO;
+    }
+    if (patch) {
+        /* base and the changed blocks have to add up to the file of the sender */
+        BlockChecksums patched;
+        fd = open(tmpName.c_str(), O_RDONLY);
+        int ret = fd < 0 ? -errno : BlockChecksums::OfFile(fd, totalSize, patched);
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (ret != 0 || patched.Fingerprint() != fingerprint) {
+            FALCON_LOG(LOG_WARNING) << "ReceiveMigratedFile(): patch of inode " << inodeId << " does not match";
+            std::remove(tmpName.c_str());
+            return -ESTALE;
+        }
+        SealCacheFile(tmpName, totalSize, &patched);
+    } else {
+        SealCacheFile(tmpName, totalSize);
+    }
+
+    FileLocker locker(&fileLock, inodeId, LockMode::X, true);
+    int ret = replica ? 0 : CompareCachedCopy(inodeId, totalSize, fingerprint);
+    if (ret != 0) {
+        std::remove(tmpName.c_str());
+        return ret;
+    }
+    if (!DiskCache::GetInstance().PreAllocSpace(totalSize)) {
+        FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): Can not pre-allocate enough space!";
+        std::remove(tmpName.c_str());
+        return -ENOSPC;
+    }
+    std::string fileName = GetFilePath(inodeId);
+    if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "ReceiveMigratedFile(): rename to " << fileName << " failed: " << strerror(err);
+        std::remove(tmpName.c_str());
+        DiskCache::GetInstance().FreePreAllocSpace(totalSize);
+        return -err;
+    }
+    DiskCache::GetInstance().InsertAndUpdate(inodeId, totalSize, false);
+    DiskCache::GetInstance().FreePreAllocSpace(totalSize);
+    FALCON_LOG(LOG_INFO) << "ReceiveMigratedFile(): inode " << inodeId << (patch ? " patched, " : " moved in, ")
+                         << totalSize << " bytes";
+    return 0;
+}
+
+/*
+ * Start a patch of inodeId in tmpName with a copy of the file cached here, -ESTALE if there is
+ * none or it is not the copy of baseFingerprint the patch was made against
+ */
+int FalconStore::CopyPatchBase(uint64_t inodeId, uint32_t baseFingerprint, const std::string &tmpName)
+{
+    FileLocker locker(&fileLock, inodeId, LockMode::S, true);
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -ESTALE;
+    }
+    struct stat st;
+    uint32_t local = 0;
+    bool same = fstat(fd, &st) == 0 && BlockChecksums::FingerprintOf(fd, st.st_size, local) == 0 &&
+                local == baseFingerprint;
+    close(fd);
+    if (!same) {
+        return -ESTALE;
+    }
+    std::error_code ec;
+    if (!std::filesystem::copy_file(fileName, tmpName, std::filesystem::copy_options::overwrite_existing, ec)) {
+        FALCON_LOG(LOG_ERROR) << "CopyPatchBase(): copy " << fileName << " failed: " << ec.message();
+        std::remove(tmpName.c_str());
+        return -EIO;
+    }
+    return 0;
+}
+
+/*
+ * Called by brpc server when the owner of a replicated file writes or deletes it
+ */
+int FalconStore::DropCachedFile(uint64_t inodeId)
+{
+    FileLocker locker(&fileLock, inodeId, LockMode::X, true);
+    if (!DiskCache::GetInstance().Find(inodeId, false)) {
+        return 0;
+    }
+    return DiskCache::GetInstance().Delete(inodeId);
+}
+
+/*
+ * Called by brpc server only, for another node filling a cache miss. A copy of another size or,
+ * if checkFingerprint, of another fingerprint is left from an older version of the file and is
+ * not offered.
+ */
+int FalconStore::LocateCachedFile(uint64_t inodeId, uint64_t size, bool checkFingerprint, uint32_t fingerprint)
+{
+    if (checkFingerprint) {
+        return CompareCachedCopy(inodeId, size, fingerprint) == -EEXIST ? 0 : -ENOENT;
+    }
+    if (!DiskCache::GetInstance().Find(inodeId, false)) {
+        return -ENOENT;
+    }
+    struct stat st;
+    if (stat(GetFilePath(inodeId).c_str(), &st) != 0 || (uint64_t)st.st_size != size) {
+        return -ENOENT;
+    }
+    return 0;
+}
+
+/*
+ * Cache a file on the node that owns it ahead of its first read, and pin it there for PIN so it
+ * is not evicted, or drop the pin for UNPIN. route is false when the call was already routed
+ * here by another node.
+ */
+int FalconStore::WarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, CacheAction action, bool route)
+{
+    if (route) {
+        int nodeId = OwnerNodeId(inodeId, path);
+        if (nodeId < 0) {
+            return -EHOSTUNREACH;
+        }
+        if (!StoreNode::GetInstance()->IsLocal(nodeId)) {
+            std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+            if (falconIOClient == nullptr) {
+                return -EHOSTUNREACH;
+            }
+            return falconIOClient->WarmupFile(inodeId, path, size, (int)action, false);
+        }
+    }
+
+    if (action == CacheAction::UNPIN) {
+        int ret = DiskCache::GetInstance().SetPinned(inodeId, false);
+        return ret == -ENOENT ? 0 : ret;
+    }
+    if (!persistToStorage) {
+        /* the cache is the only copy, there is nothing to load */
+        return action == CacheAction::PIN ? DiskCache::GetInstance().SetPinned(inodeId, true) : 0;
+    }
+    /* leaves the file pinned by this call, so it cannot be evicted before the pin below */
+    int ret = DownLoadFromStorageForBrpc(inodeId, path, nullptr, size, true, false);
+    if (ret != 0) {
+        return ret;
+    }
+    if (action == CacheAction::PIN) {
+        ret = DiskCache::GetInstance().SetPinned(inodeId, true);
+    }
+    if (action == CacheAction::PREFETCH) {
+        int fd = open(GetFilePath(inodeId).c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, size, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+    }
+    DiskCache::GetInstance().Unpin(inodeId);
+    return ret;
+}
+
+/*---------------------- kv ----------------------*/
+
+/* the first result that is an error, or 0 */
+static int FirstKvError(const std::vector<int64_t> &results)
+{
+    for (int64_t result : results) {
+        if (result < 0) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+int FalconStore::KvNodeId(const std::string &key, bool near)
+{
+    StoreNode *storeNode = StoreNode::GetInstance();
+    return near ? storeNode->GetNodeId() : storeNode->AllocNode(myHash(key));
+}
+
+void FalconStore::KvForEachNode(
+    const std::vector<std::string> &keys,
+    const std::vector<size_t> &indices,
+    bool near,
+    const std::function<void(const std::vector<size_t> &batch)> &local,
+    const std::function<void(FalconIOClient &client, const std::vector<size_t> &batch, std::function<void()> finished)>
+        &send)
+{
+    struct KvState
+    {
+        bthread::Mutex mutex;
+        bthread::ConditionVariable cv;
+        int outstanding = 0;
+    };
+    auto state = std::make_shared<KvState>();
+    StoreNode *storeNode = StoreNode::GetInstance();
+    std::map<int, std::vector<size_t>> groups;
+    for (size_t i : indices) {
+        groups[KvNodeId(keys[i], near)].push_back(i);
+    }
+    const std::vector<size_t> *mine = nullptr;
+    for (const auto &[nodeId, group] : groups) {
+        if (storeNode->IsLocal(nodeId)) {
+            mine = &group;
+            continue;
+        }
+        std::shared_ptr<FalconIOClient> falconIOClient = storeNode->GetRpcConnection(nodeId);
+        if (falconIOClient == nullptr) {
+            continue;
+        }
+        for (size_t start = 0; start < group.size(); start += KV_BATCH_BLOCKS) {
+            size_t end = std::min<size_t>(group.size(), start + KV_BATCH_BLOCKS);
+            {
+                std::lock_guard<bthread::Mutex> lock(state->mutex);
+                state->outstanding++;
+            }
+            send(*falconIOClient, std::vector<size_t>(group.begin() + start, group.begin() + end), [state]() {
+                std::lock_guard<bthread::Mutex> lock(state->mutex);
+                state->outstanding--;
+                state->cv.notify_all();
+            });
+        }
+    }
+    /* served here while the other nodes are at theirs */
+    if (mine != nullptr) {
+        local(*mine);
+    }
+
+    /* a bthread condition, kv calls also come from brpc handlers */
+    std::unique_lock<bthread::Mutex> lock(state->mutex);
+    while (state->outstanding > 0) {
+        state->cv.wait(lock);
+    }
+}
+
+/* the results of the keys at batch from the reply of their node */
+static void SetKvResults(std::vector<int64_t> &results,
+                         const std::vector<size_t> &batch,
+                         int ret,
+                         const std::vector<int64_t> &batchResults)
+{
+    for (size_t j = 0; j < batch.size(); ++j) {
+        results[batch[j]] = j < batchResults.size() ? batchResults[j] : (ret != 0 ? ret : -EIO);
+    }
+}
+
+int FalconStore::KvPut(const std::vector<std::string> &keys,
+                       const std::vector<const char *> &blocks,
+                       const std::vector<uint64_t> &sizes,
+                       uint32_t ttlSeconds,
+                       bool near,
+                       std::vector<int64_t> &results)
+{
+    if (blocks.size() != keys.size() || sizes.size() != keys.size()) {
+        return -EINVAL;
+    }
+    results.assign(keys.size(), -EHOSTUNREACH);
+    std::vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    KvForEachNode(
+        keys,
+        indices,
+        near,
+        [&](const std::vector<size_t> &batch) {
+            for (size_t i : batch) {
+                results[i] = KvStore::GetInstance().Put(keys[i], std::string(blocks[i], sizes[i]), ttlSeconds);
+            }
+        },
+        [&](FalconIOClient &client, const std::vector<size_t> &batch, std::function<void()> finished) {
+            std::vector<std::string> batchKeys;
+            std::vector<uint64_t> batchSizes;
+            butil::IOBuf data;
+            for (size_t i : batch) {
+                batchKeys.push_back(keys[i]);
+                batchSizes.push_back(sizes[i]);
+                data.append(blocks[i], sizes[i]);
+            }
+            client.KvPutAsync(batchKeys,
+                              batchSizes,
+                              ttlSeconds,
+                              data,
+                              [&results, batch, finished](int ret, std::vector<int64_t> &batchResults, butil::IOBuf &) {
+                                  SetKvResults(results, batch, ret, batchResults);
+                                  finished();
+                              });
+        });
+    return FirstKvError(results);
+}
+
+void FalconStore::KvLookup(const std::vector<std::string> &keys,
+                           const std::vector<size_t> &indices,
+                           const std::vector<char *> &blocks,
+                           uint64_t bufSize,
+                           bool near,
+                           std::vector<int64_t> &results)
+{
+    bool read = !blocks.empty();
+    KvForEachNode(
+        keys,
+        indices,
+        near,
+        [&](const std::vector<size_t> &batch) {
+            for (size_t i : batch) {
+                if (!read) {
+                    results[i] = KvStore::GetInstance().Exists(keys[i]) ? 0 : -ENOENT;
+                    continue;
+                }
+                std::shared_ptr<const std::string> block;
+                int ret = KvStore::GetInstance().Get(keys[i], block);
+                if (ret != 0) {
+                    results[i] = ret;
+                } else if (block->size() > bufSize) {
+                    results[i] = -EMSGSIZE;
+                } else {
+                    memcpy(blocks[i], block->data(), block->size());
+                    results[i] = block->size();
+                }
+            }
+        },
+        [&](FalconIOClient &client, const std::vector<size_t> &batch, std::function<void()> finished) {
+            std::vector<std::string> batchKeys;
+            for (size_t i : batch) {
+                batchKeys.push_back(keys[i]);
+            }
+            auto done = [&, batch, finished](int ret, std::vector<int64_t> &batchResults, butil::IOBuf &data) {
+                SetKvResults(results, batch, ret, batchResults);
+                for (size_t i : batch) {
+                    if (read && results[i] > (int64_t)bufSize) {
+                        data.pop_front(results[i]);
+                        results[i] = -EMSGSIZE;
+                    } else if (read && results[i] > 0) {
+                        data.cutn(blocks[i], results[i]);
+                    }
+                }
+                finished();
+            };
+            if (read) {
+                client.KvGetAsync(batchKeys, done);
+            } else {
+                client.KvExistsAsync(batchKeys, done);
+            }
+        });
+}
+int FalconStore::KvGet(const std::vector<std::string> &keys,
+                       const std::vector<char *> &blocks,
+                       uint64_t bufSize,
+                       bool near,
+                       std::vector<int64_t> &results)
+{
+    if (blocks.size() != keys.size()) {
+        return -EINVAL;
+    }
+    results.assign(keys.size(), -EHOSTUNREACH);
+    std::vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    if (near) {
+        KvLookup(keys, indices, blocks, bufSize, true, results);
+        /* blocks not found here may have been put by another node */
+        std::erase_if(indices, [&](size_t i) {
+            return (results[i] != -ENOENT && results[i] != -EOPNOTSUPP) ||
+                   StoreNode::GetInstance()->IsLocal(KvNodeId(keys[i], false));
+        });
+    }
+    KvLookup(keys, indices, blocks, bufSize, false, results);
+    return FirstKvError(results);
+}
+
+int FalconStore::KvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    results.assign(keys.size(), -EHOSTUNREACH);
+    std::vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    if (near) {
+        KvLookup(keys, indices, {}, 0, true, results);
+        std::erase_if(indices, [&](size_t i) {
+            return (results[i] != -ENOENT && results[i] != -EOPNOTSUPP) ||
+                   StoreNode::GetInstance()->IsLocal(KvNodeId(keys[i], false));
+        });
+    }
+    KvLookup(keys, indices, {}, 0, false, results);
+    return FirstKvError(results);
+}
+
+int FalconStore::KvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results)
+{
+    results.assign(keys.size(), -EHOSTUNREACH);
+    std::vector<size_t> indices(keys.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    auto drop = [&](bool nearPass, std::vector<int64_t> &passResults) {
+        KvForEachNode(
+            keys,
+            indices,
+            nearPass,
+            [&](const std::vector<size_t> &batch) {
+                for (size_t i : batch) {
+                    passResults[i] = KvStore::GetInstance().Delete(keys[i]);
+                }
+            },
+            [&](FalconIOClient &client, const std::vector<size_t> &batch, std::function<void()> finished) {
+                std::vector<std::string> batchKeys;
+                for (size_t i : batch) {
+                    batchKeys.push_back(keys[i]);
+                }
+                client.KvDeleteAsync(
+                    batchKeys,
+                    [&passResults, batch, finished](int ret, std::vector<int64_t> &batchResults, butil::IOBuf &) {
+                        SetKvResults(passResults, batch, ret, batchResults);
+                        finished();
+                    });
+            });
+    };
+    drop(false, results);
+    if (near) {
+        std::vector<int64_t> nearResults(keys.size(), -EHOSTUNREACH);
+        drop(true, nearResults);
+        /* gone if it was in either place */
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (nearResults[i] == 0 || results[i] == -ENOENT) {
+                results[i] = nearResults[i];
+            }
+        }
+    }
+    return FirstKvError(results);
+}
+
+/*---------------------- stripe ----------------------*/
+
+/* a run of a striped file held by one stripe, at bufOffset of the caller's buffer */
+struct StripePiece
+{
+    size_t bufOffset;
+    size_t size;
+    uint64_t stripeOffset;
+};
+
+/* the pieces of [offset, offset + size) of a striped file, per stripe and in file order */
+static std::vector<std::vector<StripePiece>> SplitStripes(const StripeLayout &layout, uint64_t offset, size_t size)
+{
+    std::vector<std::vector<StripePiece>> pieces(layout.width);
+    for (size_t done = 0; done < size;) {
+        uint64_t stripeOffset = 0;
+        uint32_t stripe = layout.StripeOf(offset + done, stripeOffset);
+        size_t len = std::min<uint64_t>(size - done, layout.unitSize - (offset + done) % layout.unitSize);
+        pieces[stripe].push_back({done, len, stripeOffset});
+        done += len;
+    }
+    return pieces;
+}
+
+static std::vector<uint32_t> TouchedStripes(const std::vector<std::vector<StripePiece>> &pieces)
+{
+    std::vector<uint32_t> stripes;
+    for (uint32_t stripe = 0; stripe < pieces.size(); ++stripe) {
+        if (!pieces[stripe].empty()) {
+            stripes.push_back(stripe);
+        }
+    }
+    return stripes;
+}
+
+/* run task for every stripe, each on a thread of its own if there are several */
+static void ForEachStripe(const std::vector<uint32_t> &stripes, const std::function<void(uint32_t)> &task)
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < stripes.size(); ++i) {
+        threads.emplace_back(task, stripes[i]);
+    }
+    if (!stripes.empty()) {
+        task(stripes[0]);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/*
+ * Whether openInstance is a striped file. A new file written through this node becomes one here
+ * if striping is on for its directory, its layout reaches metadata as its node id on close.
+ */
+bool FalconStore::Striped(OpenInstance *openInstance)
+{
+    /* stripes and the opens of them made by other nodes are plain files */
+    if (openInstance->isRemoteCall || StripeLayout::IsStripeInode(openInstance->inodeId)) {
+        return false;
+    }
+    if (openInstance->nodeId == -1 && stripeWidth > 1 && openInstance->originalSize == 0 &&
+        (openInstance->oflags & O_ACCMODE) != O_RDONLY) {
+        const std::string &path = openInstance->path;
+        bool inDirs = stripeDirs.empty() || std::any_of(stripeDirs.begin(), stripeDirs.end(), [&](const auto &dir) {
+                          return path.starts_with(dir) && path.size() > dir.size() && path[dir.size()] == '/';
+                      });
+        std::unique_lock<std::shared_mutex> lock(openInstance->fileMutex);
+        if (inDirs && openInstance->nodeId == -1 && !openInstance->isOpened.load()) {
+            openInstance->nodeId = StripeLayout::Make(stripeWidth, stripeUnitSize).ToNodeId();
+        }
+    }
+    return StripeLayout::IsStriped(openInstance->nodeId);
+}
+
+/* the open of stripe of a striped file, opened on first use with the flags of the file */
+std::shared_ptr<OpenInstance> FalconStore::OpenStripe(OpenInstance *openInstance, uint32_t stripe, int &ret)
+{
+    ret = 0;
+    StripeLayout layout = StripeLayout::FromNodeId(openInstance->nodeId);
+    {
+        std::shared_lock<std::shared_mutex> lock(openInstance->fileMutex);
+        if (stripe < openInstance->stripes.size() && openInstance->stripes[stripe] != nullptr) {
+            return openInstance->stripes[stripe];
+        }
+    }
+
+    auto instance = std::make_shared<OpenInstance>();
+    instance->inodeId = StripeLayout::StripeInodeId(openInstance->inodeId, stripe);
+    instance->path = StripeLayout::StripePath(openInstance->path, stripe);
+    instance->oflags = openInstance->oflags;
+    instance->originalSize = layout.StripeSize(openInstance->originalSize, stripe);
+    instance->currentSize = instance->originalSize;
+    /* as FalconOpen does for small files */
+    if (instance->originalSize > 0 && instance->originalSize < READ_BIGFILE_SIZE &&
+        (instance->oflags & O_ACCMODE) == O_RDONLY) {
+        instance->readBuffer = std::shared_ptr<char>((char *)malloc(instance->originalSize), free);
+        if (instance->readBuffer == nullptr) {
+            ret = -ENOMEM;
+            return nullptr;
+        }
+        instance->readBufferSize = instance->originalSize;
+        ret = ReadSmallFiles(instance.get());
+        if (ret < 0) {
+            FALCON_LOG(LOG_ERROR) << "OpenStripe(): read stripe " << instance->path << " failed: " << strerror(-ret);
+            return nullptr;
+        }
+        ret = 0;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(openInstance->fileMutex);
+    if (openInstance->stripes.size() < layout.width) {
+        openInstance->stripes.resize(layout.width);
+    }
+    /* a concurrent reader may have opened it meanwhile */
+    if (openInstance->stripes[stripe] == nullptr) {
+        openInstance->stripes[stripe] = instance;
+    }
+    return openInstance->stripes[stripe];
+}
+
+/* read the stripes a read covers at once, parts of the file no stripe has written read as zeros */
+int FalconStore::StripedRead(OpenInstance *openInstance, char *buf, size_t size, off_t offset)
+{
+    uint64_t fileSize = openInstance->currentSize.load();
+    if ((uint64_t)offset >= fileSize) {
+        return 0;
+    }
+    size = std::min<uint64_t>(size, fileSize - offset);
+    StripeLayout layout = StripeLayout::FromNodeId(openInstance->nodeId);
+    auto pieces = SplitStripes(layout, offset, size);
+
+    std::atomic<int> err = 0;
+    ForEachStripe(TouchedStripes(pieces), [&](uint32_t stripe) {
+        int ret = 0;
+        std::shared_ptr<OpenInstance> stripeInstance = OpenStripe(openInstance, stripe, ret);
+        for (const StripePiece &piece : pieces[stripe]) {
+            size_t got = 0;
+            while (ret == 0 && got < piece.size) {
+                int readSize = ReadFile(stripeInstance.get(), buf + piece.bufOffset + got, piece.size - got,
+                                        piece.stripeOffset + got);
+                if (readSize <= 0) {
+                    ret = readSize;
+                    break;
+                }
+                got += readSize;
+            }
+            if (ret != 0) {
+                err = ret;
+                return;
+            }
+            memset(buf + piece.bufOffset + got, 0, piece.size - got);
+        }
+    });
+    if (err != 0) {
+        FALCON_LOG(LOG_ERROR) << "StripedRead(): read " << openInstance->path << " failed: " << strerror(-err);
+        return err;
+    }
+    return size;
+}
+
+/* write the pieces of a write to their stripes at once, each stripe through its own write stream */
+int FalconStore::StripedWrite(OpenInstance *openInstance, const char *buf, size_t size, off_t offset)
+{
+    openInstance->isOpened = true;
+    StripeLayout layout = StripeLayout::FromNodeId(openInstance->nodeId);
+    auto pieces = SplitStripes(layout, offset, size);
+
+    std::atomic<int> err = 0;
+    ForEachStripe(TouchedStripes(pieces), [&](uint32_t stripe) {
+        int ret = 0;
+        std::shared_ptr<OpenInstance> stripeInstance = OpenStripe(openInstance, stripe, ret);
+        for (const StripePiece &piece : pieces[stripe]) {
+            if (ret != 0) {
+                break;
+            }
+            stripeInstance->writeCnt++;
+            ret = WriteFile(stripeInstance.get(), buf + piece.bufOffset, piece.size, piece.stripeOffset);
+        }
+        if (ret != 0) {
+            err = ret;
+        }
+    });
+    if (err != 0) {
+        FALCON_LOG(LOG_ERROR) << "StripedWrite(): write " << openInstance->path << " failed: " << strerror(-err);
+        openInstance->writeFail = true;
+        return err;
+    }
+    if (size != 0) {
+        std::unique_lock<std::shared_mutex> sizeLock(openInstance->fileMutex);
+        openInstance->currentSize = std::max(openInstance->currentSize.load(), size + offset);
+    }
+    return 0;
+}
+
+/* flush or close the stripes opened for a striped file, a close releases them */
+int FalconStore::CloseStripes(OpenInstance *openInstance, bool isFlush, bool isSync)
+{
+    std::vector<std::shared_ptr<OpenInstance>> stripes;
+    {
+        std::unique_lock<std::shared_mutex> lock(openInstance->fileMutex);
+        stripes = openInstance->stripes;
+        if (!isFlush) {
+            openInstance->stripes.clear();
+        }
+    }
+    std::vector<uint32_t> opened;
+    for (uint32_t stripe = 0; stripe < stripes.size(); ++stripe) {
+        /* stripes read whole on open have nothing to close */
+        if (stripes[stripe] != nullptr && stripes[stripe]->isOpened.load()) {
+            opened.push_back(stripe);
+        }
+    }
+
+    std::atomic<int> err = 0;
+    ForEachStripe(opened, [&](uint32_t stripe) {
+        int ret = CloseTmpFiles(stripes[stripe].get(), isFlush, isSync);
+        if (ret != 0 || stripes[stripe]->writeFail) {
+            err = ret != 0 ? ret : -EIO;
+        }
+    });
+    if (err != 0) {
+        FALCON_LOG(LOG_ERROR) << "CloseStripes(): " << (isFlush ? "flush " : "close ") << openInstance->path
+                              << " failed: " << strerror(-err);
+        openInstance->writeFail = true;
+    }
+    return err;
+}
+
+/* truncate every stripe to its part of size, only the opened ones if openInstanceOnly */
+int FalconStore::TruncateStripes(OpenInstance *openInstance, off_t size, bool openInstanceOnly)
+{
+    StripeLayout layout = StripeLayout::FromNodeId(openInstance->nodeId);
+    int ret = 0;
+    if (openInstanceOnly) {
+        std::vector<std::shared_ptr<OpenInstance>> stripes;
+        {
+            std::shared_lock<std::shared_mutex> lock(openInstance->fileMutex);
+            stripes = openInstance->stripes;
+        }
+        for (size_t stripe = 0; stripe < stripes.size() && ret == 0; ++stripe) {
+            if (stripes[stripe] != nullptr) {
+                ret = TruncateOpenInstance(stripes[stripe].get(), layout.StripeSize(size, stripe));
+            }
+        }
+        if (ret == 0) {
+            std::unique_lock<std::shared_mutex> sizeLock(openInstance->fileMutex);
+            openInstance->currentSize = size;
+            openInstance->originalSize = size;
+        }
+        return ret;
+    }
+
+    openInstance->isOpened = true;
+    for (uint32_t stripe = 0; stripe < layout.width && ret == 0; ++stripe) {
+        std::shared_ptr<OpenInstance> stripeInstance = OpenStripe(openInstance, stripe, ret);
+        if (ret != 0) {
+            break;
+        }
+        uint64_t stripeSize = layout.StripeSize(size, stripe);
+        stripeInstance->writeCnt++;
+        ret = TruncateFile(stripeInstance.get(), stripeSize);
+        stripeInstance->currentSize = stripeSize;
+    }
+    return ret;
+}
+
+/* delete the stripes of a striped file wherever they are cached, and their objects */
+int FalconStore::DeleteStripes(uint64_t inodeId, int nodeId, const std::string &path)
+{
+    StripeLayout layout = StripeLayout::FromNodeId(nodeId);
+    int ret = 0;
+    for (uint32_t stripe = 0; stripe < layout.width; ++stripe) {
+        uint64_t stripeInodeId = StripeLayout::StripeInodeId(inodeId, stripe);
+        std::string stripePath = StripeLayout::StripePath(path, stripe);
+        int stripeRet = DeleteFiles(stripeInodeId, OwnerNodeId(stripeInodeId, stripePath), stripePath);
+        /* stripes beyond the end of a short file were never written */
+        if (stripeRet != 0 && stripeRet != -ENOENT) {
+            FALCON_LOG(LOG_ERROR) << "DeleteStripes(): delete " << stripePath << " failed: " << strerror(-stripeRet);
+            ret = stripeRet;
+        }
+    }
+    return ret;
+}
+
+/*---------------------- checksum ----------------------*/
+
+/*
+ * Store the checksums of the first size bytes of a cache file in its xattr, known ones if they
+ * are of that size. A file that can not be read back is left without, it is read unchecked.
+ */
+void FalconStore::SealCacheFile(const std::string &fileName, uint64_t size, const BlockChecksums *known)
+{
+    if (!checksum) {
+        return;
+    }
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        FALCON_LOG(LOG_WARNING) << "SealCacheFile(): open " << fileName << " failed: " << strerror(errno);
+        return;
+    }
+    BlockChecksums computed;
+    int ret = 0;
+    if (known == nullptr || known->FileSize() != size) {
+        ret = BlockChecksums::OfFile(fd, size, computed);
+        known = &computed;
+    }
+    if (ret == 0) {
+        ret = known->Save(fd);
+    }
+    if (ret != 0) {
+        FALCON_LOG(LOG_WARNING) << "SealCacheFile(): " << fileName << " left unchecked: " << strerror(-ret);
+        BlockChecksums::Drop(fd);
+    }
+    close(fd);
+}
+
+/*
+ * Compare the copy of inodeId cached here with a copy elsewhere of size bytes and fingerprint,
+ * 0 if there is none here, -EEXIST if both hold the same content, else -ESTALE
+ */
+int FalconStore::CompareCachedCopy(uint64_t inodeId, uint64_t size, uint32_t fingerprint)
+{
+    if (!DiskCache::GetInstance().Find(inodeId, false)) {
+        return 0;
+    }
+    int fd = open(GetFilePath(inodeId).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -ESTALE;
+    }
+    struct stat st;
+    uint32_t local = 0;
+    int ret = -ESTALE;
+    if (fstat(fd, &st) == 0 && (uint64_t)st.st_size == size &&
+        BlockChecksums::FingerprintOf(fd, size, local) == 0 && local == fingerprint) {
+        ret = -EEXIST;
+    }
+    close(fd);
+    return ret;
+}
+
+/*
+ * Fetch a block of the cache file of inodeId that fails checksums again from obs. 0 once the
+ * block is intact, -ESTALE if the file changed and checksums do not hold any more, or -EIO.
+ * A file obs does not have the latest content of yet is not repaired.
+ */
+int FalconStore::RepairCacheFile(uint64_t inodeId,
+                                 const std::string &path,
+                                 const BlockChecksums &checksums,
+                                 size_t block)
+{
+    FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+    FALCON_LOG(LOG_WARNING) << "RepairCacheFile(): block " << block << " of " << path << " fails its checksum";
+    if (!persistToStorage || WriteBack::GetInstance().Queued(inodeId)) {
+        return -EIO;
+    }
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_RDWR);
+    if (fd < 0) {
+        return -errno;
+    }
+    BlockChecksums current;
+    if (BlockChecksums::Load(fd, current) != 0 || !(current == checksums)) {
+        close(fd);
+        return -ESTALE;
+    }
+    uint64_t offset = checksums.BlockOffset(block);
+    uint64_t length = checksums.BlockLength(block);
+    std::vector<char> data(length);
+    FalconStats::GetInstance().stats[CHECKSUM_REFETCH]++;
+    int ret = -EIO;
+    if (storage->ReadObject(path.substr(1), offset, length, -1, data.data()) == (ssize_t)length &&
+        checksums.Check(block, data.data()) && pwrite(fd, data.data(), length, offset) == (ssize_t)length) {
+        ret = 0;
+    }
+    close(fd);
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "RepairCacheFile(): block " << block << " of " << path << " can not be repaired";
+    }
+    return ret;
+}
+
+/*
+ * Called by ReadFileLR before a range of a local cache file is read, 0 if it is intact or was
+ * repaired
+ */
+int FalconStore::VerifyCacheRange(OpenInstance *openInstance, off_t offset, size_t size)
+{
+    std::shared_ptr<CacheVerifier> verifier = openInstance->verifier;
+    if (verifier == nullptr) {
+        return 0;
+    }
+    size_t block = 0;
+    int ret = 0;
+    while ((ret = verifier->Verify(openInstance->physicalFd, offset, size, block)) == -EBADMSG) {
+        ret = RepairCacheFile(openInstance->inodeId, openInstance->path, verifier->Checksums(), block);
+        if (ret == -ESTALE) {
+            verifier->Disable();
+            return 0;
+        }
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Called on a small file cache hit with the whole file read from fd into buf, 0 if it is intact
+ * or was repaired
+ */
+int FalconStore::VerifyCacheBuffer(uint64_t inodeId, const std::string &path, int fd, char *buf, size_t size)
+{
+    BlockChecksums checksums;
+    if (!checksum || BlockChecksums::Load(fd, checksums) != 0 || checksums.FileSize() != size) {
+        return 0;
+    }
+    for (size_t block : checksums.Mismatches(buf, 0, size)) {
+        int ret = RepairCacheFile(inodeId, path, checksums, block);
+        if (ret == -ESTALE) {
+            /* rewritten since it was read, not checked like a file without checksums */
+            return 0;
+        }
+        uint64_t offset = checksums.BlockOffset(block);
+        uint64_t length = checksums.BlockLength(block);
+        if (ret != 0 || pread(fd, buf + offset, length, offset) != (ssize_t)length ||
+            !checksums.Check(block, buf + offset)) {
+            return -EIO;
+        }
+    }
+    return 0;
+}
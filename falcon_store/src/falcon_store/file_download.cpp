@@ -0,0 +1,131 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/file_download.h"
+
+#include <algorithm>
+#include <cerrno>
+
+FileDownload::FileDownload(uint64_t size, uint64_t blockSize)
+    : fileSize(size),
+      blockSize(std::max<uint64_t>(blockSize, 1)),
+      blocks((size + this->blockSize - 1) / this->blockSize, BlockState::PENDING)
+{
+}
+
+bool FileDownload::NextBlock(uint64_t &offset, uint64_t &size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error != 0) {
+        return false;
+    }
+    size_t block = blocks.size();
+    while (!wanted.empty() && block == blocks.size()) {
+        if (blocks[wanted.front()] == BlockState::PENDING) {
+            block = wanted.front();
+        }
+        wanted.pop_front();
+    }
+    while (block == blocks.size() && cursor < blocks.size()) {
+        if (blocks[cursor] == BlockState::PENDING) {
+            block = cursor;
+        }
+        cursor++;
+    }
+    if (block == blocks.size()) {
+        return false;
+    }
+    blocks[block] = BlockState::FETCHING;
+    offset = block * blockSize;
+    size = std::min(blockSize, fileSize - offset);
+    return true;
+}
+
+void FileDownload::Complete(uint64_t offset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t block = offset / blockSize;
+    if (block < blocks.size() && blocks[block] != BlockState::LANDED) {
+        blocks[block] = BlockState::LANDED;
+        landed++;
+    }
+    cv.notify_all();
+}
+
+void FileDownload::CompleteAll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(blocks.begin(), blocks.end(), BlockState::LANDED);
+    landed = blocks.size();
+    cv.notify_all();
+}
+
+void FileDownload::Fail(int err)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    error = err == 0 ? -EIO : err;
+    cv.notify_all();
+}
+
+int FileDownload::Wait(uint64_t offset, uint64_t size)
+{
+    if (size == 0 || offset >= fileSize) {
+        return 0;
+    }
+    size_t first = offset / blockSize;
+    size_t last = (std::min(offset + size, fileSize) - 1) / blockSize;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (size_t block = first; block <= last; ++block) {
+        if (blocks[block] == BlockState::PENDING) {
+            wanted.push_back(block);
+        }
+    }
+    for (size_t block = first; block <= last; ++block) {
+        cv.wait(lock, [this, block]() { return blocks[block] == BlockState::LANDED || error != 0; });
+        if (blocks[block] != BlockState::LANDED) {
+            return error;
+        }
+    }
+    return 0;
+}
+
+bool FileDownload::Failed()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return error != 0;
+}
+
+std::shared_ptr<FileDownload> DownloadTable::Find(uint64_t inodeId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = downloads.find(inodeId);
+    return it == downloads.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<FileDownload> DownloadTable::Start(uint64_t inodeId, uint64_t size, uint64_t blockSize)
+{
+    auto download = std::make_shared<FileDownload>(size, blockSize);
+    std::lock_guard<std::mutex> lock(mutex);
+    downloads[inodeId] = download;
+    return download;
+}
+
+void DownloadTable::Finish(uint64_t inodeId,
+                           const std::shared_ptr<FileDownload> &download,
+                           int err,
+                           const std::function<void()> &publish)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (err != 0) {
+        download->Fail(err);
+    } else {
+        publish();
+        download->CompleteAll();
+    }
+    auto it = downloads.find(inodeId);
+    if (it != downloads.end() && it->second == download) {
+        downloads.erase(it);
+    }
+}
@@ -0,0 +1,436 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/kv_store.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+static ssize_t ReadAll(int fd, char *buf, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static ssize_t WriteAll(int fd, const char *buf, size_t size)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pwrite(fd, buf + done, size - done, done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+KvStore::~KvStore() { Stop(); }
+
+int KvStore::Start(const std::string &rootPath,
+                   uint64_t initBlockSize,
+                   uint64_t dramBytes,
+                   uint64_t ssdBytes,
+                   uint32_t ttlSeconds)
+{
+    /* every shard of a tier in use holds a block at least */
+    if (initBlockSize == 0 || (dramBytes == 0 && ssdBytes == 0) ||
+        (dramBytes > 0 && dramBytes / KV_SHARDS < initBlockSize) ||
+        (ssdBytes > 0 && ssdBytes / KV_SHARDS < initBlockSize)) {
+        FALCON_LOG(LOG_ERROR) << "KvStore: " << dramBytes << " bytes of memory and " << ssdBytes
+                              << " bytes of disk do not hold " << KV_SHARDS << " blocks of " << initBlockSize;
+        return -EINVAL;
+    }
+    std::error_code ec;
+    kvDir = (std::filesystem::path(rootPath) / "kv").string();
+    /* blocks spilled before a restart are not indexed any more */
+    std::filesystem::remove_all(kvDir, ec);
+    for (size_t shard = 0; shard < KV_SHARDS; ++shard) {
+        std::string dir = kvDir + "/" + std::to_string(shard);
+        if (!std::filesystem::create_directories(dir, ec) && ec) {
+            FALCON_LOG(LOG_ERROR) << "KvStore: create " << dir << " failed: " << ec.message();
+            return -EIO;
+        }
+    }
+    blockSize = initBlockSize;
+    dramCapacity = dramBytes / KV_SHARDS;
+    ssdCapacity = ssdBytes / KV_SHARDS;
+    defaultTtl = ttlSeconds;
+    stop = false;
+    worker = std::thread(&KvStore::Run, this);
+    running = true;
+    FALCON_LOG(LOG_INFO) << "KvStore: blocks of " << blockSize << " bytes, " << dramBytes << " bytes in memory, "
+                         << ssdBytes << " bytes under " << kvDir;
+    return 0;
+}
+
+void KvStore::Stop()
+{
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.clear();
+        shard.dramLru.clear();
+        shard.ssdLru.clear();
+        shard.dramUsed = 0;
+        shard.ssdUsed = 0;
+    }
+    if (!kvDir.empty()) {
+        std::error_code ec;
+        std::filesystem::remove_all(kvDir, ec);
+    }
+}
+
+size_t KvStore::ShardIndex(const std::string &key) const { return std::hash<std::string>{}(key) % KV_SHARDS; }
+
+std::string KvStore::FilePath(size_t shard, uint64_t fileId) const
+{
+    return kvDir + "/" + std::to_string(shard) + "/" + std::to_string(fileId);
+}
+
+void KvStore::RemoveLocked(size_t shard, EntryIt it, FileWork &work)
+{
+    Shard &s = shards[shard];
+    Entry &entry = it->second;
+    if (entry.tier == Tier::DRAM) {
+        s.dramLru.erase(entry.lru);
+        s.dramUsed -= entry.size;
+    } else {
+        s.ssdLru.erase(entry.lru);
+        s.ssdUsed -= entry.size;
+        /* a file still being written is removed by its writer */
+        if (!entry.writing) {
+            work.unlinks.push_back(FilePath(shard, entry.fileId));
+        }
+    }
+    s.entries.erase(it);
+}
+
+void KvStore::ToDramLocked(size_t shard, EntryIt it, std::shared_ptr<const std::string> block, FileWork &work)
+{
+    Shard &s = shards[shard];
+    Entry &entry = it->second;
+    entry.tier = Tier::DRAM;
+    entry.writing = false;
+    entry.block = std::move(block);
+    s.dramLru.push_front(it->first);
+    entry.lru = s.dramLru.begin();
+    s.dramUsed += entry.size;
+
+    /* the block just added is the most recent one, it is never the one to go */
+    while (s.dramUsed > dramCapacity) {
+        EntryIt victim = s.entries.find(s.dramLru.back());
+        s.dramLru.pop_back();
+        s.dramUsed -= victim->second.size;
+        if (ssdCapacity == 0 || !ToSsdLocked(shard, victim, work)) {
+            s.entries.erase(victim);
+            FalconStats::GetInstance().stats[KV_EVICT]++;
+        }
+    }
+}
+
+bool KvStore::ToSsdLocked(size_t shard, EntryIt it, FileWork &work)
+{
+    Shard &s = shards[shard];
+    Entry &entry = it->second;
+    while (s.ssdUsed + entry.size > ssdCapacity && !s.ssdLru.empty()) {
+        RemoveLocked(shard, s.entries.find(s.ssdLru.back()), work);
+        FalconStats::GetInstance().stats[KV_EVICT]++;
+    }
+    if (s.ssdUsed + entry.size > ssdCapacity) {
+        return false;
+    }
+
+    /* the file is written once the lock is released, the block is read from memory until then */
+    entry.tier = Tier::SSD;
+    entry.fileId = s.nextFileId++;
+    entry.writing = true;
+    s.ssdLru.push_front(it->first);
+    entry.lru = s.ssdLru.begin();
+    s.ssdUsed += entry.size;
+    work.spills.push_back(Spill{it->first, entry.fileId, entry.block});
+    return true;
+}
+
+void KvStore::DoFileWork(size_t shard, FileWork &work)
+{
+    Shard &s = shards[shard];
+    for (Spill &spill : work.spills) {
+        std::string path = FilePath(shard, spill.fileId);
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            FALCON_LOG(LOG_WARNING) << "KvStore: create " << path << " failed: " << strerror(errno);
+        } else {
+            ssize_t ret = WriteAll(fd, spill.block->data(), spill.block->size());
+            close(fd);
+            spill.written = ret == (ssize_t)spill.block->size();
+            if (!spill.written) {
+                FALCON_LOG(LOG_WARNING)
+                    << "KvStore: write " << path << " failed: " << strerror(ret < 0 ? -ret : ENOSPC);
+                unlink(path.c_str());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        EntryIt it = s.entries.find(spill.key);
+        if (it == s.entries.end() || !it->second.writing || it->second.fileId != spill.fileId) {
+            /* replaced, dropped or got back to memory while it was written */
+            if (spill.written) {
+                work.unlinks.push_back(path);
+                spill.written = false;
+            }
+            continue;
+        }
+        if (!spill.written) {
+            RemoveLocked(shard, it, work);
+            FalconStats::GetInstance().stats[KV_EVICT]++;
+            continue;
+        }
+        it->second.writing = false;
+        it->second.block.reset();
+        FalconStats::GetInstance().stats[KV_SPILL] += it->second.size;
+    }
+    for (const std::string &path : work.unlinks) {
+        unlink(path.c_str());
+    }
+    work.unlinks.clear();
+}
+
+int KvStore::Put(const std::string &key, std::string block, uint32_t ttlSeconds)
+{
+    if (!Enabled()) {
+        return -EOPNOTSUPP;
+    }
+    if (key.empty() || key.size() > KV_MAX_KEY_SIZE) {
+        return -EINVAL;
+    }
+    if (block.size() > blockSize) {
+        return -EMSGSIZE;
+    }
+    uint32_t ttl = ttlSeconds == 0 ? defaultTtl : ttlSeconds;
+    uint64_t size = block.size();
+
+    size_t index = ShardIndex(key);
+    Shard &s = shards[index];
+    FileWork work;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        EntryIt it = s.entries.find(key);
+        if (it != s.entries.end()) {
+            RemoveLocked(index, it, work);
+        }
+        it = s.entries.emplace(key, Entry{}).first;
+        it->second.size = size;
+        if (ttl > 0) {
+            it->second.expiry = Clock::now() + std::chrono::seconds(ttl);
+            expiring = true;
+        }
+        auto shared = std::make_shared<const std::string>(std::move(block));
+        if (dramCapacity > 0) {
+            ToDramLocked(index, it, std::move(shared), work);
+        } else {
+            it->second.block = std::move(shared);
+            if (!ToSsdLocked(index, it, work)) {
+                s.entries.erase(it);
+            }
+        }
+    }
+    DoFileWork(index, work);
+    /* with no memory tier the block only lands once its file is written, the last spill */
+    if (dramCapacity == 0 && (work.spills.empty() || !work.spills.back().written)) {
+        return -EIO;
+    }
+    FalconStats::GetInstance().stats[KV_PUT] += size;
+    return 0;
+}
+
+int KvStore::Get(const std::string &key, std::shared_ptr<const std::string> &block)
+{
+    if (!Enabled()) {
+        return -EOPNOTSUPP;
+    }
+    size_t index = ShardIndex(key);
+    Shard &s = shards[index];
+    FileWork work;
+    int ret = -ENOENT;
+    /* a block on disk is read without the lock and looked up again if it moved meanwhile */
+    while (true) {
+        uint64_t fileId = 0;
+        uint64_t size = 0;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            EntryIt it = s.entries.find(key);
+            if (it != s.entries.end() && it->second.expiry <= Clock::now()) {
+                RemoveLocked(index, it, work);
+                FalconStats::GetInstance().stats[KV_EVICT]++;
+                it = s.entries.end();
+            }
+            if (it == s.entries.end()) {
+                FalconStats::GetInstance().stats[KV_MISS]++;
+                break;
+            }
+            Entry &entry = it->second;
+            if (entry.block != nullptr) {
+                std::list<std::string> &lru = entry.tier == Tier::DRAM ? s.dramLru : s.ssdLru;
+                lru.splice(lru.begin(), lru, entry.lru);
+                block = entry.block;
+                FalconStats::GetInstance().stats[KV_GET] += entry.size;
+                ret = 0;
+                break;
+            }
+            fileId = entry.fileId;
+            size = entry.size;
+        }
+
+        std::string path = FilePath(index, fileId);
+        std::string data(size, '\0');
+        int fd = open(path.c_str(), O_RDONLY);
+        ssize_t readRet = fd < 0 ? -errno : ReadAll(fd, data.data(), data.size());
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        EntryIt it = s.entries.find(key);
+        if (it == s.entries.end() || it->second.tier != Tier::SSD || it->second.fileId != fileId) {
+            continue;
+        }
+        Entry &entry = it->second;
+        if (readRet != (ssize_t)size) {
+            FALCON_LOG(LOG_WARNING) << "KvStore: read " << path << " failed, dropping its block";
+            RemoveLocked(index, it, work);
+            FalconStats::GetInstance().stats[KV_MISS]++;
+            break;
+        }
+        block = std::make_shared<const std::string>(std::move(data));
+        if (dramCapacity > 0) {
+            /* read again soon, most likely */
+            s.ssdLru.erase(entry.lru);
+            s.ssdUsed -= entry.size;
+            work.unlinks.push_back(path);
+            ToDramLocked(index, it, block, work);
+        } else {
+            s.ssdLru.splice(s.ssdLru.begin(), s.ssdLru, entry.lru);
+        }
+        FalconStats::GetInstance().stats[KV_GET] += size;
+        ret = 0;
+        break;
+    }
+    DoFileWork(index, work);
+    return ret;
+}
+
+bool KvStore::Exists(const std::string &key)
+{
+    if (!Enabled()) {
+        return false;
+    }
+    Shard &s = shards[ShardIndex(key)];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(key);
+    return it != s.entries.end() && it->second.expiry > Clock::now();
+}
+
+int KvStore::Delete(const std::string &key)
+{
+    if (!Enabled()) {
+        return -EOPNOTSUPP;
+    }
+    size_t index = ShardIndex(key);
+    Shard &s = shards[index];
+    FileWork work;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        EntryIt it = s.entries.find(key);
+        if (it == s.entries.end()) {
+            return -ENOENT;
+        }
+        RemoveLocked(index, it, work);
+    }
+    DoFileWork(index, work);
+    return 0;
+}
+uint64_t KvStore::DramBytes()
+{
+    uint64_t bytes = 0;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.dramUsed;
+    }
+    return bytes;
+}
+
+uint64_t KvStore::SsdBytes()
+{
+    uint64_t bytes = 0;
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bytes += shard.ssdUsed;
+    }
+    return bytes;
+}
+
+void KvStore::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        cv.wait_for(lock, std::chrono::seconds(KV_SWEEP_INTERVAL_S), [this]() { return stop; });
+        if (stop) {
+            break;
+        }
+        if (!expiring) {
+            continue;
+        }
+        lock.unlock();
+        for (size_t index = 0; index < KV_SHARDS; ++index) {
+            Shard &s = shards[index];
+            FileWork work;
+            {
+                std::lock_guard<std::mutex> shardLock(s.mutex);
+                auto now = Clock::now();
+                for (EntryIt it = s.entries.begin(); it != s.entries.end();) {
+                    EntryIt next = std::next(it);
+                    if (it->second.expiry <= now) {
+                        RemoveLocked(index, it, work);
+                        FalconStats::GetInstance().stats[KV_EVICT]++;
+                    }
+                    it = next;
+                }
+            }
+            DoFileWork(index, work);
+        }
+        lock.lock();
+    }
+}
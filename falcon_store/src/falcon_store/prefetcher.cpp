@@ -0,0 +1,160 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/prefetcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+Prefetcher::~Prefetcher() { Stop(); }
+
+int Prefetcher::Start(uint32_t threadNum, uint32_t distance, Stager stager)
+{
+    if (threadNum == 0 || distance == 0) {
+        return -EINVAL;
+    }
+    stage = std::move(stager);
+    defaultDistance = distance;
+    stop = false;
+    for (uint32_t i = 0; i < threadNum; ++i) {
+        workers.emplace_back(&Prefetcher::Run, this);
+    }
+    running = true;
+    return 0;
+}
+
+void Prefetcher::Stop()
+{
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    streams.clear();
+    inodeStreams.clear();
+    queue.clear();
+}
+
+uint64_t Prefetcher::Register(std::vector<PrefetchEntry> order, uint32_t distance)
+{
+    if (!Enabled()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t streamId = nextStreamId++;
+    Stream &stream = streams[streamId];
+    stream.order = std::move(order);
+    stream.states.assign(stream.order.size(), State::IDLE);
+    stream.distance = distance == 0 ? defaultDistance : distance;
+    for (size_t i = 0; i < stream.order.size(); ++i) {
+        /* a file read twice in an order is staged for its first read */
+        if (stream.positions.emplace(stream.order[i].inodeId, i).second) {
+            inodeStreams[stream.order[i].inodeId].push_back(streamId);
+        }
+    }
+    IssueLocked(streamId, stream);
+    cv.notify_all();
+    FALCON_LOG(LOG_INFO) << "Prefetcher: stream " << streamId << " of " << stream.order.size()
+                         << " files, distance " << stream.distance;
+    return streamId;
+}
+
+void Prefetcher::Unregister(uint64_t streamId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = streams.find(streamId);
+    if (it == streams.end()) {
+        return;
+    }
+    for (auto &[inodeId, position] : it->second.positions) {
+        auto &ids = inodeStreams[inodeId];
+        ids.erase(std::remove(ids.begin(), ids.end(), streamId), ids.end());
+        if (ids.empty()) {
+            inodeStreams.erase(inodeId);
+        }
+    }
+    /* tasks still queued for the stream are dropped by the workers */
+    streams.erase(it);
+}
+
+void Prefetcher::Accessed(uint64_t inodeId)
+{
+    if (!Enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inodeStreams.find(inodeId);
+    if (it == inodeStreams.end()) {
+        return;
+    }
+    for (uint64_t streamId : it->second) {
+        Stream &stream = streams[streamId];
+        size_t position = stream.positions[inodeId];
+        if (position < stream.cursor) {
+            continue;
+        }
+        if (stream.states[position] == State::STAGED) {
+            FalconStats::GetInstance().stats[PREFETCH_HIT]++;
+        } else if (position < stream.issued) {
+            FalconStats::GetInstance().stats[PREFETCH_LATE]++;
+        }
+        stream.cursor = position + 1;
+        IssueLocked(streamId, stream);
+    }
+    cv.notify_all();
+}
+
+void Prefetcher::IssueLocked(uint64_t streamId, Stream &stream)
+{
+    /* files skipped by the reader are not staged any more */
+    stream.issued = std::max(stream.issued, stream.cursor);
+    size_t end = std::min(stream.order.size(), stream.cursor + stream.distance);
+    for (; stream.issued < end; ++stream.issued) {
+        stream.states[stream.issued] = State::QUEUED;
+        queue.push_back({streamId, stream.issued});
+    }
+}
+
+void Prefetcher::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        if (queue.empty()) {
+            cv.wait(lock);
+            continue;
+        }
+        Task task = queue.front();
+        queue.pop_front();
+        auto it = streams.find(task.streamId);
+        /* unregistered, or read while it was queued */
+        if (it == streams.end() || task.position < it->second.cursor) {
+            continue;
+        }
+        PrefetchEntry entry = it->second.order[task.position];
+
+        lock.unlock();
+        int ret = stage(entry);
+        lock.lock();
+
+        if (ret == 0) {
+            FalconStats::GetInstance().stats[PREFETCH] += entry.size;
+        } else {
+            FALCON_LOG(LOG_WARNING) << "Prefetcher: stage " << entry.path << " failed: " << strerror(-ret);
+        }
+        /* stream ids are not reused, the stream may be gone but is never another one */
+        it = streams.find(task.streamId);
+        if (it != streams.end()) {
+            it->second.states[task.position] = ret == 0 ? State::STAGED : State::IDLE;
+        }
+    }
+}
@@ -0,0 +1,265 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/rebalancer.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#include <butil/iobuf.h>
+
+#include "connection/node.h"
+#include "disk_cache/disk_cache.h"
+#include "falcon_store/block_checksums.h"
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+#include "util/crc32c.h"
+#include "util/utils.h"
+
+int PushCacheFile(int nodeId,
+                  uint64_t inodeId,
+                  uint64_t placementKey,
+                  bool hasKey,
+                  bool replica,
+                  const std::function<void(size_t)> &throttle,
+                  const BlockChecksums *base,
+                  BlockChecksums *pushed)
+{
+    std::shared_ptr<FalconIOClient> falconIOClient = StoreNode::GetInstance()->GetRpcConnection(nodeId);
+    if (falconIOClient == nullptr) {
+        return -EHOSTUNREACH;
+    }
+    std::string fileName = GetFilePath(inodeId);
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -errno;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+
+    uint64_t totalSize = st.st_size;
+    /* a damaged cache file is not handed on, the receiver loads the file from storage instead */
+    BlockChecksums expected;
+    BlockChecksums actual;
+    int ret = BlockChecksums::OfFile(fd, totalSize, actual);
+    if (ret != 0) {
+        close(fd);
+        return ret;
+    }
+    if (BlockChecksums::Load(fd, expected) == 0 && expected.FileSize() == totalSize && !(actual == expected)) {
+        FALCON_LOG(LOG_ERROR) << "PushCacheFile(): cache file of inode " << inodeId << " fails its checksums";
+        FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+        close(fd);
+        return -EBADMSG;
+    }
+    uint32_t fingerprint = actual.Fingerprint();
+    if (pushed != nullptr) {
+        *pushed = actual;
+    }
+
+    /* a patch that is not much smaller than the file is not worth a copy of base at the node */
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    bool patch = base != nullptr && base->BlockSize() == actual.BlockSize();
+    if (patch) {
+        ranges = actual.Changes(*base);
+        uint64_t changed = 0;
+        for (auto &range : ranges) {
+            changed += range.second;
+        }
+        patch = changed <= totalSize / 2;
+    }
+    if (!patch) {
+        ranges = {{0, totalSize}};
+    } else if (ranges.empty() || ranges.front().first != 0) {
+        /* the chunk at offset 0 starts a copy at the node, empty if the first block is the same */
+        ranges.insert(ranges.begin(), {0, 0});
+    }
+    uint32_t baseFingerprint = patch ? base->Fingerprint() : 0;
+    bool resent = false;
+    for (size_t i = 0; ret == 0 && i < ranges.size(); ++i) {
+        uint64_t offset = ranges[i].first;
+        uint64_t end = offset + ranges[i].second;
+        bool rangeEnd = false;
+        while (ret == 0 && !rangeEnd) {
+            butil::IOPortal data;
+            size_t chunk = std::min<uint64_t>(REBALANCE_CHUNK_SIZE, end - offset);
+            ssize_t nread = chunk > 0 ? data.pappend_from_file_descriptor(fd, offset, chunk) : 0;
+            if (nread < 0 || (nread == 0 && chunk > 0)) {
+                ret = nread < 0 ? -errno : -EIO;
+                break;
+            }
+            if (throttle) {
+                throttle(nread);
+            }
+            bool last = offset + nread >= end && i + 1 == ranges.size();
+            uint32_t crc = IOBufCrc32c(data);
+            ret = falconIOClient->MigrateFile(inodeId,
+                                              placementKey,
+                                              hasKey,
+                                              offset,
+                                              totalSize,
+                                              last,
+                                              replica,
+                                              crc,
+                                              fingerprint,
+                                              patch,
+                                              baseFingerprint,
+                                              data);
+            if (ret == -EBADMSG && !resent) {
+                FALCON_LOG(LOG_WARNING) << "PushCacheFile(): chunk at " << offset << " of inode " << inodeId
+                                        << " arrived damaged at node " << nodeId << ", sending it again";
+                FalconStats::GetInstance().stats[CHECKSUM_REFETCH]++;
+                resent = true;
+                ret = 0;
+                continue;
+            }
+            resent = false;
+            offset += nread;
+            rangeEnd = offset >= end;
+        }
+    }
+    close(fd);
+    if (patch && ret == -ESTALE) {
+        /* the node does not have base any more */
+        return PushCacheFile(nodeId, inodeId, placementKey, hasKey, replica, throttle, nullptr, pushed);
+    }
+    return ret;
+}
+
+uint32_t IOBufCrc32c(const butil::IOBuf &data)
+{
+    uint32_t crc = 0;
+    for (size_t i = 0; i < data.backing_block_num(); ++i) {
+        butil::StringPiece block = data.backing_block(i);
+        crc = Crc32c(block.data(), block.size(), crc);
+    }
+    return crc;
+}
+
+Rebalancer::~Rebalancer() { Stop(); }
+
+int Rebalancer::Start(const std::string &rootPath, uint32_t bandwidthMb, bool initInodeKeyed)
+{
+    /* files half received before a restart are sent again by their owner */
+    std::error_code ec;
+    std::filesystem::path migratingDir = std::filesystem::path(rootPath) / "migrating";
+    std::filesystem::remove_all(migratingDir, ec);
+    if (!std::filesystem::create_directories(migratingDir, ec) && ec) {
+        FALCON_LOG(LOG_ERROR) << "Rebalancer: create " << migratingDir << " failed: " << ec.message();
+        return -EIO;
+    }
+    inodeKeyed = initInodeKeyed;
+    bytesPerSecond = (uint64_t)bandwidthMb * 1024 * 1024;
+    worker = std::thread(&Rebalancer::Run, this);
+    return 0;
+}
+
+void Rebalancer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void Rebalancer::Kick()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    cv.notify_all();
+}
+
+void Rebalancer::Run()
+{
+    bool retry = false;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (retry) {
+                cv.wait_for(lock, std::chrono::seconds(REBALANCE_RETRY_SECONDS), [this] { return stop || pending; });
+            } else {
+                cv.wait(lock, [this] { return stop || pending; });
+            }
+            if (stop) {
+                return;
+            }
+            pending = false;
+        }
+        retry = RunOnce() > 0;
+    }
+}
+
+int Rebalancer::RunOnce()
+{
+    int moved = 0;
+    int kept = 0;
+    int failed = 0;
+    throttle.SetRate(bytesPerSecond);
+    for (uint64_t inodeId : DiskCache::GetInstance().IdleKeys()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stop) {
+                break;
+            }
+        }
+        uint64_t placementKey = inodeId;
+        bool hasKey = GetPlacementKey(GetFilePath(inodeId), placementKey);
+        if (!hasKey && !inodeKeyed) {
+            continue;
+        }
+        int owner = StoreNode::GetInstance()->AllocNode(placementKey);
+        if (owner < 0) {
+            continue;
+        }
+        /* backups keep their copy */
+        std::vector<int> holders = StoreNode::GetInstance()->ReplicaNodes(owner, placementKey);
+        if (std::any_of(holders.begin(), holders.end(), [](int node) {
+                return StoreNode::GetInstance()->IsLocal(node);
+            })) {
+            continue;
+        }
+        /* opened since the scan, it is moved on a later pass */
+        if (!DiskCache::GetInstance().TryPinIdle(inodeId)) {
+            continue;
+        }
+        int ret = PushCacheFile(owner, inodeId, placementKey, hasKey, false, [this](size_t bytes) {
+            throttle.Acquire(bytes);
+        });
+        DiskCache::GetInstance().Unpin(inodeId);
+        if (ret == 0 || ret == -EEXIST) {
+            DiskCache::GetInstance().DeleteOldCacheWithNoPin(inodeId);
+            moved++;
+        } else if (ret == -ESTALE) {
+            /* which copy is current is not known here, the owner keeps serving its own and this
+             * one stays until it is evicted */
+            FALCON_LOG(LOG_WARNING) << "Rebalancer: node " << owner << " has another copy of inode " << inodeId
+                                    << ", keeping this one";
+            kept++;
+        } else {
+            FALCON_LOG(LOG_WARNING) << "Rebalancer: move inode " << inodeId << " to node " << owner
+                                    << " failed: " << strerror(-ret);
+            failed++;
+        }
+    }
+    if (moved > 0 || kept > 0 || failed > 0) {
+        FALCON_LOG(LOG_INFO) << "Rebalancer: moved " << moved << " files, kept " << kept << " that differ from the copy of"
+                             << " their owner, " << failed << " left";
+    }
+    return failed;
+}
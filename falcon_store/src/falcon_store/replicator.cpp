@@ -0,0 +1,166 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/replicator.h"
+
+#include <algorithm>
+
+Replicator::~Replicator() { Stop(); }
+
+int Replicator::Start(uint32_t threadNum, Pusher pusher)
+{
+    push = std::move(pusher);
+    stop = false;
+    for (uint32_t i = 0; i < std::max<uint32_t>(threadNum, 1); ++i) {
+        workers.emplace_back(&Replicator::Run, this);
+    }
+    return 0;
+}
+
+void Replicator::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    workCv.notify_all();
+    doneCv.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    queue.clear();
+    bases.clear();
+    baseOrder.clear();
+}
+
+void Replicator::Enqueue(uint64_t inodeId, uint64_t placementKey, std::vector<int> nodes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, added] = entries.try_emplace(inodeId);
+    Entry &entry = it->second;
+    entry.placementKey = placementKey;
+    entry.nodes = std::move(nodes);
+    entry.version++;
+    /* one in flight is queued again when it is over */
+    if (added) {
+        queue.push_back(inodeId);
+        workCv.notify_one();
+    }
+}
+
+void Replicator::Cancel(uint64_t inodeId)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    DropBases(inodeId);
+    auto it = entries.find(inodeId);
+    if (it == entries.end()) {
+        return;
+    }
+    if (it->second.pushing) {
+        /* the worker drops it when the copy is over */
+        it->second.cancelled = true;
+        doneCv.wait(lock, [&]() { return stop || entries.count(inodeId) == 0; });
+        return;
+    }
+    queue.erase(std::find(queue.begin(), queue.end(), inodeId));
+    Finish(inodeId);
+}
+
+size_t Replicator::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void Replicator::Finish(uint64_t inodeId)
+{
+    entries.erase(inodeId);
+    doneCv.notify_all();
+}
+
+void Replicator::SetBase(uint64_t inodeId, int nodeId, std::shared_ptr<const BlockChecksums> base)
+{
+    auto it = bases.find(inodeId);
+    if (it == bases.end()) {
+        if (bases.size() >= REPLICATE_BASES_MAX) {
+            bases.erase(baseOrder.front());
+            baseOrder.pop_front();
+        }
+        it = bases.emplace(inodeId, Bases{}).first;
+        it->second.order = baseOrder.insert(baseOrder.end(), inodeId);
+    } else {
+        baseOrder.splice(baseOrder.end(), baseOrder, it->second.order);
+    }
+    it->second.nodes[nodeId] = std::move(base);
+}
+
+void Replicator::DropBases(uint64_t inodeId)
+{
+    auto it = bases.find(inodeId);
+    if (it != bases.end()) {
+        baseOrder.erase(it->second.order);
+        bases.erase(it);
+    }
+}
+
+void Replicator::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        if (queue.empty()) {
+            workCv.wait(lock);
+            continue;
+        }
+        uint64_t inodeId = queue.front();
+        queue.pop_front();
+        /* entries are only erased by this worker while pushing is set */
+        Entry &entry = entries[inodeId];
+        entry.pushing = true;
+        uint64_t version = entry.version;
+        uint64_t placementKey = entry.placementKey;
+        std::vector<int> nodes = entry.nodes;
+        std::vector<std::shared_ptr<const BlockChecksums>> nodeBases(nodes.size());
+        auto found = bases.find(inodeId);
+        for (size_t i = 0; found != bases.end() && i < nodes.size(); ++i) {
+            auto base = found->second.nodes.find(nodes[i]);
+            if (base != found->second.nodes.end()) {
+                nodeBases[i] = base->second;
+            }
+        }
+
+        lock.unlock();
+        std::vector<std::shared_ptr<const BlockChecksums>> pushed(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            auto checksums = std::make_shared<BlockChecksums>();
+            if (push(inodeId, placementKey, nodes[i], nodeBases[i].get(), *checksums) == 0) {
+                pushed[i] = std::move(checksums);
+            }
+        }
+        lock.lock();
+
+        entry.pushing = false;
+        if (entry.cancelled) {
+            DropBases(inodeId);
+            Finish(inodeId);
+            continue;
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (pushed[i] != nullptr) {
+                SetBase(inodeId, nodes[i], std::move(pushed[i]));
+            } else if (bases.count(inodeId) != 0) {
+                bases[inodeId].nodes.erase(nodes[i]);
+            }
+        }
+        if (entry.version == version) {
+            Finish(inodeId);
+        } else {
+            /* flushed again while it was copied */
+            queue.push_back(inodeId);
+            workCv.notify_one();
+        }
+    }
+}
@@ -0,0 +1,69 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/stripe_layout.h"
+
+#include <algorithm>
+
+/* node id bits: sign set, unit size in granules from bit 8, width in the low 8 bits */
+#define STRIPE_NODE_FLAG 0x80000000u
+#define STRIPE_UNIT_SHIFT 8
+#define STRIPE_UNIT_MAX 0x7FFFFEu /* all ones would be -1 */
+#define STRIPE_WIDTH_MASK 0xFFu
+
+StripeLayout StripeLayout::FromNodeId(int nodeId)
+{
+    uint32_t bits = (uint32_t)nodeId;
+    StripeLayout layout;
+    layout.width = bits & STRIPE_WIDTH_MASK;
+    layout.unitSize = (uint64_t)((bits & ~STRIPE_NODE_FLAG) >> STRIPE_UNIT_SHIFT) * STRIPE_UNIT_GRANULE;
+    return layout;
+}
+
+StripeLayout StripeLayout::Make(uint32_t width, uint64_t unitSize)
+{
+    StripeLayout layout;
+    layout.width = std::clamp<uint32_t>(width, 1, STRIPE_MAX_WIDTH);
+    uint64_t granules = std::clamp<uint64_t>((unitSize + STRIPE_UNIT_GRANULE - 1) / STRIPE_UNIT_GRANULE, 1,
+                                             STRIPE_UNIT_MAX);
+    layout.unitSize = granules * STRIPE_UNIT_GRANULE;
+    return layout;
+}
+
+int StripeLayout::ToNodeId() const
+{
+    uint32_t granules = unitSize / STRIPE_UNIT_GRANULE;
+    return (int)(STRIPE_NODE_FLAG | (granules << STRIPE_UNIT_SHIFT) | (width & STRIPE_WIDTH_MASK));
+}
+
+uint32_t StripeLayout::StripeOf(uint64_t offset, uint64_t &stripeOffset) const
+{
+    uint64_t unit = offset / unitSize;
+    stripeOffset = unit / width * unitSize + offset % unitSize;
+    return unit % width;
+}
+
+uint64_t StripeLayout::StripeSize(uint64_t fileSize, uint32_t stripe) const
+{
+    uint64_t round = unitSize * width;
+    uint64_t size = fileSize / round * unitSize;
+    uint64_t rest = fileSize % round;
+    uint64_t start = (uint64_t)stripe * unitSize;
+    if (rest > start) {
+        size += std::min(rest - start, unitSize);
+    }
+    return size;
+}
+
+uint64_t StripeLayout::StripeInodeId(uint64_t inodeId, uint32_t stripe)
+{
+    return STRIPE_INODE_FLAG | (inodeId << 8) | (stripe & STRIPE_WIDTH_MASK);
+}
+
+std::string StripeLayout::StripePath(const std::string &path, uint32_t stripe)
+{
+    size_t slash = path.rfind('/');
+    size_t nameStart = slash == std::string::npos ? 0 : slash + 1;
+    return path.substr(0, nameStart) + ".falcon_stripe." + std::to_string(stripe) + "." + path.substr(nameStart);
+}
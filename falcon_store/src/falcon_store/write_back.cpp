@@ -0,0 +1,345 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "falcon_store/write_back.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "disk_cache/disk_cache.h"
+#include "log/logging.h"
+
+WriteBack::~WriteBack() { Stop(); }
+
+int WriteBack::Start(const std::string &rootPath, uint32_t threadNum, Uploader uploader)
+{
+    std::error_code ec;
+    journalDir = rootPath + "/writeback";
+    if (!std::filesystem::create_directories(journalDir, ec) && ec) {
+        FALCON_LOG(LOG_ERROR) << "WriteBack: create " << journalDir << " failed: " << ec.message();
+        return -EIO;
+    }
+    upload = std::move(uploader);
+
+    /* queue again what was not uploaded before the restart */
+    int replayed = 0;
+    for (auto &file : std::filesystem::directory_iterator(journalDir, ec)) {
+        std::string name = file.path().filename().string();
+        if (name.find('.') != std::string::npos) {
+            /* journal entry half written */
+            std::filesystem::remove(file.path(), ec);
+            continue;
+        }
+        uint64_t inodeId = strtoull(name.c_str(), nullptr, 10);
+        std::ifstream journal(file.path());
+        std::stringstream path;
+        path << journal.rdbuf();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!Add(inodeId, path.str())) {
+            FALCON_LOG(LOG_ERROR) << "WriteBack: cache file of " << path.str() << " is gone, it was not uploaded";
+            RemoveJournal(inodeId);
+            continue;
+        }
+        replayed++;
+    }
+    if (replayed > 0) {
+        FALCON_LOG(LOG_INFO) << "WriteBack: " << replayed << " uploads queued from the journal";
+    }
+
+    stop = false;
+    for (uint32_t i = 0; i < std::max<uint32_t>(threadNum, 1); ++i) {
+        workers.emplace_back(&WriteBack::Run, this);
+    }
+    return 0;
+}
+
+void WriteBack::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    workCv.notify_all();
+    doneCv.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    /* the journal keeps what is left for the next Start */
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &[inodeId, entry] : entries) {
+        DiskCache::GetInstance().Unpin(inodeId);
+    }
+    entries.clear();
+    pathToInode.clear();
+    queue.clear();
+}
+
+WriteBack::QueueKey WriteBack::KeyOf(uint64_t inodeId, const Entry &entry)
+{
+    return {!entry.urgent, entry.notBefore, entry.seq, inodeId};
+}
+
+bool WriteBack::Add(uint64_t inodeId, const std::string &path)
+{
+    if (!DiskCache::GetInstance().Find(inodeId, true)) {
+        return false;
+    }
+    Entry &entry = entries[inodeId];
+    entry.path = path;
+    entry.version = 1;
+    entry.seq = nextSeq++;
+    entry.notBefore = std::chrono::steady_clock::now();
+    pathToInode[path] = inodeId;
+    queue.insert(KeyOf(inodeId, entry));
+    workCv.notify_one();
+    return true;
+}
+
+int WriteBack::Enqueue(uint64_t inodeId, const std::string &path)
+{
+    std::string tmpFile;
+    int ret = WriteJournal(inodeId, path, tmpFile);
+    if (ret != 0) {
+        return ret;
+    }
+    /* the journal goes in place with the version bump, an upload that finishes the old version
+     * in between would remove it otherwise */
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ret = CommitJournal(inodeId, tmpFile);
+        if (ret == 0) {
+            ret = AddOrUpdate(inodeId, path);
+        }
+    }
+    /* the rename lasts once the directory is synced */
+    if (ret == 0) {
+        SyncJournalDir();
+    }
+    return ret;
+}
+
+int WriteBack::AddOrUpdate(uint64_t inodeId, const std::string &path)
+{
+    auto it = entries.find(inodeId);
+    if (it == entries.end()) {
+        if (!Add(inodeId, path)) {
+            RemoveJournal(inodeId);
+            return -ENOENT;
+        }
+        return 0;
+    }
+    Entry &entry = it->second;
+    if (!entry.uploading) {
+        queue.erase(KeyOf(inodeId, entry));
+    }
+    if (entry.path != path) {
+        pathToInode.erase(entry.path);
+        entry.path = path;
+        pathToInode[path] = inodeId;
+    }
+    entry.version++;
+    entry.notBefore = std::chrono::steady_clock::now();
+    if (!entry.uploading) {
+        queue.insert(KeyOf(inodeId, entry));
+        workCv.notify_one();
+    }
+    return 0;
+}
+
+int WriteBack::Wait(uint64_t inodeId)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return WaitLocked(lock, inodeId);
+}
+
+int WriteBack::WaitPath(const std::string &path)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = pathToInode.find(path);
+    if (it == pathToInode.end()) {
+        return 0;
+    }
+    return WaitLocked(lock, it->second);
+}
+
+int WriteBack::WaitLocked(std::unique_lock<std::mutex> &lock, uint64_t inodeId)
+{
+    auto it = entries.find(inodeId);
+    if (it == entries.end()) {
+        return 0;
+    }
+    Entry &entry = it->second;
+    if (!entry.urgent) {
+        if (!entry.uploading) {
+            queue.erase(KeyOf(inodeId, entry));
+        }
+        entry.urgent = true;
+        entry.notBefore = std::chrono::steady_clock::now();
+        if (!entry.uploading) {
+            queue.insert(KeyOf(inodeId, entry));
+            workCv.notify_one();
+        }
+    }
+    uint32_t failures = entry.failures;
+    doneCv.wait(lock, [&]() {
+        auto found = entries.find(inodeId);
+        return stop || found == entries.end() || found->second.failures != failures;
+    });
+    return entries.count(inodeId) == 0 ? 0 : -EIO;
+}
+
+void WriteBack::Cancel(uint64_t inodeId)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(inodeId);
+    if (it == entries.end()) {
+        return;
+    }
+    if (it->second.uploading) {
+        /* the worker drops it when the attempt is over */
+        it->second.cancelled = true;
+        doneCv.wait(lock, [&]() { return stop || entries.count(inodeId) == 0; });
+        return;
+    }
+    Finish(inodeId);
+}
+
+bool WriteBack::Queued(uint64_t inodeId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.count(inodeId) != 0;
+}
+
+size_t WriteBack::Pending()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void WriteBack::Finish(uint64_t inodeId)
+{
+    Entry &entry = entries[inodeId];
+    if (!entry.uploading) {
+        queue.erase(KeyOf(inodeId, entry));
+    }
+    auto it = pathToInode.find(entry.path);
+    if (it != pathToInode.end() && it->second == inodeId) {
+        pathToInode.erase(it);
+    }
+    entries.erase(inodeId);
+    RemoveJournal(inodeId);
+    DiskCache::GetInstance().Unpin(inodeId);
+    doneCv.notify_all();
+}
+
+void WriteBack::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        if (queue.empty()) {
+            workCv.wait(lock);
+            continue;
+        }
+        auto [notUrgent, notBefore, seq, inodeId] = *queue.begin();
+        if (notBefore > std::chrono::steady_clock::now()) {
+            workCv.wait_until(lock, notBefore);
+            continue;
+        }
+        queue.erase(queue.begin());
+        /* entries are only erased by this worker while uploading is set */
+        Entry &entry = entries[inodeId];
+        entry.uploading = true;
+        uint64_t version = entry.version;
+        std::string path = entry.path;
+
+        lock.unlock();
+        int ret = upload(inodeId, path);
+        lock.lock();
+
+        entry.uploading = false;
+        if (entry.cancelled || (ret == 0 && entry.version == version)) {
+            Finish(inodeId);
+            continue;
+        }
+        if (ret != 0) {
+            /* the waiters see the failure, the retry is no longer urgent */
+            entry.failures++;
+            entry.urgent = false;
+            uint64_t backoffMs = (uint64_t)WRITEBACK_RETRY_MIN_MS << std::min(entry.failures - 1, 20U);
+            backoffMs = std::min<uint64_t>(backoffMs, WRITEBACK_RETRY_MAX_MS);
+            entry.notBefore = std::chrono::steady_clock::now() + std::chrono::milliseconds(backoffMs);
+            FALCON_LOG(LOG_WARNING) << "WriteBack: upload " << path << " failed: " << strerror(-ret) << ", retry in "
+                                    << backoffMs << "ms";
+            doneCv.notify_all();
+        } else {
+            /* written again while it was uploading */
+            entry.notBefore = std::chrono::steady_clock::now();
+        }
+        queue.insert(KeyOf(inodeId, entry));
+    }
+}
+
+int WriteBack::WriteJournal(uint64_t inodeId, const std::string &path, std::string &tmpFile)
+{
+    static std::atomic<uint64_t> tmpSeq{0};
+    tmpFile = journalDir + "/" + std::to_string(inodeId) + ".tmp." + std::to_string(tmpSeq++);
+    int fd = open(tmpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "WriteBack: create " << tmpFile << " failed: " << strerror(err);
+        return -err;
+    }
+    int ret = 0;
+    ssize_t written = write(fd, path.data(), path.size());
+    if (written != (ssize_t)path.size()) {
+        ret = written < 0 ? -errno : -EIO;
+    } else if (fsync(fd) != 0) {
+        ret = -errno;
+    }
+    close(fd);
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "WriteBack: journal " << path << " failed: " << strerror(-ret);
+        unlink(tmpFile.c_str());
+    }
+    return ret;
+}
+
+int WriteBack::CommitJournal(uint64_t inodeId, const std::string &tmpFile)
+{
+    std::string journalFile = journalDir + "/" + std::to_string(inodeId);
+    if (rename(tmpFile.c_str(), journalFile.c_str()) != 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "WriteBack: rename " << tmpFile << " failed: " << strerror(err);
+        unlink(tmpFile.c_str());
+        return -err;
+    }
+    return 0;
+}
+
+void WriteBack::SyncJournalDir()
+{
+    int fd = open(journalDir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || fsync(fd) != 0) {
+        FALCON_LOG(LOG_WARNING) << "WriteBack: sync " << journalDir << " failed: " << strerror(errno);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+void WriteBack::RemoveJournal(uint64_t inodeId)
+{
+    std::string journalFile = journalDir + "/" + std::to_string(inodeId);
+    if (unlink(journalFile.c_str()) != 0 && errno != ENOENT) {
+        FALCON_LOG(LOG_WARNING) << "WriteBack: remove " << journalFile << " failed: " << strerror(errno);
+    }
+}
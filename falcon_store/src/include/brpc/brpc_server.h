@@ -40,6 +40,11 @@ class RemoteIOServiceImpl : public RemoteIOService {
                        ErrorCodeOnlyReply *response,
                        google::protobuf::Closure *done) override;
 
+    void StreamRead(google::protobuf::RpcController *cntl_base,
+                    const StreamReadRequest *request,
+                    ErrorCodeOnlyReply *response,
+                    google::protobuf::Closure *done) override;
+
     void WriteFile(google::protobuf::RpcController *cntl_base,
                    const WriteRequest *request,
                    WriteReply *response,
@@ -74,6 +79,61 @@ class RemoteIOServiceImpl : public RemoteIOService {
                          const StatClusterRequest *request,
                          StatClusterReply *response,
                          google::protobuf::Closure *done) override;
+
+    void MigrateFile(google::protobuf::RpcController *cntl_base,
+                     const MigrateFileRequest *request,
+                     ErrorCodeOnlyReply *response,
+                     google::protobuf::Closure *done) override;
+
+    void DropCache(google::protobuf::RpcController *cntl_base,
+                   const DropCacheRequest *request,
+                   ErrorCodeOnlyReply *response,
+                   google::protobuf::Closure *done) override;
+
+    void LocateCache(google::protobuf::RpcController *cntl_base,
+                     const LocateCacheRequest *request,
+                     ErrorCodeOnlyReply *response,
+                     google::protobuf::Closure *done) override;
+
+    void WarmupFile(google::protobuf::RpcController *cntl_base,
+                    const WarmupFileRequest *request,
+                    ErrorCodeOnlyReply *response,
+                    google::protobuf::Closure *done) override;
+
+    void PutShard(google::protobuf::RpcController *cntl_base,
+                  const PutShardRequest *request,
+                  ErrorCodeOnlyReply *response,
+                  google::protobuf::Closure *done) override;
+
+    void ReadShard(google::protobuf::RpcController *cntl_base,
+                   const ReadShardRequest *request,
+                   ReadShardReply *response,
+                   google::protobuf::Closure *done) override;
+
+    void DropShard(google::protobuf::RpcController *cntl_base,
+                   const DropCacheRequest *request,
+                   ErrorCodeOnlyReply *response,
+                   google::protobuf::Closure *done) override;
+
+    void KvPut(google::protobuf::RpcController *cntl_base,
+               const KvPutRequest *request,
+               KvReply *response,
+               google::protobuf::Closure *done) override;
+
+    void KvGet(google::protobuf::RpcController *cntl_base,
+               const KvKeysRequest *request,
+               KvReply *response,
+               google::protobuf::Closure *done) override;
+
+    void KvExists(google::protobuf::RpcController *cntl_base,
+                  const KvKeysRequest *request,
+                  KvReply *response,
+                  google::protobuf::Closure *done) override;
+
+    void KvDelete(google::protobuf::RpcController *cntl_base,
+                  const KvKeysRequest *request,
+                  KvReply *response,
+                  google::protobuf::Closure *done) override;
 };
 
 class RemoteIOServer {
@@ -5,10 +5,12 @@
 #pragma once
 
 #include <securec.h>
+#include <functional>
 #include <memory>
 #include <string>
 
 #include <brpc/channel.h>
+#include <brpc/stream.h>
 
 #include "brpc_io.pb.h"
 #include "util/utils.h"
@@ -17,8 +19,42 @@
 #define BRPC_RETRY_NUM 3
 #define BRPC_RETRY_DELEY 1
 
+/*
+ * Every block pushed on a StreamRead stream starts with this header, result is the size of
+ * the block or -errno. The reader grants credits back with messages of one uint32_t each.
+ */
+struct StreamReadHeader
+{
+    uint64_t offset;
+    int64_t result;
+};
+
+/* the erasure coded shard of a file a node holds */
+struct ShardInfo
+{
+    uint32_t index = 0;
+    uint32_t dataShards = 0;
+    uint32_t parityShards = 0;
+    /* node holding the whole file when it was coded */
+    int owner = -1;
+    uint64_t fileSize = 0;
+    /* shards of a file coded at different times carry different versions */
+    uint64_t version = 0;
+
+    uint64_t ShardSize() const { return dataShards == 0 ? 0 : (fileSize + dataShards - 1) / dataShards; }
+};
+
 class FalconIOClient {
   public:
+    /* completion of an asynchronous call, with 0 or -errno */
+    using Done = std::function<void(int)>;
+    /* completion of an asynchronous read, data holds what was read on 0 */
+    using ReadDone = std::function<void(int, butil::IOBuf &)>;
+    /* completion of an asynchronous shard read, with the shard, the crc32c of data and data on 0 */
+    using ShardDone = std::function<void(int, const ShardInfo &, uint32_t, butil::IOBuf &)>;
+    /* completion of an asynchronous kv call, with the result per key and for KvGet the blocks on 0 */
+    using KvDone = std::function<void(int, std::vector<int64_t> &, butil::IOBuf &)>;
+
     FalconIOClient()
     {
         channel = nullptr;
@@ -36,23 +72,86 @@ class FalconIOClient {
                  uint64_t &physicalFd,
                  int BufferSize,
                  off_t offset,
-                 const std::string &path = "");
+                 const std::string &path = "",
+                 butil::IOBuf *data = nullptr);
     int CloseFile(uint64_t physicalFd, bool isFlush, bool isSync, const char *buf, size_t size, off_t offset);
+    /* data is left as it was, for a retry */
+    int CloseFile(uint64_t physicalFd, bool isFlush, bool isSync, const butil::IOBuf &data, off_t offset);
     int OpenFile(uint64_t inodeId,
                  int oflags,
                  uint64_t &physicalFd,
                  uint64_t originalSize,
                  const std::string &path,
-                 bool nodeFail);
+                 bool nodeFail,
+                 bool cacheOnly = false);
     int WriteFile(uint64_t physicalFd, const char *writeBuffer, uint64_t size, off_t offset);
-    ssize_t
-    ReadSmallFile(uint64_t inodeId, ssize_t size, std::string &path, char *readBuffer, int oflags, bool nodeFail);
+    int WriteFile(uint64_t physicalFd, const butil::IOBuf &data, off_t offset);
+    void WriteFileAsync(uint64_t physicalFd, butil::IOBuf &data, off_t offset, Done done);
+    ssize_t ReadSmallFile(uint64_t inodeId,
+                          ssize_t size,
+                          std::string &path,
+                          char *readBuffer,
+                          int oflags,
+                          bool nodeFail,
+                          bool cacheOnly = false);
+    void ReadSmallFileAsync(uint64_t inodeId,
+                            ssize_t size,
+                            const std::string &path,
+                            int oflags,
+                            bool cacheOnly,
+                            ReadDone done);
     int DeleteFile(uint64_t inodeId, int nodeId, std::string &path);
     int StatFS(std::string &path, struct StatFSBuf *fsBuf);
     int TruncateOpenInstance(uint64_t physicalFd, off_t size);
     int TruncateFile(uint64_t physicalFd, off_t size);
     int CheckConnection();
     int StatCluster(int nodeId, std::vector<size_t> &stats, bool scatter);
+    int OpenReadStream(uint64_t physicalFd,
+                       off_t offset,
+                       uint64_t size,
+                       uint32_t blockSize,
+                       uint32_t credits,
+                       brpc::StreamInputHandler *handler,
+                       brpc::StreamId &streamId);
+    static int GrantReadStreamCredits(brpc::StreamId streamId, uint32_t credits);
+    int MigrateFile(uint64_t inodeId,
+                    uint64_t placementKey,
+                    bool hasKey,
+                    off_t offset,
+                    uint64_t totalSize,
+                    bool last,
+                    bool replica,
+                    uint32_t crc,
+                    uint32_t fingerprint,
+                    bool patch,
+                    uint32_t baseFingerprint,
+                    butil::IOBuf &data);
+    int DropCache(uint64_t inodeId);
+    void LocateCacheAsync(
+        uint64_t inodeId, uint64_t size, bool checkFingerprint, uint32_t fingerprint, int timeoutMs, Done done);
+    /* action is a CacheAction, route asks the node to forward the call to the owner of the file */
+    int WarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, int action, bool route);
+    int PutShard(uint64_t inodeId, const ShardInfo &info, uint64_t offset, bool last, uint32_t crc, butil::IOBuf &data);
+    void ReadShardAsync(uint64_t inodeId, uint64_t offset, uint64_t size, int timeoutMs, ShardDone done);
+    int DropShard(uint64_t inodeId, int timeoutMs);
+    /* results hold a result per key, 0 or -errno, and for KvGet the size of the block in data */
+    int KvPut(const std::vector<std::string> &keys,
+              const std::vector<uint64_t> &sizes,
+              uint32_t ttlSeconds,
+              butil::IOBuf &data,
+              std::vector<int64_t> &results);
+    int KvGet(const std::vector<std::string> &keys, std::vector<int64_t> &results, butil::IOBuf &data);
+    int KvExists(const std::vector<std::string> &keys, std::vector<int64_t> &results);
+    int KvDelete(const std::vector<std::string> &keys, std::vector<int64_t> &results);
+    /* the kv calls without waiting */
+    void KvPutAsync(const std::vector<std::string> &keys,
+                    const std::vector<uint64_t> &sizes,
+                    uint32_t ttlSeconds,
+                    butil::IOBuf &data,
+                    KvDone done);
+    void KvGetAsync(const std::vector<std::string> &keys, KvDone done);
+    void KvExistsAsync(const std::vector<std::string> &keys, KvDone done);
+    void KvDeleteAsync(const std::vector<std::string> &keys, KvDone done);
 
   private:
     std::shared_ptr<brpc::Channel> channel;
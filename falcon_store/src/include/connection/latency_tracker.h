@@ -0,0 +1,43 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/* bucket i counts latencies in [2^i, 2^(i+1)) us, bucket 0 also counts 0 */
+#define LATENCY_BUCKETS 32
+/* counts are halved every this many samples, so percentiles follow recent latency */
+#define LATENCY_DECAY_SAMPLES 1024
+/* fewer samples than this give no percentile */
+#define LATENCY_MIN_SAMPLES 16
+
+/*
+ * Latency of requests to one store node, used to pick the replica to read from and to decide
+ * when a read has waited long enough to be hedged to another replica.
+ */
+class LatencyTracker {
+  public:
+    void Record(uint64_t us);
+    /* latency in us that p percent of recent requests stayed below, 0 if too few were seen */
+    uint64_t Percentile(uint32_t p);
+    /* smoothed mean latency in us */
+    uint64_t Mean() { return mean.load(std::memory_order_relaxed); }
+    /* requests sent and not answered yet */
+    void Begin() { inflight.fetch_add(1, std::memory_order_relaxed); }
+    void End() { inflight.fetch_sub(1, std::memory_order_relaxed); }
+    uint32_t Inflight() { return inflight.load(std::memory_order_relaxed); }
+    /* lower is better, unknown nodes score 0 so they get tried */
+    uint64_t Load() { return Mean() * (Inflight() + 1); }
+
+  private:
+    std::mutex mutex;
+    uint64_t buckets[LATENCY_BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sinceDecay = 0;
+    std::atomic<uint64_t> mean = 0;
+    std::atomic<uint32_t> inflight = 0;
+};
@@ -4,23 +4,65 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <unordered_map>
 #include <vector>
 
+#include "connection/latency_tracker.h"
+#include "connection/node_placement.h"
 #include "falcon_io_client.h"
 
+/* how long opens are forwarded to the previous owner of a file after a membership change */
+#define NODE_DEFAULT_FORWARD_SECONDS 600
+
 class StoreNode {
   private:
     std::shared_mutex nodeMutex;
     int initStatus = 0;
     int nodeId;
     std::unordered_map<int, std::pair<std::string, std::shared_ptr<FalconIOClient>>> nodeMap;
+    /* placement of files over nodeMap, and configured weights by node id */
+    NodePlacement placement;
+    std::unordered_map<int, double> nodeWeights;
+    /* placement before the last membership change, files may still be cached there */
+    NodePlacement previousPlacement;
+    std::chrono::steady_clock::time_point placementChangedAt;
+    uint32_t forwardSeconds = NODE_DEFAULT_FORWARD_SECONDS;
+    std::atomic<uint64_t> generation = 0;
+    std::function<void()> membershipListener;
+    /* nodes holding a copy of each file, the owner included */
+    uint32_t replicas = 1;
+    std::mutex latencyMutex;
+    std::unordered_map<int, std::unique_ptr<LatencyTracker>> latency;
+
+    double NodeWeight(int id);
 
   public:
     int SetNodeConfig(int initNodeId, std::string &clusterView);
     int SetNodeConfig(std::string &rootPath);
+    /* comma separated weights in cluster view order, empty or invalid entries weigh 1 */
+    void SetNodeWeights(const std::string &weights);
+    /* called, without locks held, after a membership change moved the placement of files */
+    void SetMembershipListener(std::function<void()> listener);
+    void SetForwardSeconds(uint32_t seconds);
+    /* bumped on every placement change, callers caching AllocNode results drop them */
+    uint64_t Generation() { return generation.load(); }
+    /* owner of key before the last membership change if it differs and is still up, else -1 */
+    int PreviousOwner(uint64_t key);
+    void SetReplicas(uint32_t count);
+    uint32_t Replicas() { return replicas; }
+    /* nodes holding key, owner first, then the backups in failover order */
+    std::vector<int> ReplicaNodes(int owner, uint64_t key);
+    /* up to count nodes other than owner to hold the erasure coded shards of key, in rank order */
+    std::vector<int> ShardNodes(int owner, uint64_t key, size_t count);
+    /* the first count nodes in the placement order of key, its owner first */
+    std::vector<int> RankedNodes(uint64_t key, size_t count);
+    LatencyTracker &Latency(int nodeId);
     static StoreNode *GetInstance();
     static void DeleteInstance();
     FalconIOClient *CreateIOConnection(const std::string &rpcEndPoint);
@@ -0,0 +1,49 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define NODE_DEFAULT_WEIGHT 1.0
+
+uint64_t hash64(uint64_t x);
+
+/*
+ * Weighted rendezvous hashing of keys to store nodes.
+ *
+ * Every node scores a key as weight / -ln(u), u being a hash of (key, nodeId) mapped to (0, 1);
+ * the key goes to the highest score. A node's share of keys is proportional to its weight, and
+ * the result depends only on the key and the set of (nodeId, weight), so it is the same on every
+ * client and across restarts. Adding or removing a node only moves the keys that it wins or
+ * held, about 1/N of them.
+ *
+ * Not synchronized, the owner guards it.
+ */
+class NodePlacement {
+  public:
+    void AddNode(int nodeId, double weight = NODE_DEFAULT_WEIGHT);
+    void RemoveNode(int nodeId);
+    void Clear();
+    bool Empty() const { return nodes.empty(); }
+    size_t Size() const { return nodes.size(); }
+
+    /* node for key, -1 if there is no node */
+    int Locate(uint64_t key) const;
+    /* up to count distinct nodes for key, best first */
+    std::vector<int> Rank(uint64_t key, size_t count) const;
+
+  private:
+    struct Node
+    {
+        int nodeId;
+        double weight;
+    };
+
+    static double Score(uint64_t key, const Node &node);
+
+    std::vector<Node> nodes;
+};
@@ -7,6 +7,7 @@
 #include <dirent.h>
 #include <securec.h>
 #include <atomic>
+#include <functional>
 #include <list>
 #include <mutex>
 #include <string>
@@ -28,6 +29,8 @@ struct CacheItem
     uint64_t size{0};
     uint64_t atime{0};
     uint32_t refs{0};
+    /* kept through evictions until unpinned, see DiskCache::SetPinned */
+    bool pinned{false};
 };
 
 class DiskCache {
@@ -53,6 +56,23 @@ class DiskCache {
     bool PreAllocSpace(uint64_t size);
     void FreePreAllocSpace(uint64_t size);
     bool HasFreeSpace();
+    /* cached files nobody has pinned */
+    std::vector<uint64_t> IdleKeys();
+    /* pin key only if it is cached and nobody else has it pinned */
+    bool TryPinIdle(uint64_t key);
+    /* pinned cache files are never evicted, their bytes together are limited to quota, 0 allows none */
+    void SetPinQuota(uint64_t quota);
+    /* pin or unpin a cached file, the pin is kept across restarts. Returns -ENOENT if key is not
+     * cached and -EDQUOT if pinning it would exceed the quota */
+    int SetPinned(uint64_t key, bool pinned);
+    uint64_t PinnedBytes();
+    /* size bytes more are kept on the cache disk outside the cached files and never evicted, e.g.
+     * shards of files of other nodes, or fewer if negative. Bytes just written are taken from the
+     * free space too, until its next refresh sees them */
+    void Keep(int64_t size, bool written);
+    uint64_t KeptBytes();
+    /* called with the key of every cache file removed, evicted or deleted */
+    void SetRemoveListener(std::function<void(uint64_t)> listener);
 
   private:
     uint64_t totalCap{0};
@@ -67,6 +87,9 @@ class DiskCache {
     bool testOBS = false;
 
     uint64_t usedCap{0};
+    uint64_t pinQuota{0};
+    uint64_t pinnedCap{0};
+    uint64_t keptCap{0};
 
     std::string rootDir;
     std::list<CacheItem> cacheItems;
@@ -84,6 +107,7 @@ class DiskCache {
     std::mutex allocMutex;
 
     static std::mutex initCacheMutex;
+    std::function<void(uint64_t)> removeListener;
 
     static std::vector<CacheItem> initCacheVector;
     int GetCurFreeRatio();
@@ -93,4 +117,7 @@ class DiskCache {
     int ScanCache();
     static int Walk(std::string dirPath);
     int CheckSpaceEnough();
+    void Removed(uint64_t key);
+    /* drop the item of key from the lru and the counters, the file is already gone */
+    void Erase(cacheIterator elem);
 };
@@ -0,0 +1,88 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define CHECKSUM_MAGIC 0x31435246 /* "FRC1" */
+#define CHECKSUM_HEADER_SIZE 16
+#define CHECKSUM_MIN_BLOCK_SIZE (1024 * 1024)
+/* the checksums of a file fit one xattr on ext4, larger files get larger blocks */
+#define CHECKSUM_MAX_BLOCKS 960
+#define CHECKSUM_XATTR "user.falcon.crc"
+
+/*
+ * crc32c of every block of a file, serialized as
+ *
+ *   | magic blockSize fileSize | u32 crc per block |
+ *
+ * and kept in an xattr of a cache file and in a sidecar object next to an object in storage.
+ * Blocks are CHECKSUM_MIN_BLOCK_SIZE, doubled until a file has at most CHECKSUM_MAX_BLOCKS.
+ */
+class BlockChecksums {
+  public:
+    BlockChecksums() = default;
+    explicit BlockChecksums(uint64_t fileSize);
+
+    static BlockChecksums OfBuffer(const char *buf, uint64_t size);
+    /* the checksums of the first size bytes of fd, 0 or -errno */
+    static int OfFile(int fd, uint64_t size, BlockChecksums &checksums);
+    /* 0, -ENODATA if fd has none, or -errno */
+    static int Load(int fd, BlockChecksums &checksums);
+    int Save(int fd) const;
+    /* fd is about to change, its checksums do not hold any more */
+    static void Drop(int fd);
+    /* the fingerprint of the first size bytes of fd, taken from its checksums if they are of that size */
+    static int FingerprintOf(int fd, uint64_t size, uint32_t &fingerprint);
+
+    std::string Serialize() const;
+    static bool Parse(const std::string &data, BlockChecksums &checksums);
+
+    uint64_t FileSize() const { return fileSize; }
+    uint32_t BlockSize() const { return blockSize; }
+    size_t Blocks() const { return crcs.size(); }
+    uint64_t BlockOffset(size_t block) const { return (uint64_t)block * blockSize; }
+    uint64_t BlockLength(size_t block) const;
+    void Set(size_t block, uint32_t crc) { crcs[block] = crc; }
+    bool Check(size_t block, const char *data) const;
+    /* the blocks wholly inside [offset, offset + size) of buf holding that range that do not match */
+    std::vector<size_t> Mismatches(const char *buf, uint64_t offset, uint64_t size) const;
+    /* the byte ranges, as offset and length, of the blocks that differ from older, which has the same block size */
+    std::vector<std::pair<uint64_t, uint64_t>> Changes(const BlockChecksums &older) const;
+    /* crc32c of the checksums, the same for files of the same content */
+    uint32_t Fingerprint() const;
+    bool operator==(const BlockChecksums &other) const = default;
+
+  private:
+    uint32_t blockSize = CHECKSUM_MIN_BLOCK_SIZE;
+    uint64_t fileSize = 0;
+    std::vector<uint32_t> crcs;
+};
+
+/*
+ * Checks the blocks of a cache file as an open reads them. A block is read whole and checked
+ * the first time a read touches it, later reads of it are not checked again. A verifier is
+ * disabled once the file changed under the open and its checksums do not hold any more.
+ */
+class CacheVerifier {
+  public:
+    explicit CacheVerifier(BlockChecksums initChecksums);
+    /* 0 if the blocks [offset, offset + size) touches are intact, or -EBADMSG and the first bad block */
+    int Verify(int fd, uint64_t offset, uint64_t size, size_t &badBlock);
+    const BlockChecksums &Checksums() const { return checksums; }
+    bool Enabled() const { return !disabled; }
+    void Disable() { disabled = true; }
+
+  private:
+    std::atomic<bool> disabled{false};
+    std::mutex mutex;
+    BlockChecksums checksums;
+    std::vector<bool> verified;
+};
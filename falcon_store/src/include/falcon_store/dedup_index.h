@@ -0,0 +1,119 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "falcon_store/block_checksums.h"
+#include "storage/storage.h"
+
+/* smaller files are uploaded again, a copy and its checks cost about as much */
+#define DEDUP_MIN_COPY_SIZE (1024 * 1024)
+
+/* sha-256 of a chunk */
+using Fingerprint = std::array<uint8_t, 32>;
+
+struct FingerprintHash
+{
+    size_t operator()(const Fingerprint &fp) const
+    {
+        size_t hash;
+        memcpy(&hash, fp.data(), sizeof(hash));
+        return hash;
+    }
+};
+
+/*
+ * Content addressing of the cache files on this node. Files are fingerprinted chunk by chunk
+ * when they are written, a chunk equal to one of another cached file is shared with it through
+ * FIDEDUPERANGE, so the cache file system keeps the data once and counts its references, the
+ * blocks are freed with the last file using them and a write to a shared block copies it. That
+ * needs a file system with reflinks, e.g. xfs or btrfs, elsewhere only uploads are deduplicated.
+ *
+ * A file whose whole content was uploaded before from another cache file is copied in storage
+ * from that object instead. Uploads are looked up by the block checksums of the file. The source
+ * object is only copied while its checksum sidecar, read again from storage for that, holds the
+ * same ones, and the sidecar the copy brings along is checked the same way after it, to catch a
+ * replace in between. A file that fails either check is uploaded as usual. Copies thus need the
+ * checksum storage, without it every file is uploaded. The index lives in memory and covers the
+ * files written since the start.
+ */
+class DedupIndex {
+  public:
+    /* share length bytes of srcFd at srcOffset into dstFd at dstOffset if they are equal,
+     * returns the bytes shared or -errno */
+    using Sharer =
+        std::function<int64_t(int srcFd, uint64_t srcOffset, int dstFd, uint64_t dstOffset, uint64_t length)>;
+
+    static DedupIndex &GetInstance()
+    {
+        static DedupIndex instance;
+        return instance;
+    }
+
+    /* chunkSize 0 turns the index off, sharer is FIDEDUPERANGE by default */
+    void Init(uint32_t chunkSize, Sharer sharer = nullptr);
+    bool Enabled() const { return chunkSize != 0; }
+    /* fingerprint cache file inodeId and share its chunks with equal ones of other cached files */
+    int Scan(uint64_t inodeId);
+    /* drop inodeId from the index, e.g. its cache file is deleted, every chunk loses a reference */
+    void Forget(uint64_t inodeId);
+    /* copy content to objectKey from an object uploaded before that still has it, -ENOENT if none */
+    int CopyUploaded(Storage *storage, const std::string &objectKey, const BlockChecksums &content);
+    /* objectKey got content from cache file inodeId */
+    void SetUploaded(uint64_t inodeId, const std::string &objectKey, const BlockChecksums &content);
+    void MoveObject(const std::string &from, const std::string &to);
+    void ForgetObject(const std::string &objectKey);
+    /* files holding the content of chunk of inodeId */
+    size_t References(uint64_t inodeId, uint32_t chunk);
+    size_t Files();
+    void Clear();
+
+  private:
+    struct FileEntry
+    {
+        uint64_t size = 0;
+        std::vector<Fingerprint> chunks;
+    };
+    struct ChunkRef
+    {
+        uint64_t inodeId;
+        uint32_t chunk;
+    };
+    struct Upload
+    {
+        /* of the block checksums of the content */
+        uint32_t fingerprint;
+        uint64_t inodeId;
+    };
+
+    DedupIndex() = default;
+    static int64_t Dedupe(int srcFd, uint64_t srcOffset, int dstFd, uint64_t dstOffset, uint64_t length);
+    int64_t ShareChunk(const Fingerprint &fp, uint64_t inodeId, int fd, uint64_t offset, uint64_t length);
+    void ForgetChunksLocked(uint64_t inodeId);
+    /* the checksum sidecar of objectKey in storage holds those of content */
+    static bool StoredAs(const std::string &objectKey, const BlockChecksums &content);
+    void DropObjectLocked(const std::string &objectKey);
+
+    uint32_t chunkSize = 0;
+    Sharer share;
+    std::atomic<bool> shareSupported{true};
+
+    std::mutex mutex;
+    std::unordered_map<Fingerprint, std::vector<ChunkRef>, FingerprintHash> chunks;
+    std::unordered_map<uint64_t, FileEntry> files;
+    /* objects uploaded from cache files, by the fingerprint of their content */
+    std::unordered_map<uint32_t, std::vector<std::string>> uploads;
+    std::unordered_map<std::string, Upload> objects;
+    std::unordered_map<uint64_t, std::string> fileObjects;
+};
@@ -0,0 +1,182 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <butil/iobuf.h>
+
+#include "connection/falcon_io_client.h"
+#include "util/reed_solomon.h"
+
+/* size of a PutShard or ReadShard rpc, files are coded a stripe of this much per shard at a time */
+#define EC_CHUNK_SIZE (1024 * 1024)
+/* how long a node may take to say which shard of a file it holds */
+#define EC_PROBE_TIMEOUT_MS 1000
+#define EC_READ_TIMEOUT_MS 10000
+/* xattr of a shard file holding its ShardInfo */
+#define EC_SHARD_XATTR "user.falcon.shard"
+#define EC_SHARD_MAGIC 0x31534346 /* "FCS1" */
+/* files the shard holders are remembered for, a miss on others asks every node */
+#define EC_LOCATIONS_MAX 4096
+
+/*
+ * Erasure codes files that live only in the store cache across store nodes. A file is cut into
+ * dataShards shards padded to the same size and coded into parityShards more, each shard goes to
+ * a different node than the owner and the other shards, so the file survives the loss of its
+ * owner and parityShards more nodes. The owner keeps the whole file for reads on top of the
+ * shards, so a file takes 1 + (dataShards + parityShards) / dataShards times its size on disk
+ * across the cluster until the owner evicts it, where replication needs parityShards + 2 full
+ * copies for the same. A miss after the owner lost it rebuilds the file from any dataShards
+ * shards.
+ *
+ * Files are coded by a background worker once flushed, a file flushed again before its coding
+ * started is coded once, at its latest size; codings still queued at Stop are dropped. Shards
+ * are kept under rootPath/shards outside the lru of the disk cache, they are the only copy of a
+ * file its owner evicted and are never evicted, only dropped when the file is written again or
+ * deleted. Their bytes are kept by the disk cache all the same, which evicts cache files to make
+ * room for them. Every coding of a file carries a new version, readers only use shards of the
+ * latest one. The same worker rebuilds shards lost with their node on other nodes, the holder of
+ * the lowest shard index of a file does it.
+ */
+class ErasureCoder {
+  public:
+    static ErasureCoder &GetInstance()
+    {
+        static ErasureCoder instance;
+        return instance;
+    }
+    ~ErasureCoder();
+
+    /* lost shards are looked for every repairSeconds and after membership changes */
+    int Start(const std::string &rootPath, uint32_t dataShards, uint32_t parityShards, uint32_t repairSeconds);
+    void Stop();
+    bool Enabled() const { return running; }
+    /* look for lost shards soon, e.g. after a node left */
+    void Kick();
+
+    /* queue coding the first size bytes of cache file inodeId, it replaces one queued for the file */
+    void Enqueue(uint64_t inodeId, uint64_t size);
+    /* code the first size bytes of cache file inodeId and push its shards to other nodes, 0 or -errno */
+    int Encode(uint64_t inodeId, uint64_t size);
+    /* rebuild the size bytes of inodeId from its shards into fd and, if set, buf. 0 or -errno */
+    int Fill(uint64_t inodeId, uint64_t size, int fd, char *buf);
+    /* drop the shards of inodeId on every node once a coding in flight is over, the file is written
+     * again or deleted */
+    void Drop(uint64_t inodeId);
+    /* codings queued or in flight */
+    size_t Pending();
+
+    /* the PutShard, ReadShard and DropShard rpcs */
+    int ReceiveShard(uint64_t inodeId,
+                     const ShardInfo &info,
+                     uint64_t offset,
+                     bool last,
+                     uint32_t crc,
+                     butil::IOBuf &data);
+    int ReadShard(uint64_t inodeId, uint64_t offset, uint64_t size, ShardInfo &info, butil::IOBuf &data);
+    int DropShard(uint64_t inodeId);
+
+    static std::string SerializeInfo(const ShardInfo &info);
+    static bool ParseInfo(const std::string &data, ShardInfo &info);
+
+  private:
+    struct Holder
+    {
+        int nodeId;
+        ShardInfo info;
+    };
+    struct Coding
+    {
+        uint64_t size = 0;
+        /* bumped by every Enqueue, a coding only finishes the version it read */
+        uint64_t version = 0;
+        bool encoding = false;
+        bool cancelled = false;
+    };
+    struct Location
+    {
+        std::vector<Holder> holders;
+        std::list<uint64_t>::iterator order;
+    };
+
+    ErasureCoder() = default;
+    std::string ShardPath(uint64_t inodeId) const;
+    /* the shards of inodeId every reachable node holds, this one included, and the nodes that answered */
+    std::vector<Holder> Locate(uint64_t inodeId, std::vector<int> *reachable = nullptr);
+    /* the latest shards of inodeId, the ones this node remembers if it does, then remembered is set */
+    std::vector<Holder> Holders(uint64_t inodeId, bool &remembered);
+    void RememberHolders(uint64_t inodeId, std::vector<Holder> holders);
+    void ForgetHolders(uint64_t inodeId);
+    /* one holder per index of the latest version in holders */
+    static std::vector<Holder> Latest(const std::vector<Holder> &holders);
+    /* read len bytes at offset of the shard of each holder into bufs at once, the result of each */
+    std::vector<int> ReadChunks(uint64_t inodeId,
+                                const std::vector<Holder> &holders,
+                                uint64_t offset,
+                                size_t len,
+                                const std::vector<char *> &bufs);
+    /*
+     * Fill shards with len bytes at offset of every shard in want, read from their holder or
+     * rebuilt from any dataShards others. Holders that fail are dropped from holders. 0, or
+     * -EIO when too few shards are left.
+     */
+    int DecodeStripe(uint64_t inodeId,
+                     const ReedSolomon &code,
+                     std::vector<Holder> &holders,
+                     uint64_t offset,
+                     size_t len,
+                     const std::vector<bool> &want,
+                     std::vector<std::vector<char>> &shards,
+                     bool &rebuilt);
+    /* Fill from holders, the ones that fail are dropped from it */
+    int FillFrom(uint64_t inodeId, uint64_t size, int fd, char *buf, std::vector<Holder> &holders);
+    /* push len bytes of buf as the chunk at offset of shard info to nodeId, a damaged chunk once more */
+    static int
+    PushChunk(int nodeId, uint64_t inodeId, const ShardInfo &info, uint64_t offset, const char *buf, size_t len);
+    /* size bytes more of shards are on disk, or fewer if negative */
+    void Kept(int64_t size, bool written);
+    /* remove shard file path, its bytes are no longer kept by the disk cache */
+    void RemoveShardFile(const std::string &path);
+    void Run();
+    /* code the first queued file, lock is held around it but not while it is coded */
+    void EncodeNext(std::unique_lock<std::mutex> &lock);
+    /* rebuild the lost shards of files this node is responsible for, number of shards rebuilt */
+    int RepairOnce();
+    /* 0 when inodeId needs nothing or was repaired */
+    int Repair(uint64_t inodeId);
+
+    std::string shardDir;
+    uint32_t dataShards = 0;
+    uint32_t parityShards = 0;
+    uint32_t repairSeconds = 0;
+    std::atomic<bool> running{false};
+    std::atomic<int64_t> shardBytes{0};
+
+    /* orders finishing, reading and dropping shard files */
+    std::mutex shardMutex;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::condition_variable doneCv;
+    std::unordered_map<uint64_t, Coding> codings;
+    std::deque<uint64_t> queue;
+    bool pending = false;
+    bool stop = false;
+    std::thread worker;
+
+    /* the shard holders of files, in the order they were last used */
+    std::mutex locationMutex;
+    std::unordered_map<uint64_t, Location> locations;
+    std::list<uint64_t> locationOrder;
+};
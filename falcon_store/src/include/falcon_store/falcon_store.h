@@ -8,6 +8,7 @@
 #include <securec.h>
 #include <atomic>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -18,9 +19,27 @@
 
 #include "buffer/falcon_buffer.h"
 #include "buffer/open_instance.h"
+#include "falcon_store/block_checksums.h"
+#include "falcon_store/file_download.h"
+#include "falcon_store/stripe_layout.h"
 #include "storage/storage.h"
 #include "thread_pool/thread_pool.h"
 #include "util/file_lock.h"
+#include "util/path_node_map.h"
+
+/* hedge delay while a replica has too few latency samples for a percentile */
+#define HEDGE_DEFAULT_DELAY_US 10000
+/* how long a cache miss waits for other nodes to tell whether they hold the file */
+#define PEER_LOCATE_TIMEOUT_MS 500
+/* downloads whose blocks are fetched by downloadWorkers at once, others fetch on their own thread */
+#define DOWNLOAD_POOL_FILES 4
+/* nodes first in the placement order of a file asked for a copy of it, besides its backups and previous owner */
+#define PEER_LOCATE_RANKED 2
+/* kv blocks sent to a node in one rpc */
+#define KV_BATCH_BLOCKS 32
+
+/* what WarmupFile does with a file on the node that owns it, PREFETCH also reads it into memory */
+enum class CacheAction : int32_t { WARMUP = 0, PIN = 1, UNPIN = 2, PREFETCH = 3 };
 
 class FalconStore {
   public:
@@ -30,10 +49,19 @@ class FalconStore {
 
     /*-----------------read-----------------*/
     int ReadFile(OpenInstance *openInstance, char *buffer, size_t size, off_t offset);
-    ssize_t ReadFileLR(char *readBuffer, off_t offset, OpenInstance *openInstance, size_t readBufferSize);
+    ssize_t ReadFileLR(char *readBuffer,
+                       off_t offset,
+                       OpenInstance *openInstance,
+                       size_t readBufferSize,
+                       butil::IOBuf *remoteData = nullptr);
     int ReadSmallFiles(OpenInstance *openInstance);
-    int
-    ReadSmallFilesForBrpc(uint64_t inodeId, const std::string &path, char *buf, size_t size, int oflags, bool nodeFail);
+    int ReadSmallFilesForBrpc(uint64_t inodeId,
+                              const std::string &path,
+                              char *buf,
+                              size_t size,
+                              int oflags,
+                              bool nodeFail,
+                              bool cacheOnly = false);
 
     /*-----------------func-----------------*/
     int OpenFile(OpenInstance *openInstance);
@@ -54,6 +82,47 @@ class FalconStore {
     int TruncateOpenInstance(OpenInstance *openInstance, off_t size);
     int TruncateFileForBrpc(uint64_t inodeId, off_t size);
     int StatCluster(int nodeId, std::vector<size_t> &currentStats, bool scatter);
+    int ReceiveMigratedFile(uint64_t inodeId,
+                            uint64_t placementKey,
+                            bool hasKey,
+                            off_t offset,
+                            uint64_t totalSize,
+                            bool last,
+                            bool replica,
+                            bool hasCrc,
+                            uint32_t crc,
+                            uint32_t fingerprint,
+                            bool patch,
+                            uint32_t baseFingerprint,
+                            butil::IOBuf &data);
+    int DropCachedFile(uint64_t inodeId);
+    /* 0 if inodeId is cached here with size bytes, and the content of fingerprint if checkFingerprint, else -ENOENT */
+    int LocateCachedFile(uint64_t inodeId, uint64_t size, bool checkFingerprint, uint32_t fingerprint);
+    int WarmupFile(uint64_t inodeId, const std::string &path, uint64_t size, CacheAction action, bool route);
+
+    /*-----------------kv-----------------*/
+    /*
+     * Batches of kv blocks, see KvStore. A block is kept on the node its key is placed on, or on
+     * this node if it is put near, so gets and exists near look on this node before the placed
+     * one. A block put near is only reachable from this node: a get from another node, near or
+     * not, does not find it, as the node it was put near is not recorded anywhere. Blocks shared
+     * across nodes are put with near off. results hold 0 or -errno per key, for KvGet the size of
+     * the block read into blocks[i], which hold bufSize bytes each. The first error is returned.
+     */
+    int KvPut(const std::vector<std::string> &keys,
+              const std::vector<const char *> &blocks,
+              const std::vector<uint64_t> &sizes,
+              uint32_t ttlSeconds,
+              bool near,
+              std::vector<int64_t> &results);
+    int KvGet(const std::vector<std::string> &keys,
+              const std::vector<char *> &blocks,
+              uint64_t bufSize,
+              bool near,
+              std::vector<int64_t> &results);
+    int KvExists(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
+    /* drops the block near and where it is placed */
+    int KvDelete(const std::vector<std::string> &keys, bool near, std::vector<int64_t> &results);
 
     /*-----------------util-----------------*/
     int GetInitStatus();
@@ -62,23 +131,86 @@ class FalconStore {
   private:
     /*-----------------read-----------------*/
     bool StartPreReadThreaded(OpenInstance *openInstance);
+    bool RestartPreReadThreaded(OpenInstance *openInstance, ReadPattern pattern, off_t offset, size_t size);
     void StopPreReadThreaded(OpenInstance *openInstance);
     int ReadToBuffer(FalconReadBuffer buf, OpenInstance *openInstance, off_t offset);
     int RandomRead(FalconReadBuffer buf, OpenInstance *openInstance, off_t offset);
     int SequenceRead(FalconReadBuffer buf, OpenInstance *openInstance, off_t offset);
-    int WriteToFileAsync(uint64_t inodeId, std::string &fileName, std::shared_ptr<char> buf, size_t bufSize);
+    int WriteToFileAsync(uint64_t inodeId,
+                         uint64_t placementKey,
+                         std::string &fileName,
+                         std::shared_ptr<char> buf,
+                         size_t bufSize);
 
     /*-----------------func-----------------*/
     int OpenFileFromRemote(OpenInstance *openInstance, bool largeFile);
+    int OpenCachedAt(OpenInstance *openInstance, int nodeId, bool largeFile);
+    int OpenDuringMigration(OpenInstance *openInstance, bool largeFile);
+    int FetchFromPreviousOwner(OpenInstance *openInstance);
+    int CopyFromPeer(int nodeId, uint64_t inodeId, const std::string &path, uint64_t size, int fd, char *buf);
+    int LocateCachedPeer(
+        uint64_t inodeId, const std::string &path, uint64_t size, bool checkFingerprint, uint32_t fingerprint);
+    int FillFromPeer(uint64_t inodeId, const std::string &path, uint64_t size, int fd, char *buf);
+    int OpenReplica(OpenInstance *openInstance, bool largeFile);
+    int HedgedReadSmallFile(OpenInstance *openInstance, const std::vector<int> &nodes);
+    void DropReplicas(uint64_t inodeId, const std::string &path);
+    void PushReplicas(uint64_t inodeId, const std::string &path);
+    int PushReplica(
+        uint64_t inodeId, uint64_t placementKey, int nodeId, const BlockChecksums *base, BlockChecksums &pushed);
+
+    /*-----------------checksum-----------------*/
+    void SealCacheFile(const std::string &fileName, uint64_t size, const BlockChecksums *known = nullptr);
+    int CompareCachedCopy(uint64_t inodeId, uint64_t size, uint32_t fingerprint);
+    int CopyPatchBase(uint64_t inodeId, uint32_t baseFingerprint, const std::string &tmpName);
+    int RepairCacheFile(uint64_t inodeId, const std::string &path, const BlockChecksums &checksums, size_t block);
+    int VerifyCacheRange(OpenInstance *openInstance, off_t offset, size_t size);
+    int VerifyCacheBuffer(uint64_t inodeId, const std::string &path, int fd, char *buf, size_t size);
+
+    /*-----------------stripe-----------------*/
+    bool Striped(OpenInstance *openInstance);
+    std::shared_ptr<OpenInstance> OpenStripe(OpenInstance *openInstance, uint32_t stripe, int &ret);
+    int StripedRead(OpenInstance *openInstance, char *buf, size_t size, off_t offset);
+    int StripedWrite(OpenInstance *openInstance, const char *buf, size_t size, off_t offset);
+    int CloseStripes(OpenInstance *openInstance, bool isFlush, bool isSync);
+    int TruncateStripes(OpenInstance *openInstance, off_t size, bool openInstanceOnly);
+    int DeleteStripes(uint64_t inodeId, int nodeId, const std::string &path);
 
     /*-----------------util-----------------*/
     int PathToNodeId(std::string &path);
+    uint64_t PlacementKey(uint64_t inodeId, std::string_view path);
+    int OwnerNodeId(uint64_t inodeId, const std::string &path);
     void AllocNodeId(OpenInstance *openInstance);
+    int KvNodeId(const std::string &key, bool near);
+    /*
+     * Call local with the indices of keys kept on this node and send with the ones kept on every
+     * other node, in batches. send starts an rpc to client and calls finished once its reply is
+     * handled, the batches of all nodes are in flight at once. Returns when every one finished.
+     */
+    void KvForEachNode(const std::vector<std::string> &keys,
+                       const std::vector<size_t> &indices,
+                       bool near,
+                       const std::function<void(const std::vector<size_t> &batch)> &local,
+                       const std::function<void(FalconIOClient &client,
+                                                const std::vector<size_t> &batch,
+                                                std::function<void()> finished)> &send);
+    /* look for the blocks of keys at indices, reading them into blocks unless it is empty */
+    void KvLookup(const std::vector<std::string> &keys,
+                  const std::vector<size_t> &indices,
+                  const std::vector<char *> &blocks,
+                  uint64_t bufSize,
+                  bool near,
+                  std::vector<int64_t> &results);
     bool ConnectionError(int err);
     bool IoError(int err);
 
     /*-----------------storage-----------------*/
     int DownLoadFromStorage(OpenInstance *openInstance, bool isSync, bool toBuffer = false);
+    int JoinDownload(OpenInstance *openInstance, std::shared_ptr<FileDownload> download, bool isSync, bool toBuffer);
+    int FetchBlocks(const std::string &path,
+                    int fd,
+                    const std::shared_ptr<FileDownload> &download,
+                    const std::shared_ptr<const BlockChecksums> &expected);
+    int ReadFromDownload(uint64_t inodeId, const std::shared_ptr<FileDownload> &download, char *buf, size_t size);
     /* buf is oraganized by other, and must exist in process */
     int DownLoadFromStorageForBrpc(uint64_t inodeId,
                                    const std::string &path,
@@ -98,9 +230,26 @@ class FalconStore {
     int parentPathLevel{-1};
     bool isInference = true;
     bool toLocal = false;
+    /* percentile of a replica's latency after which a small file read is hedged, 0 disables */
+    uint32_t hedgePercentile{0};
+    /* cache misses are filled from other nodes holding the file before storage is read */
+    bool peerFill{false};
     FileLock fileLock;
-    std::unordered_map<std::string, std::atomic<uint64_t>> nodeHash;
-    std::mutex mutex;
+    /* cache misses in flight, shared by concurrent misses of a file */
+    DownloadTable downloads;
+    uint64_t downloadBlockSize{4 * 1024 * 1024};
+    uint32_t downloadWorkers{1};
+    /* fetch blocks of downloads besides the thread each download runs on */
+    std::unique_ptr<ThreadPool> downloadPool;
+    /* new files under stripeDirs, or anywhere if it is empty, are striped when stripeWidth > 1 */
+    uint32_t stripeWidth{0};
+    uint64_t stripeUnitSize{4 * 1024 * 1024};
+    std::vector<std::string> stripeDirs;
+    /* cache files carry the crc32c of their blocks, checked when they are read */
+    bool checksum{true};
+    PathNodeMap nodeMap;
+    /* StoreNode generation nodeMap was filled under */
+    std::atomic<uint64_t> nodeMapGeneration{0};
     std::string dataPath;
     std::unique_ptr<ThreadPool> storeThreadPool;
     Storage *storage;
@@ -0,0 +1,73 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Progress of one download of a file into its cache file, block by block. Fetchers take blocks
+ * with NextBlock, blocks a reader waits for come first and the rest in file order, so a reader
+ * of one range is served once that range landed rather than once the whole file did.
+ */
+class FileDownload {
+  public:
+    FileDownload(uint64_t size, uint64_t blockSize);
+
+    /* the next block to fetch, false once every block is taken or the download finished */
+    bool NextBlock(uint64_t &offset, uint64_t &size);
+    /* the block at offset landed in the cache file */
+    void Complete(uint64_t offset);
+    /* the whole file landed */
+    void CompleteAll();
+    /* no more blocks land, waiters of missing blocks get err */
+    void Fail(int err);
+    /* 0 once [offset, offset + size) landed, or the error the download failed with */
+    int Wait(uint64_t offset, uint64_t size);
+    int WaitAll() { return Wait(0, fileSize); }
+    bool Failed();
+
+  private:
+    enum class BlockState : uint8_t { PENDING, FETCHING, LANDED };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t fileSize;
+    uint64_t blockSize;
+    std::vector<BlockState> blocks;
+    /* blocks readers wait for, fetched before cursor */
+    std::deque<size_t> wanted;
+    size_t cursor = 0;
+    size_t landed = 0;
+    int error = 0;
+};
+
+/*
+ * Downloads in flight by inode, so concurrent misses of a file share one download instead of
+ * each reading storage or waiting on the file lock for the whole file.
+ */
+class DownloadTable {
+  public:
+    /* the download of inodeId in flight, or nullptr */
+    std::shared_ptr<FileDownload> Find(uint64_t inodeId);
+    /* a new download of inodeId, the caller holds the file lock so no other one is in flight */
+    std::shared_ptr<FileDownload> Start(uint64_t inodeId, uint64_t size, uint64_t blockSize);
+    /*
+     * End the download of inodeId with err. On success publish runs before waiters are woken, so
+     * whatever it makes visible, e.g. the disk cache entry, is there for them.
+     */
+    void Finish(uint64_t inodeId, const std::shared_ptr<FileDownload> &download, int err,
+                const std::function<void()> &publish);
+
+  private:
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<FileDownload>> downloads;
+};
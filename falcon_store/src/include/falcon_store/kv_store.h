@@ -0,0 +1,136 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* blocks are spread over this many independently locked shards by key */
+#define KV_SHARDS 16
+#define KV_MAX_KEY_SIZE 1024
+/* expired blocks are looked for this often */
+#define KV_SWEEP_INTERVAL_S 1
+
+/*
+ * Blocks of up to a fixed size keyed by opaque byte strings, e.g. the KV cache blocks an inference
+ * engine offloads, kept apart from files and the disk cache. A block put lands in memory, the
+ * least recently used blocks move to files under rootPath/kv once memory is full and are evicted
+ * once those are full too, a block got from disk moves back to memory. Blocks may carry a ttl,
+ * expired ones are dropped. Nothing survives a restart, blocks spilled before it are removed on
+ * Start. Files are written, read and removed without the lock of their shard, a block moved to
+ * disk is served from memory until its file is written.
+ */
+class KvStore {
+  public:
+    static KvStore &GetInstance()
+    {
+        static KvStore instance;
+        return instance;
+    }
+    ~KvStore();
+
+    /*
+     * blocks of up to blockSize, dramBytes of them in memory and ssdBytes more on disk, either may be
+     * 0 but not both. ttlSeconds is the ttl of blocks put without one, 0 for none
+     */
+    int Start(const std::string &rootPath,
+              uint64_t blockSize,
+              uint64_t dramBytes,
+              uint64_t ssdBytes,
+              uint32_t ttlSeconds);
+    void Stop();
+    bool Enabled() const { return running; }
+    uint64_t BlockSize() const { return blockSize; }
+
+    /* replaces the block of key if there is one, 0 or -errno */
+    int Put(const std::string &key, std::string block, uint32_t ttlSeconds = 0);
+    /* 0 and the block of key, or -ENOENT */
+    int Get(const std::string &key, std::shared_ptr<const std::string> &block);
+    bool Exists(const std::string &key);
+    /* 0 or -ENOENT */
+    int Delete(const std::string &key);
+
+    uint64_t DramBytes();
+    uint64_t SsdBytes();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    enum class Tier : uint8_t { DRAM, SSD };
+    struct Entry
+    {
+        Tier tier = Tier::DRAM;
+        uint64_t size = 0;
+        /* in memory */
+        std::shared_ptr<const std::string> block;
+        /* on disk */
+        uint64_t fileId = 0;
+        /* on disk, its file is still being written and block still holds it */
+        bool writing = false;
+        Clock::time_point expiry = Clock::time_point::max();
+        std::list<std::string>::iterator lru;
+    };
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+        /* most recently used first */
+        std::list<std::string> dramLru;
+        std::list<std::string> ssdLru;
+        uint64_t dramUsed = 0;
+        uint64_t ssdUsed = 0;
+        uint64_t nextFileId = 0;
+    };
+    using EntryIt = std::unordered_map<std::string, Entry>::iterator;
+    struct Spill
+    {
+        std::string key;
+        uint64_t fileId = 0;
+        std::shared_ptr<const std::string> block;
+        bool written = false;
+    };
+    /* file work of a shard, done once its lock is released */
+    struct FileWork
+    {
+        std::vector<Spill> spills;
+        std::vector<std::string> unlinks;
+    };
+
+    KvStore() = default;
+    size_t ShardIndex(const std::string &key) const;
+    std::string FilePath(size_t shard, uint64_t fileId) const;
+    void RemoveLocked(size_t shard, EntryIt it, FileWork &work);
+    /* hold the block of it in memory, moving blocks to disk or evicting them to make room */
+    void ToDramLocked(size_t shard, EntryIt it, std::shared_ptr<const std::string> block, FileWork &work);
+    /* move the block of it to disk, evicting blocks there to make room, false if it has to go */
+    bool ToSsdLocked(size_t shard, EntryIt it, FileWork &work);
+    /* write the spilled blocks and remove the files of work, a block whose file fails is dropped */
+    void DoFileWork(size_t shard, FileWork &work);
+    void Run();
+
+    std::string kvDir;
+    uint64_t blockSize = 0;
+    /* per shard */
+    uint64_t dramCapacity = 0;
+    uint64_t ssdCapacity = 0;
+    uint32_t defaultTtl = 0;
+    /* a block with a ttl was put, there is something to sweep */
+    std::atomic<bool> expiring{false};
+    Shard shards[KV_SHARDS];
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stop = false;
+    std::atomic<bool> running{false};
+    std::thread worker;
+};
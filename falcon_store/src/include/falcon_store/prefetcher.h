@@ -0,0 +1,88 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct PrefetchEntry
+{
+    uint64_t inodeId = 0;
+    std::string path;
+    uint64_t size = 0;
+};
+
+/*
+ * Stages files ahead of reads whose order is known in advance, e.g. the shuffled order a data
+ * loader reads a dataset in every epoch. A client registers the order as a stream, every open of
+ * a file in a stream moves the stream's cursor to it and the files up to distance after the
+ * cursor are handed to stage, which loads them on the node that owns them. Files the reader has
+ * passed while they were queued are skipped.
+ */
+class Prefetcher {
+  public:
+    /* load entry into the cache of its owner, 0 or -errno */
+    using Stager = std::function<int(const PrefetchEntry &entry)>;
+
+    static Prefetcher &GetInstance()
+    {
+        static Prefetcher instance;
+        return instance;
+    }
+    ~Prefetcher();
+
+    /* threadNum files are staged at once, streams registered without a distance get distance */
+    int Start(uint32_t threadNum, uint32_t distance, Stager stager);
+    void Stop();
+    bool Enabled() const { return running; }
+    /* returns the stream id, or 0 if prefetching is off */
+    uint64_t Register(std::vector<PrefetchEntry> order, uint32_t distance = 0);
+    void Unregister(uint64_t streamId);
+    /* inodeId is opened for reading */
+    void Accessed(uint64_t inodeId);
+
+  private:
+    enum class State : uint8_t { IDLE, QUEUED, STAGED };
+    struct Stream
+    {
+        std::vector<PrefetchEntry> order;
+        std::vector<State> states;
+        std::unordered_map<uint64_t, size_t> positions;
+        uint32_t distance = 0;
+        /* files before cursor were read, files before issued were queued */
+        size_t cursor = 0;
+        size_t issued = 0;
+    };
+    struct Task
+    {
+        uint64_t streamId;
+        size_t position;
+    };
+
+    Prefetcher() = default;
+    void Run();
+    /* queue the files of stream up to distance after its cursor */
+    void IssueLocked(uint64_t streamId, Stream &stream);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<uint64_t, Stream> streams;
+    std::unordered_map<uint64_t, std::vector<uint64_t>> inodeStreams;
+    std::deque<Task> queue;
+    uint64_t nextStreamId = 1;
+    uint32_t defaultDistance = 0;
+    bool stop = false;
+    std::atomic<bool> running{false};
+    std::vector<std::thread> workers;
+    Stager stage;
+};
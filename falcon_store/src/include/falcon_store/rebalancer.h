@@ -0,0 +1,85 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <butil/iobuf.h>
+
+#include "falcon_store/block_checksums.h"
+#include "util/rate_limiter.h"
+
+/* size of a MigrateFile rpc */
+#define REBALANCE_CHUNK_SIZE (1024 * 1024)
+/* pause before a pass retries files that failed to move */
+#define REBALANCE_RETRY_SECONDS 10
+
+/*
+ * Stream cache file inodeId to nodeId with MigrateFile rpcs. -EEXIST is returned if nodeId has
+ * the same file, told apart by size and BlockChecksums::Fingerprint. Otherwise a replica copy
+ * replaces the one there, and -ESTALE is returned if nodeId has another version of a file that
+ * is not a replica. throttle, if set, is called with the size of each chunk before it is sent.
+ * Every chunk carries its crc32c, a chunk the receiver got damaged is read and sent again once.
+ *
+ * A replica is sent as a patch when base, the checksums of the copy nodeId had last, is set: only
+ * the blocks that changed since are sent, and applied to a copy of base there. The whole file is
+ * sent when nodeId does not have base any more. pushed, if set, is set to the checksums of the
+ * file sent.
+ */
+int PushCacheFile(int nodeId,
+                  uint64_t inodeId,
+                  uint64_t placementKey,
+                  bool hasKey,
+                  bool replica,
+                  const std::function<void(size_t)> &throttle = nullptr,
+                  const BlockChecksums *base = nullptr,
+                  BlockChecksums *pushed = nullptr);
+/* crc32c of the bytes of data */
+uint32_t IOBufCrc32c(const butil::IOBuf &data);
+
+/*
+ * Moves cache files to their new owner after a node membership change. Only files nobody has
+ * open are moved, each is pinned while it streams, and it is dropped here once the new owner
+ * has it, so a file is never lost when the node it is cached on no longer owns it. A file the
+ * new owner holds another version of is kept here until it is evicted. Files not uploaded to
+ * storage yet are moved like any other, the cache is their only copy.
+ */
+class Rebalancer {
+  public:
+    static Rebalancer &GetInstance()
+    {
+        static Rebalancer instance;
+        return instance;
+    }
+    ~Rebalancer();
+
+    /* bandwidthMb is the limit on bytes sent per second in MB, 0 for no limit. inodeKeyed means
+     * files are placed by inode id, so files without a placement key xattr can be moved too */
+    int Start(const std::string &rootPath, uint32_t bandwidthMb, bool inodeKeyed);
+    void Stop();
+    /* schedule a pass over the cache, e.g. after the membership changed */
+    void Kick();
+
+  private:
+    Rebalancer() = default;
+    void Run();
+    /* number of files that should move but did not */
+    int RunOnce();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool pending = false;
+    bool stop = false;
+    std::thread worker;
+
+    bool inodeKeyed = false;
+    uint64_t bytesPerSecond = 0;
+    RateLimiter throttle;
+};
@@ -0,0 +1,86 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "falcon_store/block_checksums.h"
+
+/* files copied to their backups at once */
+#define REPLICATE_THREADS 4
+/* files the versions their backups got are kept for, the copy of others is sent whole */
+#define REPLICATE_BASES_MAX 1024
+
+/*
+ * Copies flushed cache files to their backups in the background. A file flushed again before
+ * its copy started is copied once, at its latest version. The block checksums of what each
+ * backup got last are kept, so a backup is sent the blocks that changed since then only. A copy
+ * that fails is not retried, the backup has no copy and is skipped by reads. Copies still queued
+ * at Stop are dropped the same way.
+ */
+class Replicator {
+  public:
+    /* copy cache file inodeId to nodeId, only the blocks that differ from base unless it is null,
+     * and set pushed to the checksums of what nodeId has now; 0 or -errno */
+    using Pusher = std::function<int(
+        uint64_t inodeId, uint64_t placementKey, int nodeId, const BlockChecksums *base, BlockChecksums &pushed)>;
+
+    static Replicator &GetInstance()
+    {
+        static Replicator instance;
+        return instance;
+    }
+    ~Replicator();
+
+    int Start(uint32_t threadNum, Pusher pusher);
+    void Stop();
+    /* queue a copy of cache file inodeId to nodes, it replaces one queued for the file */
+    void Enqueue(uint64_t inodeId, uint64_t placementKey, std::vector<int> nodes);
+    /* drop the copy queued for inodeId once one in flight is over, e.g. the backups drop theirs */
+    void Cancel(uint64_t inodeId);
+    size_t Pending();
+
+  private:
+    struct Entry {
+        uint64_t placementKey = 0;
+        std::vector<int> nodes;
+        /* bumped by every Enqueue, a copy only finishes the version it read */
+        uint64_t version = 0;
+        bool pushing = false;
+        bool cancelled = false;
+    };
+    struct Bases {
+        std::unordered_map<int, std::shared_ptr<const BlockChecksums>> nodes;
+        std::list<uint64_t>::iterator order;
+    };
+
+    Replicator() = default;
+    void Run();
+    void Finish(uint64_t inodeId);
+    void SetBase(uint64_t inodeId, int nodeId, std::shared_ptr<const BlockChecksums> base);
+    void DropBases(uint64_t inodeId);
+
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::deque<uint64_t> queue;
+    bool stop = false;
+    std::vector<std::thread> workers;
+
+    /* what the backups of a file got last, files in the order they were copied */
+    std::unordered_map<uint64_t, Bases> bases;
+    std::list<uint64_t> baseOrder;
+    Pusher push;
+};
@@ -0,0 +1,45 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#define STRIPE_MAX_WIDTH 255
+/* stripe units are whole multiples of this */
+#define STRIPE_UNIT_GRANULE (64 * 1024)
+/* set in the inode ids of stripes, real inode ids stay far below it */
+#define STRIPE_INODE_FLAG (1ULL << 63)
+
+/*
+ * How a striped file is spread over nodes. The file is cut into units of unitSize, unit i goes
+ * to stripe i % width, and every stripe is a file of its own with an inode id and path derived
+ * from the file's, placed, cached and persisted like any other file. A sequential reader or
+ * writer of the file is therefore served by up to width nodes at once.
+ *
+ * The layout is kept in metadata as the node id of the file, in place of the single node an
+ * unstriped file has, encoded as a value below -1.
+ */
+struct StripeLayout
+{
+    uint32_t width = 0;
+    uint64_t unitSize = 0;
+
+    static bool IsStriped(int nodeId) { return nodeId < -1; }
+    static StripeLayout FromNodeId(int nodeId);
+    /* width is clamped to [1, STRIPE_MAX_WIDTH] and unitSize rounded to STRIPE_UNIT_GRANULE */
+    static StripeLayout Make(uint32_t width, uint64_t unitSize);
+    int ToNodeId() const;
+
+    /* the stripe holding offset of the file, stripeOffset is where in the stripe it is */
+    uint32_t StripeOf(uint64_t offset, uint64_t &stripeOffset) const;
+    /* bytes of a file of fileSize held by stripe */
+    uint64_t StripeSize(uint64_t fileSize, uint32_t stripe) const;
+
+    static uint64_t StripeInodeId(uint64_t inodeId, uint32_t stripe);
+    static bool IsStripeInode(uint64_t inodeId) { return (inodeId & STRIPE_INODE_FLAG) != 0; }
+    /* a hidden sibling of path that keeps its directory and extension */
+    static std::string StripePath(const std::string &path, uint32_t stripe);
+};
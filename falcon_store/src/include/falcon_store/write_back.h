@@ -0,0 +1,98 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+/* pause before a failed upload is tried again, doubled on every failure up to the max */
+#define WRITEBACK_RETRY_MIN_MS 100
+#define WRITEBACK_RETRY_MAX_MS 30000
+
+/*
+ * Uploads closed cache files to storage in the background. Every queued upload is journaled
+ * as a file under rootPath/writeback named by inode id and holding the object path, so uploads
+ * queued before a crash are queued again on Start. A queued file stays pinned in the disk cache
+ * until it is uploaded, it can not be evicted or moved to another node before. Failed uploads
+ * are retried with backoff forever, files somebody waits for go first.
+ */
+class WriteBack {
+  public:
+    /* upload cache file inodeId to object path, 0 or -errno */
+    using Uploader = std::function<int(uint64_t inodeId, const std::string &path)>;
+
+    static WriteBack &GetInstance()
+    {
+        static WriteBack instance;
+        return instance;
+    }
+    ~WriteBack();
+
+    int Start(const std::string &rootPath, uint32_t threadNum, Uploader uploader);
+    void Stop();
+    /* queue an upload of cache file inodeId, it replaces one already queued for the file */
+    int Enqueue(uint64_t inodeId, const std::string &path);
+    /* move the upload of inodeId to the front and wait for it, -EIO if an attempt failed */
+    int Wait(uint64_t inodeId);
+    /* Wait for the upload of the file queued to object path, if any */
+    int WaitPath(const std::string &path);
+    /* drop the upload of inodeId once an attempt in flight is over, e.g. the file is deleted */
+    void Cancel(uint64_t inodeId);
+    /* storage does not have the latest content of inodeId yet */
+    bool Queued(uint64_t inodeId);
+    size_t Pending();
+
+  private:
+    struct Entry {
+        std::string path;
+        /* bumped by every Enqueue, an upload only finishes the version it read */
+        uint64_t version = 0;
+        bool urgent = false;
+        bool uploading = false;
+        bool cancelled = false;
+        uint32_t failures = 0;
+        std::chrono::steady_clock::time_point notBefore;
+        uint64_t seq = 0;
+    };
+    /* urgent first, then by the time the upload may start, then in queueing order */
+    using QueueKey = std::tuple<bool, std::chrono::steady_clock::time_point, uint64_t, uint64_t>;
+
+    WriteBack() = default;
+    void Run();
+    QueueKey KeyOf(uint64_t inodeId, const Entry &entry);
+    /* takes the pin on the cache file, false if it is gone */
+    bool Add(uint64_t inodeId, const std::string &path);
+    /* queue inodeId once its journal is in place, or bump the version of the upload queued */
+    int AddOrUpdate(uint64_t inodeId, const std::string &path);
+    void Finish(uint64_t inodeId);
+    int WaitLocked(std::unique_lock<std::mutex> &lock, uint64_t inodeId);
+    /* write the journal entry of inodeId aside to tmpFile, CommitJournal puts it in place */
+    int WriteJournal(uint64_t inodeId, const std::string &path, std::string &tmpFile);
+    int CommitJournal(uint64_t inodeId, const std::string &tmpFile);
+    void SyncJournalDir();
+    void RemoveJournal(uint64_t inodeId);
+
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+    std::unordered_map<uint64_t, Entry> entries;
+    std::unordered_map<std::string, uint64_t> pathToInode;
+    std::set<QueueKey> queue;
+    uint64_t nextSeq = 0;
+    bool stop = false;
+    std::vector<std::thread> workers;
+
+    std::string journalDir;
+    Uploader upload;
+};
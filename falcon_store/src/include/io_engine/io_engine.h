@@ -0,0 +1,67 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include <liburing.h>
+#endif
+
+enum class IoEngineType { SYNC = 0, IO_URING = 1 };
+
+/*
+ * Local cache file IO. All calls return the transferred size or -errno.
+ *
+ * SYNC issues pread/pwrite on the calling thread. IO_URING queues the request on a
+ * shared ring and parks the caller on a bthread butex until the completion is reaped,
+ * so a slow disk suspends the bthread instead of blocking a brpc worker pthread.
+ * Requests queued by concurrent callers are submitted together with one syscall.
+ */
+class IoEngine {
+  public:
+    static IoEngine &GetInstance();
+
+    int Init(const std::string &engine, uint32_t queueDepth, bool sqpoll);
+    void Stop();
+    IoEngineType Type() { return type; }
+
+    ssize_t Pread(int fd, void *buf, size_t size, off_t offset);
+    ssize_t Pwrite(int fd, const void *buf, size_t size, off_t offset);
+    ssize_t Preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+    ssize_t Pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+  private:
+    IoEngine() = default;
+    ~IoEngine();
+
+    ssize_t SyncIo(bool isWrite, int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+    IoEngineType type = IoEngineType::SYNC;
+
+#ifdef USE_IO_URING
+    struct IoRequest;
+    ssize_t SubmitAndWait(IoRequest *req);
+    void PrepareSqe(struct io_uring_sqe *sqe, IoRequest *req);
+    int Submit();
+    void FailUnsubmitted(int err);
+    void FlushPending();
+    void ReapLoop();
+
+    struct io_uring ring;
+    bool fixedBuffers = false;
+    std::atomic<bool> running{false};
+    std::mutex pendingMutex;
+    std::vector<IoRequest *> pending;
+    std::mutex submitMutex;
+    std::thread reaper;
+#endif
+};
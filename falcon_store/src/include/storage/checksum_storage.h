@@ -0,0 +1,69 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "falcon_store/block_checksums.h"
+#include "storage.h"
+
+/* prefix of the sidecar object holding the checksums of the object next to it */
+#define CHECKSUM_SIDECAR_PREFIX ".falcon_crc."
+/* checksums of objects read lately */
+#define CHECKSUM_SIDECAR_CACHE 1024
+
+/*
+ * Keeps the block checksums of every object uploaded through it in a sidecar object next to it,
+ * dir/.falcon_crc.name for dir/name, and checks what is read back against them. A range read
+ * into a buffer checks the blocks it covers whole, a damaged block is fetched once more and the
+ * read fails if it is still damaged. Reads into a file are checked by Verify, e.g. block by block
+ * as a download lands. Objects without a sidecar, e.g. uploaded before checksums were turned on or by other
+ * clients, are read through unchecked.
+ */
+class ChecksumStorage : public Storage {
+  private:
+    ChecksumStorage() = default;
+
+    static std::string SidecarKey(const std::string &objectKey);
+    void ForgetChecksums(const std::string &objectKey);
+    int PutChecksums(const std::string &objectKey, const BlockChecksums &checksums);
+    /* check the blocks of buf holding [offset, offset + size) and fetch damaged ones again, 0 or -EBADMSG */
+    int CheckBuffer(const std::string &objectKey, char *buf, uint64_t offset, uint64_t size);
+
+    Storage *inner = nullptr;
+    std::mutex checksumMutex;
+    std::unordered_map<std::string, std::shared_ptr<const BlockChecksums>> sidecars;
+
+  public:
+    ~ChecksumStorage() noexcept override = default;
+
+    static ChecksumStorage *GetInstance();
+    void Wrap(Storage *storage);
+    void DeleteInstance() override;
+    int Init() override;
+
+    /* the checksums of the object, nullptr if it has none */
+    std::shared_ptr<const BlockChecksums> GetChecksums(const std::string &objectKey);
+    /*
+     * Check the blocks of expected wholly inside [offset, offset + size) of the object read into fd
+     * at the same offsets, and fetch damaged ones again. 0, or -EBADMSG once a block is still
+     * damaged, the cached checksums are dropped then as the object may have been rewritten.
+     */
+    int Verify(const std::string &objectKey, int fd, uint64_t offset, uint64_t size, const BlockChecksums &expected);
+    /* the checksums in the sidecar of the object now rather than cached ones, 0 or -ENODATA */
+    int ReadChecksums(const std::string &objectKey, BlockChecksums &checksums);
+
+    ssize_t ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) override;
+    void SetTransferOptions(uint64_t partSize, uint32_t concurrency) override;
+    int PutFile(const std::string &objectKey, const std::string &filePath) override;
+    ssize_t
+    PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) override;
+    int DeleteObject(const std::string &objectKey) override;
+    int CopyObject(const std::string &fromPath, const std::string &toPath) override;
+    int StatFs(struct statvfs *vfsbuf) override;
+};
@@ -0,0 +1,28 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+
+/* values are stored in compressed objects, never renumber them */
+enum class CodecType : uint8_t {
+    NONE = 0,
+    ZLIB = 1,
+    LZ4 = 2,
+    ZSTD = 3,
+};
+
+/* "zlib", "lz4" or "zstd", NONE for "none" and for codecs this build was not linked with */
+CodecType CodecFromName(const std::string &name);
+const char *CodecName(CodecType type);
+/* the largest output Compress can produce for size bytes */
+size_t CodecBound(CodecType type, size_t size);
+/* compress src into dst, returns the compressed size or -1 */
+ssize_t CodecCompress(CodecType type, const char *src, size_t size, char *dst, size_t capacity);
+/* returns the decompressed size or -1 if src is corrupt or does not fit */
+ssize_t CodecDecompress(CodecType type, const char *src, size_t size, char *dst, size_t capacity);
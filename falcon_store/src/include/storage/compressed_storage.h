@@ -0,0 +1,121 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage.h"
+#include "storage/codec.h"
+
+#define COMPRESS_MAGIC 0x315a4346 /* "FCZ1" */
+#define COMPRESS_HEADER_SIZE 32
+/* set in a block index entry when the block did not compress and is stored as is */
+#define COMPRESS_RAW_BLOCK 0x80000000U
+/* a block is only stored compressed when it saves this much */
+#define COMPRESS_MIN_SAVING_PERCENT 10
+/* blocks tried before a file that does not compress is uploaded as is */
+#define COMPRESS_PROBE_BLOCKS 4
+/* compressed bytes fetched by one range read */
+#define COMPRESS_READ_BATCH (8 * 1024 * 1024)
+/* block indexes of objects read lately */
+#define COMPRESS_LAYOUT_CACHE 1024
+/* a cached layout is used this long before the header is read again to see the object was not rewritten */
+#define COMPRESS_LAYOUT_RECHECK_MS 3000
+
+/*
+ * Compresses objects on their way to the wrapped storage. An object is cut into blocks of
+ * blockSize that are compressed on their own and stored after a header and an index of their
+ * compressed sizes, so a range read fetches and decompresses only the blocks it covers:
+ *
+ *   | magic codec blockSize blockCount rawSize uploadId | u32 size per block | blocks |
+ *
+ * Objects outside the configured directories, of file types that are compressed already, and
+ * files whose first blocks do not compress are stored as is. Objects without the header are
+ * read through unchanged, so data written before compression was turned on stays readable.
+ * Only objects that would be compressed are looked at for a header, the directories must not
+ * be narrowed while objects compressed under the old ones are still read.
+ *
+ * Layouts are cached per object and read again every COMPRESS_LAYOUT_RECHECK_MS, the index is
+ * only fetched again when the uploadId in the header changed. Objects rewritten through this
+ * storage drop theirs at once. A block that does not decompress as the cached layout says, e.g.
+ * after another node rewrote the object, makes the read start over with a fresh layout.
+ */
+class CompressedStorage : public Storage {
+  private:
+    struct Layout {
+        bool compressed = false;
+        CodecType codec = CodecType::NONE;
+        uint32_t blockSize = 0;
+        uint64_t rawSize = 0;
+        /* the header the index was read under, a rewritten object has another uploadId */
+        std::string header;
+        /* object offset of every block and of the end of the last one */
+        std::vector<uint64_t> offsets;
+        std::vector<bool> rawBlocks;
+    };
+    struct CachedLayout {
+        std::shared_ptr<const Layout> layout;
+        /* when the header was last seen to match layout */
+        std::chrono::steady_clock::time_point checked;
+    };
+
+    CompressedStorage() = default;
+    using BlockReader = std::function<ssize_t(char *buf, size_t size, uint64_t offset)>;
+    using BlockWriter = std::function<int(const char *buf, size_t size, uint64_t offset)>;
+
+    bool ShouldCompress(const std::string &objectKey);
+    /* write the compressed layout of rawSize bytes, 1 if they do not compress, or -errno */
+    int Pack(uint64_t rawSize, const BlockReader &read, const BlockWriter &write);
+    /* the layout of the object as stored now, nullptr if its index can not be read */
+    std::shared_ptr<const Layout> GetLayout(const std::string &objectKey);
+    void RememberLayout(const std::string &objectKey, std::shared_ptr<const Layout> layout);
+    /* read the range through layout, -ESTALE if the object does not match it */
+    ssize_t ReadBlocks(const std::string &objectKey,
+                       const Layout &layout,
+                       uint64_t offset,
+                       uint64_t size,
+                       int fd,
+                       char *destBuffer);
+    void ForgetLayout(const std::string &objectKey);
+
+    Storage *inner = nullptr;
+    CodecType codec = CodecType::NONE;
+    uint32_t blockSize = 0;
+    std::vector<std::string> dirs;
+    std::string scratchDir;
+    std::atomic<uint64_t> scratchSeq{0};
+
+    std::mutex layoutMutex;
+    std::unordered_map<std::string, CachedLayout> layouts;
+
+  public:
+    ~CompressedStorage() noexcept override = default;
+
+    static CompressedStorage *GetInstance();
+    /* compress objects under the comma separated dirs, all if empty, staging them in scratchDir */
+    void Wrap(Storage *storage,
+              CodecType type,
+              uint32_t initBlockSize,
+              const std::string &compressDirs,
+              const std::string &initScratchDir);
+    void DeleteInstance() override;
+    int Init() override;
+
+    ssize_t ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) override;
+    void SetTransferOptions(uint64_t partSize, uint32_t concurrency) override;
+    int PutFile(const std::string &objectKey, const std::string &filePath) override;
+    ssize_t
+    PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) override;
+    int DeleteObject(const std::string &objectKey) override;
+    int CopyObject(const std::string &fromPath, const std::string &toPath) override;
+    int StatFs(struct statvfs *vfsbuf) override;
+};
@@ -0,0 +1,55 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "storage.h"
+
+/*
+ * Objects kept in memory, for tests and benchmarks without an object store. Every request
+ * first waits latencyUs plus its size at bandwidthMb, then fails with errorPercent probability,
+ * so slow and flaky storage can be reproduced on one box.
+ */
+class MockStorage : public Storage {
+  private:
+    MockStorage() = default;
+    /* wait as a request moving bytes would, false if the request should fail */
+    bool InjectFault(uint64_t bytes);
+    std::shared_ptr<const std::string> Find(const std::string &objectKey);
+    void Store(const std::string &objectKey, std::shared_ptr<const std::string> object);
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const std::string>> objects;
+    uint32_t latencyUs = 0;
+    uint64_t bytesPerSecond = 0;
+    uint32_t errorPercent = 0;
+    std::atomic<uint64_t> gets{0};
+
+  public:
+    ~MockStorage() noexcept override = default;
+
+    static MockStorage *GetInstance();
+    /* bandwidthMb 0 for no limit, errorPercent of requests fail */
+    void SetFaults(uint32_t latencyUs, uint32_t bandwidthMb, uint32_t errorPercent);
+    size_t ObjectCount();
+    /* read requests since the objects were last dropped */
+    uint64_t Gets();
+    /* drops all objects */
+    void DeleteInstance() override;
+    int Init() override;
+
+    ssize_t ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) override;
+    int PutFile(const std::string &objectKey, const std::string &filePath) override;
+    ssize_t
+    PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) override;
+    int DeleteObject(const std::string &objectKey) override;
+    int CopyObject(const std::string &fromPath, const std::string &toPath) override;
+    int StatFs(struct statvfs *vfsbuf) override;
+};
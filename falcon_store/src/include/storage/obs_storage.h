@@ -22,7 +22,10 @@
 #define TIME_INTERVAL (50)
 #define TIME_UNIT (1000)
 
-constexpr uint64_t UPLOAD_SLICE_SIZE = 512L * 1024 * 1024;
+/* multipart parts, the last excepted, must be at least this big */
+constexpr uint64_t OBS_MIN_PART_SIZE = 5L * 1024 * 1024;
+constexpr uint64_t DEFAULT_TRANSFER_PART_SIZE = 64L * 1024 * 1024;
+constexpr uint32_t DEFAULT_TRANSFER_CONCURRENCY = 8;
 
 class OBSStorage : public Storage {
   private:
@@ -46,6 +49,9 @@ class OBSStorage : public Storage {
     std::string accessKey;
     std::string secretAccessKey;
     bool isHttps{true};
+    /* files from one part up are uploaded as parts, this many at a time */
+    uint64_t transferPartSize{DEFAULT_TRANSFER_PART_SIZE};
+    uint32_t transferConcurrency{DEFAULT_TRANSFER_CONCURRENCY};
 
   public:
     static OBSStorage *GetInstance();
@@ -53,6 +59,7 @@ class OBSStorage : public Storage {
     int Init() override;
 
     ssize_t ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) override;
+    void SetTransferOptions(uint64_t partSize, uint32_t concurrency) override;
     int PutFile(const std::string &objectKey, const std::string &filePath) override;
     ssize_t
     PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) override;
@@ -0,0 +1,43 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "storage.h"
+
+/* size of the reads and writes copying object data */
+#define POSIX_STORAGE_CHUNK_SIZE (1024 * 1024)
+
+/*
+ * Objects kept as files under a local directory, e.g. a local disk or an NFS mount. The '/' in
+ * an object key become subdirectories. Objects are written to a temporary file and renamed in
+ * place, so a reader never sees half an object.
+ */
+class PosixStorage : public Storage {
+  private:
+    PosixStorage() = default;
+    std::string ObjectPath(const std::string &objectKey);
+    /* write to a temporary file next to the object, rename it over the object on success */
+    int WriteObject(const std::string &objectKey, const std::function<int(int)> &writer);
+    std::string rootPath;
+
+  public:
+    ~PosixStorage() noexcept override = default;
+
+    static PosixStorage *GetInstance();
+    void SetRootPath(const std::string &path);
+    void DeleteInstance() override;
+    int Init() override;
+
+    ssize_t ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) override;
+    int PutFile(const std::string &objectKey, const std::string &filePath) override;
+    ssize_t
+    PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) override;
+    int DeleteObject(const std::string &objectKey) override;
+    int CopyObject(const std::string &fromPath, const std::string &toPath) override;
+    int StatFs(struct statvfs *vfsbuf) override;
+};
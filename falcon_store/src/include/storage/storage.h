@@ -15,8 +15,12 @@ class Storage {
     virtual ~Storage() = default;
     virtual void DeleteInstance() = 0;
     virtual int Init() = 0;
+    /* read [offset, offset + size) of the object, size 0 reads to its end. destBuffer gets the
+     * range from its start, fd gets it at the same offsets as in the object */
     virtual ssize_t
     ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer) = 0;
+    /* part size and number of parts in flight for transfers split into parts */
+    virtual void SetTransferOptions(uint64_t /*partSize*/, uint32_t /*concurrency*/) {}
     virtual int PutFile(const std::string &objectKey, const std::string &filePath) = 0;
     virtual ssize_t
     PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset) = 0;
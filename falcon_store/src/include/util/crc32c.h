@@ -0,0 +1,16 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * crc32c (Castagnoli) of size bytes at data, continuing crc of the bytes before them. The crc
+ * instructions of SSE4.2 and ARMv8 are used where the cpu has them, a table otherwise.
+ */
+uint32_t Crc32c(const void *data, size_t size, uint32_t crc = 0);
+/* whether Crc32c runs on crc instructions */
+bool Crc32cHardware();
@@ -5,21 +5,53 @@
 #pragma once
 
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <memory>
-#include <shared_mutex>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
-#define FILE_BUCKET 100
+#define FILE_LOCK_SHARDS 64
+#define FILE_LOCK_WHOLE UINT64_MAX
 
 enum class LockMode { X = -1, S = 1 };
 
+/* byte range [start, end) of a file */
+struct FileLockRange
+{
+    uint64_t start;
+    uint64_t end;
+    LockMode mode;
+
+    bool Conflicts(const FileLockRange &other) const
+    {
+        return start < other.end && other.start < end && (mode == LockMode::X || other.mode == LockMode::X);
+    }
+};
+
+struct FileLockWaiter
+{
+    FileLockRange range;
+    bool granted = false;
+    std::condition_variable cv;
+};
+
 struct FileLockState
 {
-    std::shared_ptr<std::condition_variable_any> cv;
-    int lockCount;      // >0: S锁数量; <0: X锁; =0: 无锁
-    int waitingThreads; // 等待此锁的线程数
+    std::vector<FileLockRange> holders;
+    /* waiters in arrival order, a waiter is never passed by a later conflicting one */
+    std::deque<FileLockWaiter *> waiters;
 };
 
+/*
+ * Shared/exclusive locks on byte ranges of files, the whole-file calls lock [0, FILE_LOCK_WHOLE).
+ *
+ * Inodes are spread over FILE_LOCK_SHARDS shards, each with its own mutex, so locks on different
+ * files rarely meet. Every waiter sleeps on its own condition variable and is woken only when
+ * its range is granted. Grants follow arrival order among conflicting requests, so a stream of
+ * shared locks cannot starve an exclusive one.
+ */
 class FileLock {
   public:
     void ReleaseFileLock(uint64_t inodeId, LockMode m);
@@ -28,20 +60,42 @@ class FileLock {
     void WaitGetFileLock(uint64_t inodeId, LockMode m);
     bool TestLocked(uint64_t inodeId, LockMode m = LockMode::S);
 
+    bool GetRangeLock(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m, bool wait = true);
+    void ReleaseRangeLock(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m);
+    /* X: any lock or waiter overlaps the range, S: an exclusive lock overlaps the range */
+    bool TestRangeLocked(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m = LockMode::S);
+
   private:
-    bool innerGetFileLock(uint64_t inodeId, LockMode m, bool wait = true);
-    std::unordered_map<uint64_t, FileLockState> inodeIdTofileLockStateMap;
-    std::shared_mutex mutex;
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, FileLockState> states;
+    };
+
+    Shard &GetShard(uint64_t inodeId) { return shards[inodeId % FILE_LOCK_SHARDS]; }
+    static FileLockRange MakeRange(uint64_t offset, uint64_t size, LockMode m);
+    static bool Grantable(const FileLockState &state, const FileLockRange &range, size_t waiterIndex);
+    static void GrantWaiters(FileLockState &state);
+
+    Shard shards[FILE_LOCK_SHARDS];
 };
 
 class FileLocker {
   public:
     FileLocker(FileLock *initFileLock, uint64_t initInodeId, LockMode initLockMode, bool wait);
+    FileLocker(FileLock *initFileLock,
+               uint64_t initInodeId,
+               uint64_t initOffset,
+               uint64_t initSize,
+               LockMode initLockMode,
+               bool wait);
     ~FileLocker();
     bool isLocked();
 
     FileLock *fileLock;
     uint64_t inodeId;
+    uint64_t offset = 0;
+    uint64_t size = FILE_LOCK_WHOLE;
     LockMode lockMode;
     bool locked = false;
 };
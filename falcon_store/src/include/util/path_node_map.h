@@ -0,0 +1,66 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define PATH_NODE_MAP_SHARDS 32
+#define PATH_NODE_MAP_DEFAULT_CAPACITY (64 * 1024)
+
+/*
+ * Parent directory of path as a view into path, no allocation. level -1 cuts the last
+ * component, level n keeps at most the first n - 1 directories, see GetParentPath.
+ */
+std::string_view GetParentPathView(std::string_view path, int level = -1);
+
+/*
+ * Bounded map from parent directory to the node holding its files.
+ *
+ * Lookups take a shard's shared lock and a string_view key, so concurrent opens only contend
+ * when a new directory is inserted. When a shard is full, an entry not looked up since the last
+ * sweep is evicted (second chance); an evicted directory is simply resolved again.
+ */
+class PathNodeMap {
+  public:
+    explicit PathNodeMap(size_t capacity = PATH_NODE_MAP_DEFAULT_CAPACITY);
+
+    /* node of path, alloc(path) is called and remembered on a miss */
+    int GetOrAlloc(std::string_view path, const std::function<int(std::string_view)> &alloc);
+    bool Get(std::string_view path, int &nodeId);
+    void Set(std::string_view path, int nodeId);
+    size_t Size();
+    /* forget every directory, e.g. after node membership changed */
+    void Clear();
+
+  private:
+    struct PathHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view path) const { return std::hash<std::string_view>{}(path); }
+    };
+
+    struct Entry
+    {
+        std::atomic<int> nodeId = -1;
+        std::atomic<bool> referenced = true;
+    };
+
+    struct Shard
+    {
+        std::shared_mutex mutex;
+        std::unordered_map<std::string, Entry, PathHash, std::equal_to<>> entries;
+    };
+
+    Shard &GetShard(std::string_view path) { return shards[PathHash{}(path) % PATH_NODE_MAP_SHARDS]; }
+    void EvictOne(Shard &shard);
+
+    size_t shardCapacity;
+    Shard shards[PATH_NODE_MAP_SHARDS];
+};
@@ -0,0 +1,28 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/*
+ * Paces callers to bytesPerSecond over all threads sharing the limiter. Idle time is not saved
+ * up beyond a second of burst, 0 bytes per second means no limit.
+ */
+class RateLimiter {
+  public:
+    explicit RateLimiter(uint64_t bytesPerSecond = 0) { SetRate(bytesPerSecond); }
+    /* start a new period at rate, the bytes sent before are forgotten */
+    void SetRate(uint64_t bytesPerSecond);
+    /* sleep until bytes more can be sent */
+    void Acquire(size_t bytes);
+
+  private:
+    std::mutex mutex;
+    uint64_t bytesPerSecond = 0;
+    std::chrono::steady_clock::time_point start;
+    uint64_t bytes = 0;
+};
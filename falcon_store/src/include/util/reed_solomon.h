@@ -0,0 +1,45 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* data and parity shards of a code together, the size of GF(2^8) */
+#define RS_MAX_SHARDS 256
+
+/*
+ * Systematic Reed-Solomon code over GF(2^8). dataShards buffers are coded into parityShards
+ * more, and any dataShards of the dataShards + parityShards buffers are enough to rebuild all
+ * of them. Parity rows form a Cauchy matrix, so every square submatrix of the generator is
+ * invertible.
+ */
+class ReedSolomon {
+  public:
+    ReedSolomon(uint32_t dataShards, uint32_t parityShards);
+    /* at least one data and one parity shard, at most RS_MAX_SHARDS together */
+    bool Valid() const { return valid; }
+    uint32_t DataShards() const { return dataShards; }
+    uint32_t ParityShards() const { return parityShards; }
+
+    /* fill the parityShards buffers of parity from the dataShards buffers of data, all len bytes */
+    void Encode(const std::vector<const char *> &data, const std::vector<char *> &parity, size_t len) const;
+    /*
+     * shards holds dataShards + parityShards buffers of len bytes, those not present are rebuilt
+     * from the others. 0, or -EINVAL if fewer than dataShards are present.
+     */
+    int Reconstruct(const std::vector<char *> &shards, const std::vector<bool> &present, size_t len) const;
+
+  private:
+    /* dst ^= coef * src over len bytes */
+    static void MulAdd(char *dst, const char *src, uint8_t coef, size_t len);
+
+    uint32_t dataShards;
+    uint32_t parityShards;
+    bool valid;
+    /* parityShards x dataShards coefficients, row major */
+    std::vector<uint8_t> parityRows;
+};
@@ -39,9 +39,14 @@ struct StatFSBuf
 void SetRootPath(std::string str);
 void SetTotalDirectory(int num);
 std::string GetFilePath(uint64_t inodeId);
+/* where files received from other nodes are assembled before they enter the cache */
+std::string GetMigratingPath(uint64_t inodeId);
 int GenerateRandom(int minValue, int maxValue);
 std::optional<std::string> GetUserName();
 std::optional<std::string_view> SplitIp(std::string_view ipPort);
 std::expected<std::string, std::string> GetPodIPPort();
 float GetStorageThreshold(bool persistToStorage);
 int GetParentPathLevel();
+/* key a cache file is placed by, kept in an xattr so the file can be moved when the owner changes */
+int SetPlacementKey(int fd, uint64_t key);
+bool GetPlacementKey(const std::string &fileName, uint64_t &key);
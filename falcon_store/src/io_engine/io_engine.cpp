@@ -0,0 +1,336 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "io_engine/io_engine.h"
+
+#include <sched.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef USE_IO_URING
+#include <bthread/countdown_event.h>
+#endif
+
+#include "buffer/mem_pool.h"
+#include "log/logging.h"
+
+#define IO_URING_REAP_BATCH 64
+#define IO_URING_SQ_THREAD_IDLE_MS 2000
+
+IoEngine &IoEngine::GetInstance()
+{
+    static IoEngine instance;
+    return instance;
+}
+
+IoEngine::~IoEngine() { Stop(); }
+
+int IoEngine::Init(const std::string &engine, uint32_t queueDepth, bool sqpoll)
+{
+    if (engine.empty() || engine == "sync") {
+        type = IoEngineType::SYNC;
+        return 0;
+    }
+    if (engine != "io_uring") {
+        FALCON_LOG(LOG_ERROR) << "IoEngine::Init(): unknown io engine " << engine;
+        return -EINVAL;
+    }
+#ifdef USE_IO_URING
+    if (running.load()) {
+        return 0;
+    }
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (sqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = IO_URING_SQ_THREAD_IDLE_MS;
+    }
+    int ret = io_uring_queue_init_params(queueDepth, &ring, &params);
+    if (ret < 0 && sqpoll) {
+        FALCON_LOG(LOG_WARNING) << "IoEngine::Init(): SQPOLL unavailable (" << strerror(-ret)
+                                << "), fall back to normal submission";
+        memset(&params, 0, sizeof(params));
+        ret = io_uring_queue_init_params(queueDepth, &ring, &params);
+    }
+    if (ret < 0) {
+        FALCON_LOG(LOG_ERROR) << "IoEngine::Init(): io_uring init failed: " << strerror(-ret)
+                              << ", fall back to sync io";
+        type = IoEngineType::SYNC;
+        return 0;
+    }
+
+    /* register the MemPool blocks once, reads and writes inside them skip the per-io page pinning */
+    MemPool &memPool = MemPool::GetInstance();
+    if (memPool.arena() != nullptr || memPool.initArena()) {
+        struct iovec arena = {.iov_base = memPool.arena(), .iov_len = memPool.arenaSize()};
+        ret = io_uring_register_buffers(&ring, &arena, 1);
+        if (ret < 0) {
+            FALCON_LOG(LOG_WARNING) << "IoEngine::Init(): register buffers failed: " << strerror(-ret);
+        } else {
+            fixedBuffers = true;
+        }
+    }
+
+    running = true;
+    reaper = std::thread(&IoEngine::ReapLoop, this);
+    type = IoEngineType::IO_URING;
+    FALCON_LOG(LOG_INFO) << "IoEngine: io_uring started, depth " << queueDepth << ", sqpoll "
+                         << ((params.flags & IORING_SETUP_SQPOLL) != 0) << ", fixed buffers " << fixedBuffers;
+    return 0;
+#else
+    (void)queueDepth;
+    (void)sqpoll;
+    FALCON_LOG(LOG_WARNING) << "IoEngine::Init(): built without io_uring, fall back to sync io";
+    type = IoEngineType::SYNC;
+    return 0;
+#endif
+}
+
+void IoEngine::Stop()
+{
+#ifdef USE_IO_URING
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        /* wake the reaper with an empty completion */
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        while (sqe == nullptr) {
+            io_uring_submit(&ring);
+            sqe = io_uring_get_sqe(&ring);
+        }
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_data(sqe, nullptr);
+        io_uring_submit(&ring);
+    }
+    if (reaper.joinable()) {
+        reaper.join();
+    }
+    if (fixedBuffers) {
+        io_uring_unregister_buffers(&ring);
+        fixedBuffers = false;
+    }
+    io_uring_queue_exit(&ring);
+#endif
+    type = IoEngineType::SYNC;
+}
+
+ssize_t IoEngine::SyncIo(bool isWrite, int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    ssize_t ret = 0;
+    if (iovcnt == 1) {
+        ret = isWrite ? pwrite(fd, iov[0].iov_base, iov[0].iov_len, offset)
+                      : pread(fd, iov[0].iov_base, iov[0].iov_len, offset);
+    } else {
+        ret = isWrite ? pwritev(fd, iov, iovcnt, offset) : preadv(fd, iov, iovcnt, offset);
+    }
+    return ret < 0 ? -errno : ret;
+}
+
+ssize_t IoEngine::Pread(int fd, void *buf, size_t size, off_t offset)
+{
+    struct iovec iov = {.iov_base = buf, .iov_len = size};
+    return Preadv(fd, &iov, 1, offset);
+}
+
+ssize_t IoEngine::Pwrite(int fd, const void *buf, size_t size, off_t offset)
+{
+    struct iovec iov = {.iov_base = const_cast<void *>(buf), .iov_len = size};
+    return Pwritev(fd, &iov, 1, offset);
+}
+
+#ifdef USE_IO_URING
+struct IoEngine::IoRequest
+{
+    bool isWrite;
+    int fd;
+    const struct iovec *iov;
+    int iovcnt;
+    off_t offset;
+    ssize_t result = -EIO;
+    bthread::CountdownEvent done{1};
+};
+
+ssize_t IoEngine::Preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    if (type != IoEngineType::IO_URING) {
+        return SyncIo(false, fd, iov, iovcnt, offset);
+    }
+    IoRequest req{.isWrite = false, .fd = fd, .iov = iov, .iovcnt = iovcnt, .offset = offset};
+    return SubmitAndWait(&req);
+}
+
+ssize_t IoEngine::Pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    if (type != IoEngineType::IO_URING) {
+        return SyncIo(true, fd, iov, iovcnt, offset);
+    }
+    IoRequest req{.isWrite = true, .fd = fd, .iov = iov, .iovcnt = iovcnt, .offset = offset};
+    return SubmitAndWait(&req);
+}
+
+ssize_t IoEngine::SubmitAndWait(IoRequest *req)
+{
+    {
+        std::lock_guard<std::mutex> pendingLock(pendingMutex);
+        pending.push_back(req);
+    }
+    FlushPending();
+    /* suspends the bthread (or blocks the pthread) until ReapLoop signals */
+    req->done.wait();
+    return req->result;
+}
+
+void IoEngine::PrepareSqe(struct io_uring_sqe *sqe, IoRequest *req)
+{
+    const struct iovec &first = req->iov[0];
+    MemPool &memPool = MemPool::GetInstance();
+    if (req->iovcnt == 1 && fixedBuffers && first.iov_len > 0 && memPool.inArena(first.iov_base) &&
+        memPool.inArena((char *)first.iov_base + first.iov_len - 1)) {
+        if (req->isWrite) {
+            io_uring_prep_write_fixed(sqe, req->fd, first.iov_base, first.iov_len, req->offset, 0);
+        } else {
+            io_uring_prep_read_fixed(sqe, req->fd, first.iov_base, first.iov_len, req->offset, 0);
+        }
+    } else if (req->iovcnt == 1) {
+        if (req->isWrite) {
+            io_uring_prep_write(sqe, req->fd, first.iov_base, first.iov_len, req->offset);
+        } else {
+            io_uring_prep_read(sqe, req->fd, first.iov_base, first.iov_len, req->offset);
+        }
+    } else {
+        if (req->isWrite) {
+            io_uring_prep_writev(sqe, req->fd, req->iov, req->iovcnt, req->offset);
+        } else {
+            io_uring_prep_readv(sqe, req->fd, req->iov, req->iovcnt, req->offset);
+        }
+    }
+    io_uring_sqe_set_data(sqe, req);
+}
+
+/* io_uring_submit, retried while the ring is only busy; the number submitted or -errno */
+int IoEngine::Submit()
+{
+    int ret = io_uring_submit(&ring);
+    while (ret == -EAGAIN || ret == -EBUSY || ret == -EINTR) {
+        sched_yield();
+        ret = io_uring_submit(&ring);
+    }
+    return ret;
+}
+
+/*
+ * Complete the requests whose sqes the kernel did not take with err. Those sqes would still go
+ * in with the next submit, after their callers are gone, so they are turned into nops first.
+ * Without SQPOLL the kernel only reads the ring inside io_uring_enter, which runs under
+ * submitMutex. With SQPOLL its thread takes them by itself and completes them as usual.
+ */
+void IoEngine::FailUnsubmitted(int err)
+{
+    if ((ring.flags & IORING_SETUP_SQPOLL) != 0) {
+        return;
+    }
+    unsigned head = *ring.sq.khead;
+    unsigned mask = *ring.sq.kring_mask;
+    unsigned left = io_uring_sq_ready(&ring);
+    for (unsigned i = 0; i < left; ++i) {
+        struct io_uring_sqe *sqe = &ring.sq.sqes[(head + i) & mask];
+        IoRequest *req = (IoRequest *)(uintptr_t)sqe->user_data;
+        io_uring_prep_nop(sqe);
+        io_uring_sqe_set_data(sqe, nullptr);
+        if (req != nullptr) {
+            req->result = err;
+            req->done.signal();
+        }
+    }
+}
+
+/*
+ * Whoever holds submitMutex drains every queued request into one io_uring_submit.
+ * A caller that loses the race leaves its request queued; the holder rechecks the
+ * queue after unlocking, so no request is stranded. A submit that fails for good
+ * completes the requests it did not take with its error.
+ */
+void IoEngine::FlushPending()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> submitLock(submitMutex, std::try_to_lock);
+            if (!submitLock.owns_lock()) {
+                return;
+            }
+            std::vector<IoRequest *> batch;
+            {
+                std::lock_guard<std::mutex> pendingLock(pendingMutex);
+                batch.swap(pending);
+            }
+            int ret = 0;
+            size_t prepared = 0;
+            while (prepared < batch.size() && ret >= 0) {
+                struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+                if (sqe == nullptr) {
+                    /* submission queue full, push what we have and retry */
+                    ret = Submit();
+                    continue;
+                }
+                PrepareSqe(sqe, batch[prepared++]);
+            }
+            if (ret >= 0 && !batch.empty()) {
+                ret = Submit();
+            }
+            if (ret < 0) {
+                FALCON_LOG(LOG_ERROR) << "IoEngine: io_uring_submit failed: " << strerror(-ret);
+                FailUnsubmitted(ret);
+                for (; prepared < batch.size(); ++prepared) {
+                    batch[prepared]->result = ret;
+                    batch[prepared]->done.signal();
+                }
+            }
+        }
+        std::lock_guard<std::mutex> pendingLock(pendingMutex);
+        if (pending.empty()) {
+            return;
+        }
+    }
+}
+
+void IoEngine::ReapLoop()
+{
+    struct io_uring_cqe *cqes[IO_URING_REAP_BATCH];
+    while (running.load()) {
+        struct io_uring_cqe *cqe = nullptr;
+        int ret = io_uring_wait_cqe(&ring, &cqe);
+        if (ret < 0) {
+            if (ret != -EINTR) {
+                FALCON_LOG(LOG_ERROR) << "IoEngine: io_uring_wait_cqe failed: " << strerror(-ret);
+            }
+            continue;
+        }
+        unsigned count = io_uring_peek_batch_cqe(&ring, cqes, IO_URING_REAP_BATCH);
+        for (unsigned i = 0; i < count; ++i) {
+            IoRequest *req = (IoRequest *)io_uring_cqe_get_data(cqes[i]);
+            if (req == nullptr) {
+                continue;
+            }
+            req->result = cqes[i]->res;
+            /* req lives on the waiter's stack, do not touch it after signal */
+            req->done.signal();
+        }
+        io_uring_cq_advance(&ring, count);
+    }
+}
+#else
+ssize_t IoEngine::Preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return SyncIo(false, fd, iov, iovcnt, offset);
+}
+
+ssize_t IoEngine::Pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset)
+{
+    return SyncIo(true, fd, iov, iovcnt, offset);
+}
+#endif
@@ -0,0 +1,268 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "storage/checksum_storage.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+static ssize_t ReadAll(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+ChecksumStorage *ChecksumStorage::GetInstance()
+{
+    static ChecksumStorage m_singleton;
+    return &m_singleton;
+}
+
+void ChecksumStorage::Wrap(Storage *storage) { inner = storage; }
+
+int ChecksumStorage::Init()
+{
+    int ret = inner->Init();
+    if (ret != 0) {
+        return ret;
+    }
+    FALCON_LOG(LOG_INFO) << "successfully init checksum storage";
+    return 0;
+}
+
+void ChecksumStorage::DeleteInstance()
+{
+    {
+        std::lock_guard<std::mutex> lock(checksumMutex);
+        sidecars.clear();
+    }
+    if (inner != nullptr) {
+        inner->DeleteInstance();
+    }
+}
+
+void ChecksumStorage::SetTransferOptions(uint64_t partSize, uint32_t concurrency)
+{
+    inner->SetTransferOptions(partSize, concurrency);
+}
+
+std::string ChecksumStorage::SidecarKey(const std::string &objectKey)
+{
+    size_t slash = objectKey.rfind('/');
+    size_t nameStart = slash == std::string::npos ? 0 : slash + 1;
+    return objectKey.substr(0, nameStart) + CHECKSUM_SIDECAR_PREFIX + objectKey.substr(nameStart);
+}
+
+std::shared_ptr<const BlockChecksums> ChecksumStorage::GetChecksums(const std::string &objectKey)
+{
+    {
+        std::lock_guard<std::mutex> lock(checksumMutex);
+        auto it = sidecars.find(objectKey);
+        if (it != sidecars.end()) {
+            return it->second;
+        }
+    }
+    std::shared_ptr<const BlockChecksums> checksums;
+    std::string data(CHECKSUM_HEADER_SIZE + CHECKSUM_MAX_BLOCKS * sizeof(uint32_t), '\0');
+    ssize_t nread = inner->ReadObject(SidecarKey(objectKey), 0, data.size(), -1, data.data());
+    if (nread > 0) {
+        data.resize(nread);
+        auto parsed = std::make_shared<BlockChecksums>();
+        if (BlockChecksums::Parse(data, *parsed)) {
+            checksums = parsed;
+        } else {
+            FALCON_LOG(LOG_WARNING) << "ChecksumStorage: sidecar of " << objectKey << " is corrupt, not checked";
+        }
+    }
+
+    /* objects without a sidecar are remembered too, so they cost no extra request on every read */
+    std::lock_guard<std::mutex> lock(checksumMutex);
+    if (sidecars.size() >= CHECKSUM_SIDECAR_CACHE) {
+        sidecars.clear();
+    }
+    sidecars[objectKey] = checksums;
+    return checksums;
+}
+
+void ChecksumStorage::ForgetChecksums(const std::string &objectKey)
+{
+    std::lock_guard<std::mutex> lock(checksumMutex);
+    sidecars.erase(objectKey);
+}
+
+int ChecksumStorage::PutChecksums(const std::string &objectKey, const BlockChecksums &checksums)
+{
+    std::string data = checksums.Serialize();
+    if (inner->PutBuffer(SidecarKey(objectKey), data.data(), data.size(), 0) < 0) {
+        /* the object stays readable, it is only not checked */
+        FALCON_LOG(LOG_WARNING) << "ChecksumStorage: put sidecar of " << objectKey << " failed";
+        inner->DeleteObject(SidecarKey(objectKey));
+        return -EIO;
+    }
+    return 0;
+}
+
+int ChecksumStorage::CheckBuffer(const std::string &objectKey, char *buf, uint64_t offset, uint64_t size)
+{
+    std::shared_ptr<const BlockChecksums> checksums = GetChecksums(objectKey);
+    if (checksums == nullptr) {
+        return 0;
+    }
+    std::vector<size_t> bad = checksums->Mismatches(buf, offset, size);
+    if (bad.empty()) {
+        return 0;
+    }
+    /* the object may have been rewritten by another node since its checksums were read */
+    ForgetChecksums(objectKey);
+    checksums = GetChecksums(objectKey);
+    if (checksums == nullptr) {
+        return 0;
+    }
+    bad = checksums->Mismatches(buf, offset, size);
+    for (size_t block : bad) {
+        FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+        FALCON_LOG(LOG_WARNING) << "ChecksumStorage: block " << block << " of " << objectKey
+                                << " fails its checksum, fetching it again";
+        uint64_t blockOffset = checksums->BlockOffset(block);
+        uint64_t length = checksums->BlockLength(block);
+        char *data = buf + (blockOffset - offset);
+        FalconStats::GetInstance().stats[CHECKSUM_REFETCH]++;
+        if (inner->ReadObject(objectKey, blockOffset, length, -1, data) != (ssize_t)length ||
+            !checksums->Check(block, data)) {
+            FALCON_LOG(LOG_ERROR) << "ChecksumStorage: block " << block << " of " << objectKey << " is damaged";
+            return -EBADMSG;
+        }
+    }
+    return 0;
+}
+
+int ChecksumStorage::Verify(
+    const std::string &objectKey, int fd, uint64_t offset, uint64_t size, const BlockChecksums &expected)
+{
+    uint64_t end = std::min(offset + size, expected.FileSize());
+    std::vector<char> buf(expected.BlockSize());
+    for (size_t block = (offset + expected.BlockSize() - 1) / expected.BlockSize(); block < expected.Blocks();
+         ++block) {
+        uint64_t blockOffset = expected.BlockOffset(block);
+        uint64_t length = expected.BlockLength(block);
+        if (blockOffset + length > end) {
+            break;
+        }
+        if (ReadAll(fd, buf.data(), length, blockOffset) == (ssize_t)length && expected.Check(block, buf.data())) {
+            continue;
+        }
+        FalconStats::GetInstance().stats[CHECKSUM_MISMATCH]++;
+        FalconStats::GetInstance().stats[CHECKSUM_REFETCH]++;
+        FALCON_LOG(LOG_WARNING) << "ChecksumStorage: block " << block << " of " << objectKey
+                                << " fails its checksum, fetching it again";
+        if (inner->ReadObject(objectKey, blockOffset, length, fd, nullptr) != (ssize_t)length ||
+            ReadAll(fd, buf.data(), length, blockOffset) != (ssize_t)length || !expected.Check(block, buf.data())) {
+            FALCON_LOG(LOG_ERROR) << "ChecksumStorage: block " << block << " of " << objectKey << " is damaged";
+            ForgetChecksums(objectKey);
+            return -EBADMSG;
+        }
+    }
+    return 0;
+}
+
+int ChecksumStorage::ReadChecksums(const std::string &objectKey, BlockChecksums &checksums)
+{
+    ForgetChecksums(objectKey);
+    std::shared_ptr<const BlockChecksums> stored = GetChecksums(objectKey);
+    if (stored == nullptr) {
+        return -ENODATA;
+    }
+    checksums = *stored;
+    return 0;
+}
+
+ssize_t
+ChecksumStorage::ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer)
+{
+    ssize_t ret = inner->ReadObject(objectKey, offset, size, fd, destBuffer);
+    if (ret <= 0 || destBuffer == nullptr) {
+        return ret;
+    }
+    return CheckBuffer(objectKey, destBuffer, offset, ret) == 0 ? ret : -1;
+}
+
+int ChecksumStorage::PutFile(const std::string &objectKey, const std::string &filePath)
+{
+    ForgetChecksums(objectKey);
+    /* a sidecar left from the old content must not outlive it if the upload fails half way */
+    inner->DeleteObject(SidecarKey(objectKey));
+    BlockChecksums checksums;
+    int ret = -ENODATA;
+    int fd = open(filePath.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0) {
+        /* a sealed cache file carries its checksums already */
+        ret = BlockChecksums::Load(fd, checksums);
+        if (ret != 0 || checksums.FileSize() != (uint64_t)st.st_size) {
+            ret = BlockChecksums::OfFile(fd, st.st_size, checksums);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    int putRet = inner->PutFile(objectKey, filePath);
+    if (putRet == 0 && ret == 0) {
+        PutChecksums(objectKey, checksums);
+    }
+    return putRet;
+}
+
+ssize_t
+ChecksumStorage::PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset)
+{
+    ForgetChecksums(objectKey);
+    inner->DeleteObject(SidecarKey(objectKey));
+    ssize_t ret = inner->PutBuffer(objectKey, buf, size, offset);
+    if (ret >= 0 && buf != nullptr) {
+        PutChecksums(objectKey, BlockChecksums::OfBuffer(buf + offset, size));
+    }
+    return ret;
+}
+
+int ChecksumStorage::DeleteObject(const std::string &objectKey)
+{
+    ForgetChecksums(objectKey);
+    inner->DeleteObject(SidecarKey(objectKey));
+    return inner->DeleteObject(objectKey);
+}
+
+int ChecksumStorage::CopyObject(const std::string &fromPath, const std::string &toPath)
+{
+    ForgetChecksums(toPath);
+    int ret = inner->CopyObject(fromPath, toPath);
+    if (ret == 0 && inner->CopyObject(SidecarKey(fromPath), SidecarKey(toPath)) != 0) {
+        /* the source had none, or the old one of the destination must not stay */
+        inner->DeleteObject(SidecarKey(toPath));
+    }
+    return ret;
+}
+
+int ChecksumStorage::StatFs(struct statvfs *vfsbuf) { return inner->StatFs(vfsbuf); }
@@ -0,0 +1,122 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "storage/codec.h"
+
+#include <zlib.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "log/logging.h"
+
+/* fast levels, blocks are compressed on the upload path */
+#define CODEC_ZLIB_LEVEL 1
+#define CODEC_ZSTD_LEVEL 1
+
+CodecType CodecFromName(const std::string &name)
+{
+    if (name == "zlib") {
+        return CodecType::ZLIB;
+    }
+#ifdef USE_LZ4
+    if (name == "lz4") {
+        return CodecType::LZ4;
+    }
+#endif
+#ifdef USE_ZSTD
+    if (name == "zstd") {
+        return CodecType::ZSTD;
+    }
+#endif
+    if (!name.empty() && name != "none") {
+        FALCON_LOG(LOG_WARNING) << "compression " << name << " is not built in, data is stored uncompressed";
+    }
+    return CodecType::NONE;
+}
+
+const char *CodecName(CodecType type)
+{
+    switch (type) {
+    case CodecType::ZLIB:
+        return "zlib";
+    case CodecType::LZ4:
+        return "lz4";
+    case CodecType::ZSTD:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+size_t CodecBound(CodecType type, size_t size)
+{
+    switch (type) {
+    case CodecType::ZLIB:
+        return compressBound(size);
+#ifdef USE_LZ4
+    case CodecType::LZ4:
+        return LZ4_compressBound(size);
+#endif
+#ifdef USE_ZSTD
+    case CodecType::ZSTD:
+        return ZSTD_compressBound(size);
+#endif
+    default:
+        return size;
+    }
+}
+
+ssize_t CodecCompress(CodecType type, const char *src, size_t size, char *dst, size_t capacity)
+{
+    switch (type) {
+    case CodecType::ZLIB: {
+        uLongf destLen = capacity;
+        int ret = compress2((Bytef *)dst, &destLen, (const Bytef *)src, size, CODEC_ZLIB_LEVEL);
+        return ret == Z_OK ? (ssize_t)destLen : -1;
+    }
+#ifdef USE_LZ4
+    case CodecType::LZ4: {
+        int ret = LZ4_compress_default(src, dst, size, capacity);
+        return ret > 0 ? ret : -1;
+    }
+#endif
+#ifdef USE_ZSTD
+    case CodecType::ZSTD: {
+        size_t ret = ZSTD_compress(dst, capacity, src, size, CODEC_ZSTD_LEVEL);
+        return ZSTD_isError(ret) ? -1 : (ssize_t)ret;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
+
+ssize_t CodecDecompress(CodecType type, const char *src, size_t size, char *dst, size_t capacity)
+{
+    switch (type) {
+    case CodecType::ZLIB: {
+        uLongf destLen = capacity;
+        int ret = uncompress((Bytef *)dst, &destLen, (const Bytef *)src, size);
+        return ret == Z_OK ? (ssize_t)destLen : -1;
+    }
+#ifdef USE_LZ4
+    case CodecType::LZ4: {
+        int ret = LZ4_decompress_safe(src, dst, size, capacity);
+        return ret >= 0 ? ret : -1;
+    }
+#endif
+#ifdef USE_ZSTD
+    case CodecType::ZSTD: {
+        size_t ret = ZSTD_decompress(dst, capacity, src, size);
+        return ZSTD_isError(ret) ? -1 : (ssize_t)ret;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
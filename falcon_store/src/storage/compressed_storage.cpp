@@ -0,0 +1,483 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "storage/compressed_storage.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <ranges>
+#include <unordered_set>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+/* block size bounds, sizes in the index must stay below COMPRESS_RAW_BLOCK */
+#define COMPRESS_MIN_BLOCK_SIZE (4 * 1024)
+#define COMPRESS_MAX_BLOCK_SIZE (64 * 1024 * 1024)
+
+/* formats that are compressed already, trying them only costs cpu */
+static const std::unordered_set<std::string> INCOMPRESSIBLE_TYPES = {
+    "jpg", "jpeg", "png", "gif", "webp", "heic", "mp3", "mp4", "mkv", "avi", "mov", "webm",
+    "zip", "gz",   "tgz", "bz2", "xz",   "zst",  "lz4", "7z",  "rar", "br",  "jar",
+};
+
+static ssize_t ReadAll(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pread(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (ret == 0) {
+            break;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+static int WriteAll(int fd, const char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pwrite(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+static uint64_t ElapsedUs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+CompressedStorage *CompressedStorage::GetInstance()
+{
+    static CompressedStorage m_singleton;
+    return &m_singleton;
+}
+
+void CompressedStorage::Wrap(Storage *storage,
+                             CodecType type,
+                             uint32_t initBlockSize,
+                             const std::string &compressDirs,
+                             const std::string &initScratchDir)
+{
+    inner = storage;
+    codec = type;
+    blockSize = std::clamp<uint32_t>(initBlockSize, COMPRESS_MIN_BLOCK_SIZE, COMPRESS_MAX_BLOCK_SIZE);
+    scratchDir = initScratchDir;
+    {
+        std::lock_guard<std::mutex> lock(layoutMutex);
+        layouts.clear();
+    }
+    dirs.clear();
+    for (auto &&dir : compressDirs | std::views::split(',') | std::views::transform([](auto &&rng) {
+                          return std::string(&*rng.begin(), std::ranges::distance(rng));
+                      })) {
+        /* object keys have no leading slash */
+        size_t begin = dir.find_first_not_of('/');
+        if (begin == std::string::npos) {
+            if (!dir.empty()) {
+                /* the root covers everything */
+                dirs.clear();
+                break;
+            }
+            continue;
+        }
+        size_t end = dir.find_last_not_of('/');
+        dirs.push_back(dir.substr(begin, end - begin + 1));
+    }
+}
+
+int CompressedStorage::Init()
+{
+    std::error_code ec;
+    /* staged objects of a previous run were uploaded or will be again from the write back journal */
+    std::filesystem::remove_all(scratchDir, ec);
+    if (!std::filesystem::create_directories(scratchDir, ec) && ec) {
+        FALCON_LOG(LOG_ERROR) << "CompressedStorage: create " << scratchDir << " failed: " << ec.message();
+        return -1;
+    }
+    int ret = inner->Init();
+    if (ret != 0) {
+        return ret;
+    }
+    FALCON_LOG(LOG_INFO) << "successfully init compressed storage, codec " << CodecName(codec) << ", block size "
+                         << blockSize;
+    return 0;
+}
+
+void CompressedStorage::DeleteInstance()
+{
+    {
+        std::lock_guard<std::mutex> lock(layoutMutex);
+        layouts.clear();
+    }
+    if (inner != nullptr) {
+        inner->DeleteInstance();
+    }
+}
+
+void CompressedStorage::SetTransferOptions(uint64_t partSize, uint32_t concurrency)
+{
+    inner->SetTransferOptions(partSize, concurrency);
+}
+
+bool CompressedStorage::ShouldCompress(const std::string &objectKey)
+{
+    if (codec == CodecType::NONE) {
+        return false;
+    }
+    std::string name = objectKey.substr(objectKey.rfind('/') + 1);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) {
+        std::string type = name.substr(dot + 1);
+        std::transform(type.begin(), type.end(), type.begin(), [](unsigned char c) { return std::tolower(c); });
+        if (INCOMPRESSIBLE_TYPES.contains(type)) {
+            return false;
+        }
+    }
+    if (dirs.empty()) {
+        return true;
+    }
+    return std::any_of(dirs.begin(), dirs.end(), [&](const std::string &dir) {
+        return objectKey.starts_with(dir) && (objectKey.size() == dir.size() || objectKey[dir.size()] == '/');
+    });
+}
+
+int CompressedStorage::Pack(uint64_t rawSize, const BlockReader &read, const BlockWriter &write)
+{
+    uint32_t blockCount = (rawSize + blockSize - 1) / blockSize;
+    std::vector<char> header(COMPRESS_HEADER_SIZE + (size_t)blockCount * sizeof(uint32_t));
+    uint32_t *index = (uint32_t *)(header.data() + COMPRESS_HEADER_SIZE);
+    std::vector<char> raw(blockSize);
+    std::vector<char> packed(CodecBound(codec, blockSize));
+    uint64_t offset = header.size();
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t cpuUs = 0;
+    int ret = 0;
+    for (uint32_t i = 0; i < blockCount && ret == 0; ++i) {
+        size_t size = std::min<uint64_t>(blockSize, rawSize - (uint64_t)i * blockSize);
+        ssize_t nread = read(raw.data(), size, (uint64_t)i * blockSize);
+        if (nread != (ssize_t)size) {
+            ret = nread < 0 ? nread : -EIO;
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        ssize_t compressed = CodecCompress(codec, raw.data(), size, packed.data(), packed.size());
+        cpuUs += ElapsedUs(start);
+        const char *data = packed.data();
+        if (compressed < 0 || compressed * 100 > size * (100 - COMPRESS_MIN_SAVING_PERCENT)) {
+            data = raw.data();
+            compressed = size;
+            index[i] = size | COMPRESS_RAW_BLOCK;
+        } else {
+            index[i] = compressed;
+        }
+        bytesIn += size;
+        bytesOut += compressed;
+        bool probed = i + 1 == COMPRESS_PROBE_BLOCKS || (i + 1 == blockCount && i < COMPRESS_PROBE_BLOCKS);
+        if (probed && bytesOut * 100 > bytesIn * (100 - COMPRESS_MIN_SAVING_PERCENT)) {
+            ret = 1;
+            break;
+        }
+        ret = write(data, compressed, offset);
+        offset += compressed;
+    }
+    FalconStats::GetInstance().stats[COMPRESS_CPU_US] += cpuUs;
+    if (ret != 0) {
+        return ret;
+    }
+
+    thread_local std::mt19937_64 engine(std::random_device{}());
+    uint32_t magic = COMPRESS_MAGIC;
+    uint64_t uploadId = engine();
+    memcpy(header.data(), &magic, sizeof(magic));
+    header[4] = (char)codec;
+    memcpy(header.data() + 8, &blockSize, sizeof(blockSize));
+    memcpy(header.data() + 12, &blockCount, sizeof(blockCount));
+    memcpy(header.data() + 16, &rawSize, sizeof(rawSize));
+    memcpy(header.data() + 24, &uploadId, sizeof(uploadId));
+    ret = write(header.data(), header.size(), 0);
+    if (ret == 0) {
+        FalconStats::GetInstance().stats[COMPRESS_IN] += bytesIn;
+        FalconStats::GetInstance().stats[COMPRESS_OUT] += bytesOut + header.size();
+    }
+    return ret;
+}
+
+int CompressedStorage::PutFile(const std::string &objectKey, const std::string &filePath)
+{
+    if (!ShouldCompress(objectKey)) {
+        return inner->PutFile(objectKey, filePath);
+    }
+    int in = open(filePath.c_str(), O_RDONLY);
+    if (in < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "PutFile() " << objectKey << " failed: open " << filePath << ": " << strerror(err);
+        return -err;
+    }
+    struct stat st;
+    if (fstat(in, &st) != 0 || st.st_size == 0) {
+        close(in);
+        return inner->PutFile(objectKey, filePath);
+    }
+    std::string tmpPath = scratchDir + "/" + std::to_string(scratchSeq++);
+    int out = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out < 0) {
+        int err = errno;
+        close(in);
+        FALCON_LOG(LOG_ERROR) << "PutFile() " << objectKey << " failed: create " << tmpPath << ": " << strerror(err);
+        return -err;
+    }
+    int ret = Pack(
+        st.st_size, [in](char *buf, size_t size, uint64_t offset) { return ReadAll(in, buf, size, offset); },
+        [out](const char *buf, size_t size, uint64_t offset) { return WriteAll(out, buf, size, offset); });
+    close(in);
+    close(out);
+    if (ret == 0) {
+        ret = inner->PutFile(objectKey, tmpPath);
+    } else if (ret == 1) {
+        ret = inner->PutFile(objectKey, filePath);
+    } else {
+        FALCON_LOG(LOG_ERROR) << "PutFile() " << objectKey << " failed: compress: " << strerror(-ret);
+    }
+    unlink(tmpPath.c_str());
+    ForgetLayout(objectKey);
+    return ret;
+}
+
+ssize_t
+CompressedStorage::PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset)
+{
+    if (buf == nullptr || size == 0 || !ShouldCompress(objectKey)) {
+        return inner->PutBuffer(objectKey, buf, size, offset);
+    }
+    std::string object;
+    int ret = Pack(
+        size,
+        [&](char *dest, size_t length, uint64_t from) {
+            memcpy(dest, buf + offset + from, length);
+            return (ssize_t)length;
+        },
+        [&](const char *src, size_t length, uint64_t to) {
+            object.resize(std::max<size_t>(object.size(), to + length));
+            memcpy(object.data() + to, src, length);
+            return 0;
+        });
+    ForgetLayout(objectKey);
+    if (ret == 1) {
+        return inner->PutBuffer(objectKey, buf, size, offset);
+    }
+    if (ret != 0 || inner->PutBuffer(objectKey, object.data(), object.size(), 0) < 0) {
+        return -1;
+    }
+    return size;
+}
+
+std::shared_ptr<const CompressedStorage::Layout> CompressedStorage::GetLayout(const std::string &objectKey)
+{
+    static const auto plain = std::make_shared<const Layout>();
+    std::shared_ptr<const Layout> cached;
+    {
+        std::lock_guard<std::mutex> lock(layoutMutex);
+        auto it = layouts.find(objectKey);
+        if (it != layouts.end()) {
+            if (std::chrono::steady_clock::now() - it->second.checked <
+                std::chrono::milliseconds(COMPRESS_LAYOUT_RECHECK_MS)) {
+                return it->second.layout;
+            }
+            cached = it->second.layout;
+        }
+    }
+    char header[COMPRESS_HEADER_SIZE];
+    ssize_t nread = inner->ReadObject(objectKey, 0, COMPRESS_HEADER_SIZE, -1, header);
+    if (nread < 0) {
+        /* reading the object through reports it */
+        return plain;
+    }
+    uint32_t magic = 0;
+    if (nread == COMPRESS_HEADER_SIZE) {
+        memcpy(&magic, header, sizeof(magic));
+    }
+    if (magic != COMPRESS_MAGIC) {
+        RememberLayout(objectKey, plain);
+        return plain;
+    }
+    auto layout = std::make_shared<Layout>();
+    layout->compressed = true;
+    layout->codec = (CodecType)header[4];
+    memcpy(&layout->blockSize, header + 8, sizeof(layout->blockSize));
+    uint32_t blockCount = 0;
+    memcpy(&blockCount, header + 12, sizeof(blockCount));
+    memcpy(&layout->rawSize, header + 16, sizeof(layout->rawSize));
+    layout->header.assign(header, COMPRESS_HEADER_SIZE);
+    if (layout->blockSize == 0 || blockCount != (layout->rawSize + layout->blockSize - 1) / layout->blockSize) {
+        FALCON_LOG(LOG_ERROR) << "CompressedStorage: " << objectKey << " has a corrupt header";
+        return nullptr;
+    }
+    if (cached != nullptr && cached->header == layout->header) {
+        RememberLayout(objectKey, cached);
+        return cached;
+    }
+
+    std::vector<uint32_t> index(blockCount);
+    uint64_t indexSize = (uint64_t)blockCount * sizeof(uint32_t);
+    if (indexSize > 0 &&
+        inner->ReadObject(objectKey, COMPRESS_HEADER_SIZE, indexSize, -1, (char *)index.data()) != (ssize_t)indexSize) {
+        FALCON_LOG(LOG_ERROR) << "CompressedStorage: read block index of " << objectKey << " failed";
+        return nullptr;
+    }
+    layout->offsets.resize(blockCount + 1);
+    layout->rawBlocks.resize(blockCount);
+    layout->offsets[0] = COMPRESS_HEADER_SIZE + indexSize;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        layout->rawBlocks[i] = (index[i] & COMPRESS_RAW_BLOCK) != 0;
+        layout->offsets[i + 1] = layout->offsets[i] + (index[i] & ~COMPRESS_RAW_BLOCK);
+    }
+    RememberLayout(objectKey, layout);
+    return layout;
+}
+
+void CompressedStorage::RememberLayout(const std::string &objectKey, std::shared_ptr<const Layout> layout)
+{
+    std::lock_guard<std::mutex> lock(layoutMutex);
+    if (layouts.size() >= COMPRESS_LAYOUT_CACHE && !layouts.contains(objectKey)) {
+        layouts.clear();
+    }
+    layouts[objectKey] = CachedLayout{std::move(layout), std::chrono::steady_clock::now()};
+}
+
+void CompressedStorage::ForgetLayout(const std::string &objectKey)
+{
+    std::lock_guard<std::mutex> lock(layoutMutex);
+    layouts.erase(objectKey);
+}
+
+ssize_t CompressedStorage::ReadBlocks(const std::string &objectKey,
+                                      const Layout &layout,
+                                      uint64_t offset,
+                                      uint64_t size,
+                                      int fd,
+                                      char *destBuffer)
+{
+    uint64_t end = size == 0 ? layout.rawSize : std::min(layout.rawSize, offset + size);
+    if (offset >= end) {
+        return 0;
+    }
+    const uint64_t unit = layout.blockSize;
+    std::vector<char> packed;
+    std::vector<char> raw(unit);
+    uint64_t block = offset / unit;
+    while (block * unit < end) {
+        /* fetch the compressed bytes of as many covered blocks as fit a batch in one range read */
+        uint64_t last = block + 1;
+        while (last * unit < end && layout.offsets[last + 1] - layout.offsets[block] <= COMPRESS_READ_BATCH) {
+            last++;
+        }
+        uint64_t packedSize = layout.offsets[last] - layout.offsets[block];
+        packed.resize(packedSize);
+        ssize_t nread = inner->ReadObject(objectKey, layout.offsets[block], packedSize, -1, packed.data());
+        if (nread < 0) {
+            FALCON_LOG(LOG_ERROR) << "CompressedStorage: read blocks of " << objectKey << " failed";
+            return -1;
+        }
+        if (nread != (ssize_t)packedSize) {
+            /* shorter than the layout says */
+            return -ESTALE;
+        }
+        for (uint64_t i = block; i < last; ++i) {
+            const char *data = packed.data() + (layout.offsets[i] - layout.offsets[block]);
+            uint64_t blockStart = i * unit;
+            size_t blockLength = std::min(unit, layout.rawSize - blockStart);
+            if (!layout.rawBlocks[i]) {
+                auto start = std::chrono::steady_clock::now();
+                ssize_t length = CodecDecompress(layout.codec, data, layout.offsets[i + 1] - layout.offsets[i],
+                                                 raw.data(), raw.size());
+                FalconStats::GetInstance().stats[DECOMPRESS_CPU_US] += ElapsedUs(start);
+                if (length != (ssize_t)blockLength) {
+                    return -ESTALE;
+                }
+                data = raw.data();
+            }
+            uint64_t from = std::max(offset, blockStart);
+            uint64_t to = std::min(end, blockStart + blockLength);
+            if (destBuffer != nullptr) {
+                memcpy(destBuffer + (from - offset), data + (from - blockStart), to - from);
+            }
+            if (fd != -1) {
+                FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += to - from;
+                int ret = WriteAll(fd, data + (from - blockStart), to - from, from);
+                if (ret != 0) {
+                    FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: " << strerror(-ret);
+                    return -1;
+                }
+            }
+        }
+        block = last;
+    }
+    return end - offset;
+}
+
+ssize_t
+CompressedStorage::ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer)
+{
+    if (!ShouldCompress(objectKey)) {
+        /* never compressed, no header to look for */
+        return inner->ReadObject(objectKey, offset, size, fd, destBuffer);
+    }
+    for (int attempt = 0;; ++attempt) {
+        std::shared_ptr<const Layout> layout = GetLayout(objectKey);
+        if (layout == nullptr) {
+            return -1;
+        }
+        if (!layout->compressed) {
+            return inner->ReadObject(objectKey, offset, size, fd, destBuffer);
+        }
+        ssize_t ret = ReadBlocks(objectKey, *layout, offset, size, fd, destBuffer);
+        if (ret != -ESTALE) {
+            return ret;
+        }
+        if (attempt > 0) {
+            FALCON_LOG(LOG_ERROR) << "CompressedStorage: blocks of " << objectKey << " do not decompress with "
+                                  << CodecName(layout->codec);
+            return -1;
+        }
+        /* rewritten since the layout was cached */
+        ForgetLayout(objectKey);
+    }
+}
+
+int CompressedStorage::DeleteObject(const std::string &objectKey)
+{
+    ForgetLayout(objectKey);
+    return inner->DeleteObject(objectKey);
+}
+
+int CompressedStorage::CopyObject(const std::string &fromPath, const std::string &toPath)
+{
+    ForgetLayout(toPath);
+    return inner->CopyObject(fromPath, toPath);
+}
+
+int CompressedStorage::StatFs(struct statvfs *vfsbuf) { return inner->StatFs(vfsbuf); }
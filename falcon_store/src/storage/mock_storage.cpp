@@ -0,0 +1,193 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "storage/mock_storage.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <thread>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+MockStorage *MockStorage::GetInstance()
+{
+    static MockStorage m_singleton;
+    return &m_singleton;
+}
+
+void MockStorage::SetFaults(uint32_t initLatencyUs, uint32_t bandwidthMb, uint32_t initErrorPercent)
+{
+    latencyUs = initLatencyUs;
+    bytesPerSecond = (uint64_t)bandwidthMb * 1024 * 1024;
+    errorPercent = initErrorPercent;
+}
+
+int MockStorage::Init()
+{
+    FALCON_LOG(LOG_INFO) << "successfully init mock storage, latency " << latencyUs << "us, bandwidth "
+                         << bytesPerSecond << "B/s, errors " << errorPercent << "%";
+    return 0;
+}
+
+void MockStorage::DeleteInstance()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    objects.clear();
+    gets = 0;
+}
+
+size_t MockStorage::ObjectCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return objects.size();
+}
+
+uint64_t MockStorage::Gets() { return gets.load(); }
+
+bool MockStorage::InjectFault(uint64_t bytes)
+{
+    std::chrono::microseconds delay(latencyUs);
+    if (bytesPerSecond != 0) {
+        delay += std::chrono::microseconds(bytes * 1000000 / bytesPerSecond);
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+    if (errorPercent == 0) {
+        return true;
+    }
+    thread_local std::minstd_rand engine(std::random_device{}());
+    return std::uniform_int_distribution<uint32_t>(0, 99)(engine) >= errorPercent;
+}
+
+std::shared_ptr<const std::string> MockStorage::Find(const std::string &objectKey)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = objects.find(objectKey);
+    return it == objects.end() ? nullptr : it->second;
+}
+
+void MockStorage::Store(const std::string &objectKey, std::shared_ptr<const std::string> object)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    objects[objectKey] = std::move(object);
+}
+
+ssize_t MockStorage::ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer)
+{
+    gets++;
+    std::shared_ptr<const std::string> object = Find(objectKey);
+    if (object == nullptr) {
+        FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: no such object";
+        return -1;
+    }
+    uint64_t length = offset >= object->size() ? 0 : object->size() - offset;
+    if (size != 0) {
+        length = std::min(length, size);
+    }
+    if (!InjectFault(length)) {
+        FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: injected error";
+        return -1;
+    }
+    const char *data = object->data() + std::min<uint64_t>(offset, object->size());
+    if (destBuffer != nullptr) {
+        FalconStats::GetInstance().stats[OBJ_GET] += length;
+        memcpy(destBuffer, data, length);
+    }
+    if (fd != -1) {
+        FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += length;
+        uint64_t done = 0;
+        while (done < length) {
+            ssize_t ret = pwrite(fd, data + done, length - done, offset + done);
+            if (ret < 0 && errno != EINTR) {
+                FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: " << strerror(errno);
+                return -1;
+            }
+            done += ret < 0 ? 0 : ret;
+        }
+    }
+    return length;
+}
+
+int MockStorage::PutFile(const std::string &objectKey, const std::string &filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file) {
+        FALCON_LOG(LOG_ERROR) << "PutFile() " << objectKey << " failed: can not open " << filePath;
+        return -ENOENT;
+    }
+    auto object = std::make_shared<const std::string>(std::istreambuf_iterator<char>(file),
+                                                      std::istreambuf_iterator<char>());
+    if (!InjectFault(object->size())) {
+        FALCON_LOG(LOG_ERROR) << "PutFile() " << objectKey << " failed: injected error";
+        return -EIO;
+    }
+    FalconStats::GetInstance().stats[OBJ_PUT] += object->size();
+    Store(objectKey, std::move(object));
+    return 0;
+}
+
+ssize_t
+MockStorage::PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset)
+{
+    auto object = std::make_shared<const std::string>(buf == nullptr ? std::string() : std::string(buf + offset, size));
+    if (!InjectFault(object->size())) {
+        FALCON_LOG(LOG_ERROR) << "PutBuffer() " << objectKey << " failed: injected error";
+        return -1;
+    }
+    FalconStats::GetInstance().stats[OBJ_PUT] += object->size();
+    ssize_t ret = object->size();
+    Store(objectKey, std::move(object));
+    return ret;
+}
+
+int MockStorage::DeleteObject(const std::string &objectKey)
+{
+    if (!InjectFault(0)) {
+        FALCON_LOG(LOG_ERROR) << "delete object " << objectKey << " failed: injected error";
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    objects.erase(objectKey);
+    return 0;
+}
+
+int MockStorage::CopyObject(const std::string &fromPath, const std::string &toPath)
+{
+    std::shared_ptr<const std::string> object = Find(fromPath);
+    if (object == nullptr || !InjectFault(0)) {
+        FALCON_LOG(LOG_ERROR) << "CopyObject " << fromPath << " to " << toPath << " failed";
+        return -1;
+    }
+    Store(toPath, std::move(object));
+    return 0;
+}
+
+int MockStorage::StatFs(struct statvfs *vfsbuf)
+{
+    uint64_t used = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &[key, object] : objects) {
+            used += object->size();
+        }
+        vfsbuf->f_files = objects.size();
+    }
+    vfsbuf->f_bsize = 4096;
+    vfsbuf->f_frsize = 4096;
+    vfsbuf->f_blocks = UINT64_MAX / vfsbuf->f_frsize;
+    vfsbuf->f_bfree = vfsbuf->f_blocks - (used + vfsbuf->f_frsize - 1) / vfsbuf->f_frsize;
+    vfsbuf->f_bavail = vfsbuf->f_bfree;
+    vfsbuf->f_ffree = UINT32_MAX;
+    vfsbuf->f_favail = UINT32_MAX;
+    vfsbuf->f_namemax = 255;
+    return 0;
+}
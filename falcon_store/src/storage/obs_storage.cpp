@@ -9,6 +9,7 @@
 #include <securec.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 
 #include "log/logging.h"
 #include "stats/falcon_stats.h"
@@ -41,8 +42,10 @@ struct GetObjectCallbackType
     int fd = 0;
     char *destBuffer = nullptr;
     size_t destBuffSize = 0;
-    int realSize = 0;
+    ssize_t realSize = 0;
+    /* offset is relative to the start of the read, fileOffset is where the read starts in fd */
     off_t offset = 0;
+    off_t fileOffset = 0;
     obs_status retStatus = OBS_STATUS_OK;
     const obs_error_details *error = nullptr;
 };
@@ -264,7 +267,6 @@ obs_status GetObjectDataCallback(int bufferSize, const char *buffer, void *callb
         return OBS_STATUS_ErrorUnknown;
     }
     auto *data = static_cast<GetObjectCallbackType *>(callbackData);
-    data->realSize += bufferSize;
 
     if (data->destBuffer != nullptr) {
         FalconStats::GetInstance().stats[OBJ_GET] += bufferSize;
@@ -277,10 +279,11 @@ obs_status GetObjectDataCallback(int bufferSize, const char *buffer, void *callb
     }
     if (data->fd != -1) {
         FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += bufferSize;
-        if (pwrite(data->fd, buffer, bufferSize, data->offset) == -1) {
+        if (pwrite(data->fd, buffer, bufferSize, data->fileOffset + data->offset) == -1) {
             return OBS_STATUS_AbortedByCallback;
         }
     }
+    data->realSize += bufferSize;
     data->offset += bufferSize;
     return OBS_STATUS_OK;
 }
@@ -303,6 +306,7 @@ ssize_t OBSStorage::ReadObject(const std::string &objectKey, uint64_t offset, ui
     data.retStatus = OBS_STATUS_BUTT;
     data.fd = fd;
     data.offset = 0;
+    data.fileOffset = offset;
     data.destBuffer = destBuffer;
     data.realSize = 0;
     data.destBuffSize = size;
@@ -315,15 +319,20 @@ ssize_t OBSStorage::ReadObject(const std::string &objectKey, uint64_t offset, ui
     }
 
     init_get_properties(&getcondition);
-    // The starting position of the reading
-    getcondition.start_byte = offset;
-    // Read length, default is 0: read to the end of the object
-    getcondition.byte_count = size;
     obs_get_object_handler getObjectHandler = {{&NormalPropertiesCallback, &GetObjectCompleteCallback},
                                                &GetObjectDataCallback};
     ssize_t ret = 0;
     int retryCount = RETRY_NUM;
     while (retryCount > 0) {
+        if (size != 0 && (uint64_t)data.offset >= size) {
+            /* the range arrived before the request failed */
+            ret = data.realSize;
+            break;
+        }
+        /* a retry resumes after the bytes already received instead of starting over */
+        getcondition.start_byte = offset + data.offset;
+        // Read length, 0: read to the end of the object
+        getcondition.byte_count = size == 0 ? 0 : size - data.offset;
         get_object(&option, &objectInfo, &getcondition, nullptr, &getObjectHandler, &data);
         if (OBS_STATUS_OK == data.retStatus) {
             ret = data.realSize;
@@ -346,11 +355,17 @@ uint64_t OpenFileGetLength(const std::string &localFile)
     return statbuf.st_size;
 }
 
+void OBSStorage::SetTransferOptions(uint64_t partSize, uint32_t concurrency)
+{
+    transferPartSize = std::max<uint64_t>(partSize, OBS_MIN_PART_SIZE);
+    transferConcurrency = std::max<uint32_t>(concurrency, 1);
+}
+
 int OBSStorage::PutFile(const std::string &objectKey, const std::string &filePath)
 {
     uint64_t contentLen = OpenFileGetLength(filePath);
     obs_status retStatus = OBS_STATUS_BUTT;
-    if (contentLen < UPLOAD_SLICE_SIZE) {
+    if (contentLen < transferPartSize) {
         retStatus = ObsPutObject(objectKey, filePath, contentLen);
     } else {
         retStatus = ObsUploadFile(objectKey, filePath, contentLen);
@@ -483,8 +498,8 @@ obs_status OBSStorage::ObsUploadFile(const std::string &objectKey, const std::st
     }
     uploadFileInfo.check_point_file = nullptr;
     uploadFileInfo.enable_check_point = 1;
-    uploadFileInfo.part_size = UPLOAD_SLICE_SIZE;
-    uploadFileInfo.task_num = 4;
+    uploadFileInfo.part_size = transferPartSize;
+    uploadFileInfo.task_num = transferConcurrency;
     uploadFileInfo.upload_file = const_cast<char *>(filePath.c_str());
     FalconStats::GetInstance().stats[OBJ_PUT] += contentLen;
 
@@ -0,0 +1,211 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "storage/posix_storage.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "log/logging.h"
+#include "stats/falcon_stats.h"
+
+static int WriteAll(int fd, const char *buf, size_t size, off_t offset)
+{
+    size_t done = 0;
+    while (done < size) {
+        ssize_t ret = pwrite(fd, buf + done, size - done, offset + done);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += ret;
+    }
+    return 0;
+}
+
+/* copy the content of file src to the start of out */
+static int CopyFileTo(const std::string &src, int out)
+{
+    int in = open(src.c_str(), O_RDONLY);
+    if (in < 0) {
+        return -errno;
+    }
+    std::vector<char> chunk(POSIX_STORAGE_CHUNK_SIZE);
+    off_t offset = 0;
+    int ret = 0;
+    while (ret == 0) {
+        ssize_t nread = pread(in, chunk.data(), chunk.size(), offset);
+        if (nread < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -errno;
+        } else if (nread == 0) {
+            break;
+        } else {
+            ret = WriteAll(out, chunk.data(), nread, offset);
+            offset += nread;
+        }
+    }
+    close(in);
+    return ret;
+}
+
+PosixStorage *PosixStorage::GetInstance()
+{
+    static PosixStorage m_singleton;
+    return &m_singleton;
+}
+
+void PosixStorage::SetRootPath(const std::string &path) { rootPath = path; }
+
+int PosixStorage::Init()
+{
+    if (rootPath.empty()) {
+        FALCON_LOG(LOG_ERROR) << "PosixStorage: no storage path given";
+        return -1;
+    }
+    std::error_code ec;
+    if (!std::filesystem::create_directories(rootPath, ec) && ec) {
+        FALCON_LOG(LOG_ERROR) << "PosixStorage: create " << rootPath << " failed: " << ec.message();
+        return -1;
+    }
+    FALCON_LOG(LOG_INFO) << "successfully init posix storage at " << rootPath;
+    return 0;
+}
+
+void PosixStorage::DeleteInstance() {}
+
+std::string PosixStorage::ObjectPath(const std::string &objectKey) { return rootPath + "/" + objectKey; }
+
+int PosixStorage::WriteObject(const std::string &objectKey, const std::function<int(int)> &writer)
+{
+    static std::atomic<uint64_t> tmpSeq{0};
+    std::string objectPath = ObjectPath(objectKey);
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(objectPath).parent_path(), ec);
+    std::string tmpPath = objectPath + ".falcon_tmp." + std::to_string(tmpSeq++);
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        int err = errno;
+        FALCON_LOG(LOG_ERROR) << "PosixStorage: create " << tmpPath << " failed: " << strerror(err);
+        return -err;
+    }
+    int ret = writer(fd);
+    if (ret == 0 && fsync(fd) != 0) {
+        ret = -errno;
+    }
+    close(fd);
+    if (ret == 0 && rename(tmpPath.c_str(), objectPath.c_str()) != 0) {
+        ret = -errno;
+    }
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "PosixStorage: write object " << objectKey << " failed: " << strerror(-ret);
+        unlink(tmpPath.c_str());
+    }
+    return ret;
+}
+
+ssize_t PosixStorage::ReadObject(const std::string &objectKey, uint64_t offset, uint64_t size, int fd, char *destBuffer)
+{
+    int objectFd = open(ObjectPath(objectKey).c_str(), O_RDONLY);
+    if (objectFd < 0) {
+        FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: " << strerror(errno);
+        return -1;
+    }
+    std::vector<char> chunk(destBuffer == nullptr ? POSIX_STORAGE_CHUNK_SIZE : 0);
+    uint64_t done = 0;
+    ssize_t ret = 0;
+    while (size == 0 || done < size) {
+        size_t toRead =
+            size == 0 ? POSIX_STORAGE_CHUNK_SIZE : std::min<uint64_t>(POSIX_STORAGE_CHUNK_SIZE, size - done);
+        char *buf = destBuffer != nullptr ? destBuffer + done : chunk.data();
+        ssize_t nread = pread(objectFd, buf, toRead, offset + done);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread <= 0) {
+            ret = nread < 0 ? -errno : 0;
+            break;
+        }
+        if (destBuffer != nullptr) {
+            FalconStats::GetInstance().stats[OBJ_GET] += nread;
+        }
+        if (fd != -1) {
+            FalconStats::GetInstance().stats[BLOCKCACHE_WRITE] += nread;
+            ret = WriteAll(fd, buf, nread, offset + done);
+            if (ret != 0) {
+                break;
+            }
+        }
+        done += nread;
+    }
+    close(objectFd);
+    if (ret < 0) {
+        FALCON_LOG(LOG_ERROR) << "ReadObject() " << objectKey << " failed: " << strerror(-ret);
+        return -1;
+    }
+    return done;
+}
+
+int PosixStorage::PutFile(const std::string &objectKey, const std::string &filePath)
+{
+    return WriteObject(objectKey, [&](int fd) {
+        int ret = CopyFileTo(filePath, fd);
+        if (ret == 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                FalconStats::GetInstance().stats[OBJ_PUT] += st.st_size;
+            }
+        }
+        return ret;
+    });
+}
+
+ssize_t
+PosixStorage::PutBuffer(const std::string &objectKey, const char *buf, const uint64_t size, const uint64_t offset)
+{
+    int ret = WriteObject(objectKey, [&](int fd) {
+        FalconStats::GetInstance().stats[OBJ_PUT] += size;
+        return buf == nullptr ? 0 : WriteAll(fd, buf + offset, size, 0);
+    });
+    return ret == 0 ? (ssize_t)(buf == nullptr ? 0 : size) : -1;
+}
+
+int PosixStorage::DeleteObject(const std::string &objectKey)
+{
+    if (unlink(ObjectPath(objectKey).c_str()) != 0 && errno != ENOENT) {
+        FALCON_LOG(LOG_ERROR) << "delete object " << objectKey << " failed: " << strerror(errno);
+        return -1;
+    }
+    return 0;
+}
+
+int PosixStorage::CopyObject(const std::string &fromPath, const std::string &toPath)
+{
+    std::string fromObject = ObjectPath(fromPath);
+    int ret = WriteObject(toPath, [&](int fd) { return CopyFileTo(fromObject, fd); });
+    if (ret != 0) {
+        FALCON_LOG(LOG_ERROR) << "CopyObject " << fromPath << " to " << toPath << " failed: " << strerror(-ret);
+        return -1;
+    }
+    return 0;
+}
+
+int PosixStorage::StatFs(struct statvfs *vfsbuf)
+{
+    if (statvfs(rootPath.c_str(), vfsbuf) != 0) {
+        FALCON_LOG(LOG_ERROR) << "PosixStorage: statvfs " << rootPath << " failed: " << strerror(errno);
+        return -EIO;
+    }
+    return 0;
+}
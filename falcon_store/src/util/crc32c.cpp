@@ -0,0 +1,96 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "util/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
+/* reflected Castagnoli polynomial */
+#define CRC32C_POLY 0x82F63B78U
+
+static std::array<uint32_t, 256> MakeTable()
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+static uint32_t Crc32cSoftware(const uint8_t *data, size_t size, uint32_t crc)
+{
+    static const std::array<uint32_t, 256> table = MakeTable();
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t Crc32cInstructions(const uint8_t *data, size_t size, uint32_t crc)
+{
+    uint64_t crc64 = crc;
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; size > 0; --size, ++data) {
+        crc = _mm_crc32_u8(crc, *data);
+    }
+    return crc;
+}
+
+static bool DetectInstructions() { return __builtin_cpu_supports("sse4.2"); }
+#elif defined(__aarch64__)
+__attribute__((target("+crc"))) static uint32_t Crc32cInstructions(const uint8_t *data, size_t size, uint32_t crc)
+{
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), data += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; --size, ++data) {
+        crc = __crc32cb(crc, *data);
+    }
+    return crc;
+}
+
+static bool DetectInstructions() { return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0; }
+#else
+static uint32_t Crc32cInstructions(const uint8_t *data, size_t size, uint32_t crc)
+{
+    return Crc32cSoftware(data, size, crc);
+}
+
+static bool DetectInstructions() { return false; }
+#endif
+
+bool Crc32cHardware()
+{
+    static const bool hardware = DetectInstructions();
+    return hardware;
+}
+
+uint32_t Crc32c(const void *data, size_t size, uint32_t crc)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    crc = Crc32cHardware() ? Crc32cInstructions(bytes, size, crc) : Crc32cSoftware(bytes, size, crc);
+    return ~crc;
+}
@@ -4,113 +4,156 @@
 
 #include "util/file_lock.h"
 
-#include "log/logging.h"
+FileLockRange FileLock::MakeRange(uint64_t offset, uint64_t size, LockMode m)
+{
+    uint64_t end = size > FILE_LOCK_WHOLE - offset ? FILE_LOCK_WHOLE : offset + size;
+    return FileLockRange{.start = offset, .end = end, .mode = m};
+}
 
-void FileLock::ReleaseFileLock(uint64_t inodeId, LockMode m)
+/* no holder conflicts with range, and no one queued before waiterIndex does either */
+bool FileLock::Grantable(const FileLockState &state, const FileLockRange &range, size_t waiterIndex)
 {
-    std::unique_lock<std::shared_mutex> lock(mutex);
-    if (inodeIdTofileLockStateMap.find(inodeId) == inodeIdTofileLockStateMap.end()) {
-        return;
-    }
-    /* file is locked, exists in map */
-    std::shared_ptr<std::condition_variable_any> cv = inodeIdTofileLockStateMap[inodeId].cv;
-    bool toNotify = false;
-    if (m == LockMode::S) {
-        if (--inodeIdTofileLockStateMap[inodeId].lockCount == 0) {
-            toNotify = true;
-        }
-    } else {
-        if (++inodeIdTofileLockStateMap[inodeId].lockCount == 0) {
-            toNotify = true;
+    for (const FileLockRange &holder : state.holders) {
+        if (holder.Conflicts(range)) {
+            return false;
         }
     }
-    if (toNotify) {
-        if (inodeIdTofileLockStateMap[inodeId].waitingThreads == 0) {
-            /* no one is currently waiting for this lock, able to erase */
-            inodeIdTofileLockStateMap.erase(inodeId);
-        } else {
-            /* wake up all waiting for this lock, may be slocks */
-            cv->notify_all();
+    for (size_t i = 0; i < waiterIndex && i < state.waiters.size(); ++i) {
+        if (state.waiters[i]->range.Conflicts(range)) {
+            return false;
         }
     }
+    return true;
 }
 
-bool FileLock::GetFileLock(uint64_t inodeId, LockMode m, bool wait) { return innerGetFileLock(inodeId, m, wait); }
-
-bool FileLock::TryGetFileLock(uint64_t inodeId, LockMode m) { return innerGetFileLock(inodeId, m, false); }
-
-void FileLock::WaitGetFileLock(uint64_t inodeId, LockMode m) { innerGetFileLock(inodeId, m, true); }
-
-bool FileLock::innerGetFileLock(uint64_t inodeId, LockMode m, bool wait)
+void FileLock::GrantWaiters(FileLockState &state)
 {
-    std::unique_lock<std::shared_mutex> lock(mutex);
-
-    /* do not insert */
-    int lockCnt = 0;
-    if (inodeIdTofileLockStateMap.count(inodeId) != 0) {
-        lockCnt = inodeIdTofileLockStateMap[inodeId].lockCount;
+    size_t i = 0;
+    while (i < state.waiters.size()) {
+        FileLockWaiter *waiter = state.waiters[i];
+        if (!Grantable(state, waiter->range, i)) {
+            ++i;
+            continue;
+        }
+        state.holders.push_back(waiter->range);
+        state.waiters.erase(state.waiters.begin() + i);
+        /* waiter lives on the waiting thread's stack, do not touch it after notify */
+        waiter->granted = true;
+        waiter->cv.notify_one();
     }
+}
 
-    if (lockCnt == 0) {
-        /* not locked */
-        if (inodeIdTofileLockStateMap[inodeId].waitingThreads == 0) {
-            /* no one is waiting, create cv */
-            inodeIdTofileLockStateMap[inodeId].cv = std::make_shared<std::condition_variable_any>();
-        }
-        inodeIdTofileLockStateMap[inodeId].lockCount = static_cast<int>(m);
-    } else if (lockCnt > 0 && m == LockMode::S) {
-        /* slocked, do not create new cv */
-        inodeIdTofileLockStateMap[inodeId].lockCount++;
-    } else if (wait) {
-        /* xlocked, slocked before xlock, same cv for this inode */
-        std::shared_ptr<std::condition_variable_any> cv = inodeIdTofileLockStateMap[inodeId].cv;
-        if (cv == nullptr) {
-            FALCON_LOG(LOG_ERROR) << "innerGetFileLock(): cv == nullptr for inode Id " << inodeId;
-            return false;
-        }
-        /* increment lockWait */
-        ++inodeIdTofileLockStateMap[inodeId].waitingThreads;
-        if (m == LockMode::X) {
-            cv->wait(lock, [this, inodeId]() { return inodeIdTofileLockStateMap[inodeId].lockCount == 0; });
-        } else {
-            cv->wait(lock, [this, inodeId]() { return inodeIdTofileLockStateMap[inodeId].lockCount >= 0; });
+bool FileLock::GetRangeLock(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m, bool wait)
+{
+    FileLockRange range = MakeRange(offset, size, m);
+    Shard &shard = GetShard(inodeId);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    FileLockState &state = shard.states[inodeId];
+    if (Grantable(state, range, state.waiters.size())) {
+        state.holders.push_back(range);
+        return true;
+    }
+    if (!wait) {
+        if (state.holders.empty() && state.waiters.empty()) {
+            shard.states.erase(inodeId);
         }
-        /* decrement lockWait */
-        --inodeIdTofileLockStateMap[inodeId].waitingThreads;
-        /* change lockCnt */
-        inodeIdTofileLockStateMap[inodeId].lockCount += static_cast<int>(m);
-    } else {
-        /* try get lock failed */
         return false;
     }
+    FileLockWaiter waiter{.range = range};
+    state.waiters.push_back(&waiter);
+    waiter.cv.wait(lock, [&waiter]() { return waiter.granted; });
     return true;
 }
 
-bool FileLock::TestLocked(uint64_t inodeId, LockMode m)
+void FileLock::ReleaseRangeLock(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m)
+{
+    FileLockRange range = MakeRange(offset, size, m);
+    Shard &shard = GetShard(inodeId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.states.find(inodeId);
+    if (it == shard.states.end()) {
+        return;
+    }
+    FileLockState &state = it->second;
+    for (auto holder = state.holders.begin(); holder != state.holders.end(); ++holder) {
+        if (holder->start == range.start && holder->end == range.end && holder->mode == range.mode) {
+            state.holders.erase(holder);
+            break;
+        }
+    }
+    GrantWaiters(state);
+    if (state.holders.empty() && state.waiters.empty()) {
+        shard.states.erase(it);
+    }
+}
+
+bool FileLock::TestRangeLocked(uint64_t inodeId, uint64_t offset, uint64_t size, LockMode m)
 {
-    std::shared_lock<std::shared_mutex> lock(mutex);
+    /* an X probe conflicts with every lock, an S probe only with X locks */
+    FileLockRange range = MakeRange(offset, size, m);
+    Shard &shard = GetShard(inodeId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.states.find(inodeId);
+    if (it == shard.states.end()) {
+        return false;
+    }
+    for (const FileLockRange &holder : it->second.holders) {
+        if (holder.Conflicts(range)) {
+            return true;
+        }
+    }
     if (m == LockMode::X) {
-        /* no any lock, and no one waiting */
-        return inodeIdTofileLockStateMap.count(inodeId) != 0;
+        for (const FileLockWaiter *waiter : it->second.waiters) {
+            if (waiter->range.Conflicts(range)) {
+                return true;
+            }
+        }
     }
-    /* no any lock, or xLocked */
-    return inodeIdTofileLockStateMap.count(inodeId) != 0 && inodeIdTofileLockStateMap[inodeId].lockCount < 0;
+    return false;
+}
+
+void FileLock::ReleaseFileLock(uint64_t inodeId, LockMode m) { ReleaseRangeLock(inodeId, 0, FILE_LOCK_WHOLE, m); }
+
+bool FileLock::GetFileLock(uint64_t inodeId, LockMode m, bool wait)
+{
+    return GetRangeLock(inodeId, 0, FILE_LOCK_WHOLE, m, wait);
+}
+
+bool FileLock::TryGetFileLock(uint64_t inodeId, LockMode m) { return GetRangeLock(inodeId, 0, FILE_LOCK_WHOLE, m, false); }
+
+void FileLock::WaitGetFileLock(uint64_t inodeId, LockMode m) { GetRangeLock(inodeId, 0, FILE_LOCK_WHOLE, m, true); }
+
+bool FileLock::TestLocked(uint64_t inodeId, LockMode m)
+{
+    return TestRangeLocked(inodeId, 0, FILE_LOCK_WHOLE, m);
 }
 
 /* -------------- locker class ------------------- */
 
 FileLocker::FileLocker(FileLock *initFileLock, uint64_t initInodeId, LockMode initLockMode, bool wait)
+    : FileLocker(initFileLock, initInodeId, 0, FILE_LOCK_WHOLE, initLockMode, wait)
+{
+}
+
+FileLocker::FileLocker(FileLock *initFileLock,
+                       uint64_t initInodeId,
+                       uint64_t initOffset,
+                       uint64_t initSize,
+                       LockMode initLockMode,
+                       bool wait)
 {
     fileLock = initFileLock;
     inodeId = initInodeId;
+    offset = initOffset;
+    size = initSize;
     lockMode = initLockMode;
-    locked = fileLock->GetFileLock(initInodeId, initLockMode, wait);
+    locked = fileLock->GetRangeLock(inodeId, offset, size, lockMode, wait);
 }
 
 FileLocker::~FileLocker()
 {
     if (locked) {
-        fileLock->ReleaseFileLock(inodeId, lockMode);
+        fileLock->ReleaseRangeLock(inodeId, offset, size, lockMode);
     }
 }
 
@@ -0,0 +1,128 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "util/path_node_map.h"
+
+#include <mutex>
+
+std::string_view GetParentPathView(std::string_view path, int level)
+{
+    if (path.empty()) {
+        return path;
+    }
+    if (level == -1) {
+        size_t endPos = path.rfind('/');
+        return path.substr(0, endPos == std::string_view::npos ? 0 : endPos);
+    }
+    /* keep "/" and the directories before the last collected component, with their slashes */
+    int count = 0;
+    size_t prevEnd = 0;
+    size_t lastEnd = 0;
+    size_t pos = 0;
+    while (pos < path.size()) {
+        if (path[pos] == '/') {
+            ++pos;
+            continue;
+        }
+        size_t end = path.find('/', pos);
+        end = end == std::string_view::npos ? path.size() : end;
+        prevEnd = lastEnd;
+        lastEnd = end;
+        pos = end;
+        if (++count >= std::max(level, 1)) {
+            break;
+        }
+    }
+    return count <= 1 ? path.substr(0, 1) : path.substr(0, prevEnd + 1);
+}
+
+PathNodeMap::PathNodeMap(size_t capacity)
+{
+    shardCapacity = std::max<size_t>(capacity / PATH_NODE_MAP_SHARDS, 1);
+    for (Shard &shard : shards) {
+        shard.entries.reserve(shardCapacity);
+    }
+}
+
+bool PathNodeMap::Get(std::string_view path, int &nodeId)
+{
+    Shard &shard = GetShard(path);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(path);
+    if (it == shard.entries.end()) {
+        return false;
+    }
+    /* only write the flag when it changes, keep the cache line shared among readers */
+    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+        it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    nodeId = it->second.nodeId.load(std::memory_order_relaxed);
+    return true;
+}
+
+int PathNodeMap::GetOrAlloc(std::string_view path, const std::function<int(std::string_view)> &alloc)
+{
+    int nodeId = -1;
+    if (Get(path, nodeId)) {
+        return nodeId;
+    }
+    Shard &shard = GetShard(path);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(path);
+    if (it != shard.entries.end()) {
+        /* inserted by another thread meanwhile */
+        return it->second.nodeId.load(std::memory_order_relaxed);
+    }
+    nodeId = alloc(path);
+    if (shard.entries.size() >= shardCapacity) {
+        EvictOne(shard);
+    }
+    shard.entries.try_emplace(std::string(path)).first->second.nodeId.store(nodeId, std::memory_order_relaxed);
+    return nodeId;
+}
+
+void PathNodeMap::Set(std::string_view path, int nodeId)
+{
+    Shard &shard = GetShard(path);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    auto it = shard.entries.find(path);
+    if (it == shard.entries.end()) {
+        if (shard.entries.size() >= shardCapacity) {
+            EvictOne(shard);
+        }
+        it = shard.entries.try_emplace(std::string(path)).first;
+    }
+    it->second.nodeId.store(nodeId, std::memory_order_relaxed);
+}
+
+size_t PathNodeMap::Size()
+{
+    size_t size = 0;
+    for (Shard &shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        size += shard.entries.size();
+    }
+    return size;
+}
+
+void PathNodeMap::Clear()
+{
+    for (Shard &shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.entries.clear();
+    }
+}
+
+void PathNodeMap::EvictOne(Shard &shard)
+{
+    /* second chance: clear reference flags until an entry without one shows up */
+    for (int round = 0; round < 2; ++round) {
+        for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+            if (!it->second.referenced.exchange(false, std::memory_order_relaxed)) {
+                shard.entries.erase(it);
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "util/rate_limiter.h"
+
+#include <thread>
+
+void RateLimiter::SetRate(uint64_t rate)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bytesPerSecond = rate;
+    start = std::chrono::steady_clock::now();
+    bytes = 0;
+}
+
+void RateLimiter::Acquire(size_t size)
+{
+    std::chrono::steady_clock::time_point due;
+    std::chrono::steady_clock::time_point now;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bytesPerSecond == 0) {
+            return;
+        }
+        now = std::chrono::steady_clock::now();
+        due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>((double)bytes / bytesPerSecond));
+        if (now - due > std::chrono::seconds(1)) {
+            start = now - std::chrono::seconds(1);
+            bytes = bytesPerSecond;
+            due = now;
+        }
+        bytes += size;
+    }
+    if (due > now) {
+        std::this_thread::sleep_for(due - now);
+    }
+}
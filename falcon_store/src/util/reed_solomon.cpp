@@ -0,0 +1,199 @@
+/* Copyright (c) 2025 Huawei Technologies Co., Ltd.
+ * SPDX-License-Identifier: MulanPSL-2.0
+ */
+
+#include "util/reed_solomon.h"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+/* x^8 + x^4 + x^3 + x^2 + 1 */
+#define GF_POLY 0x11D
+
+namespace {
+
+struct GaloisField
+{
+    std::array<uint8_t, 512> exp{};
+    std::array<uint8_t, 256> log{};
+    /* product of every pair, a row per coefficient */
+    std::vector<std::array<uint8_t, 256>> mul;
+
+    GaloisField()
+        : mul(256)
+    {
+        uint32_t x = 1;
+        for (int i = 0; i < 255; ++i) {
+            exp[i] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= GF_POLY;
+            }
+        }
+        for (int i = 255; i < 512; ++i) {
+            exp[i] = exp[i - 255];
+        }
+        for (int a = 0; a < 256; ++a) {
+            for (int b = 0; b < 256; ++b) {
+                mul[a][b] = Mul(a, b);
+            }
+        }
+    }
+
+    uint8_t Mul(uint8_t a, uint8_t b) const { return a == 0 || b == 0 ? 0 : exp[log[a] + log[b]]; }
+    /* a must not be 0 */
+    uint8_t Inv(uint8_t a) const { return exp[255 - log[a]]; }
+};
+
+const GaloisField &Field()
+{
+    static const GaloisField field;
+    return field;
+}
+
+/* invert the n x n matrix in place by Gauss-Jordan elimination, false if it is singular */
+bool Invert(std::vector<uint8_t> &matrix, size_t n)
+{
+    const GaloisField &gf = Field();
+    std::vector<uint8_t> inverse(n * n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        inverse[i * n + i] = 1;
+    }
+    for (size_t col = 0; col < n; ++col) {
+        size_t pivot = col;
+        while (pivot < n && matrix[pivot * n + col] == 0) {
+            ++pivot;
+        }
+        if (pivot == n) {
+            return false;
+        }
+        if (pivot != col) {
+            for (size_t j = 0; j < n; ++j) {
+                std::swap(matrix[pivot * n + j], matrix[col * n + j]);
+                std::swap(inverse[pivot * n + j], inverse[col * n + j]);
+            }
+        }
+        uint8_t scale = gf.Inv(matrix[col * n + col]);
+        for (size_t j = 0; j < n; ++j) {
+            matrix[col * n + j] = gf.Mul(matrix[col * n + j], scale);
+            inverse[col * n + j] = gf.Mul(inverse[col * n + j], scale);
+        }
+        for (size_t row = 0; row < n; ++row) {
+            uint8_t factor = matrix[row * n + col];
+            if (row == col || factor == 0) {
+                continue;
+            }
+            for (size_t j = 0; j < n; ++j) {
+                matrix[row * n + j] ^= gf.Mul(factor, matrix[col * n + j]);
+                inverse[row * n + j] ^= gf.Mul(factor, inverse[col * n + j]);
+            }
+        }
+    }
+    matrix.swap(inverse);
+    return true;
+}
+
+} // namespace
+
+ReedSolomon::ReedSolomon(uint32_t initDataShards, uint32_t initParityShards)
+    : dataShards(initDataShards),
+      parityShards(initParityShards),
+      valid(initDataShards > 0 && initParityShards > 0 && initDataShards + initParityShards <= RS_MAX_SHARDS)
+{
+    if (!valid) {
+        return;
+    }
+    /* 1 / (x_i + y_j) with x_i = dataShards + i and y_j = j, all distinct */
+    const GaloisField &gf = Field();
+    parityRows.resize((size_t)parityShards * dataShards);
+    for (uint32_t i = 0; i < parityShards; ++i) {
+        for (uint32_t j = 0; j < dataShards; ++j) {
+            parityRows[(size_t)i * dataShards + j] = gf.Inv((uint8_t)((dataShards + i) ^ j));
+        }
+    }
+}
+
+void ReedSolomon::MulAdd(char *dst, const char *src, uint8_t coef, size_t len)
+{
+    if (coef == 0) {
+        return;
+    }
+    if (coef == 1) {
+        for (size_t i = 0; i < len; ++i) {
+            dst[i] ^= src[i];
+        }
+        return;
+    }
+    const std::array<uint8_t, 256> &row = Field().mul[coef];
+    for (size_t i = 0; i < len; ++i) {
+        dst[i] ^= (char)row[(uint8_t)src[i]];
+    }
+}
+
+void ReedSolomon::Encode(const std::vector<const char *> &data, const std::vector<char *> &parity, size_t len) const
+{
+    for (uint32_t i = 0; i < parityShards; ++i) {
+        memset(parity[i], 0, len);
+        for (uint32_t j = 0; j < dataShards; ++j) {
+            MulAdd(parity[i], data[j], parityRows[(size_t)i * dataShards + j], len);
+        }
+    }
+}
+
+int ReedSolomon::Reconstruct(const std::vector<char *> &shards, const std::vector<bool> &present, size_t len) const
+{
+    uint32_t total = dataShards + parityShards;
+    /* the first dataShards present shards, their rows of the generator form the matrix to invert */
+    std::vector<uint32_t> rows;
+    for (uint32_t i = 0; i < total && rows.size() < dataShards; ++i) {
+        if (present[i]) {
+            rows.push_back(i);
+        }
+    }
+    if (rows.size() < dataShards) {
+        return -EINVAL;
+    }
+
+    bool dataMissing = false;
+    for (uint32_t j = 0; j < dataShards; ++j) {
+        dataMissing = dataMissing || !present[j];
+    }
+    if (dataMissing) {
+        std::vector<uint8_t> matrix((size_t)dataShards * dataShards, 0);
+        for (uint32_t r = 0; r < dataShards; ++r) {
+            if (rows[r] < dataShards) {
+                matrix[(size_t)r * dataShards + rows[r]] = 1;
+            } else {
+                memcpy(&matrix[(size_t)r * dataShards],
+                       &parityRows[(size_t)(rows[r] - dataShards) * dataShards],
+                       dataShards);
+            }
+        }
+        if (!Invert(matrix, dataShards)) {
+            return -EINVAL;
+        }
+        for (uint32_t j = 0; j < dataShards; ++j) {
+            if (present[j]) {
+                continue;
+            }
+            memset(shards[j], 0, len);
+            for (uint32_t r = 0; r < dataShards; ++r) {
+                MulAdd(shards[j], shards[rows[r]], matrix[(size_t)j * dataShards + r], len);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < parityShards; ++i) {
+        if (present[dataShards + i]) {
+            continue;
+        }
+        char *parity = shards[dataShards + i];
+        memset(parity, 0, len);
+        for (uint32_t j = 0; j < dataShards; ++j) {
+            MulAdd(parity, shards[j], parityRows[(size_t)i * dataShards + j], len);
+        }
+    }
+    return 0;
+}
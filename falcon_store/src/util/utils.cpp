@@ -4,9 +4,14 @@
 
 #include "util/utils.h"
 
+#include <cerrno>
 #include <string>
 #include <random>
 
+#include <sys/xattr.h>
+
+#define PLACEMENT_KEY_XATTR "user.falcon.placement_key"
+
 std::string rootPath;
 int totalDirectory;
 uint32_t FALCON_BLOCK_SIZE;
@@ -22,6 +27,24 @@ std::string GetFilePath(uint64_t inodeId)
     return std::string(rootPath) + "/" + std::to_string(directoryId) + "/" + std::to_string(inodeId) + "-large";
 }
 
+std::string GetMigratingPath(uint64_t inodeId)
+{
+    return std::string(rootPath) + "/migrating/" + std::to_string(inodeId);
+}
+
+int SetPlacementKey(int fd, uint64_t key)
+{
+    if (fsetxattr(fd, PLACEMENT_KEY_XATTR, &key, sizeof(key), 0) != 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+bool GetPlacementKey(const std::string &fileName, uint64_t &key)
+{
+    return getxattr(fileName.c_str(), PLACEMENT_KEY_XATTR, &key, sizeof(key)) == sizeof(key);
+}
+
 int GenerateRandom(int minValue, int maxValue)
 {
     static std::random_device seed;
@@ -547,6 +547,302 @@ static PyObject* PyWrapper_ReadDir(PyObject* self, PyObject* args)
     return Py_BuildValue("(iN)", ret, list);
 }
 
+static PyObject* PyWrapper_Warmup(PyObject* self, PyObject* args)
+{
+    PyObject* pathList = nullptr;
+    int action = (int)CacheAction::WARMUP;
+    unsigned int concurrency = 8;
+    unsigned long long bandwidthMb = 0;
+    if (!PyArg_ParseTuple(args, "O!|iIK", &PyList_Type, &pathList, &action, &concurrency, &bandwidthMb))
+        return NULL;
+    if (action < (int)CacheAction::WARMUP || action > (int)CacheAction::UNPIN)
+    {
+        PyErr_SetString(PyExc_ValueError, "action must be 0 (warmup), 1 (pin) or 2 (unpin)");
+        return NULL;
+    }
+
+    std::vector<std::string> paths;
+    for (Py_ssize_t i = 0; i < PyList_Size(pathList); ++i)
+    {
+        const char* path = PyUnicode_AsUTF8(PyList_GetItem(pathList, i));
+        if (path == nullptr)
+            return NULL;
+        paths.emplace_back(path);
+    }
+    FalconWarmupOptions options;
+    options.action = (CacheAction)action;
+    options.concurrency = concurrency;
+    options.bytesPerSecond = bandwidthMb * 1024 * 1024;
+    FalconWarmupProgress progress;
+    int ret = -1;
+    try
+    {
+        /* files load for a long time, other python threads keep running meanwhile */
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconWarmup(paths, options, &progress);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    PyObject* dict = PyDict_New();
+    PyDict_SetItem(dict, PyUnicode_FromString("files"), PyLong_FromUnsignedLongLong(progress.files));
+    PyDict_SetItem(dict, PyUnicode_FromString("done_files"), PyLong_FromUnsignedLongLong(progress.doneFiles));
+    PyDict_SetItem(dict, PyUnicode_FromString("failed_files"), PyLong_FromUnsignedLongLong(progress.failedFiles));
+    PyDict_SetItem(dict, PyUnicode_FromString("bytes"), PyLong_FromUnsignedLongLong(progress.bytes));
+    PyDict_SetItem(dict, PyUnicode_FromString("done_bytes"), PyLong_FromUnsignedLongLong(progress.doneBytes));
+    return Py_BuildValue("(iN)", ret, dict);
+}
+
+static PyObject* PyWrapper_RegisterPrefetch(PyObject* self, PyObject* args)
+{
+    PyObject* pathList = nullptr;
+    unsigned long long seed = 0;
+    unsigned int distance = 0;
+    if (!PyArg_ParseTuple(args, "O!|KI", &PyList_Type, &pathList, &seed, &distance))
+        return NULL;
+
+    std::vector<std::string> paths;
+    for (Py_ssize_t i = 0; i < PyList_Size(pathList); ++i)
+    {
+        const char* path = PyUnicode_AsUTF8(PyList_GetItem(pathList, i));
+        if (path == nullptr)
+            return NULL;
+        paths.emplace_back(path);
+    }
+    int ret = -1;
+    uint64_t streamId = 0;
+    try
+    {
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconRegisterPrefetch(paths, seed, distance, streamId);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    PyObject* order = PyList_New(0);
+    for (const std::string& path : paths)
+        PyList_Append(order, PyUnicode_FromString(path.c_str()));
+    return Py_BuildValue("(iKN)", ret, streamId, order);
+}
+
+static PyObject* PyWrapper_UnregisterPrefetch(PyObject* self, PyObject* args)
+{
+    unsigned long long streamId = 0;
+    if (!PyArg_ParseTuple(args, "K", &streamId))
+        return NULL;
+
+    int ret = FalconUnregisterPrefetch(streamId);
+    return PyLong_FromLong(ret > 0 ? -ErrorCodeToErrno(ret) : ret);
+}
+
+/* keys are bytes or str */
+static bool KvKeysFromList(PyObject* keyList, std::vector<std::string>& keys)
+{
+    for (Py_ssize_t i = 0; i < PyList_Size(keyList); ++i)
+    {
+        PyObject* item = PyList_GetItem(keyList, i);
+        if (PyBytes_Check(item))
+        {
+            keys.emplace_back(PyBytes_AsString(item), PyBytes_Size(item));
+            continue;
+        }
+        Py_ssize_t size = 0;
+        const char* key = PyUnicode_AsUTF8AndSize(item, &size);
+        if (key == nullptr)
+            return false;
+        keys.emplace_back(key, size);
+    }
+    return true;
+}
+
+static PyObject* KvResultList(const std::vector<int64_t>& results)
+{
+    PyObject* list = PyList_New(0);
+    for (int64_t result : results)
+    {
+        PyObject* item = PyLong_FromLongLong(result);
+        PyList_Append(list, item);
+        Py_DECREF(item);
+    }
+    return list;
+}
+
+/* the buffers of blockList, released by the destructor */
+class KvBuffers
+{
+public:
+    std::vector<Py_buffer> views;
+
+    bool Get(PyObject* blockList, bool writable)
+    {
+        for (Py_ssize_t i = 0; i < PyList_Size(blockList); ++i)
+        {
+            Py_buffer view;
+            if (PyObject_GetBuffer(PyList_GetItem(blockList, i), &view, writable ? PyBUF_WRITABLE : PyBUF_SIMPLE) != 0)
+                return false;
+            views.push_back(view);
+        }
+        return true;
+    }
+    ~KvBuffers()
+    {
+        for (Py_buffer& view : views)
+            PyBuffer_Release(&view);
+    }
+};
+
+static PyObject* PyWrapper_KvPut(PyObject* self, PyObject* args)
+{
+    PyObject* keyList = nullptr;
+    PyObject* blockList = nullptr;
+    unsigned int ttlSeconds = 0;
+    int near = 1;
+    if (!PyArg_ParseTuple(args, "O!O!|Ip", &PyList_Type, &keyList, &PyList_Type, &blockList, &ttlSeconds, &near))
+        return NULL;
+    if (PyList_Size(keyList) != PyList_Size(blockList))
+    {
+        PyErr_SetString(PyExc_ValueError, "keys and blocks must be of the same length");
+        return NULL;
+    }
+
+    std::vector<std::string> keys;
+    KvBuffers buffers;
+    if (!KvKeysFromList(keyList, keys) || !buffers.Get(blockList, false))
+        return NULL;
+    std::vector<const char*> blocks;
+    std::vector<uint64_t> sizes;
+    for (Py_buffer& view : buffers.views)
+    {
+        blocks.push_back((const char*)view.buf);
+        sizes.push_back(view.len);
+    }
+    int ret = -1;
+    std::vector<int64_t> results;
+    try
+    {
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconKvPut(keys, blocks, sizes, ttlSeconds, near != 0, results);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    return Py_BuildValue("(iN)", ret, KvResultList(results));
+}
+
+static PyObject* PyWrapper_KvGet(PyObject* self, PyObject* args)
+{
+    PyObject* keyList = nullptr;
+    PyObject* blockList = nullptr;
+    int near = 1;
+    if (!PyArg_ParseTuple(args, "O!O!|p", &PyList_Type, &keyList, &PyList_Type, &blockList, &near))
+        return NULL;
+    if (PyList_Size(keyList) != PyList_Size(blockList))
+    {
+        PyErr_SetString(PyExc_ValueError, "keys and blocks must be of the same length");
+        return NULL;
+    }
+
+    std::vector<std::string> keys;
+    KvBuffers buffers;
+    if (!KvKeysFromList(keyList, keys) || !buffers.Get(blockList, true))
+        return NULL;
+    /* blocks are of a fixed size, the smallest buffer bounds them all */
+    std::vector<char*> blocks;
+    uint64_t bufSize = buffers.views.empty() ? 0 : UINT64_MAX;
+    for (Py_buffer& view : buffers.views)
+    {
+        blocks.push_back((char*)view.buf);
+        bufSize = std::min<uint64_t>(bufSize, view.len);
+    }
+    int ret = -1;
+    std::vector<int64_t> results;
+    try
+    {
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconKvGet(keys, blocks, bufSize, near != 0, results);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    return Py_BuildValue("(iN)", ret, KvResultList(results));
+}
+
+static PyObject* PyWrapper_KvExists(PyObject* self, PyObject* args)
+{
+    PyObject* keyList = nullptr;
+    int near = 1;
+    if (!PyArg_ParseTuple(args, "O!|p", &PyList_Type, &keyList, &near))
+        return NULL;
+
+    std::vector<std::string> keys;
+    if (!KvKeysFromList(keyList, keys))
+        return NULL;
+    int ret = -1;
+    std::vector<int64_t> results;
+    try
+    {
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconKvExists(keys, near != 0, results);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    return Py_BuildValue("(iN)", ret, KvResultList(results));
+}
+
+static PyObject* PyWrapper_KvDelete(PyObject* self, PyObject* args)
+{
+    PyObject* keyList = nullptr;
+    int near = 1;
+    if (!PyArg_ParseTuple(args, "O!|p", &PyList_Type, &keyList, &near))
+        return NULL;
+
+    std::vector<std::string> keys;
+    if (!KvKeysFromList(keyList, keys))
+        return NULL;
+    int ret = -1;
+    std::vector<int64_t> results;
+    try
+    {
+        Py_BEGIN_ALLOW_THREADS
+        ret = FalconKvDelete(keys, near != 0, results);
+        Py_END_ALLOW_THREADS
+    }
+    catch (const std::exception& e)
+    {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
+        return NULL;
+    }
+    ret = ret > 0 ? -ErrorCodeToErrno(ret) : ret;
+
+    return Py_BuildValue("(iN)", ret, KvResultList(results));
+}
+
 /* =================== Non-Blocking Methods =======================*/
 class AsyncTaskThreadPool 
 {
@@ -1076,6 +1372,98 @@ static PyMethodDef PyFalconFSInternalMethods[] =
         "  errno (int): Refer to errno in linux\n"
         "  content (list): Contain items which are (name, st_mode)"
     },
+    {
+        "Warmup", 
+        PyWrapper_Warmup, 
+        METH_VARARGS, 
+        "Load files into the cache of the nodes owning them before they are read\n"
+        "Parameters:\n"
+        "  paths (list): Files and directories, directories are walked recursively\n"
+        "  action (int): 0 to load, 1 to load and pin against eviction, 2 to unpin\n"
+        "  concurrency (int): Files loaded at once, 8 by default\n"
+        "  bandwidth_mb (int): MB loaded per second, 0 by default for no limit\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux, the first error of any file\n"
+        "  progress (dict): files, done_files, failed_files, bytes and done_bytes"
+    },
+    {
+        "RegisterPrefetch", 
+        PyWrapper_RegisterPrefetch, 
+        METH_VARARGS, 
+        "Register the order files are about to be read in, they are staged ahead of the reads\n"
+        "Parameters:\n"
+        "  paths (list): Files in the order they will be read\n"
+        "  seed (int): Shuffle paths with this seed first, 0 by default to keep the order\n"
+        "  distance (int): Files staged ahead of the last one read, 0 by default for the configured one\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux\n"
+        "  stream_id (int): Id to unregister the order with\n"
+        "  order (list): paths in the order registered"
+    },
+    {
+        "UnregisterPrefetch", 
+        PyWrapper_UnregisterPrefetch, 
+        METH_VARARGS, 
+        "Stop staging files of a registered order\n"
+        "Parameters:\n"
+        "  stream_id (int): Id returned by RegisterPrefetch\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux"
+    },
+    {
+        "KvPut", 
+        PyWrapper_KvPut, 
+        METH_VARARGS, 
+        "Put blocks keyed by opaque ids, e.g. KV cache blocks, replacing blocks of the same keys\n"
+        "Parameters:\n"
+        "  keys (list): Ids of the blocks, bytes or str\n"
+        "  blocks (list): Data of the blocks, bytes-like objects of at most the configured block size\n"
+        "  ttl_s (int): Seconds the blocks are kept, 0 by default for the configured ttl\n"
+        "  near (bool): Keep the blocks on the store of this client, True by default. Blocks put near are\n"
+        "    only found by clients of the same store, put blocks shared across nodes with near=False\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux, the first error of any block\n"
+        "  results (list): errno of every block"
+    },
+    {
+        "KvGet", 
+        PyWrapper_KvGet, 
+        METH_VARARGS, 
+        "Get blocks put by KvPut\n"
+        "Parameters:\n"
+        "  keys (list): Ids of the blocks, bytes or str\n"
+        "  blocks (list): Writable buffers the blocks are read into, e.g. bytearray\n"
+        "  near (bool): Look on the store of this client first, True by default. Blocks put near on\n"
+        "    another store are not found\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux, the first error of any block\n"
+        "  results (list): read byte size of every block, or errno"
+    },
+    {
+        "KvExists", 
+        PyWrapper_KvExists, 
+        METH_VARARGS, 
+        "Check blocks put by KvPut exist\n"
+        "Parameters:\n"
+        "  keys (list): Ids of the blocks, bytes or str\n"
+        "  near (bool): Look on the store of this client first, True by default. Blocks put near on\n"
+        "    another store are not found\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux, the first error of any block\n"
+        "  results (list): 0 for every block that exists, else errno"
+    },
+    {
+        "KvDelete", 
+        PyWrapper_KvDelete, 
+        METH_VARARGS, 
+        "Remove blocks put by KvPut\n"
+        "Parameters:\n"
+        "  keys (list): Ids of the blocks, bytes or str\n"
+        "  near (bool): Also remove blocks put near on the store of this client, True by default\n"
+        "Returns:\n"
+        "  errno (int): Refer to errno in linux, the first error of any block\n"
+        "  results (list): errno of every block"
+    },
     {
         "AsyncExists", 
         PyWrapper_AsyncExists, 
@@ -71,6 +71,42 @@ class Client:
     def ReadDir(self, path, fd):
         return _pyfalconfs_internal.ReadDir(path, fd)
 
+    @copy_doc_from(_pyfalconfs_internal.Warmup)
+    def Warmup(self, paths, concurrency=8, bandwidth_mb=0):
+        return _pyfalconfs_internal.Warmup(paths, 0, concurrency, bandwidth_mb)
+
+    @copy_doc_from(_pyfalconfs_internal.Warmup)
+    def Pin(self, paths, concurrency=8, bandwidth_mb=0):
+        return _pyfalconfs_internal.Warmup(paths, 1, concurrency, bandwidth_mb)
+
+    @copy_doc_from(_pyfalconfs_internal.Warmup)
+    def Unpin(self, paths, concurrency=8):
+        return _pyfalconfs_internal.Warmup(paths, 2, concurrency, 0)
+
+    @copy_doc_from(_pyfalconfs_internal.RegisterPrefetch)
+    def RegisterPrefetch(self, paths, seed=0, distance=0):
+        return _pyfalconfs_internal.RegisterPrefetch(paths, seed, distance)
+
+    @copy_doc_from(_pyfalconfs_internal.UnregisterPrefetch)
+    def UnregisterPrefetch(self, stream_id):
+        return _pyfalconfs_internal.UnregisterPrefetch(stream_id)
+
+    @copy_doc_from(_pyfalconfs_internal.KvPut)
+    def KvPut(self, keys, blocks, ttl_s=0, near=True):
+        return _pyfalconfs_internal.KvPut(keys, blocks, ttl_s, near)
+
+    @copy_doc_from(_pyfalconfs_internal.KvGet)
+    def KvGet(self, keys, blocks, near=True):
+        return _pyfalconfs_internal.KvGet(keys, blocks, near)
+
+    @copy_doc_from(_pyfalconfs_internal.KvExists)
+    def KvExists(self, keys, near=True):
+        return _pyfalconfs_internal.KvExists(keys, near)
+
+    @copy_doc_from(_pyfalconfs_internal.KvDelete)
+    def KvDelete(self, keys, near=True):
+        return _pyfalconfs_internal.KvDelete(keys, near)
+
 class AsyncConnector:
     @copy_doc_from(_pyfalconfs_internal.Init)
     def __init__(self, workspace, running_config_file):
@@ -0,0 +1,96 @@
+/*
+ * Cache capacity gained by deduplication on a dataset copied into several directories.
+ *
+ *   DedupBench <dir> [copies] [files] [file mb] [chunk kb]
+ *
+ * Files are written to a scratch directory under dir, which should be on a file system with
+ * reflinks, e.g. xfs or btrfs, to share blocks.
+ */
+#include <fcntl.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "falcon_store/dedup_index.h"
+#include "stats/falcon_stats.h"
+#include "util/utils.h"
+
+static uint64_t FreeBytes(const std::string &path)
+{
+    struct statvfs st;
+    statvfs(path.c_str(), &st);
+    return (uint64_t)st.f_bavail * st.f_frsize;
+}
+
+static bool WriteCacheFile(uint64_t inodeId, const std::vector<char> &data)
+{
+    int fd = open(GetFilePath(inodeId).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write(fd, data.data(), data.size()) == (ssize_t)data.size() && fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <dir> [copies] [files] [file mb] [chunk kb]\n", argv[0]);
+        return 1;
+    }
+    std::string root = std::string(argv[1]) + "/falcon_dedup_bench";
+    uint32_t copies = argc > 2 ? atoi(argv[2]) : 4;
+    uint32_t files = argc > 3 ? atoi(argv[3]) : 8;
+    uint64_t fileSize = (argc > 4 ? atoll(argv[4]) : 64) * 1024 * 1024;
+    uint32_t chunkSize = (argc > 5 ? atoi(argv[5]) : 1024) * 1024;
+
+    std::filesystem::create_directories(root + "/0");
+    SetRootPath(root);
+    SetTotalDirectory(1);
+    DedupIndex::GetInstance().Init(chunkSize);
+
+    uint64_t freeBefore = FreeBytes(root);
+    std::mt19937_64 engine(1);
+    std::vector<char> data(fileSize);
+    for (uint32_t f = 0; f < files; ++f) {
+        for (auto &c : data) {
+            c = (char)engine();
+        }
+        for (uint32_t c = 0; c < copies; ++c) {
+            if (!WriteCacheFile((uint64_t)c * files + f + 1, data)) {
+                perror("write cache file");
+                return 1;
+            }
+        }
+    }
+    uint64_t freeWritten = FreeBytes(root);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t inodeId = 1; inodeId <= (uint64_t)copies * files; ++inodeId) {
+        DedupIndex::GetInstance().Scan(inodeId);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sync();
+    uint64_t freeAfter = FreeBytes(root);
+
+    auto &stats = FalconStats::GetInstance().stats;
+    uint64_t logical = (uint64_t)copies * files * fileSize;
+    uint64_t written = freeBefore > freeWritten ? freeBefore - freeWritten : 0;
+    uint64_t physical = freeBefore > freeAfter ? freeBefore - freeAfter : 0;
+    printf("logical bytes:          %lu\n", logical);
+    printf("physical bytes before:  %lu\n", written);
+    printf("physical bytes after:   %lu\n", physical);
+    printf("shared bytes:           %lu\n", (uint64_t)stats[DEDUP_SHARED]);
+    printf("capacity gained:        %.2fx\n", physical == 0 ? 0.0 : (double)logical / physical);
+    printf("scan throughput:        %.1f MB/s\n", logical / seconds / 1024 / 1024);
+    printf("fingerprint cpu:        %.3f s\n", stats[DEDUP_CPU_US] / 1e6);
+
+    std::filesystem::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Degraded reads and repair of erasure coded files, on a cluster of local processes.
+ *
+ *   CONFIG_FILE=<config> ErasureCodingBench <dir> [nodes] [files] [file kb] [data shards] [parity shards]
+ *
+ * Every node is a process with the settings of config and its own cache under dir, there is no
+ * storage behind them. Files are written and flushed through node 0, which codes them across the
+ * other nodes. Node 0 and the last node are killed and every file is read back through node 1,
+ * rebuilt from the shards left. Once the shards lost with the last node are repaired, node 1 and
+ * parity - 1 more nodes are killed and every file is read back again through node 2.
+ */
+#include <fcntl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "local_cluster.h"
+#include "stats/falcon_stats.h"
+
+#define BENCH_BASE_PORT 56600
+/* give up waiting for repair after this long */
+#define BENCH_REPAIR_WAIT_S 60
+
+static void FillFile(uint32_t file, std::vector<char> &data)
+{
+    std::mt19937_64 engine(file + 1);
+    for (auto &c : data) {
+        c = (char)engine();
+    }
+}
+
+/* open the file on client, read it whole and compare it with what was written */
+static bool ReadBack(FalconIOClient &client, uint32_t file, uint64_t size)
+{
+    std::string path = "/erasure_coding/" + std::to_string(file);
+    uint64_t fd = UINT64_MAX;
+    if (client.OpenFile(file + 1, O_RDONLY, fd, size, path, false) != 0) {
+        return false;
+    }
+    std::vector<char> data(size);
+    std::vector<char> read(size);
+    FillFile(file, data);
+    uint64_t offset = 0;
+    while (offset < size) {
+        int chunk = std::min<uint64_t>(size - offset, 512 * 1024);
+        int ret = client.ReadFile(file + 1, O_RDONLY, read.data() + offset, fd, chunk, offset, path);
+        if (ret <= 0) {
+            break;
+        }
+        offset += ret;
+    }
+    client.CloseFile(fd, false, false, nullptr, 0, 0);
+    return offset == size && read == data;
+}
+
+/* read every file back through client, returns the files that failed */
+static uint32_t ReadAllBack(FalconIOClient &client, uint32_t files, uint64_t fileSize, const char *phase)
+{
+    uint32_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < files; ++f) {
+        if (!ReadBack(client, f, fileSize)) {
+            failed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-24s%u of %u files, %.1f MB/s\n",
+           phase,
+           files - failed,
+           files,
+           (double)files * fileSize / seconds / 1024 / 1024);
+    fflush(stdout);
+    return failed;
+}
+
+/* print what nodeId coded and rebuilt */
+static void Report(int nodeId)
+{
+    auto &stats = FalconStats::GetInstance().stats;
+    printf("node %d: encoded %lu bytes, rebuilt %lu bytes, repaired %lu shards\n",
+           nodeId,
+           (uint64_t)stats[EC_ENCODE],
+           (uint64_t)stats[EC_RECONSTRUCT],
+           (uint64_t)stats[EC_REPAIR]);
+}
+
+/* wait until the live nodes stop repairing, returns the shards they repaired */
+static uint64_t WaitForRepair(FalconIOClient &client)
+{
+    uint64_t repaired = 0;
+    int quiet = 0;
+    for (int i = 0; i < BENCH_REPAIR_WAIT_S && (repaired == 0 || quiet < 3); ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        /* stats of the cluster are what each node did since the last call */
+        std::vector<size_t> stats;
+        if (client.StatCluster(-1, stats, true) != 0 || stats.size() <= EC_REPAIR) {
+            continue;
+        }
+        repaired += stats[EC_REPAIR];
+        quiet = stats[EC_REPAIR] == 0 ? quiet + 1 : 0;
+    }
+    return repaired;
+}
+
+int main(int argc, char **argv)
+{
+    char *baseConfig = std::getenv("CONFIG_FILE");
+    if (argc < 2 || baseConfig == nullptr) {
+        fprintf(stderr,
+                "usage: CONFIG_FILE=<config> %s <dir> [nodes] [files] [file kb] [data shards] [parity shards]\n",
+                argv[0]);
+        return 1;
+    }
+    std::string dir = std::string(argv[1]) + "/falcon_erasure_coding_bench";
+    int nodes = argc > 2 ? atoi(argv[2]) : 8;
+    uint32_t files = argc > 3 ? atoi(argv[3]) : 32;
+    uint64_t fileSize = (argc > 4 ? atoll(argv[4]) : 1024) * 1024;
+    uint32_t dataShards = argc > 5 ? atoi(argv[5]) : 4;
+    uint32_t parityShards = argc > 6 ? atoi(argv[6]) : 2;
+    /* the writer, the node lost before repair, and the shards of every file on the rest */
+    if (dataShards == 0 || parityShards == 0 || nodes < (int)(dataShards + parityShards) + 2) {
+        fprintf(stderr, "at least data + parity + 2 nodes and one shard of each are needed\n");
+        return 1;
+    }
+
+    Json::Value root;
+    if (LocalCluster::LoadConfig(baseConfig, root) != 0) {
+        return 1;
+    }
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    LocalCluster cluster(dir, nodes, BENCH_BASE_PORT);
+    auto configure = [dataShards, parityShards](int, Json::Value &main) {
+        main["falcon_persist"] = false;
+        main["falcon_async"] = false;
+        main["falcon_is_inference"] = false;
+        main["falcon_to_local"] = false;
+        main["falcon_replicas"] = 1;
+        main["falcon_peer_fill"] = false;
+        main["falcon_ec_data_shards"] = dataShards;
+        main["falcon_ec_parity_shards"] = parityShards;
+        main["falcon_ec_repair_s"] = 1;
+    };
+    if (cluster.Start(root, configure, Report) != 0) {
+        return 1;
+    }
+    std::vector<std::shared_ptr<FalconIOClient>> clients = cluster.Clients();
+    if (clients.empty()) {
+        return 1;
+    }
+
+    std::vector<char> data(fileSize);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t f = 0; f < files; ++f) {
+        FillFile(f, data);
+        std::string path = "/erasure_coding/" + std::to_string(f);
+        uint64_t fd = UINT64_MAX;
+        if (clients[0]->OpenFile(f + 1, O_WRONLY | O_CREAT, fd, 0, path, false) != 0 ||
+            clients[0]->WriteFile(fd, data.data(), fileSize, 0) != 0 ||
+            clients[0]->CloseFile(fd, true, true, nullptr, 0, 0) != 0) {
+            fprintf(stderr, "write %s on node 0 failed\n", path.c_str());
+            return 1;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    /* the owner keeps its whole copy next to the shards */
+    printf("code:                   %u + %u shards, %.2fx the data on disk\n",
+           dataShards,
+           parityShards,
+           1 + (double)(dataShards + parityShards) / dataShards);
+    printf("write and encode:       %.1f MB/s\n", (double)files * fileSize / seconds / 1024 / 1024);
+
+    /* the only full copy is gone, and a shard of most files with it */
+    cluster.Kill(0);
+    cluster.Kill(nodes - 1);
+    uint32_t failed = ReadAllBack(*clients[1], files, fileSize, "degraded read:");
+
+    uint64_t repaired = WaitForRepair(*clients[1]);
+    printf("repaired:               %lu shards\n", repaired);
+
+    /* node 1 holds what it read in its cache */
+    for (uint32_t i = 0; i < parityShards; ++i) {
+        cluster.Kill(i == 0 ? 1 : 2 + i);
+    }
+    failed += ReadAllBack(*clients[2], files, fileSize, "read after repair:");
+    fflush(stdout);
+    cluster.Stop();
+    std::filesystem::remove_all(dir);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+/*
+ * Put and get throughput and latency of kv blocks, on a cluster of local processes.
+ *
+ *   CONFIG_FILE=<config> KvBench <dir> [nodes] [blocks] [block kb] [batch] [dram mb] [ssd mb]
+ *
+ * Every node is a process with the settings of config, a kv store of dram mb in memory and ssd mb
+ * under dir. Blocks are spread over the nodes round robin, a thread per node puts its blocks in
+ * batches and then gets them back, the same way FalconStore batches the blocks placed on a node.
+ * Blocks that do not fit in memory and on disk are evicted and counted as misses.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "local_cluster.h"
+#include "stats/falcon_stats.h"
+
+#define BENCH_BASE_PORT 56800
+
+static std::string BlockKey(uint32_t block) { return "bench/" + std::to_string(block); }
+
+static void FillBlock(uint32_t block, std::string &data)
+{
+    std::mt19937_64 engine(block + 1);
+    for (auto &c : data) {
+        c = (char)engine();
+    }
+}
+
+/* print what the kv store of nodeId did */
+static void ReportNode(int nodeId)
+{
+    auto &stats = FalconStats::GetInstance().stats;
+    printf("node %d: put %lu bytes, got %lu bytes, spilled %lu bytes, evicted %lu blocks\n",
+           nodeId,
+           (uint64_t)stats[KV_PUT],
+           (uint64_t)stats[KV_GET],
+           (uint64_t)stats[KV_SPILL],
+           (uint64_t)stats[KV_EVICT]);
+}
+
+struct PhaseResult
+{
+    std::vector<double> latencies;
+    uint64_t blocks = 0;
+    uint64_t misses = 0;
+    uint64_t failed = 0;
+};
+
+/* put or get the blocks of nodeId through client in batches, timing each batch */
+static void RunPhase(FalconIOClient &client,
+                     int nodeId,
+                     int nodes,
+                     uint32_t blocks,
+                     uint64_t blockSize,
+                     uint32_t batch,
+                     bool put,
+                     PhaseResult &result)
+{
+    std::vector<uint32_t> mine;
+    for (uint32_t b = nodeId; b < blocks; b += nodes) {
+        mine.push_back(b);
+    }
+    std::string data(blockSize, 0);
+    for (size_t start = 0; start < mine.size(); start += batch) {
+        size_t end = std::min(mine.size(), start + batch);
+        std::vector<std::string> keys;
+        std::vector<uint64_t> sizes;
+        butil::IOBuf buf;
+        for (size_t i = start; i < end; ++i) {
+            keys.push_back(BlockKey(mine[i]));
+            if (put) {
+                FillBlock(mine[i], data);
+                sizes.push_back(blockSize);
+                buf.append(data.data(), data.size());
+            }
+        }
+        std::vector<int64_t> results;
+        auto begin = std::chrono::steady_clock::now();
+        int ret = put ? client.KvPut(keys, sizes, 0, buf, results) : client.KvGet(keys, results, buf);
+        result.latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+        if (ret != 0 || results.size() != keys.size()) {
+            result.failed += keys.size();
+            continue;
+        }
+        result.blocks += keys.size();
+        for (size_t i = start; i < end; ++i) {
+            int64_t r = results[i - start];
+            if (put) {
+                result.failed += r != 0;
+                continue;
+            }
+            if (r < 0) {
+                result.misses += r == -ENOENT;
+                result.failed += r != -ENOENT;
+                continue;
+            }
+            /* blocks come back in the order of their keys */
+            FillBlock(mine[i], data);
+            std::string read(r, 0);
+            buf.cutn(read.data(), r);
+            result.failed += read != data;
+        }
+    }
+}
+
+static void Report(const char *phase, std::vector<PhaseResult> &results, uint64_t blockSize, double seconds)
+{
+    PhaseResult all;
+    for (auto &r : results) {
+        all.latencies.insert(all.latencies.end(), r.latencies.begin(), r.latencies.end());
+        all.blocks += r.blocks;
+        all.misses += r.misses;
+        all.failed += r.failed;
+    }
+    std::sort(all.latencies.begin(), all.latencies.end());
+    auto percentile = [&all](double p) {
+        return all.latencies.empty() ? 0 : all.latencies[(size_t)(p * (all.latencies.size() - 1))] * 1000;
+    };
+    uint64_t moved = all.blocks - all.misses;
+    printf("%-6s%8.1f MB/s %10.0f blocks/s   batch p50 %7.2f ms  p99 %7.2f ms   missed %lu  failed %lu\n",
+           phase,
+           (double)moved * blockSize / seconds / 1024 / 1024,
+           moved / seconds,
+           percentile(0.5),
+           percentile(0.99),
+           all.misses,
+           all.failed);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    char *baseConfig = std::getenv("CONFIG_FILE");
+    if (argc < 2 || baseConfig == nullptr) {
+        fprintf(stderr,
+                "usage: CONFIG_FILE=<config> %s <dir> [nodes] [blocks] [block kb] [batch] [dram mb] [ssd mb]\n",
+                argv[0]);
+        return 1;
+    }
+    std::string dir = std::string(argv[1]) + "/falcon_kv_bench";
+    int nodes = argc > 2 ? atoi(argv[2]) : 4;
+    uint32_t blocks = argc > 3 ? atoi(argv[3]) : 4096;
+    uint64_t blockKb = argc > 4 ? atoll(argv[4]) : 256;
+    uint32_t batch = argc > 5 ? atoi(argv[5]) : KV_BATCH_BLOCKS;
+    uint64_t dramMb = argc > 6 ? atoll(argv[6]) : 1024;
+    uint64_t ssdMb = argc > 7 ? atoll(argv[7]) : 0;
+    uint64_t blockSize = blockKb * 1024;
+    if (nodes <= 0 || blocks == 0 || blockKb == 0 || batch == 0) {
+        fprintf(stderr, "nodes, blocks, block kb and batch must be positive\n");
+        return 1;
+    }
+
+    Json::Value root;
+    if (LocalCluster::LoadConfig(baseConfig, root) != 0) {
+        return 1;
+    }
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    LocalCluster cluster(dir, nodes, BENCH_BASE_PORT);
+    auto configure = [blockKb, dramMb, ssdMb](int, Json::Value &main) {
+        main["falcon_persist"] = false;
+        main["falcon_async"] = false;
+        main["falcon_peer_fill"] = false;
+        main["falcon_kv_block_kb"] = (Json::UInt64)blockKb;
+        main["falcon_kv_dram_mb"] = (Json::UInt64)dramMb;
+        main["falcon_kv_ssd_mb"] = (Json::UInt64)ssdMb;
+        main["falcon_kv_ttl_s"] = 0;
+    };
+    if (cluster.Start(root, configure, ReportNode) != 0) {
+        return 1;
+    }
+    std::vector<std::shared_ptr<FalconIOClient>> clients = cluster.Clients();
+    if (clients.empty()) {
+        return 1;
+    }
+
+    printf("%d nodes, %u blocks of %lu KB in batches of %u, %lu MB memory and %lu MB disk per node\n",
+           nodes,
+           blocks,
+           blockKb,
+           batch,
+           dramMb,
+           ssdMb);
+    uint64_t failed = 0;
+    for (bool put : {true, false}) {
+        std::vector<PhaseResult> results(nodes);
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < nodes; ++i) {
+            threads.emplace_back(
+                RunPhase, std::ref(*clients[i]), i, nodes, blocks, blockSize, batch, put, std::ref(results[i]));
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Report(put ? "put:" : "get:", results, blockSize, seconds);
+        for (auto &r : results) {
+            failed += r.failed;
+        }
+    }
+
+    cluster.Stop();
+    std::filesystem::remove_all(dir);
+    return failed == 0 ? 0 : 1;
+}
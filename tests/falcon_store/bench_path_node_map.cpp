@@ -0,0 +1,75 @@
+/*
+ * Parent directory lookups per second from many threads, PathNodeMap against the mutex guarded
+ * unordered_map it replaced.
+ *
+ *   PathNodeMapBench [threads] [lookups per thread] [dirs]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "util/path_node_map.h"
+
+/* ns per lookup of resolve over paths from threadNum threads */
+static double Run(int threadNum,
+                  int loops,
+                  const std::vector<std::string> &paths,
+                  const std::function<int(const std::string &)> &resolve)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadNum; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < loops; ++i) {
+                resolve(paths[(i + t) % paths.size()]);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double)loops;
+}
+
+int main(int argc, char **argv)
+{
+    int threadNum = argc > 1 ? atoi(argv[1]) : std::max(4u, std::thread::hardware_concurrency());
+    int loops = argc > 2 ? atoi(argv[2]) : 200000;
+    int dirNum = argc > 3 ? atoi(argv[3]) : 256;
+    if (threadNum <= 0 || loops <= 0 || dirNum <= 0) {
+        fprintf(stderr, "usage: %s [threads] [lookups per thread] [dirs]\n", argv[0]);
+        return 1;
+    }
+    std::vector<std::string> paths;
+    for (int i = 0; i < dirNum; ++i) {
+        paths.push_back("/ckpt/dir" + std::to_string(i) + "/file" + std::to_string(i));
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, int> nodeHash;
+    double mutexNs = Run(threadNum, loops, paths, [&](const std::string &path) {
+        std::string parent(GetParentPathView(path));
+        std::unique_lock<std::mutex> lock(mutex);
+        if (nodeHash.count(parent) == 0) {
+            nodeHash[parent] = 1;
+        }
+        return nodeHash[parent];
+    });
+    PathNodeMap nodeMap;
+    double mapNs = Run(threadNum, loops, paths, [&](const std::string &path) {
+        return nodeMap.GetOrAlloc(GetParentPathView(path), [](std::string_view) { return 1; });
+    });
+
+    printf("threads:                %d\n", threadNum);
+    printf("mutex map lookup:       %.1f ns\n", mutexNs);
+    printf("PathNodeMap lookup:     %.1f ns\n", mapNs);
+    return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * Storage reads saved by filling cache misses from other nodes, on a cluster of local processes.
+ *
+ *   CONFIG_FILE=<config> PeerFillBench <dir> [nodes] [files] [file kb] [peer fill 0|1]
+ *
+ * Every node is a process with the settings of config, its own cache under dir and the posix
+ * storage backend under dir shared by all of them. Files are written and flushed through node 0,
+ * then opened for update on every other node as if they had moved there, and every node reports
+ * the bytes it read from storage and the bytes it got from other nodes.
+ */
+#include <fcntl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "local_cluster.h"
+#include "stats/falcon_stats.h"
+
+#define BENCH_BASE_PORT 56200
+
+static void FillFile(uint32_t file, std::vector<char> &data)
+{
+    std::mt19937_64 engine(file + 1);
+    for (auto &c : data) {
+        c = (char)engine();
+    }
+}
+
+/* read the whole file open at fd and compare it with what was written */
+static bool ReadBack(FalconIOClient &client, uint32_t file, uint64_t fd, const std::string &path, uint64_t size)
+{
+    std::vector<char> data(size);
+    std::vector<char> read(size);
+    FillFile(file, data);
+    uint64_t offset = 0;
+    while (offset < size) {
+        int chunk = std::min<uint64_t>(size - offset, 512 * 1024);
+        int ret = client.ReadFile(file + 1, O_RDWR, read.data() + offset, fd, chunk, offset, path);
+        if (ret <= 0) {
+            return false;
+        }
+        offset += ret;
+    }
+    return read == data;
+}
+
+/* print what nodeId read from where */
+static void Report(int nodeId)
+{
+    auto &stats = FalconStats::GetInstance().stats;
+    printf("node %d: storage read %lu bytes, filled from peers %lu bytes, peer misses %lu\n",
+           nodeId,
+           (uint64_t)stats[OBJ_GET],
+           (uint64_t)stats[PEER_FILL],
+           (uint64_t)stats[PEER_FILL_MISS]);
+}
+
+int main(int argc, char **argv)
+{
+    char *baseConfig = std::getenv("CONFIG_FILE");
+    if (argc < 2 || baseConfig == nullptr) {
+        fprintf(stderr, "usage: CONFIG_FILE=<config> %s <dir> [nodes] [files] [file kb] [peer fill 0|1]\n", argv[0]);
+        return 1;
+    }
+    std::string dir = std::string(argv[1]) + "/falcon_peer_fill_bench";
+    int nodes = argc > 2 ? atoi(argv[2]) : 3;
+    uint32_t files = argc > 3 ? atoi(argv[3]) : 64;
+    uint64_t fileSize = (argc > 4 ? atoll(argv[4]) : 1024) * 1024;
+    bool peerFill = argc > 5 ? atoi(argv[5]) != 0 : true;
+    if (nodes < 2) {
+        fprintf(stderr, "at least 2 nodes are needed\n");
+        return 1;
+    }
+
+    Json::Value root;
+    if (LocalCluster::LoadConfig(baseConfig, root) != 0) {
+        return 1;
+    }
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir + "/storage");
+
+    LocalCluster cluster(dir, nodes, BENCH_BASE_PORT);
+    auto configure = [&dir, peerFill](int, Json::Value &main) {
+        main["falcon_persist"] = true;
+        main["falcon_async"] = false;
+        main["falcon_is_inference"] = false;
+        main["falcon_to_local"] = false;
+        main["falcon_replicas"] = 1;
+        main["falcon_storage_backend"] = "posix";
+        main["falcon_storage_path"] = dir + "/storage";
+        main["falcon_peer_fill"] = peerFill;
+        /* peer copies are matched against the checksum sidecars */
+        main["falcon_checksum"] = true;
+    };
+    if (cluster.Start(root, configure, Report) != 0) {
+        return 1;
+    }
+    std::vector<std::shared_ptr<FalconIOClient>> clients = cluster.Clients();
+    if (clients.empty()) {
+        return 1;
+    }
+
+    std::vector<char> data(fileSize);
+    for (uint32_t f = 0; f < files; ++f) {
+        FillFile(f, data);
+        std::string path = "/peer_fill/" + std::to_string(f);
+        uint64_t fd = UINT64_MAX;
+        if (clients[0]->OpenFile(f + 1, O_WRONLY | O_CREAT, fd, 0, path, false) != 0 ||
+            clients[0]->WriteFile(fd, data.data(), fileSize, 0) != 0 ||
+            clients[0]->CloseFile(fd, true, true, nullptr, 0, 0) != 0) {
+            fprintf(stderr, "write %s on node 0 failed\n", path.c_str());
+            return 1;
+        }
+    }
+
+    uint32_t failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i < nodes; ++i) {
+        for (uint32_t f = 0; f < files; ++f) {
+            std::string path = "/peer_fill/" + std::to_string(f);
+            uint64_t fd = UINT64_MAX;
+            if (clients[i]->OpenFile(f + 1, O_RDWR, fd, fileSize, path, false) != 0) {
+                failed++;
+                continue;
+            }
+            if (!ReadBack(*clients[i], f, fd, path, fileSize)) {
+                failed++;
+            }
+            clients[i]->CloseFile(fd, false, false, nullptr, 0, 0);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("peer fill:              %s\n", peerFill ? "on" : "off");
+    printf("misses filled:          %u of %u\n", (nodes - 1) * files - failed, (nodes - 1) * files);
+    printf("fill throughput:        %.1f MB/s\n", (double)(nodes - 1) * files * fileSize / seconds / 1024 / 1024);
+    fflush(stdout);
+    cluster.Stop();
+    std::filesystem::remove_all(dir);
+    return failed == 0 ? 0 : 1;
+}
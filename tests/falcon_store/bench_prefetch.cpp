@@ -0,0 +1,171 @@
+/*
+ * Read latency of shuffled epochs over a dataset on slow storage, with and without prefetching.
+ *
+ *   CONFIG_FILE=<config> PrefetchBench <dir> [files] [file kb] [epochs] [compute us] [distance]
+ *
+ * One node with the settings of config and the mock storage backend, which adds
+ * falcon_mock_storage_latency_us to every request. Every epoch reads all files in a new random
+ * order and spends compute us on each, like a training step, and the cache is dropped between
+ * epochs so every epoch reads from storage. With distance 0 nothing is prefetched, otherwise the
+ * order of every epoch is registered before it starts.
+ */
+#include <fcntl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+#include "brpc/brpc_server.h"
+#include "falcon_store/falcon_store.h"
+#include "falcon_store/prefetcher.h"
+#include "init/falcon_init.h"
+#include "stats/falcon_stats.h"
+#include "storage/mock_storage.h"
+
+#define BENCH_PORT 56300
+
+static std::string Path(uint32_t file) { return "/prefetch/" + std::to_string(file); }
+
+/* write the config next to the cache, the base config with a single mock node */
+static std::string WriteConfig(Json::Value root, const std::string &dir, uint32_t distance)
+{
+    Json::Value &main = root["main"];
+    Json::Value view(Json::arrayValue);
+    view.append("127.0.0.1:" + std::to_string(BENCH_PORT));
+    std::string cacheRoot = dir + "/node0";
+    main["falcon_node_id"] = 0;
+    main["falcon_cluster_view"] = view;
+    main["falcon_cache_root"] = cacheRoot;
+    main["falcon_log_dir"] = cacheRoot;
+    main["falcon_persist"] = true;
+    main["falcon_is_inference"] = false;
+    main["falcon_replicas"] = 1;
+    main["falcon_use_prometheus"] = false;
+    main["falcon_storage_backend"] = "mock";
+    main["falcon_prefetch_distance"] = distance;
+
+    std::filesystem::create_directories(cacheRoot);
+    for (uint32_t i = 0; i < main["falcon_dir_num"].asUInt(); ++i) {
+        std::filesystem::create_directories(cacheRoot + "/" + std::to_string(i));
+    }
+    std::string path = cacheRoot + ".json";
+    std::ofstream(path) << root;
+    return path;
+}
+
+static double Percentile(std::vector<double> &sorted, double p)
+{
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+}
+
+int main(int argc, char **argv)
+{
+    char *baseConfig = std::getenv("CONFIG_FILE");
+    if (argc < 2 || baseConfig == nullptr) {
+        fprintf(stderr,
+                "usage: CONFIG_FILE=<config> %s <dir> [files] [file kb] [epochs] [compute us] [distance]\n",
+                argv[0]);
+        return 1;
+    }
+    std::string dir = std::string(argv[1]) + "/falcon_prefetch_bench";
+    uint32_t files = argc > 2 ? atoi(argv[2]) : 512;
+    uint64_t fileSize = (argc > 3 ? atoll(argv[3]) : 256) * 1024;
+    uint32_t epochs = argc > 4 ? atoi(argv[4]) : 3;
+    uint32_t computeUs = argc > 5 ? atoi(argv[5]) : 2000;
+    uint32_t distance = argc > 6 ? atoi(argv[6]) : 16;
+
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::ifstream in(baseConfig);
+    std::string errs;
+    if (!Json::parseFromStream(builder, in, &root, &errs)) {
+        fprintf(stderr, "parse %s failed: %s\n", baseConfig, errs.c_str());
+        return 1;
+    }
+    std::filesystem::remove_all(dir);
+    setenv("CONFIG_FILE", WriteConfig(root, dir, distance).c_str(), 1);
+    if (GetInit().Init() != 0) {
+        return 1;
+    }
+    falcon::brpc_io::RemoteIOServer &server = falcon::brpc_io::RemoteIOServer::GetInstance();
+    server.endPoint = "127.0.0.1:" + std::to_string(BENCH_PORT);
+    std::thread brpcServerThread(&falcon::brpc_io::RemoteIOServer::Run, &server);
+    {
+        std::unique_lock<std::mutex> lk(server.mutexStart);
+        server.cvStart.wait(lk, [&server]() { return server.isStarted; });
+    }
+    brpcServerThread.detach();
+    server.SetReadyFlag();
+    if (FalconStore::GetInstance()->GetInitStatus() != 0) {
+        fprintf(stderr, "init failed, see the logs under %s\n", dir.c_str());
+        return 1;
+    }
+
+    std::vector<char> data(fileSize, 'x');
+    std::vector<PrefetchEntry> dataset;
+    for (uint32_t f = 0; f < files; ++f) {
+        /* objects are keyed by the path without its leading slash */
+        if (MockStorage::GetInstance()->PutBuffer(Path(f).substr(1), data.data(), fileSize, 0) != (ssize_t)fileSize) {
+            fprintf(stderr, "put %s failed\n", Path(f).c_str());
+            return 1;
+        }
+        dataset.push_back({f + 1, Path(f), fileSize});
+    }
+
+    std::vector<double> latencies;
+    uint32_t failed = 0;
+    std::mt19937_64 engine(1);
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t epoch = 0; epoch < epochs; ++epoch) {
+        for (auto &entry : dataset) {
+            FalconStore::GetInstance()->DropCachedFile(entry.inodeId);
+        }
+        std::vector<PrefetchEntry> order = dataset;
+        std::shuffle(order.begin(), order.end(), engine);
+        uint64_t streamId = Prefetcher::GetInstance().Register(order);
+
+        for (auto &entry : order) {
+            auto readStart = std::chrono::steady_clock::now();
+            OpenInstance openInstance;
+            openInstance.inodeId = entry.inodeId;
+            openInstance.path = entry.path;
+            openInstance.oflags = O_RDONLY;
+            openInstance.originalSize = fileSize;
+            openInstance.currentSize = fileSize;
+            openInstance.readBuffer = std::shared_ptr<char>((char *)malloc(fileSize), free);
+            openInstance.readBufferSize = fileSize;
+            if (FalconStore::GetInstance()->ReadSmallFiles(&openInstance) != 0) {
+                failed++;
+            }
+            latencies.push_back(
+                std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - readStart).count());
+            std::this_thread::sleep_for(std::chrono::microseconds(computeUs));
+        }
+        Prefetcher::GetInstance().Unregister(streamId);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto &stats = FalconStats::GetInstance().stats;
+    printf("prefetch distance:      %u\n", distance);
+    printf("reads:                  %zu, %u failed\n", latencies.size(), failed);
+    printf("read latency p50:       %.0f us\n", Percentile(latencies, 0.5));
+    printf("read latency p99:       %.0f us\n", Percentile(latencies, 0.99));
+    printf("read latency p999:      %.0f us\n", Percentile(latencies, 0.999));
+    printf("epoch time:             %.2f s\n", seconds / epochs);
+    printf("prefetched:             %lu bytes, %lu hits, %lu late\n",
+           (uint64_t)stats[PREFETCH],
+           (uint64_t)stats[PREFETCH_HIT],
+           (uint64_t)stats[PREFETCH_LATE]);
+    fflush(stdout);
+    std::filesystem::remove_all(dir);
+    /* brpc threads are not joined */
+    _exit(failed == 0 ? 0 : 1);
+}
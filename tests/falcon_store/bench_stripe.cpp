@@ -0,0 +1,122 @@
+/*
+ * Single file bandwidth with the file striped over a growing number of nodes.
+ *
+ *   CONFIG_FILE=<config> StripeBench <dir> [nodes] [file mb] [unit kb] [io kb] [stripe 0|1]
+ *
+ * Every node is a process with the settings of config and its own cache under dir, this process
+ * is node 0 and the client. One file is written through node 0 in io kb writes, flushed, and read
+ * back in io kb reads; with stripe 1 it is striped over all nodes, with 0 it is cached on one.
+ * Run it for 1, 2, 4, ... nodes to see how the bandwidth of one file scales with the cluster.
+ */
+#include <fcntl.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "local_cluster.h"
+
+#define BENCH_BASE_PORT 56400
+#define BENCH_INODE_ID (1ULL << 12)
+
+int main(int argc, char **argv)
+{
+    char *baseConfig = std::getenv("CONFIG_FILE");
+    if (argc < 2 || baseConfig == nullptr) {
+        fprintf(stderr,
+                "usage: CONFIG_FILE=<config> %s <dir> [nodes] [file mb] [unit kb] [io kb] [stripe 0|1]\n",
+                argv[0]);
+        return 1;
+    }
+    std::string dir = std::string(argv[1]) + "/falcon_stripe_bench";
+    int nodes = argc > 2 ? atoi(argv[2]) : 4;
+    uint64_t fileSize = (argc > 3 ? atoll(argv[3]) : 1024) * 1024 * 1024;
+    uint32_t unitKb = argc > 4 ? atoi(argv[4]) : 4096;
+    uint64_t ioSize = (argc > 5 ? atoll(argv[5]) : 16384) * 1024;
+    bool stripe = argc > 6 ? atoi(argv[6]) != 0 : true;
+    if (nodes < 1 || ioSize == 0) {
+        fprintf(stderr, "at least 1 node and a non empty io size are needed\n");
+        return 1;
+    }
+    uint32_t width = stripe ? nodes : 0;
+
+    Json::Value root;
+    if (LocalCluster::LoadConfig(baseConfig, root) != 0) {
+        return 1;
+    }
+    std::filesystem::remove_all(dir);
+
+    LocalCluster cluster(dir, nodes, BENCH_BASE_PORT);
+    auto configure = [width, unitKb](int, Json::Value &main) {
+        main["falcon_persist"] = false;
+        main["falcon_is_inference"] = false;
+        main["falcon_to_local"] = false;
+        main["falcon_replicas"] = 1;
+        main["falcon_stripe_width"] = width;
+        main["falcon_stripe_unit_kb"] = unitKb;
+        main["falcon_stripe_dirs"] = Json::Value(Json::arrayValue);
+    };
+    /* this process is node 0 */
+    if (cluster.Start(root, configure, nullptr, 1) != 0) {
+        return 1;
+    }
+    if (cluster.StartNode(0, cluster.WriteNodeConfig(root, 0, configure)) != 0) {
+        fprintf(stderr, "init failed, see the logs under %s\n", dir.c_str());
+        cluster.Stop();
+        _exit(1);
+    }
+
+    FalconStore *store = FalconStore::GetInstance();
+    std::vector<char> data(ioSize);
+    for (uint64_t i = 0; i < ioSize; ++i) {
+        data[i] = (char)(i * 31 + 7);
+    }
+    int failed = 0;
+
+    OpenInstance writer;
+    writer.inodeId = BENCH_INODE_ID;
+    writer.path = "/stripe/file";
+    writer.oflags = O_WRONLY | O_CREAT;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t offset = 0; offset < fileSize && failed == 0; offset += ioSize) {
+        writer.writeCnt++;
+        failed += store->WriteFile(&writer, data.data(), std::min(ioSize, fileSize - offset), offset) != 0;
+    }
+    failed += store->CloseTmpFiles(&writer, true, true) != 0;
+    failed += store->CloseTmpFiles(&writer, false, false) != 0;
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    /* open it again as metadata would, with the node id recorded on close */
+    OpenInstance reader;
+    reader.inodeId = BENCH_INODE_ID;
+    reader.path = writer.path;
+    reader.oflags = O_RDONLY;
+    reader.nodeId = writer.nodeId;
+    reader.originalSize = fileSize;
+    reader.currentSize = fileSize;
+    std::vector<char> buf(ioSize);
+    start = std::chrono::steady_clock::now();
+    for (uint64_t offset = 0; offset < fileSize && failed == 0; offset += ioSize) {
+        uint64_t size = std::min(ioSize, fileSize - offset);
+        int ret = store->ReadFile(&reader, buf.data(), size, offset);
+        failed += ret != (int)size || memcmp(buf.data(), data.data(), size) != 0;
+    }
+    store->CloseTmpFiles(&reader, false, false);
+    double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string layout = StripeLayout::IsStriped(writer.nodeId)
+                             ? std::to_string(width) + " stripes of " + std::to_string(unitKb) + " KB"
+                             : "node " + std::to_string(writer.nodeId);
+    printf("nodes:                  %d\n", nodes);
+    printf("layout:                 %s\n", layout.c_str());
+    printf("write throughput:       %.1f MB/s\n", fileSize / writeSeconds / 1024 / 1024);
+    printf("read throughput:        %.1f MB/s\n", fileSize / readSeconds / 1024 / 1024);
+    printf("result:                 %s\n", failed == 0 ? "ok" : "failed");
+    fflush(stdout);
+    cluster.Stop();
+    std::filesystem::remove_all(dir);
+    /* brpc threads are not joined */
+    _exit(failed == 0 ? 0 : 1);
+}
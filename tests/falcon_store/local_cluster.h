@@ -0,0 +1,231 @@
+#pragma once
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+#include "brpc/brpc_server.h"
+#include "connection/falcon_io_client.h"
+#include "falcon_store/falcon_store.h"
+#include "init/falcon_init.h"
+
+/*
+ * Store nodes as processes of this machine, for tests and benches that need a cluster. Node i
+ * serves on 127.0.0.1:basePort + i with the settings of a base config, its own cache under dir
+ * and whatever the caller sets on top. Nodes are forked, so a cluster is started before this
+ * process starts any brpc thread of its own.
+ */
+class LocalCluster {
+  public:
+    /* set what nodeId needs on the main section of its config */
+    using Configure = std::function<void(int nodeId, Json::Value &main)>;
+    /* called in nodeId once it is told to stop, e.g. to print its stats */
+    using Report = std::function<void(int nodeId)>;
+
+    LocalCluster(std::string initDir, int initNodes, int initBasePort)
+        : dir(std::move(initDir)),
+          nodes(initNodes),
+          basePort(initBasePort),
+          children(initNodes, -1),
+          commands(initNodes, -1)
+    {
+    }
+    ~LocalCluster() { Stop(); }
+
+    std::string Endpoint(int nodeId) const { return "127.0.0.1:" + std::to_string(basePort + nodeId); }
+
+    /* parse the json config at file into root, 0 or 1 */
+    static int LoadConfig(const char *file, Json::Value &root)
+    {
+        Json::CharReaderBuilder builder;
+        std::ifstream in(file);
+        std::string errs;
+        if (!Json::parseFromStream(builder, in, &root, &errs)) {
+            fprintf(stderr, "parse %s failed: %s\n", file, errs.c_str());
+            return 1;
+        }
+        return 0;
+    }
+
+    /* write the config of nodeId next to its cache, the base config with the cluster and paths replaced */
+    std::string WriteNodeConfig(Json::Value root, int nodeId, const Configure &configure) const
+    {
+        Json::Value &main = root["main"];
+        Json::Value view(Json::arrayValue);
+        for (int i = 0; i < nodes; ++i) {
+            view.append(Endpoint(i));
+        }
+        std::string cacheRoot = dir + "/node" + std::to_string(nodeId);
+        main["falcon_node_id"] = nodeId;
+        main["falcon_cluster_view"] = view;
+        main["falcon_cache_root"] = cacheRoot;
+        main["falcon_log_dir"] = cacheRoot;
+        main["falcon_use_prometheus"] = false;
+        if (configure) {
+            configure(nodeId, main);
+        }
+
+        std::filesystem::create_directories(cacheRoot);
+        for (uint32_t i = 0; i < main["falcon_dir_num"].asUInt(); ++i) {
+            std::filesystem::create_directories(cacheRoot + "/" + std::to_string(i));
+        }
+        std::string path = cacheRoot + ".json";
+        std::ofstream(path) << root;
+        return path;
+    }
+
+    /* start the store and brpc server of this process as the node of config, 0 or 1 */
+    int StartNode(int nodeId, const std::string &config) const
+    {
+        setenv("CONFIG_FILE", config.c_str(), 1);
+        if (GetInit().Init() != 0) {
+            return 1;
+        }
+        falcon::brpc_io::RemoteIOServer &server = falcon::brpc_io::RemoteIOServer::GetInstance();
+        server.endPoint = Endpoint(nodeId);
+        std::thread brpcServerThread(&falcon::brpc_io::RemoteIOServer::Run, &server);
+        {
+            std::unique_lock<std::mutex> lk(server.mutexStart);
+            server.cvStart.wait(lk, [&server]() { return server.isStarted; });
+        }
+        brpcServerThread.detach();
+        server.SetReadyFlag();
+        return FalconStore::GetInstance()->GetInitStatus() != 0 ? 1 : 0;
+    }
+
+    /*
+     * Fork nodes first to the last and wait until all of them serve, 0 or 1. Nodes before first
+     * are left to this process, e.g. to start one with StartNode.
+     */
+    int Start(const Json::Value &root, const Configure &configure, const Report &report = nullptr, int first = 0)
+    {
+        int ready[2];
+        if (pipe(ready) != 0) {
+            perror("pipe");
+            return 1;
+        }
+        for (int i = first; i < nodes; ++i) {
+            std::string config = WriteNodeConfig(root, i, configure);
+            int command[2];
+            if (pipe(command) != 0) {
+                perror("pipe");
+                close(ready[0]);
+                close(ready[1]);
+                return 1;
+            }
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(ready[0]);
+                close(command[1]);
+                for (int fd : commands) {
+                    if (fd >= 0) {
+                        close(fd);
+                    }
+                }
+                _exit(RunNode(i, config, report, ready[1], command[0]));
+            }
+            close(command[0]);
+            children[i] = pid;
+            commands[i] = command[1];
+        }
+        close(ready[1]);
+        int ret = 0;
+        for (int i = first; i < nodes && ret == 0; ++i) {
+            char c;
+            if (read(ready[0], &c, 1) != 1) {
+                fprintf(stderr, "a node failed to start, see the logs under %s\n", dir.c_str());
+                ret = 1;
+            }
+        }
+        close(ready[0]);
+        if (ret != 0) {
+            for (int i = 0; i < nodes; ++i) {
+                Kill(i);
+            }
+        }
+        return ret;
+    }
+
+    /* a client of every node, empty if one can not be reached */
+    std::vector<std::shared_ptr<FalconIOClient>> Clients() const
+    {
+        std::vector<std::shared_ptr<FalconIOClient>> clients;
+        for (int i = 0; i < nodes; ++i) {
+            auto channel = std::make_shared<brpc::Channel>();
+            brpc::ChannelOptions options;
+            if (channel->Init(Endpoint(i).c_str(), &options) != 0) {
+                fprintf(stderr, "connect to node %d failed\n", i);
+                return {};
+            }
+            clients.push_back(std::make_shared<FalconIOClient>(channel));
+        }
+        return clients;
+    }
+
+    /* take nodeId down at once, as a crash would */
+    void Kill(int nodeId)
+    {
+        if (children[nodeId] < 0) {
+            return;
+        }
+        kill(children[nodeId], SIGKILL);
+        waitpid(children[nodeId], nullptr, 0);
+        close(commands[nodeId]);
+        children[nodeId] = -1;
+        commands[nodeId] = -1;
+    }
+
+    /* tell the nodes left to stop, and wait until they have reported */
+    void Stop()
+    {
+        for (int &fd : commands) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        for (pid_t &pid : children) {
+            if (pid >= 0) {
+                waitpid(pid, nullptr, 0);
+                pid = -1;
+            }
+        }
+    }
+
+  private:
+    /* serve as nodeId until commands is closed */
+    int RunNode(int nodeId, const std::string &config, const Report &report, int ready, int command) const
+    {
+        if (StartNode(nodeId, config) != 0) {
+            return 1;
+        }
+        char c = 'r';
+        if (write(ready, &c, 1) != 1) {
+            return 1;
+        }
+        close(ready);
+        while (read(command, &c, 1) > 0) {
+        }
+        if (report) {
+            report(nodeId);
+        }
+        fflush(stdout);
+        return 0;
+    }
+
+    std::string dir;
+    int nodes;
+    int basePort;
+    std::vector<pid_t> children;
+    std::vector<int> commands;
+};
@@ -0,0 +1,190 @@
+#include "test_checksum_storage.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <random>
+
+#include "stats/falcon_stats.h"
+#include "util/crc32c.h"
+
+std::string ChecksumStorageUT::scratchPath;
+
+static std::string Noise(size_t size, uint64_t seed = 42)
+{
+    std::mt19937_64 engine(seed);
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (char)engine();
+    }
+    return data;
+}
+
+TEST_F(ChecksumStorageUT, Crc32cKnownValues)
+{
+    EXPECT_EQ(Crc32c("123456789", 9), 0xe3069283U);
+    std::string zeros(32, 0);
+    EXPECT_EQ(Crc32c(zeros.data(), zeros.size()), 0x8a9136aaU);
+    /* chained over pieces */
+    std::string data = Noise(1000);
+    EXPECT_EQ(Crc32c(data.data() + 3, data.size() - 3, Crc32c(data.data(), 3)), Crc32c(data.data(), data.size()));
+}
+
+TEST_F(ChecksumStorageUT, ChecksumsRoundTrip)
+{
+    std::string data = Noise(3 * CHECKSUM_MIN_BLOCK_SIZE + 5);
+    BlockChecksums checksums = BlockChecksums::OfBuffer(data.data(), data.size());
+    EXPECT_EQ(checksums.Blocks(), 4);
+    EXPECT_EQ(checksums.BlockLength(3), 5);
+
+    BlockChecksums parsed;
+    ASSERT_TRUE(BlockChecksums::Parse(checksums.Serialize(), parsed));
+    EXPECT_EQ(parsed, checksums);
+    std::string truncated = checksums.Serialize();
+    truncated.pop_back();
+    EXPECT_FALSE(BlockChecksums::Parse(truncated, parsed));
+
+    /* large files get larger blocks instead of more of them */
+    BlockChecksums large(1000UL * CHECKSUM_MIN_BLOCK_SIZE);
+    EXPECT_EQ(large.BlockSize(), 2 * CHECKSUM_MIN_BLOCK_SIZE);
+    EXPECT_LE(large.Blocks(), CHECKSUM_MAX_BLOCKS);
+    EXPECT_EQ(BlockChecksums(0).Blocks(), 0);
+
+    /* only blocks wholly in a range are checked */
+    data[CHECKSUM_MIN_BLOCK_SIZE + 10] ^= 1;
+    EXPECT_EQ(checksums.Mismatches(data.data(), 0, data.size()), std::vector<size_t>{1});
+    EXPECT_TRUE(checksums.Mismatches(data.data() + 1, 1, CHECKSUM_MIN_BLOCK_SIZE * 2 - 2).empty());
+}
+
+TEST_F(ChecksumStorageUT, ChangedBlocks)
+{
+    std::string data = Noise(4 * CHECKSUM_MIN_BLOCK_SIZE + 5);
+    BlockChecksums older = BlockChecksums::OfBuffer(data.data(), data.size());
+    EXPECT_TRUE(older.Changes(older).empty());
+
+    /* neighbouring blocks make one range */
+    data[10] ^= 1;
+    data[CHECKSUM_MIN_BLOCK_SIZE + 10] ^= 1;
+    data[3 * CHECKSUM_MIN_BLOCK_SIZE] ^= 1;
+    BlockChecksums newer = BlockChecksums::OfBuffer(data.data(), data.size());
+    using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+    EXPECT_EQ(newer.Changes(older),
+              (Ranges{{0, 2 * CHECKSUM_MIN_BLOCK_SIZE}, {3 * CHECKSUM_MIN_BLOCK_SIZE, CHECKSUM_MIN_BLOCK_SIZE}}));
+    EXPECT_NE(newer.Fingerprint(), older.Fingerprint());
+
+    /* a last block that grew is changed, blocks past the end of older are new */
+    data.append(CHECKSUM_MIN_BLOCK_SIZE, 'x');
+    BlockChecksums longer = BlockChecksums::OfBuffer(data.data(), data.size());
+    EXPECT_EQ(longer.Changes(newer), (Ranges{{4 * CHECKSUM_MIN_BLOCK_SIZE, CHECKSUM_MIN_BLOCK_SIZE + 5}}));
+    EXPECT_EQ(longer.Fingerprint(), BlockChecksums::OfBuffer(data.data(), data.size()).Fingerprint());
+}
+
+TEST_F(ChecksumStorageUT, DamagedObjectFailsRangedRead)
+{
+    std::string data = Noise(2 * CHECKSUM_MIN_BLOCK_SIZE + 100);
+    ASSERT_EQ(storage->PutBuffer("dir/object", data.data(), data.size(), 0), (ssize_t)data.size());
+    std::string buf(data.size(), 0);
+    ASSERT_EQ(storage->ReadObject("dir/object", 0, data.size(), -1, buf.data()), (ssize_t)data.size());
+    EXPECT_EQ(buf, data);
+
+    /* damage the object behind the back of the wrapper, the sidecar stays */
+    std::string damaged = data;
+    damaged[CHECKSUM_MIN_BLOCK_SIZE + 1] ^= 1;
+    ASSERT_GE(MockStorage::GetInstance()->PutBuffer("dir/object", damaged.data(), damaged.size(), 0), 0);
+    FalconStats::GetInstance().stats[CHECKSUM_MISMATCH] = 0;
+    FalconStats::GetInstance().stats[CHECKSUM_REFETCH] = 0;
+    EXPECT_LT(storage->ReadObject("dir/object", 0, data.size(), -1, buf.data()), 0);
+    EXPECT_EQ(FalconStats::GetInstance().stats[CHECKSUM_MISMATCH], 1);
+    EXPECT_EQ(FalconStats::GetInstance().stats[CHECKSUM_REFETCH], 1);
+
+    /* the damaged block is not wholly in the range, it is not checked */
+    EXPECT_EQ(storage->ReadObject("dir/object", 0, 100, -1, buf.data()), 100);
+}
+
+TEST_F(ChecksumStorageUT, VerifyRepairsDamagedFile)
+{
+    std::string data = Noise(3 * CHECKSUM_MIN_BLOCK_SIZE);
+    ASSERT_EQ(storage->PutBuffer("object", data.data(), data.size(), 0), (ssize_t)data.size());
+    std::string path = scratchPath + "/verify";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(storage->ReadObject("object", 0, data.size(), fd, nullptr), (ssize_t)data.size());
+    std::shared_ptr<const BlockChecksums> expected = storage->GetChecksums("object");
+    ASSERT_NE(expected, nullptr);
+
+    /* damaged on its way into the file */
+    char byte = 0;
+    ASSERT_EQ(pwrite(fd, &byte, 1, 2 * CHECKSUM_MIN_BLOCK_SIZE + 7), 1);
+    FalconStats::GetInstance().stats[CHECKSUM_REFETCH] = 0;
+    /* the damaged block is not in the range, it is left for the read of its own */
+    EXPECT_EQ(storage->Verify("object", fd, 0, 2 * CHECKSUM_MIN_BLOCK_SIZE, *expected), 0);
+    EXPECT_EQ(FalconStats::GetInstance().stats[CHECKSUM_REFETCH], 0);
+    EXPECT_EQ(storage->Verify("object", fd, 2 * CHECKSUM_MIN_BLOCK_SIZE, CHECKSUM_MIN_BLOCK_SIZE, *expected), 0);
+    EXPECT_EQ(FalconStats::GetInstance().stats[CHECKSUM_REFETCH], 1);
+    std::string file(data.size(), 0);
+    EXPECT_EQ(pread(fd, file.data(), file.size(), 0), (ssize_t)data.size());
+    EXPECT_EQ(file, data);
+
+    /* the object itself is damaged, fetching it again does not help */
+    std::string damaged = data;
+    damaged[CHECKSUM_MIN_BLOCK_SIZE + 1] ^= 1;
+    ASSERT_GE(MockStorage::GetInstance()->PutBuffer("object", damaged.data(), damaged.size(), 0), 0);
+    ASSERT_EQ(pwrite(fd, &byte, 1, CHECKSUM_MIN_BLOCK_SIZE + 7), 1);
+    EXPECT_EQ(storage->Verify("object", fd, 0, data.size(), *expected), -EBADMSG);
+    close(fd);
+}
+
+TEST_F(ChecksumStorageUT, ObjectsWithoutSidecarReadUnchecked)
+{
+    std::string data = Noise(CHECKSUM_MIN_BLOCK_SIZE + 1);
+    ASSERT_GE(MockStorage::GetInstance()->PutBuffer("plain", data.data(), data.size(), 0), 0);
+    std::string buf(data.size(), 0);
+    EXPECT_EQ(storage->ReadObject("plain", 0, data.size(), -1, buf.data()), (ssize_t)data.size());
+    EXPECT_EQ(buf, data);
+
+    /* sidecars follow their objects */
+    ASSERT_EQ(storage->PutBuffer("dir/a", data.data(), data.size(), 0), (ssize_t)data.size());
+    EXPECT_EQ(MockStorage::GetInstance()->ObjectCount(), 3);
+    EXPECT_EQ(storage->CopyObject("dir/a", "dir/b"), 0);
+    EXPECT_EQ(MockStorage::GetInstance()->ObjectCount(), 5);
+    EXPECT_EQ(storage->DeleteObject("dir/a"), 0);
+    EXPECT_EQ(storage->DeleteObject("dir/b"), 0);
+    EXPECT_EQ(MockStorage::GetInstance()->ObjectCount(), 1);
+}
+
+TEST_F(ChecksumStorageUT, CacheVerifierChecksBlocksOnce)
+{
+    std::string data = Noise(2 * CHECKSUM_MIN_BLOCK_SIZE + 3);
+    std::string path = scratchPath + "/cache";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(pwrite(fd, data.data(), data.size(), 0), (ssize_t)data.size());
+    BlockChecksums checksums;
+    ASSERT_EQ(BlockChecksums::OfFile(fd, data.size(), checksums), 0);
+    if (checksums.Save(fd) == 0) {
+        BlockChecksums loaded;
+        EXPECT_EQ(BlockChecksums::Load(fd, loaded), 0);
+        EXPECT_EQ(loaded, checksums);
+        BlockChecksums::Drop(fd);
+        EXPECT_EQ(BlockChecksums::Load(fd, loaded), -ENODATA);
+    }
+
+    CacheVerifier verifier(checksums);
+    size_t bad = 0;
+    EXPECT_EQ(verifier.Verify(fd, 0, 10, bad), 0);
+    char byte = data[5] ^ 1;
+    ASSERT_EQ(pwrite(fd, &byte, 1, 5), 1);
+    ASSERT_EQ(pwrite(fd, &byte, 1, CHECKSUM_MIN_BLOCK_SIZE + 5), 1);
+    /* block 0 was checked already */
+    EXPECT_EQ(verifier.Verify(fd, 0, 10, bad), 0);
+    EXPECT_EQ(verifier.Verify(fd, 0, data.size(), bad), -EBADMSG);
+    EXPECT_EQ(bad, 1);
+    verifier.Disable();
+    EXPECT_EQ(verifier.Verify(fd, 0, data.size(), bad), 0);
+    close(fd);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
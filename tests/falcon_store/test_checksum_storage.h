@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/block_checksums.h"
+#include "storage/checksum_storage.h"
+#include "storage/mock_storage.h"
+
+class ChecksumStorageUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        scratchPath = std::filesystem::temp_directory_path() / "falcon_checksum_storage_ut";
+        std::filesystem::remove_all(scratchPath);
+        std::filesystem::create_directories(scratchPath);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(scratchPath); }
+    void SetUp() override
+    {
+        MockStorage::GetInstance()->SetFaults(0, 0, 0);
+        storage = ChecksumStorage::GetInstance();
+        storage->Wrap(MockStorage::GetInstance());
+        storage->DeleteInstance();
+        ASSERT_EQ(storage->Init(), 0);
+    }
+    void TearDown() override {}
+
+    static std::string scratchPath;
+    ChecksumStorage *storage = nullptr;
+};
@@ -0,0 +1,200 @@
+#include "test_compressed_storage.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <random>
+
+#include "stats/falcon_stats.h"
+
+std::string CompressedStorageUT::scratchPath;
+
+static std::string Text(size_t size)
+{
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = 'a' + (i / 7 + i % 13) % 26;
+    }
+    return data;
+}
+
+static std::string Noise(size_t size)
+{
+    std::mt19937_64 engine(42);
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (char)engine();
+    }
+    return data;
+}
+
+static void WriteFile(const std::string &path, const std::string &data)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+}
+
+TEST_F(CompressedStorageUT, RangedReadsDecompressOnlyCoveredBlocks)
+{
+    std::string data = Text(10 * BLOCK_SIZE + 123);
+    ASSERT_EQ(storage->PutBuffer("dir/object", data.data(), data.size(), 0), (ssize_t)data.size());
+    EXPECT_LT(StoredSize("dir/object"), (ssize_t)data.size() / 2);
+
+    for (uint64_t offset : {0UL, 100UL, BLOCK_SIZE - 10UL, 3UL * BLOCK_SIZE, data.size() - 50}) {
+        std::string buf(300, 0);
+        ssize_t expected = std::min<uint64_t>(300, data.size() - offset);
+        ASSERT_EQ(storage->ReadObject("dir/object", offset, 300, -1, buf.data()), expected) << offset;
+        EXPECT_EQ(buf.substr(0, expected), data.substr(offset, expected)) << offset;
+    }
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("dir/object", data.size(), 10, -1, buf.data()), 0);
+
+    /* one block needs only its own compressed bytes */
+    FalconStats::GetInstance().stats[OBJ_GET] = 0;
+    EXPECT_EQ(storage->ReadObject("dir/object", 5 * BLOCK_SIZE + 1, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(5 * BLOCK_SIZE + 1, 100));
+    EXPECT_LT(FalconStats::GetInstance().stats[OBJ_GET], BLOCK_SIZE);
+}
+
+TEST_F(CompressedStorageUT, FileRoundTrip)
+{
+    std::string data = Text(3 * 1024 * 1024 + 7);
+    std::string path = scratchPath + "/file";
+    WriteFile(path, data);
+    ASSERT_EQ(storage->PutFile("file", path), 0);
+    EXPECT_LT(StoredSize("file"), (ssize_t)data.size() / 2);
+    /* the staged copy is gone */
+    EXPECT_TRUE(std::filesystem::is_empty(scratchPath + "/staging"));
+
+    int fd = open(path.c_str(), O_RDWR | O_TRUNC);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(storage->ReadObject("file", 0, data.size(), fd, nullptr), (ssize_t)data.size());
+    std::string file(data.size(), 0);
+    EXPECT_EQ(pread(fd, file.data(), file.size(), 0), (ssize_t)data.size());
+    EXPECT_EQ(file, data);
+
+    /* a ranged read into a file lands at its object offsets */
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    EXPECT_EQ(storage->ReadObject("file", 1024 * 1024, 1000, fd, nullptr), 1000);
+    EXPECT_EQ(pread(fd, file.data(), 1000, 1024 * 1024), 1000);
+    EXPECT_EQ(file.substr(0, 1000), data.substr(1024 * 1024, 1000));
+    close(fd);
+
+    EXPECT_EQ(storage->CopyObject("file", "copy"), 0);
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("copy", 2 * 1024 * 1024, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(2 * 1024 * 1024, 100));
+    EXPECT_EQ(storage->DeleteObject("copy"), 0);
+    EXPECT_LT(storage->ReadObject("copy", 0, 100, -1, buf.data()), 0);
+}
+
+TEST_F(CompressedStorageUT, IncompressibleDataIsStoredAsIs)
+{
+    std::string noise = Noise(8 * BLOCK_SIZE);
+    ASSERT_EQ(storage->PutBuffer("noise", noise.data(), noise.size(), 0), (ssize_t)noise.size());
+    EXPECT_EQ(StoredSize("noise"), (ssize_t)noise.size());
+
+    std::string text = Text(2 * BLOCK_SIZE);
+    ASSERT_EQ(storage->PutBuffer("photo.JPG", text.data(), text.size(), 0), (ssize_t)text.size());
+    EXPECT_EQ(StoredSize("photo.JPG"), (ssize_t)text.size());
+
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("noise", BLOCK_SIZE, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, noise.substr(BLOCK_SIZE, 100));
+}
+
+TEST_F(CompressedStorageUT, MixedBlocks)
+{
+    /* compressible head, a noisy tail kept raw block by block */
+    std::string data = Text(6 * BLOCK_SIZE) + Noise(2 * BLOCK_SIZE + 9);
+    ASSERT_EQ(storage->PutBuffer("mixed", data.data(), data.size(), 0), (ssize_t)data.size());
+    EXPECT_LT(StoredSize("mixed"), (ssize_t)data.size());
+    std::string buf(2 * BLOCK_SIZE, 0);
+    EXPECT_EQ(storage->ReadObject("mixed", 5 * BLOCK_SIZE, buf.size(), -1, buf.data()), (ssize_t)buf.size());
+    EXPECT_EQ(buf, data.substr(5 * BLOCK_SIZE, buf.size()));
+}
+
+TEST_F(CompressedStorageUT, OnlyConfiguredDirs)
+{
+    Wrap("/data/,models");
+    std::string text = Text(4 * BLOCK_SIZE);
+    for (const char *key : {"data/a", "models/b/c", "database/a", "other/a"}) {
+        ASSERT_EQ(storage->PutBuffer(key, text.data(), text.size(), 0), (ssize_t)text.size());
+    }
+    EXPECT_LT(StoredSize("data/a"), (ssize_t)text.size());
+    EXPECT_LT(StoredSize("models/b/c"), (ssize_t)text.size());
+    EXPECT_EQ(StoredSize("database/a"), (ssize_t)text.size());
+    EXPECT_EQ(StoredSize("other/a"), (ssize_t)text.size());
+}
+
+TEST_F(CompressedStorageUT, PlainAndRewrittenObjects)
+{
+    /* written before compression was on */
+    std::string old = Text(3 * BLOCK_SIZE);
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("plain", old.data(), old.size(), 0), 0);
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("tiny", "abc", 3, 0), 0);
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("plain", 10, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, old.substr(10, 100));
+    EXPECT_EQ(storage->ReadObject("tiny", 0, 0, -1, buf.data()), 3);
+    EXPECT_EQ(buf.substr(0, 3), "abc");
+
+    std::string first = Text(4 * BLOCK_SIZE);
+    ASSERT_GT(storage->PutBuffer("object", first.data(), first.size(), 0), 0);
+    EXPECT_EQ(storage->ReadObject("object", 0, 100, -1, buf.data()), 100);
+    /* rewritten by another node, behind the back of the cached block index */
+    std::string second(3 * BLOCK_SIZE, 'z');
+    ASSERT_GT(storage->PutBuffer("rewrite", second.data(), second.size(), 0), 0);
+    std::string stored(StoredSize("rewrite"), 0);
+    MockStorage::GetInstance()->ReadObject("rewrite", 0, 0, -1, stored.data());
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("object", stored.data(), stored.size(), 0), 0);
+    EXPECT_EQ(storage->ReadObject("object", 2 * BLOCK_SIZE, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, second.substr(2 * BLOCK_SIZE, 100));
+}
+
+TEST_F(CompressedStorageUT, LayoutIsFetchedOnce)
+{
+    std::string data = Text(10 * BLOCK_SIZE);
+    ASSERT_EQ(storage->PutBuffer("dir/cached", data.data(), data.size(), 0), (ssize_t)data.size());
+    std::string buf(100, 0);
+    auto &fetched = FalconStats::GetInstance().stats[OBJ_GET];
+    fetched = 0;
+    EXPECT_EQ(storage->ReadObject("dir/cached", 5 * BLOCK_SIZE, 100, -1, buf.data()), 100);
+    uint64_t first = fetched;
+    fetched = 0;
+    EXPECT_EQ(storage->ReadObject("dir/cached", 5 * BLOCK_SIZE, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(5 * BLOCK_SIZE, 100));
+    /* the block only, not the header and index again */
+    EXPECT_EQ((uint64_t)fetched, first - COMPRESS_HEADER_SIZE - 10 * sizeof(uint32_t));
+
+    /* plain objects are remembered as such */
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("dir/plain", data.data(), data.size(), 0), 0);
+    EXPECT_EQ(storage->ReadObject("dir/plain", 0, 100, -1, buf.data()), 100);
+    fetched = 0;
+    EXPECT_EQ(storage->ReadObject("dir/plain", BLOCK_SIZE, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(BLOCK_SIZE, 100));
+    EXPECT_EQ((uint64_t)fetched, 100UL);
+}
+
+TEST_F(CompressedStorageUT, OnlyConfiguredDirsAreProbed)
+{
+    Wrap("data");
+    std::string text = Text(4 * BLOCK_SIZE);
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("other/a", text.data(), text.size(), 0), 0);
+    ASSERT_GT(MockStorage::GetInstance()->PutBuffer("data/song.mp3", text.data(), text.size(), 0), 0);
+    std::string buf(100, 0);
+    auto &fetched = FalconStats::GetInstance().stats[OBJ_GET];
+    for (const char *key : {"other/a", "data/song.mp3"}) {
+        fetched = 0;
+        EXPECT_EQ(storage->ReadObject(key, BLOCK_SIZE, 100, -1, buf.data()), 100) << key;
+        EXPECT_EQ(buf, text.substr(BLOCK_SIZE, 100)) << key;
+        /* no header read first */
+        EXPECT_EQ((uint64_t)fetched, 100UL) << key;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "storage/compressed_storage.h"
+#include "storage/mock_storage.h"
+
+class CompressedStorageUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        scratchPath = std::filesystem::temp_directory_path() / "falcon_compressed_storage_ut";
+        std::filesystem::remove_all(scratchPath);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(scratchPath); }
+    void SetUp() override
+    {
+        MockStorage::GetInstance()->SetFaults(0, 0, 0);
+        MockStorage::GetInstance()->DeleteInstance();
+        Wrap("");
+    }
+    void TearDown() override {}
+
+    void Wrap(const std::string &dirs)
+    {
+        storage = CompressedStorage::GetInstance();
+        storage->Wrap(MockStorage::GetInstance(), CodecType::ZLIB, BLOCK_SIZE, dirs, scratchPath + "/staging");
+        ASSERT_EQ(storage->Init(), 0);
+    }
+    /* size of the object as the wrapped storage keeps it */
+    static ssize_t StoredSize(const std::string &key)
+    {
+        std::string buf(64 * 1024 * 1024, 0);
+        return MockStorage::GetInstance()->ReadObject(key, 0, 0, -1, buf.data());
+    }
+
+    static constexpr uint32_t BLOCK_SIZE = 64 * 1024;
+    static std::string scratchPath;
+    CompressedStorage *storage = nullptr;
+};
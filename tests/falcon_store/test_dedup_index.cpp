@@ -0,0 +1,186 @@
+#include "test_dedup_index.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <fstream>
+#include <random>
+
+#include "stats/falcon_stats.h"
+
+std::string DedupIndexUT::rootPath;
+
+static std::string Noise(size_t size, uint64_t seed)
+{
+    std::mt19937_64 engine(seed);
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (char)engine();
+    }
+    return data;
+}
+
+static void WriteCacheFile(uint64_t inodeId, const std::string &data)
+{
+    std::ofstream file(GetFilePath(inodeId), std::ios::binary | std::ios::trunc);
+    file.write(data.data(), data.size());
+}
+
+TEST_F(DedupIndexUT, EqualChunksAreShared)
+{
+    DedupIndex &index = DedupIndex::GetInstance();
+    std::string a = Noise(4 * CHUNK_SIZE + 100, 1);
+    /* the same first two chunks and tail, other data in between */
+    std::string b = a.substr(0, 2 * CHUNK_SIZE) + Noise(2 * CHUNK_SIZE, 2) + a.substr(4 * CHUNK_SIZE);
+    WriteCacheFile(1, a);
+    WriteCacheFile(2, b);
+    ASSERT_EQ(index.Scan(1), 0);
+    EXPECT_EQ(sharedBytes, 0U);
+    ASSERT_EQ(index.Scan(2), 0);
+    EXPECT_EQ(sharedBytes, 2 * CHUNK_SIZE + 100);
+    EXPECT_EQ(index.References(2, 0), 2U);
+    EXPECT_EQ(index.References(2, 2), 1U);
+    EXPECT_EQ(index.References(2, 4), 2U);
+
+    /* deleting a file drops its references, the chunks it held alone leave the index */
+    index.Forget(1);
+    EXPECT_EQ(index.References(2, 0), 1U);
+    EXPECT_EQ(index.Files(), 1U);
+    WriteCacheFile(3, a);
+    sharedBytes = 0;
+    ASSERT_EQ(index.Scan(3), 0);
+    EXPECT_EQ(sharedBytes, 2 * CHUNK_SIZE + 100);
+}
+
+TEST_F(DedupIndexUT, RewrittenHolderIsNotShared)
+{
+    DedupIndex &index = DedupIndex::GetInstance();
+    std::string a = Noise(2 * CHUNK_SIZE, 3);
+    WriteCacheFile(1, a);
+    ASSERT_EQ(index.Scan(1), 0);
+    /* changed after its scan, the index is stale until it is scanned again */
+    WriteCacheFile(1, Noise(2 * CHUNK_SIZE, 4));
+    WriteCacheFile(2, a);
+    ASSERT_EQ(index.Scan(2), 0);
+    EXPECT_EQ(sharedBytes, 0U);
+}
+
+TEST_F(DedupIndexUT, UnsupportedFileSystemOnlyFingerprints)
+{
+    DedupIndex &index = DedupIndex::GetInstance();
+    index.Init(CHUNK_SIZE, [](int, uint64_t, int, uint64_t, uint64_t) -> int64_t { return -EOPNOTSUPP; });
+    std::string a = Noise(2 * CHUNK_SIZE, 5);
+    WriteCacheFile(1, a);
+    WriteCacheFile(2, a);
+    uint64_t scanned = FalconStats::GetInstance().stats[DEDUP_SCANNED];
+    ASSERT_EQ(index.Scan(1), 0);
+    ASSERT_EQ(index.Scan(2), 0);
+    EXPECT_EQ(index.References(2, 1), 2U);
+    EXPECT_EQ(FalconStats::GetInstance().stats[DEDUP_SCANNED] - scanned, 4 * CHUNK_SIZE);
+}
+
+TEST_F(DedupIndexUT, UploadedOnce)
+{
+    DedupIndex &index = DedupIndex::GetInstance();
+    ChecksumStorage *storage = ChecksumStorage::GetInstance();
+    std::string data = Noise(DEDUP_MIN_COPY_SIZE + 12345, 6);
+    BlockChecksums content = BlockChecksums::OfBuffer(data.data(), data.size());
+    WriteCacheFile(1, data);
+    EXPECT_EQ(index.CopyUploaded(storage, "a", content), -ENOENT);
+    ASSERT_EQ(storage->PutFile("a", GetFilePath(1)), 0);
+    index.SetUploaded(1, "a", content);
+
+    uint64_t put = FalconStats::GetInstance().stats[OBJ_PUT];
+    ASSERT_EQ(index.CopyUploaded(storage, "b", content), 0);
+    EXPECT_EQ(FalconStats::GetInstance().stats[OBJ_PUT], put);
+    std::string object(data.size(), 0);
+    EXPECT_EQ(storage->ReadObject("b", 0, 0, -1, object.data()), (ssize_t)data.size());
+    EXPECT_EQ(object, data);
+
+    /* renamed on this node, the copy follows the object */
+    index.MoveObject("a", "c");
+    ASSERT_EQ(storage->CopyObject("a", "c"), 0);
+    ASSERT_EQ(storage->DeleteObject("a"), 0);
+    EXPECT_EQ(index.CopyUploaded(storage, "d", content), 0);
+
+    /* the upload leaves the index with its cache file */
+    index.Forget(1);
+    EXPECT_EQ(index.CopyUploaded(storage, "e", content), -ENOENT);
+
+    /* nothing can be checked without the sidecars */
+    index.SetUploaded(1, "c", content);
+    EXPECT_EQ(index.CopyUploaded(MockStorage::GetInstance(), "e", content), -ENOENT);
+}
+
+TEST_F(DedupIndexUT, StaleUploadIsNotCopied)
+{
+    DedupIndex &index = DedupIndex::GetInstance();
+    ChecksumStorage *storage = ChecksumStorage::GetInstance();
+    std::string data = Noise(DEDUP_MIN_COPY_SIZE * 2, 7);
+    BlockChecksums content = BlockChecksums::OfBuffer(data.data(), data.size());
+    WriteCacheFile(1, data);
+    ASSERT_EQ(storage->PutFile("a", GetFilePath(1)), 0);
+    index.SetUploaded(1, "a", content);
+
+    /* replaced through another node, same size and head, the whole content is checked */
+    std::string other = data;
+    other[data.size() / 2] ^= 1;
+    ASSERT_GT(storage->PutBuffer("a", other.data(), other.size(), 0), 0);
+    uint64_t copied = FalconStats::GetInstance().stats[DEDUP_UPLOAD_SAVED];
+    EXPECT_EQ(index.CopyUploaded(storage, "b", content), -ENOENT);
+    EXPECT_EQ(FalconStats::GetInstance().stats[DEDUP_UPLOAD_SAVED], copied);
+    std::string buf(1, 0);
+    EXPECT_LT(storage->ReadObject("b", 0, 1, -1, buf.data()), 0);
+
+    /* and no longer offered once the object has the content again */
+    ASSERT_GT(storage->PutBuffer("a", data.data(), data.size(), 0), 0);
+    EXPECT_EQ(index.CopyUploaded(storage, "b", content), -ENOENT);
+
+    /* a source file written since its upload is still copied from, its object is unchanged */
+    ASSERT_EQ(storage->PutFile("a", GetFilePath(1)), 0);
+    index.SetUploaded(1, "a", content);
+    WriteCacheFile(1, other);
+    EXPECT_EQ(index.CopyUploaded(storage, "b", content), 0);
+}
+
+TEST_F(DedupIndexUT, ScanKeepsUpload)
+{
+    /* the chunks are fingerprinted after the upload */
+    DedupIndex &index = DedupIndex::GetInstance();
+    ChecksumStorage *storage = ChecksumStorage::GetInstance();
+    std::string data = Noise(DEDUP_MIN_COPY_SIZE, 9);
+    BlockChecksums content = BlockChecksums::OfBuffer(data.data(), data.size());
+    WriteCacheFile(1, data);
+    ASSERT_EQ(storage->PutFile("a", GetFilePath(1)), 0);
+    index.SetUploaded(1, "a", content);
+    ASSERT_EQ(index.Scan(1), 0);
+    EXPECT_EQ(index.CopyUploaded(storage, "b", content), 0);
+}
+
+TEST_F(DedupIndexUT, KernelSharing)
+{
+    /* the real FIDEDUPERANGE, only on file systems with reflinks */
+    DedupIndex &index = DedupIndex::GetInstance();
+    index.Init(CHUNK_SIZE);
+    std::string a = Noise(4 * CHUNK_SIZE, 8);
+    WriteCacheFile(1, a);
+    WriteCacheFile(2, a);
+    uint64_t shared = FalconStats::GetInstance().stats[DEDUP_SHARED];
+    ASSERT_EQ(index.Scan(1), 0);
+    ASSERT_EQ(index.Scan(2), 0);
+    if (FalconStats::GetInstance().stats[DEDUP_SHARED] == shared) {
+        GTEST_SKIP() << "the file system of " << rootPath << " can not share blocks";
+    }
+    EXPECT_EQ(FalconStats::GetInstance().stats[DEDUP_SHARED] - shared, 4 * CHUNK_SIZE);
+    std::string data(a.size(), 0);
+    int fd = open(GetFilePath(2).c_str(), O_RDONLY);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(pread(fd, data.data(), data.size(), 0), (ssize_t)a.size());
+    close(fd);
+    EXPECT_EQ(data, a);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
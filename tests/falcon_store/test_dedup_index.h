@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/dedup_index.h"
+#include "storage/checksum_storage.h"
+#include "storage/mock_storage.h"
+#include "util/utils.h"
+
+class DedupIndexUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        rootPath = std::filesystem::temp_directory_path() / "falcon_dedup_index_ut";
+        std::filesystem::remove_all(rootPath);
+        std::filesystem::create_directories(rootPath + "/0");
+        SetRootPath(rootPath);
+        SetTotalDirectory(1);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(rootPath); }
+    void SetUp() override
+    {
+        sharedBytes = 0;
+        /* compares like FIDEDUPERANGE, on any file system */
+        DedupIndex::GetInstance().Init(CHUNK_SIZE, [this](int src, uint64_t srcOffset, int dst, uint64_t dstOffset,
+                                                          uint64_t length) -> int64_t {
+            std::string a(length, 0);
+            std::string b(length, 0);
+            if (pread(src, a.data(), length, srcOffset) != (ssize_t)length ||
+                pread(dst, b.data(), length, dstOffset) != (ssize_t)length || a != b) {
+                return 0;
+            }
+            sharedBytes += length;
+            return length;
+        });
+        /* uploads are only copied with the sidecars to check them */
+        ChecksumStorage::GetInstance()->Wrap(MockStorage::GetInstance());
+        ChecksumStorage::GetInstance()->DeleteInstance();
+    }
+    void TearDown() override {}
+
+    static constexpr uint32_t CHUNK_SIZE = 64 * 1024;
+    static std::string rootPath;
+    uint64_t sharedBytes = 0;
+};
@@ -1,6 +1,11 @@
 #include "test_disk_cache.h"
 #include "disk_cache/disk_cache.h"
 
+#include <algorithm>
+#include <fstream>
+
+#include "util/utils.h"
+
 std::string DiskCacheUT::rootPath = "/tmp/testdir/";
 
 TEST_F(DiskCacheUT, Start)
@@ -9,6 +14,47 @@ TEST_F(DiskCacheUT, Start)
     EXPECT_EQ(ret, 0);
 }
 
+static void WriteCacheFile(uint64_t key, size_t size)
+{
+    std::ofstream(GetFilePath(key)) << std::string(size, 'x');
+    DiskCache::GetInstance().InsertAndUpdate(key, size, false);
+}
+
+TEST_F(DiskCacheUT, PinQuota)
+{
+    SetRootPath(rootPath);
+    SetTotalDirectory(100);
+    DiskCache &cache = DiskCache::GetInstance();
+    cache.SetPinQuota(0);
+    WriteCacheFile(1001, 100);
+    WriteCacheFile(1002, 100);
+    EXPECT_EQ(cache.SetPinned(1001, true), -EDQUOT);
+    EXPECT_EQ(cache.SetPinned(1003, true), -ENOENT);
+
+    cache.SetPinQuota(150);
+    EXPECT_EQ(cache.SetPinned(1001, true), 0);
+    EXPECT_EQ(cache.SetPinned(1001, true), 0);
+    EXPECT_EQ(cache.SetPinned(1002, true), -EDQUOT);
+    EXPECT_EQ(cache.PinnedBytes(), 100);
+
+    /* pinned files are not idle, so neither evicted nor moved to another node */
+    std::vector<uint64_t> idle = cache.IdleKeys();
+    EXPECT_EQ(std::count(idle.begin(), idle.end(), 1001), 0);
+    EXPECT_EQ(std::count(idle.begin(), idle.end(), 1002), 1);
+    EXPECT_FALSE(cache.TryPinIdle(1001));
+
+    /* growing a pinned file counts against the quota */
+    cache.InsertAndUpdate(1001, 120, false);
+    EXPECT_EQ(cache.PinnedBytes(), 120);
+
+    EXPECT_EQ(cache.SetPinned(1001, false), 0);
+    EXPECT_EQ(cache.PinnedBytes(), 0);
+    EXPECT_EQ(cache.SetPinned(1002, true), 0);
+    EXPECT_EQ(cache.Delete(1002), 0);
+    EXPECT_EQ(cache.PinnedBytes(), 0);
+    EXPECT_EQ(cache.Delete(1001), 0);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
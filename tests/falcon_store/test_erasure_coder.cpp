@@ -0,0 +1,196 @@
+#include "test_erasure_coder.h"
+
+#include <sys/xattr.h>
+#include <unistd.h>
+#include <random>
+#include <vector>
+
+#include "falcon_store/rebalancer.h"
+
+std::string ErasureCoderUT::scratchPath;
+
+static std::string Noise(size_t size, uint64_t seed = 42)
+{
+    std::mt19937_64 engine(seed);
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (char)engine();
+    }
+    return data;
+}
+
+static bool XattrSupported(const std::string &dir)
+{
+    std::string path = dir + "/xattr_probe";
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    fclose(file);
+    bool supported = setxattr(path.c_str(), "user.falcon.probe", "1", 1, 0) == 0;
+    unlink(path.c_str());
+    return supported;
+}
+
+/* shard index of a file of 4 data shards */
+static ShardInfo Info(uint32_t index, uint64_t fileSize, uint64_t version)
+{
+    ShardInfo info;
+    info.index = index;
+    info.dataShards = 4;
+    info.parityShards = 2;
+    info.owner = 1;
+    info.fileSize = fileSize;
+    info.version = version;
+    return info;
+}
+
+static int Put(uint64_t inodeId, const ShardInfo &info, uint64_t offset, const std::string &chunk, bool last)
+{
+    butil::IOBuf data;
+    data.append(chunk.data(), chunk.size());
+    return ErasureCoder::GetInstance().ReceiveShard(inodeId, info, offset, last, IOBufCrc32c(data), data);
+}
+
+TEST_F(ErasureCoderUT, ReconstructsAnyLostShards)
+{
+    const size_t len = 1000;
+    ReedSolomon code(4, 2);
+    ASSERT_TRUE(code.Valid());
+    std::vector<std::string> shards;
+    for (int i = 0; i < 6; ++i) {
+        shards.push_back(i < 4 ? Noise(len, i) : std::string(len, 0));
+    }
+    code.Encode({shards[0].data(), shards[1].data(), shards[2].data(), shards[3].data()},
+                {shards[4].data(), shards[5].data()},
+                len);
+
+    /* every pattern of at most two lost shards */
+    for (int lost = 0; lost < 64; ++lost) {
+        if (__builtin_popcount(lost) > 2) {
+            continue;
+        }
+        std::vector<std::string> copy = shards;
+        std::vector<char *> bufs;
+        std::vector<bool> present;
+        for (int i = 0; i < 6; ++i) {
+            if (lost & (1 << i)) {
+                copy[i].assign(len, 'x');
+            }
+            bufs.push_back(copy[i].data());
+            present.push_back((lost & (1 << i)) == 0);
+        }
+        ASSERT_EQ(code.Reconstruct(bufs, present, len), 0) << lost;
+        EXPECT_EQ(copy, shards) << lost;
+    }
+
+    std::vector<char *> bufs;
+    for (auto &shard : shards) {
+        bufs.push_back(shard.data());
+    }
+    EXPECT_EQ(code.Reconstruct(bufs, {true, false, true, false, false, true}, len), -EINVAL);
+}
+
+TEST_F(ErasureCoderUT, RejectsInvalidCodes)
+{
+    EXPECT_FALSE(ReedSolomon(0, 2).Valid());
+    EXPECT_FALSE(ReedSolomon(4, 0).Valid());
+    EXPECT_FALSE(ReedSolomon(200, 57).Valid());
+    EXPECT_TRUE(ReedSolomon(200, 56).Valid());
+    EXPECT_EQ(ErasureCoder::GetInstance().Start(scratchPath, 1, 0, 0), -EINVAL);
+}
+
+TEST_F(ErasureCoderUT, ShardInfoRoundTrip)
+{
+    ShardInfo info = Info(5, 12345, 678);
+    ShardInfo parsed;
+    ASSERT_TRUE(ErasureCoder::ParseInfo(ErasureCoder::SerializeInfo(info), parsed));
+    EXPECT_EQ(parsed.index, 5U);
+    EXPECT_EQ(parsed.owner, 1);
+    EXPECT_EQ(parsed.fileSize, 12345U);
+    EXPECT_EQ(parsed.version, 678U);
+    EXPECT_EQ(parsed.ShardSize(), 3087U);
+    /* an index past the shards of the code */
+    info.index = 6;
+    EXPECT_FALSE(ErasureCoder::ParseInfo(ErasureCoder::SerializeInfo(info), parsed));
+}
+
+TEST_F(ErasureCoderUT, StoresShardsInChunks)
+{
+    if (!XattrSupported(scratchPath)) {
+        GTEST_SKIP() << "no user xattrs on " << scratchPath;
+    }
+    ShardInfo info = Info(2, 4 * 3000, 10);
+    std::string shard = Noise(info.ShardSize());
+    ErasureCoder &coder = ErasureCoder::GetInstance();
+    ASSERT_EQ(Put(7, info, 0, shard.substr(0, 1000), false), 0);
+
+    /* not readable before the last chunk */
+    ShardInfo read;
+    butil::IOBuf data;
+    EXPECT_EQ(coder.ReadShard(7, 0, 0, read, data), -ENOENT);
+    /* damaged on its way */
+    butil::IOBuf damaged;
+    damaged.append(shard.data() + 1000, 2000);
+    EXPECT_EQ(coder.ReceiveShard(7, info, 1000, true, 0, damaged), -EBADMSG);
+    ASSERT_EQ(Put(7, info, 1000, shard.substr(1000), true), 0);
+
+    ASSERT_EQ(coder.ReadShard(7, 0, 0, read, data), 0);
+    EXPECT_EQ(read.index, 2U);
+    EXPECT_EQ(read.version, 10U);
+    EXPECT_TRUE(data.empty());
+    ASSERT_EQ(coder.ReadShard(7, 500, 1500, read, data), 0);
+    EXPECT_EQ(data.to_string(), shard.substr(500, 1500));
+    EXPECT_EQ(coder.ReadShard(7, 2500, 1000, read, data), -EINVAL);
+
+    EXPECT_EQ(coder.DropShard(7), 0);
+    EXPECT_EQ(coder.ReadShard(7, 0, 0, read, data), -ENOENT);
+    EXPECT_EQ(coder.DropShard(7), 0);
+}
+
+TEST_F(ErasureCoderUT, OlderVersionDoesNotReplaceNewer)
+{
+    if (!XattrSupported(scratchPath)) {
+        GTEST_SKIP() << "no user xattrs on " << scratchPath;
+    }
+    ErasureCoder &coder = ErasureCoder::GetInstance();
+    std::string newer = Noise(100, 1);
+    ASSERT_EQ(Put(8, Info(0, 400, 20), 0, newer, true), 0);
+    ASSERT_EQ(Put(8, Info(0, 400, 19), 0, Noise(100, 2), true), 0);
+
+    ShardInfo read;
+    butil::IOBuf data;
+    ASSERT_EQ(coder.ReadShard(8, 0, 100, read, data), 0);
+    EXPECT_EQ(read.version, 20U);
+    EXPECT_EQ(data.to_string(), newer);
+    coder.DropShard(8);
+}
+
+TEST_F(ErasureCoderUT, ShardBytesAreKeptByDiskCache)
+{
+    if (!XattrSupported(scratchPath)) {
+        GTEST_SKIP() << "no user xattrs on " << scratchPath;
+    }
+    ErasureCoder &coder = ErasureCoder::GetInstance();
+    DiskCache &cache = DiskCache::GetInstance();
+    uint64_t kept = cache.KeptBytes();
+    ASSERT_EQ(Put(9, Info(0, 400, 30), 0, Noise(60), false), 0);
+    EXPECT_EQ(cache.KeptBytes(), kept + 60);
+    ASSERT_EQ(Put(9, Info(0, 400, 30), 60, Noise(40), true), 0);
+    EXPECT_EQ(cache.KeptBytes(), kept + 100);
+
+    /* a newer coding replaces the shard, an older one is thrown away */
+    ASSERT_EQ(Put(9, Info(0, 400, 31), 0, Noise(100, 3), true), 0);
+    EXPECT_EQ(cache.KeptBytes(), kept + 100);
+    ASSERT_EQ(Put(9, Info(0, 400, 29), 0, Noise(100, 4), true), 0);
+    EXPECT_EQ(cache.KeptBytes(), kept + 100);
+
+    EXPECT_EQ(coder.DropShard(9), 0);
+    EXPECT_EQ(cache.KeptBytes(), kept);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "disk_cache/disk_cache.h"
+#include "falcon_store/erasure_coder.h"
+#include "util/reed_solomon.h"
+
+class ErasureCoderUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        scratchPath = std::filesystem::temp_directory_path() / "falcon_erasure_coder_ut";
+        std::filesystem::remove_all(scratchPath);
+        std::filesystem::create_directories(scratchPath);
+        /* shards take their room from the disk cache */
+        ASSERT_EQ(DiskCache::GetInstance().Start(scratchPath, 0, 0.01, 0.01), 0);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(scratchPath); }
+    void SetUp() override { ASSERT_EQ(ErasureCoder::GetInstance().Start(scratchPath, 4, 2, 0), 0); }
+    void TearDown() override { ErasureCoder::GetInstance().Stop(); }
+
+    static std::string scratchPath;
+};
@@ -410,6 +410,25 @@ TEST_F(FalconStoreUT, WriteRemoteSeqToRandom)
     free(buf);
 }
 
+TEST_F(FalconStoreUT, WriteRemoteAsyncDrained)
+{
+    NewOpenInstance(2000, StoreNode::GetInstance()->GetNodeId() + 1, "/WriteRemote", O_WRONLY);
+
+    size_t size = FALCON_STORE_STREAM_MAX_SIZE;
+    char *buf = (char *)malloc(size);
+    strcpy(buf, "abc");
+    for (uint32_t i = 0; i < 2 * WRITE_DEFAULT_WINDOW; ++i) {
+        int ret = FalconStore::GetInstance()->WriteFile(openInstance.get(), buf, size, i * size);
+        EXPECT_EQ(ret, 0);
+        writeRemoteSize += size;
+    }
+    int ret = openInstance->writeStream.WaitAsyncWrites();
+    EXPECT_EQ(ret, 0);
+    EXPECT_EQ(openInstance->writeStream.GetInflightSize(), 0);
+    EXPECT_EQ(openInstance->currentSize.load(), 2 * WRITE_DEFAULT_WINDOW * size);
+    free(buf);
+}
+
 TEST_F(FalconStoreUT, WriteRemoteStats)
 {
     // wait until stats are updated
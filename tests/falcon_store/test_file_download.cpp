@@ -0,0 +1,94 @@
+#include "test_file_download.h"
+
+TEST_F(FileDownloadUT, BlocksInOrder)
+{
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    for (uint64_t i = 0; i < 9; ++i) {
+        EXPECT_TRUE(download->NextBlock(offset, size));
+        EXPECT_EQ(offset, i * TEST_BLOCK_SIZE);
+        EXPECT_EQ(size, TEST_BLOCK_SIZE);
+    }
+    EXPECT_TRUE(download->NextBlock(offset, size));
+    EXPECT_EQ(size, 50);
+    EXPECT_FALSE(download->NextBlock(offset, size));
+}
+
+TEST_F(FileDownloadUT, WaitedBlockFirst)
+{
+    EXPECT_EQ(Next(), 0);
+    std::atomic<bool> served{false};
+    std::thread reader([this, &served]() {
+        EXPECT_EQ(download->Wait(750, 10), 0);
+        served = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    /* the block the reader waits for is taken next, the rest follow in order */
+    EXPECT_EQ(Next(), 7 * TEST_BLOCK_SIZE);
+    EXPECT_EQ(Next(), TEST_BLOCK_SIZE);
+    EXPECT_FALSE(served);
+    download->Complete(7 * TEST_BLOCK_SIZE);
+    reader.join();
+    EXPECT_TRUE(served);
+    for (uint64_t i = 2; i < 10; ++i) {
+        if (i != 7) {
+            EXPECT_EQ(Next(), i * TEST_BLOCK_SIZE);
+        }
+    }
+    EXPECT_EQ(Next(), UINT64_MAX);
+}
+
+TEST_F(FileDownloadUT, WaitSpansBlocks)
+{
+    download->Complete(0);
+    EXPECT_EQ(download->Wait(0, TEST_BLOCK_SIZE), 0);
+    EXPECT_EQ(download->Wait(2000, 10), 0);
+    EXPECT_EQ(download->Wait(10, 0), 0);
+
+    std::thread reader([this]() { EXPECT_EQ(download->Wait(50, 2 * TEST_BLOCK_SIZE), 0); });
+    download->Complete(TEST_BLOCK_SIZE);
+    download->Complete(2 * TEST_BLOCK_SIZE);
+    reader.join();
+}
+
+TEST_F(FileDownloadUT, Fail)
+{
+    download->Complete(0);
+    std::thread reader([this]() { EXPECT_EQ(download->Wait(TEST_BLOCK_SIZE, 1), -EIO); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    download->Fail(-EIO);
+    reader.join();
+    EXPECT_TRUE(download->Failed());
+    /* what landed stays readable */
+    EXPECT_EQ(download->Wait(0, TEST_BLOCK_SIZE), 0);
+    EXPECT_EQ(download->WaitAll(), -EIO);
+    EXPECT_EQ(Next(), UINT64_MAX);
+}
+
+TEST_F(FileDownloadUT, TableFinish)
+{
+    DownloadTable table;
+    EXPECT_EQ(table.Find(1), nullptr);
+    auto started = table.Start(1, 1000, TEST_BLOCK_SIZE);
+    EXPECT_EQ(table.Find(1), started);
+
+    bool published = false;
+    std::thread reader([&]() {
+        EXPECT_EQ(started->WaitAll(), 0);
+        EXPECT_TRUE(published);
+    });
+    table.Finish(1, started, 0, [&]() { published = true; });
+    reader.join();
+    EXPECT_EQ(table.Find(1), nullptr);
+
+    auto failed = table.Start(2, 1000, TEST_BLOCK_SIZE);
+    table.Finish(2, failed, -ENOENT, [&]() { FAIL(); });
+    EXPECT_EQ(failed->WaitAll(), -ENOENT);
+    EXPECT_EQ(table.Find(2), nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/file_download.h"
+
+#define TEST_BLOCK_SIZE 100
+
+class FileDownloadUT : public testing::Test {
+  public:
+    /* a download of 10 blocks, the last one half full */
+    void SetUp() override { download = std::make_shared<FileDownload>(TEST_BLOCK_SIZE * 9 + 50, TEST_BLOCK_SIZE); }
+    /* take the next block, its offset or UINT64_MAX when none is left */
+    uint64_t Next()
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        return download->NextBlock(offset, size) ? offset : UINT64_MAX;
+    }
+
+    std::shared_ptr<FileDownload> download;
+};
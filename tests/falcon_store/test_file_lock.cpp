@@ -1,6 +1,8 @@
 #include "test_file_lock.h"
 
 #include <future>
+#include <numeric>
+#include <thread>
 
 FileLock FileLockUT::flk;
 uint64_t FileLockUT::id = 0;
@@ -50,6 +52,112 @@ TEST_F(FileLockUT, TestLocked)
     flk.ReleaseFileLock(id, LockMode::X);
 }
 
+TEST_F(FileLockUT, RangeLock)
+{
+    EXPECT_TRUE(flk.GetRangeLock(id, 0, 4096, LockMode::X, false));
+    EXPECT_TRUE(flk.GetRangeLock(id, 4096, 4096, LockMode::X, false));
+    EXPECT_FALSE(flk.GetRangeLock(id, 2048, 4096, LockMode::S, false));
+    EXPECT_FALSE(flk.TryGetFileLock(id, LockMode::S));
+    EXPECT_TRUE(flk.TestRangeLocked(id, 1024, 1, LockMode::S));
+    EXPECT_FALSE(flk.TestRangeLocked(id, 8192, 4096, LockMode::X));
+    flk.ReleaseRangeLock(id, 0, 4096, LockMode::X);
+    EXPECT_TRUE(flk.GetRangeLock(id, 2048, 1024, LockMode::S, false));
+    EXPECT_TRUE(flk.GetRangeLock(id, 0, 4096, LockMode::S, false));
+    flk.ReleaseRangeLock(id, 2048, 1024, LockMode::S);
+    flk.ReleaseRangeLock(id, 0, 4096, LockMode::S);
+    flk.ReleaseRangeLock(id, 4096, 4096, LockMode::X);
+    EXPECT_FALSE(flk.TestLocked(id, LockMode::X));
+}
+
+TEST_F(FileLockUT, RangeLocker)
+{
+    {
+        FileLocker locker(&flk, id, 0, 4096, LockMode::X, false);
+        EXPECT_TRUE(locker.isLocked());
+        FileLocker other(&flk, id, 4096, FILE_LOCK_WHOLE, LockMode::X, false);
+        EXPECT_TRUE(other.isLocked());
+        FileLocker whole(&flk, id, LockMode::S, false);
+        EXPECT_FALSE(whole.isLocked());
+    }
+    EXPECT_FALSE(flk.TestLocked(id, LockMode::X));
+}
+
+TEST_F(FileLockUT, Contention)
+{
+    const int threadNum = 8;
+    const int loops = 2000;
+    const uint64_t inodeNum = 4;
+    std::vector<int> counters(inodeNum, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadNum; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < loops; ++i) {
+                uint64_t inode = (t + i) % inodeNum;
+                FileLocker locker(&flk, inode, LockMode::X, true);
+                counters[inode]++;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(std::accumulate(counters.begin(), counters.end(), 0), threadNum * loops);
+    for (uint64_t inode = 0; inode < inodeNum; ++inode) {
+        EXPECT_FALSE(flk.TestLocked(inode, LockMode::X));
+    }
+}
+
+TEST_F(FileLockUT, DisjointRangesConcurrent)
+{
+    /* every writer holds its own range for the whole run, none may block the others */
+    const int threadNum = 8;
+    const uint64_t rangeSize = 1 << 20;
+    std::atomic<int> holding = 0;
+    std::vector<std::future<void>> writers;
+    for (int t = 0; t < threadNum; ++t) {
+        writers.push_back(std::async(std::launch::async, [&, t]() {
+            FileLocker locker(&flk, id, t * rangeSize, rangeSize, LockMode::X, true);
+            holding++;
+            while (holding.load() < threadNum) {
+                std::this_thread::yield();
+            }
+        }));
+    }
+    for (auto &writer : writers) {
+        EXPECT_EQ(writer.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+    }
+    EXPECT_FALSE(flk.TestLocked(id, LockMode::X));
+}
+
+TEST_F(FileLockUT, Fairness)
+{
+    /* a waiting X lock is not passed by S locks that come after it */
+    flk.WaitGetFileLock(id, LockMode::S);
+    std::atomic<bool> xLocked = false;
+    auto writer = std::async(std::launch::async, [&]() {
+        flk.WaitGetFileLock(id, LockMode::X);
+        xLocked = true;
+    });
+    /* the file is S locked, so another S lock only fails once the writer is queued */
+    while (flk.TryGetFileLock(id, LockMode::S)) {
+        flk.ReleaseFileLock(id, LockMode::S);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto reader = std::async(std::launch::async, [&]() {
+        flk.WaitGetFileLock(id, LockMode::S);
+        bool afterWriter = xLocked.load();
+        flk.ReleaseFileLock(id, LockMode::S);
+        return afterWriter;
+    });
+    EXPECT_EQ(reader.wait_for(std::chrono::milliseconds(100)), std::future_status::timeout);
+    flk.ReleaseFileLock(id, LockMode::S);
+    writer.wait();
+    EXPECT_TRUE(xLocked.load());
+    flk.ReleaseFileLock(id, LockMode::X);
+    EXPECT_TRUE(reader.get());
+    EXPECT_FALSE(flk.TestLocked(id, LockMode::X));
+}
+
 INSTANTIATE_TEST_SUITE_P(FileLockSuite,
                          FileLockUT,
                          ::testing::Values(std::make_tuple(LockMode::S, LockMode::S, true),
@@ -0,0 +1,193 @@
+#include "test_kv_store.h"
+
+#include <atomic>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "stats/falcon_stats.h"
+
+#define UT_BLOCK_SIZE 4096
+
+std::string KvStoreUT::scratchPath;
+
+static std::string Noise(size_t size, uint64_t seed = 42)
+{
+    std::mt19937_64 engine(seed);
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = (char)engine();
+    }
+    return data;
+}
+
+/* keys that all land in shard 0, so the capacity of one shard decides what moves */
+static std::vector<std::string> KeysOfOneShard(size_t count)
+{
+    std::vector<std::string> keys;
+    for (uint64_t i = 0; keys.size() < count; ++i) {
+        std::string key = "key" + std::to_string(i);
+        if (std::hash<std::string>{}(key) % KV_SHARDS == 0) {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+static std::string GetBlock(const std::string &key)
+{
+    std::shared_ptr<const std::string> block;
+    return KvStore::GetInstance().Get(key, block) == 0 ? *block : "";
+}
+
+TEST_F(KvStoreUT, PutGetExistsDelete)
+{
+    KvStore &store = KvStore::GetInstance();
+    EXPECT_EQ(store.Put("a", "x"), -EOPNOTSUPP);
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, KV_SHARDS * UT_BLOCK_SIZE * 4, 0, 0), 0);
+
+    std::string data = Noise(UT_BLOCK_SIZE);
+    EXPECT_EQ(store.Put(std::string("a\0b", 3), data), 0);
+    EXPECT_EQ(GetBlock(std::string("a\0b", 3)), data);
+    EXPECT_TRUE(store.Exists(std::string("a\0b", 3)));
+    EXPECT_FALSE(store.Exists("a"));
+    /* replaced whole, blocks may be shorter than the block size */
+    EXPECT_EQ(store.Put(std::string("a\0b", 3), "short"), 0);
+    EXPECT_EQ(GetBlock(std::string("a\0b", 3)), "short");
+    EXPECT_EQ(store.DramBytes(), 5);
+
+    EXPECT_EQ(store.Delete(std::string("a\0b", 3)), 0);
+    EXPECT_EQ(store.Delete(std::string("a\0b", 3)), -ENOENT);
+    std::shared_ptr<const std::string> block;
+    EXPECT_EQ(store.Get(std::string("a\0b", 3), block), -ENOENT);
+    EXPECT_EQ(store.DramBytes(), 0);
+
+    EXPECT_EQ(store.Put("big", Noise(UT_BLOCK_SIZE + 1)), -EMSGSIZE);
+    EXPECT_EQ(store.Put("", data), -EINVAL);
+    EXPECT_EQ(store.Put(std::string(KV_MAX_KEY_SIZE + 1, 'k'), data), -EINVAL);
+}
+
+TEST_F(KvStoreUT, SpillsLeastRecentlyUsedToDisk)
+{
+    KvStore &store = KvStore::GetInstance();
+    /* two blocks in memory and one on disk per shard */
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, KV_SHARDS * UT_BLOCK_SIZE * 2, KV_SHARDS * UT_BLOCK_SIZE, 0), 0);
+    std::vector<std::string> keys = KeysOfOneShard(4);
+    auto &stats = FalconStats::GetInstance().stats;
+    stats[KV_SPILL] = 0;
+    stats[KV_EVICT] = 0;
+
+    ASSERT_EQ(store.Put(keys[0], Noise(UT_BLOCK_SIZE, 0)), 0);
+    ASSERT_EQ(store.Put(keys[1], Noise(UT_BLOCK_SIZE, 1)), 0);
+    ASSERT_EQ(store.Put(keys[2], Noise(UT_BLOCK_SIZE, 2)), 0);
+    /* key 0 went to disk */
+    EXPECT_EQ(stats[KV_SPILL], UT_BLOCK_SIZE);
+    EXPECT_EQ(store.SsdBytes(), UT_BLOCK_SIZE);
+
+    /* read back from disk into memory, key 1 goes to disk instead */
+    EXPECT_EQ(GetBlock(keys[0]), Noise(UT_BLOCK_SIZE, 0));
+    EXPECT_EQ(stats[KV_SPILL], 2 * UT_BLOCK_SIZE);
+
+    /* key 2 goes to disk and key 1 is evicted from there */
+    ASSERT_EQ(store.Put(keys[3], Noise(UT_BLOCK_SIZE, 3)), 0);
+    EXPECT_EQ(stats[KV_EVICT], 1);
+    EXPECT_FALSE(store.Exists(keys[1]));
+    EXPECT_EQ(GetBlock(keys[2]), Noise(UT_BLOCK_SIZE, 2));
+    EXPECT_EQ(GetBlock(keys[3]), Noise(UT_BLOCK_SIZE, 3));
+    EXPECT_EQ(store.DramBytes(), 2 * UT_BLOCK_SIZE);
+    EXPECT_EQ(store.SsdBytes(), UT_BLOCK_SIZE);
+}
+
+TEST_F(KvStoreUT, ConcurrentSpillsKeepBlocksAndFilesInStep)
+{
+    KvStore &store = KvStore::GetInstance();
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, KV_SHARDS * UT_BLOCK_SIZE * 2, KV_SHARDS * UT_BLOCK_SIZE * 4, 0),
+              0);
+    std::vector<std::string> keys = KeysOfOneShard(16);
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong{0};
+    /* each thread owns four keys, a block got back is the last one put or none as it was evicted */
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t round = 0; round < 200; ++round) {
+                for (int k = t * 4; k < t * 4 + 4; ++k) {
+                    uint64_t seed = k * 1000 + round;
+                    if (store.Put(keys[k], Noise(UT_BLOCK_SIZE, seed)) != 0) {
+                        wrong++;
+                    }
+                    std::string got = GetBlock(keys[(k + 1) % 4 + t * 4]);
+                    if (!got.empty() && got.size() != UT_BLOCK_SIZE) {
+                        wrong++;
+                    }
+                    got = GetBlock(keys[k]);
+                    if (!got.empty() && got != Noise(UT_BLOCK_SIZE, seed)) {
+                        wrong++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(wrong, 0);
+    EXPECT_EQ(store.DramBytes(), 2 * UT_BLOCK_SIZE);
+    /* no file is left behind by a block that moved or went while it was written */
+    uint64_t files = 0;
+    for (auto &entry : std::filesystem::directory_iterator(scratchPath + "/kv/0")) {
+        (void)entry;
+        files++;
+    }
+    EXPECT_EQ(files * UT_BLOCK_SIZE, store.SsdBytes());
+    EXPECT_EQ(store.SsdBytes(), 4 * UT_BLOCK_SIZE);
+}
+
+TEST_F(KvStoreUT, DiskOnlyBlocksDoNotSurviveRestart)
+{
+    KvStore &store = KvStore::GetInstance();
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, 0, KV_SHARDS * UT_BLOCK_SIZE * 2, 0), 0);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(store.Put("block" + std::to_string(i), Noise(UT_BLOCK_SIZE, i)), 0);
+    }
+    EXPECT_EQ(store.DramBytes(), 0);
+    EXPECT_EQ(store.SsdBytes(), 8 * UT_BLOCK_SIZE);
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(GetBlock("block" + std::to_string(i)), Noise(UT_BLOCK_SIZE, i));
+    }
+
+    store.Stop();
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, 0, KV_SHARDS * UT_BLOCK_SIZE * 2, 0), 0);
+    EXPECT_FALSE(store.Exists("block0"));
+    EXPECT_EQ(store.SsdBytes(), 0);
+}
+
+TEST_F(KvStoreUT, ExpiredBlocksAreDropped)
+{
+    KvStore &store = KvStore::GetInstance();
+    ASSERT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, KV_SHARDS * UT_BLOCK_SIZE * 4, 0, 0), 0);
+    ASSERT_EQ(store.Put("short lived", "a", 1), 0);
+    ASSERT_EQ(store.Put("kept", "b"), 0);
+    EXPECT_TRUE(store.Exists("short lived"));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    EXPECT_FALSE(store.Exists("short lived"));
+    std::shared_ptr<const std::string> block;
+    EXPECT_EQ(store.Get("short lived", block), -ENOENT);
+    EXPECT_EQ(GetBlock("kept"), "b");
+}
+
+TEST_F(KvStoreUT, RejectsTiersTooSmallForABlockPerShard)
+{
+    KvStore &store = KvStore::GetInstance();
+    EXPECT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, 0, 0, 0), -EINVAL);
+    EXPECT_EQ(store.Start(scratchPath, UT_BLOCK_SIZE, KV_SHARDS * UT_BLOCK_SIZE - 1, 0, 0), -EINVAL);
+    EXPECT_EQ(store.Start(scratchPath, 0, KV_SHARDS * UT_BLOCK_SIZE, 0, 0), -EINVAL);
+    EXPECT_FALSE(store.Enabled());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/kv_store.h"
+
+class KvStoreUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        scratchPath = std::filesystem::temp_directory_path() / "falcon_kv_store_ut";
+        std::filesystem::remove_all(scratchPath);
+        std::filesystem::create_directories(scratchPath);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(scratchPath); }
+    void TearDown() override { KvStore::GetInstance().Stop(); }
+
+    static std::string scratchPath;
+};
@@ -0,0 +1,69 @@
+#include "test_latency_tracker.h"
+
+TEST_F(LatencyTrackerUT, TooFewSamples)
+{
+    LatencyTracker tracker;
+    for (int i = 0; i < LATENCY_MIN_SAMPLES - 1; ++i) {
+        tracker.Record(100);
+    }
+    EXPECT_EQ(tracker.Percentile(95), 0);
+    tracker.Record(100);
+    EXPECT_GT(tracker.Percentile(95), 0);
+}
+
+TEST_F(LatencyTrackerUT, Percentile)
+{
+    LatencyTracker tracker;
+    for (int i = 0; i < 900; ++i) {
+        tracker.Record(100);
+    }
+    for (int i = 0; i < 100; ++i) {
+        tracker.Record(10000);
+    }
+    uint64_t p50 = tracker.Percentile(50);
+    EXPECT_GE(p50, 64);
+    EXPECT_LT(p50, 128);
+    uint64_t p99 = tracker.Percentile(99);
+    EXPECT_GE(p99, 8192);
+    EXPECT_LT(p99, 16384);
+    EXPECT_LE(tracker.Percentile(90), tracker.Percentile(95));
+}
+
+TEST_F(LatencyTrackerUT, FollowsRecentLatency)
+{
+    LatencyTracker tracker;
+    for (int i = 0; i < 4 * LATENCY_DECAY_SAMPLES; ++i) {
+        tracker.Record(100);
+    }
+    for (int i = 0; i < 4 * LATENCY_DECAY_SAMPLES; ++i) {
+        tracker.Record(10000);
+    }
+    EXPECT_GE(tracker.Percentile(50), 8192);
+    EXPECT_GT(tracker.Mean(), 5000);
+}
+
+TEST_F(LatencyTrackerUT, Load)
+{
+    LatencyTracker fast;
+    LatencyTracker slow;
+    EXPECT_EQ(fast.Load(), 0);
+    for (int i = 0; i < 100; ++i) {
+        fast.Record(100);
+        slow.Record(1000);
+    }
+    EXPECT_LT(fast.Load(), slow.Load());
+    for (int i = 0; i < 20; ++i) {
+        fast.Begin();
+    }
+    EXPECT_GT(fast.Load(), slow.Load());
+    for (int i = 0; i < 20; ++i) {
+        fast.End();
+    }
+    EXPECT_EQ(fast.Inflight(), 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
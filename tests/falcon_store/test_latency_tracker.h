@@ -0,0 +1,14 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "connection/latency_tracker.h"
+
+class LatencyTrackerUT : public testing::Test {
+  public:
+    static void SetUpTestSuite() {}
+    static void TearDownTestSuite() {}
+    void SetUp() override {}
+    void TearDown() override {}
+};
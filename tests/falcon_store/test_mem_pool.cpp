@@ -0,0 +1,118 @@
+#include "test_mem_pool.h"
+
+#include <thread>
+
+MemPool MemPoolUT::pool(MemPoolUT::blockSize, MemPoolUT::capacity);
+
+TEST_F(MemPoolUT, ThreadCacheReuse)
+{
+    void *block = pool.alloc();
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ((uintptr_t)block % MEMPOOL_ALIGN, 0);
+    pool.free(block);
+
+    size_t hits = Stat(MEMPOOL_HIT);
+    size_t misses = Stat(MEMPOOL_MISS);
+    void *again = pool.alloc();
+    EXPECT_EQ(again, block);
+    EXPECT_EQ(Stat(MEMPOOL_MISS), misses);
+    /* cache hits are published in batches */
+    EXPECT_GE(Stat(MEMPOOL_HIT), hits);
+    pool.free(again);
+}
+
+TEST_F(MemPoolUT, SizeClass)
+{
+    void *small = pool.alloc(100 * 1024);
+    void *medium = pool.alloc(300 * 1024);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(medium, nullptr);
+    EXPECT_NE(small, medium);
+    pool.free(small, 100 * 1024);
+    pool.free(medium, 300 * 1024);
+
+    /* any size of the same class takes the cached block back */
+    void *block = pool.alloc(blockSize / 8);
+    EXPECT_EQ(block, small);
+    pool.free(block, blockSize / 8);
+    block = pool.alloc(blockSize / 2);
+    EXPECT_EQ(block, medium);
+    pool.free(block, blockSize / 2);
+}
+
+TEST_F(MemPoolUT, Fallback)
+{
+    size_t fallbacks = Stat(MEMPOOL_FALLBACK);
+    void *large = pool.alloc(2 * blockSize);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(Stat(MEMPOOL_FALLBACK), fallbacks + 1);
+    pool.free(large, 2 * blockSize);
+
+    std::vector<void *> blocks;
+    for (size_t i = 0; i < capacity + 1; ++i) {
+        blocks.push_back(pool.alloc());
+        ASSERT_NE(blocks.back(), nullptr);
+    }
+    EXPECT_EQ(Stat(MEMPOOL_FALLBACK), fallbacks + 2);
+    for (void *block : blocks) {
+        pool.free(block);
+    }
+
+    /* the pool is back at capacity, the next allocations are served from it */
+    size_t misses = Stat(MEMPOOL_MISS);
+    for (size_t i = 0; i < capacity; ++i) {
+        blocks[i] = pool.alloc();
+    }
+    EXPECT_EQ(Stat(MEMPOOL_MISS), misses);
+    EXPECT_EQ(Stat(MEMPOOL_FALLBACK), fallbacks + 2);
+    for (size_t i = 0; i < capacity; ++i) {
+        pool.free(blocks[i]);
+    }
+}
+
+TEST_F(MemPoolUT, ThreadExit)
+{
+    void *block = nullptr;
+    std::thread worker([&]() {
+        block = pool.alloc(blockSize / 4);
+        pool.free(block, blockSize / 4);
+    });
+    worker.join();
+
+    /* the exiting thread handed its cache to the depot */
+    size_t misses = Stat(MEMPOOL_MISS);
+    void *again = pool.alloc(blockSize / 4);
+    EXPECT_EQ(again, block);
+    EXPECT_EQ(Stat(MEMPOOL_MISS), misses);
+    pool.free(again, blockSize / 4);
+}
+
+TEST_F(MemPoolUT, ConfiguredBeforeInit)
+{
+    static MemPool numaPool;
+    numaPool.SetNuma(true);
+    numaPool.SetHugePage(true);
+    numaPool.init(blockSize, capacity);
+    ASSERT_TRUE(numaPool.initArena());
+    void *block = numaPool.alloc();
+    EXPECT_TRUE(numaPool.inArena(block));
+    numaPool.free(block);
+
+    /* blocks handed to the depot of one node are found from any thread */
+    std::thread worker([&]() {
+        block = numaPool.alloc(blockSize / 4);
+        numaPool.free(block, blockSize / 4);
+    });
+    worker.join();
+    size_t misses = Stat(MEMPOOL_MISS);
+    void *again = numaPool.alloc(blockSize / 4);
+    EXPECT_EQ(again, block);
+    EXPECT_EQ(Stat(MEMPOOL_MISS), misses);
+    numaPool.free(again, blockSize / 4);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "buffer/mem_pool.h"
+
+class MemPoolUT : public testing::Test {
+  public:
+    static void SetUpTestSuite() {}
+    static void TearDownTestSuite() {}
+    void SetUp() override {}
+    void TearDown() override {}
+
+    static size_t Stat(int item) { return FalconStats::GetInstance().stats[item].load(); }
+
+    static MemPool pool;
+    static constexpr size_t blockSize = 1024 * 1024;
+    static constexpr size_t capacity = 4;
+};
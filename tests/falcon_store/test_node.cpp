@@ -144,6 +144,63 @@ TEST_F(NodeUT, UpdateNodeConfigByValueInvalid)
     EXPECT_EQ(endpoint, newNode);
 }
 
+TEST_F(NodeUT, PreviousOwner)
+{
+    int nodeId = config->GetUint32(FalconPropertyKey::FALCON_NODE_ID);
+    int changes = 0;
+    StoreNode::GetInstance()->SetMembershipListener([&changes]() { changes++; });
+    uint64_t generation = StoreNode::GetInstance()->Generation();
+
+    std::unordered_map<int, std::string> zkNodes;
+    std::string newNode = "localhost:56039";
+    zkNodes[nodeId] = newNode;
+    zkNodes[nodeId + 10] = newNode;
+    zkNodes[nodeId + 20] = newNode;
+    std::unordered_map<int, std::string> sameNodes = zkNodes;
+    StoreNode::GetInstance()->UpdateNodeConfigByValue(zkNodes);
+    EXPECT_EQ(changes, 1);
+    EXPECT_GT(StoreNode::GetInstance()->Generation(), generation);
+
+    /* only keys the new node took over have a previous owner, and it is one of the old nodes */
+    int moved = 0;
+    for (uint64_t key = 0; key < 1000; key++) {
+        int previous = StoreNode::GetInstance()->PreviousOwner(key);
+        if (StoreNode::GetInstance()->AllocNode(key) == nodeId + 20) {
+            EXPECT_TRUE(previous == nodeId || previous == nodeId + 10);
+            moved++;
+        } else {
+            EXPECT_EQ(previous, -1);
+        }
+    }
+    EXPECT_GT(moved, 0);
+
+    /* same membership again is no change */
+    StoreNode::GetInstance()->UpdateNodeConfigByValue(sameNodes);
+    EXPECT_EQ(changes, 1);
+    StoreNode::GetInstance()->SetMembershipListener(nullptr);
+}
+
+TEST_F(NodeUT, ReplicaNodes)
+{
+    uint64_t key = 100;
+    int owner = StoreNode::GetInstance()->AllocNode(key);
+    StoreNode::GetInstance()->SetReplicas(2);
+    std::vector<int> nodes = StoreNode::GetInstance()->ReplicaNodes(owner, key);
+    ASSERT_EQ(nodes.size(), 2);
+    EXPECT_EQ(nodes[0], owner);
+    EXPECT_NE(nodes[1], owner);
+    EXPECT_EQ(nodes[1], StoreNode::GetInstance()->GetNextNode(owner, key));
+
+    /* an owner taken over after a failover stays first */
+    std::vector<int> failover = StoreNode::GetInstance()->ReplicaNodes(nodes[1], key);
+    ASSERT_EQ(failover.size(), 2);
+    EXPECT_EQ(failover[0], nodes[1]);
+    EXPECT_EQ(failover[1], owner);
+
+    StoreNode::GetInstance()->SetReplicas(1);
+    EXPECT_EQ(StoreNode::GetInstance()->ReplicaNodes(owner, key), std::vector<int>{owner});
+}
+
 TEST_F(NodeUT, DeleteNode)
 {
     int oldNumber = StoreNode::GetInstance()->GetNumberofAllNodes();
@@ -0,0 +1,128 @@
+#include "test_node_placement.h"
+
+#include <map>
+
+TEST_F(NodePlacementUT, Empty)
+{
+    NodePlacement placement;
+    EXPECT_EQ(placement.Locate(1), -1);
+    EXPECT_TRUE(placement.Rank(1, 3).empty());
+}
+
+TEST_F(NodePlacementUT, Balance)
+{
+    const int nodeNum = 8;
+    NodePlacement placement;
+    for (int i = 0; i < nodeNum; ++i) {
+        placement.AddNode(i);
+    }
+    std::map<int, uint64_t> counts;
+    for (int node : Place(placement)) {
+        counts[node]++;
+    }
+    EXPECT_EQ(counts.size(), (size_t)nodeNum);
+    for (auto &[node, count] : counts) {
+        EXPECT_NEAR((double)count / keyNum, 1.0 / nodeNum, 0.01 / nodeNum) << "node " << node;
+    }
+}
+
+TEST_F(NodePlacementUT, Weighted)
+{
+    std::vector<double> weights = {1, 2, 1, 4};
+    NodePlacement placement;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        placement.AddNode(i, weights[i]);
+    }
+    std::map<int, uint64_t> counts;
+    for (int node : Place(placement)) {
+        counts[node]++;
+    }
+    double total = 8;
+    for (size_t i = 0; i < weights.size(); ++i) {
+        EXPECT_NEAR((double)counts[i] / keyNum, weights[i] / total, 0.01 * weights[i] / total) << "node " << i;
+    }
+}
+
+TEST_F(NodePlacementUT, StableAcrossOrder)
+{
+    NodePlacement forward;
+    NodePlacement backward;
+    for (int i = 0; i < 6; ++i) {
+        forward.AddNode(i, 1 + i % 3);
+        backward.AddNode(5 - i, 1 + (5 - i) % 3);
+    }
+    for (uint64_t key = 0; key < 100000; ++key) {
+        EXPECT_EQ(forward.Locate(key), backward.Locate(key));
+    }
+}
+
+TEST_F(NodePlacementUT, AddNodeMovesOneNth)
+{
+    const int nodeNum = 8;
+    NodePlacement placement;
+    for (int i = 0; i < nodeNum; ++i) {
+        placement.AddNode(i);
+    }
+    std::vector<int> before = Place(placement);
+    placement.AddNode(nodeNum);
+    std::vector<int> after = Place(placement);
+
+    uint64_t moved = 0;
+    for (uint64_t key = 0; key < keyNum; ++key) {
+        if (before[key] != after[key]) {
+            /* keys only move to the new node */
+            EXPECT_EQ(after[key], nodeNum);
+            moved++;
+        }
+    }
+    EXPECT_NEAR((double)moved / keyNum, 1.0 / (nodeNum + 1), 0.01 / (nodeNum + 1));
+}
+
+TEST_F(NodePlacementUT, RemoveNodeMovesItsKeys)
+{
+    const int nodeNum = 8;
+    const int removed = 3;
+    NodePlacement placement;
+    for (int i = 0; i < nodeNum; ++i) {
+        placement.AddNode(i);
+    }
+    std::vector<int> before = Place(placement);
+    placement.RemoveNode(removed);
+    std::vector<int> after = Place(placement);
+
+    uint64_t moved = 0;
+    for (uint64_t key = 0; key < keyNum; ++key) {
+        if (before[key] != after[key]) {
+            EXPECT_EQ(before[key], removed);
+            moved++;
+        }
+        EXPECT_NE(after[key], removed);
+    }
+    EXPECT_NEAR((double)moved / keyNum, 1.0 / nodeNum, 0.01 / nodeNum);
+}
+
+TEST_F(NodePlacementUT, Rank)
+{
+    NodePlacement placement;
+    for (int i = 0; i < 5; ++i) {
+        placement.AddNode(i);
+    }
+    for (uint64_t key = 0; key < 1000; ++key) {
+        std::vector<int> ranked = placement.Rank(key, 3);
+        ASSERT_EQ(ranked.size(), 3);
+        EXPECT_EQ(ranked[0], placement.Locate(key));
+        EXPECT_NE(ranked[0], ranked[1]);
+        EXPECT_NE(ranked[1], ranked[2]);
+        EXPECT_NE(ranked[0], ranked[2]);
+        /* the runner-up takes over when the first node goes away */
+        NodePlacement without = placement;
+        without.RemoveNode(ranked[0]);
+        EXPECT_EQ(without.Locate(key), ranked[1]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "connection/node_placement.h"
+
+class NodePlacementUT : public testing::Test {
+  public:
+    static void SetUpTestSuite() {}
+    static void TearDownTestSuite() {}
+    void SetUp() override {}
+    void TearDown() override {}
+
+    static std::vector<int> Place(const NodePlacement &placement)
+    {
+        std::vector<int> nodes(keyNum);
+        for (uint64_t key = 0; key < keyNum; ++key) {
+            nodes[key] = placement.Locate(key);
+        }
+        return nodes;
+    }
+
+    static constexpr uint64_t keyNum = 2000000;
+};
@@ -0,0 +1,85 @@
+#include "test_path_node_map.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_F(PathNodeMapUT, ParentPath)
+{
+    EXPECT_EQ(GetParentPathView("/a/b/c"), "/a/b");
+    EXPECT_EQ(GetParentPathView("/a"), "");
+    EXPECT_EQ(GetParentPathView("/a/b/c", 1), "/");
+    EXPECT_EQ(GetParentPathView("/a/b/c", 2), "/a/");
+    EXPECT_EQ(GetParentPathView("/a/b/c", 3), "/a/b/");
+    EXPECT_EQ(GetParentPathView("/a/b/c", 5), "/a/b/");
+    EXPECT_EQ(GetParentPathView("/a/b/c/d", 3), "/a/b/");
+    EXPECT_EQ(GetParentPathView("/a", 2), "/");
+    EXPECT_EQ(GetParentPathView("/", 2), "/");
+}
+
+TEST_F(PathNodeMapUT, GetOrAlloc)
+{
+    PathNodeMap nodeMap;
+    int allocs = 0;
+    auto alloc = [&allocs](std::string_view path) {
+        allocs++;
+        return (int)path.size();
+    };
+    EXPECT_EQ(nodeMap.GetOrAlloc("/a/", alloc), 3);
+    EXPECT_EQ(nodeMap.GetOrAlloc("/a/", alloc), 3);
+    EXPECT_EQ(allocs, 1);
+    nodeMap.Set("/a/", 7);
+    int nodeId = -1;
+    EXPECT_TRUE(nodeMap.Get("/a/", nodeId));
+    EXPECT_EQ(nodeId, 7);
+    EXPECT_FALSE(nodeMap.Get("/b/", nodeId));
+}
+
+TEST_F(PathNodeMapUT, Eviction)
+{
+    PathNodeMap nodeMap(PATH_NODE_MAP_SHARDS);
+    auto alloc = [](std::string_view) { return 1; };
+    for (int i = 0; i < 10 * PATH_NODE_MAP_SHARDS; ++i) {
+        nodeMap.GetOrAlloc("/dir" + std::to_string(i), alloc);
+    }
+    EXPECT_LE(nodeMap.Size(), PATH_NODE_MAP_SHARDS);
+}
+
+TEST_F(PathNodeMapUT, Concurrent)
+{
+    /* every thread resolves the same directories, each is allocated once and seen the same by all */
+    const int threadNum = 16;
+    const int dirNum = 1000;
+    PathNodeMap nodeMap;
+    std::vector<std::atomic<int>> allocs(dirNum);
+    std::vector<std::vector<int>> seen(threadNum, std::vector<int>(dirNum));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadNum; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < dirNum; ++i) {
+                int dir = (i + t * 37) % dirNum;
+                std::string path = DirPath(dir, t);
+                seen[t][dir] = nodeMap.GetOrAlloc(GetParentPathView(path), [&](std::string_view) {
+                    allocs[dir]++;
+                    return dir * threadNum + t;
+                });
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int dir = 0; dir < dirNum; ++dir) {
+        EXPECT_EQ(allocs[dir].load(), 1);
+        for (int t = 1; t < threadNum; ++t) {
+            EXPECT_EQ(seen[t][dir], seen[0][dir]);
+        }
+    }
+    EXPECT_EQ(nodeMap.Size(), (size_t)dirNum);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
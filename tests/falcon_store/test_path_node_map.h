@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "util/path_node_map.h"
+
+class PathNodeMapUT : public testing::Test {
+  public:
+    static void SetUpTestSuite() {}
+    static void TearDownTestSuite() {}
+    void SetUp() override {}
+    void TearDown() override {}
+
+    static std::string DirPath(int dir, int file)
+    {
+        return "/ckpt/dir" + std::to_string(dir) + "/file" + std::to_string(file);
+    }
+};
@@ -0,0 +1,58 @@
+#include "test_prefetcher.h"
+
+#include <thread>
+
+TEST_F(PrefetcherUT, StagesAheadOfReads)
+{
+    uint64_t streamId = Prefetcher::GetInstance().Register(Order(10));
+    EXPECT_NE(streamId, 0);
+    /* distance 2 */
+    EXPECT_EQ(stager->WaitStaged(2), 2);
+    Prefetcher::GetInstance().Accessed(1);
+    EXPECT_EQ(stager->WaitStaged(3), 3);
+    Prefetcher::GetInstance().Accessed(2);
+    Prefetcher::GetInstance().Accessed(3);
+    EXPECT_EQ(stager->WaitStaged(5), 5);
+    EXPECT_EQ(stager->staged, std::vector<uint64_t>({1, 2, 3, 4, 5}));
+    EXPECT_EQ(FalconStats::GetInstance().stats[PREFETCH_HIT], 3);
+    EXPECT_EQ(FalconStats::GetInstance().stats[PREFETCH_LATE], 0);
+
+    /* reading a file again or one of no stream changes nothing */
+    Prefetcher::GetInstance().Accessed(2);
+    Prefetcher::GetInstance().Accessed(100);
+    EXPECT_EQ(stager->WaitStaged(6), 5);
+}
+
+TEST_F(PrefetcherUT, SkipsPassedFiles)
+{
+    Prefetcher::GetInstance().Register(Order(10), 3);
+    EXPECT_EQ(stager->WaitStaged(3), 3);
+    /* the reader jumps ahead, files 4 to 6 are never needed */
+    Prefetcher::GetInstance().Accessed(7);
+    EXPECT_EQ(stager->WaitStaged(6), 6);
+    EXPECT_EQ(stager->staged, std::vector<uint64_t>({1, 2, 3, 8, 9, 10}));
+}
+
+TEST_F(PrefetcherUT, Unregister)
+{
+    uint64_t streamId = Prefetcher::GetInstance().Register(Order(10));
+    EXPECT_EQ(stager->WaitStaged(2), 2);
+    Prefetcher::GetInstance().Unregister(streamId);
+    Prefetcher::GetInstance().Accessed(1);
+    Prefetcher::GetInstance().Accessed(2);
+    EXPECT_EQ(stager->WaitStaged(3), 2);
+}
+
+TEST_F(PrefetcherUT, Disabled)
+{
+    Prefetcher::GetInstance().Stop();
+    EXPECT_EQ(Prefetcher::GetInstance().Register(Order(10)), 0);
+    Prefetcher::GetInstance().Accessed(1);
+    EXPECT_EQ(stager->WaitStaged(1), 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
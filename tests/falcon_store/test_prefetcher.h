@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/prefetcher.h"
+#include "stats/falcon_stats.h"
+
+/* records the files staged in order */
+struct FakeStager {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<uint64_t> staged;
+
+    int Stage(const PrefetchEntry &entry)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        staged.push_back(entry.inodeId);
+        cv.notify_all();
+        return 0;
+    }
+    /* wait until count files are staged, the stage count after a grace period if it was reached */
+    size_t WaitStaged(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, std::chrono::seconds(1), [this, count]() { return staged.size() >= count; });
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        lock.lock();
+        return staged.size();
+    }
+};
+
+class PrefetcherUT : public testing::Test {
+  public:
+    void SetUp() override
+    {
+        stager = std::make_shared<FakeStager>();
+        auto fake = stager;
+        ASSERT_EQ(Prefetcher::GetInstance().Start(1, 2, [fake](const PrefetchEntry &entry) {
+            return fake->Stage(entry);
+        }),
+                  0);
+        FalconStats::GetInstance().stats[PREFETCH_HIT] = 0;
+        FalconStats::GetInstance().stats[PREFETCH_LATE] = 0;
+    }
+    void TearDown() override { Prefetcher::GetInstance().Stop(); }
+    /* files 1 to count in order */
+    static std::vector<PrefetchEntry> Order(uint64_t count)
+    {
+        std::vector<PrefetchEntry> order;
+        for (uint64_t i = 1; i <= count; ++i) {
+            order.push_back({i, "/file" + std::to_string(i), 100});
+        }
+        return order;
+    }
+
+    std::shared_ptr<FakeStager> stager;
+};
@@ -49,6 +49,30 @@ TEST_F(FalconStoreUT, WaitPop)
     s_pipe.Destroy();
 }
 
+TEST_F(FalconStoreUT, PipeFill)
+{
+    Pipe pipe;
+    size_t blockSize = 4096;
+    pipe.Init(blockSize, nullptr);
+    std::string block(blockSize, 'f');
+    butil::IOBuf buf;
+    buf.append(block.data(), block.size());
+    EXPECT_TRUE(pipe.Fill(buf, blockSize));
+    EXPECT_TRUE(buf.empty());
+
+    std::string out(blockSize, 0);
+    bool end = false;
+    ssize_t retSize = pipe.WaitPop(out.data(), blockSize, end);
+    EXPECT_EQ(retSize, blockSize);
+    EXPECT_TRUE(end);
+    EXPECT_EQ(out, block);
+
+    EXPECT_TRUE(pipe.Fill(buf, -EPIPE));
+    retSize = pipe.WaitPop(out.data(), blockSize, end);
+    EXPECT_EQ(retSize, -EPIPE);
+    EXPECT_FALSE(pipe.Fill(buf, blockSize));
+}
+
 /*-------------------------------------------- ReadStream --------------------------------------------*/
 
 TEST_F(FalconStoreUT, ReadStreamInit)
@@ -105,6 +129,44 @@ TEST_F(FalconStoreUT, ReadStreamReadFull)
     openInstance = nullptr;
 }
 
+TEST_F(FalconStoreUT, ReadStreamTrackSequential)
+{
+    ReadStream stream;
+    size_t blockSize = config->GetUint32(FalconPropertyKey::FALCON_BLOCK_SIZE);
+    EXPECT_EQ(stream.Track(4 * blockSize, blockSize), ReadPattern::RANDOM);
+    EXPECT_EQ(stream.Track(5 * blockSize, blockSize), ReadPattern::RANDOM);
+    EXPECT_EQ(stream.Track(6 * blockSize, blockSize), ReadPattern::SEQUENTIAL);
+    EXPECT_EQ(stream.Track(7 * blockSize, blockSize), ReadPattern::SEQUENTIAL);
+    EXPECT_EQ(stream.Track(0, blockSize), ReadPattern::RANDOM);
+}
+
+TEST_F(FalconStoreUT, ReadStreamTrackStrided)
+{
+    ReadStream stream;
+    size_t recordSize = 4096;
+    off_t stride = 3 * 4096;
+    EXPECT_EQ(stream.Track(0, recordSize), ReadPattern::RANDOM);
+    EXPECT_EQ(stream.Track(stride, recordSize), ReadPattern::RANDOM);
+    EXPECT_EQ(stream.Track(2 * stride, recordSize), ReadPattern::RANDOM);
+    EXPECT_EQ(stream.Track(3 * stride, recordSize), ReadPattern::STRIDED);
+    EXPECT_EQ(stream.lastStride, stride);
+    /* size changes, pattern is broken */
+    EXPECT_EQ(stream.Track(4 * stride, 2 * recordSize), ReadPattern::RANDOM);
+}
+
+TEST_F(FalconStoreUT, ReadaheadBudget)
+{
+    ReadaheadBudget &budget = ReadaheadBudget::GetInstance();
+    budget.Init(READAHEAD_DEFAULT_MAX_WINDOW, 2 * FALCON_BLOCK_SIZE);
+    EXPECT_TRUE(budget.TryAcquire(FALCON_BLOCK_SIZE));
+    EXPECT_TRUE(budget.TryAcquire(FALCON_BLOCK_SIZE));
+    EXPECT_FALSE(budget.TryAcquire(FALCON_BLOCK_SIZE));
+    budget.Release(FALCON_BLOCK_SIZE);
+    EXPECT_TRUE(budget.TryAcquire(FALCON_BLOCK_SIZE));
+    budget.Release(2 * FALCON_BLOCK_SIZE);
+    budget.Init(READAHEAD_DEFAULT_MAX_WINDOW, SIZE_MAX);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,67 @@
+#include "test_rebalance.h"
+
+#include <future>
+
+std::string RebalanceUT::rootPath = "/tmp/falcon_rebalance_ut";
+std::unique_ptr<LocalCluster> RebalanceUT::cluster;
+std::vector<std::shared_ptr<FalconIOClient>> RebalanceUT::clients;
+
+TEST_F(RebalanceUT, SameCopyExists)
+{
+    std::string data = Content('a', 4096);
+    EXPECT_EQ(Migrate(1, 1, data, false), 0);
+    /* the sender may drop its copy */
+    EXPECT_EQ(Migrate(1, 1, data, false), -EEXIST);
+}
+
+TEST_F(RebalanceUT, OtherVersionIsKept)
+{
+    std::string data = Content('a', 4096);
+    EXPECT_EQ(Migrate(1, 2, data, false), 0);
+    EXPECT_EQ(Migrate(1, 2, Content('b', 4096), false), -ESTALE);
+    EXPECT_EQ(Migrate(1, 2, Content('a', 8192), false), -ESTALE);
+    /* the copy there is still the first one */
+    EXPECT_EQ(Migrate(1, 2, data, false), -EEXIST);
+}
+
+TEST_F(RebalanceUT, ReplicaReplaces)
+{
+    EXPECT_EQ(Migrate(1, 3, Content('a', 4096), false), 0);
+    EXPECT_EQ(Migrate(1, 3, Content('b', 4096), true), 0);
+    EXPECT_EQ(Migrate(1, 3, Content('b', 4096), false), -EEXIST);
+}
+
+TEST_F(RebalanceUT, ChunkedCopy)
+{
+    std::string data = Content('a', 2 * 4096);
+    data[4096] = 'b';
+    EXPECT_EQ(Migrate(0, 4, data, false, 0, 4096), 0);
+    EXPECT_EQ(Migrate(0, 4, data, false, 4096, 4096), 0);
+    EXPECT_EQ(Migrate(0, 4, data, false), -EEXIST);
+    EXPECT_EQ(Migrate(0, 4, Content('a', 2 * 4096), false), -ESTALE);
+}
+
+TEST_F(RebalanceUT, LocateChecksContent)
+{
+    std::string data = Content('a', 4096);
+    uint32_t fingerprint = BlockChecksums::OfBuffer(data.data(), data.size()).Fingerprint();
+    uint32_t other = BlockChecksums::OfBuffer(Content('b', 4096).data(), 4096).Fingerprint();
+    EXPECT_EQ(Migrate(1, 5, data, false), 0);
+    auto locate = [](uint64_t size, bool check, uint32_t fingerprint) {
+        auto result = std::make_shared<std::promise<int>>();
+        clients[1]->LocateCacheAsync(5, size, check, fingerprint, PEER_LOCATE_TIMEOUT_MS,
+                                     [result](int ret) { result->set_value(ret); });
+        return result->get_future().get();
+    };
+    EXPECT_EQ(locate(4096, true, fingerprint), 0);
+    /* an older copy of the same size is not offered */
+    EXPECT_EQ(locate(4096, true, other), -ENOENT);
+    EXPECT_EQ(locate(8192, true, fingerprint), -ENOENT);
+    EXPECT_EQ(locate(4096, false, 0), 0);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/block_checksums.h"
+#include "falcon_store/rebalancer.h"
+#include "local_cluster.h"
+
+#define REBALANCE_UT_BASE_PORT 57000
+#define REBALANCE_UT_NODES 2
+
+class RebalanceUT : public testing::Test {
+  public:
+    /* nodes are forked before the first client starts brpc threads here */
+    static void SetUpTestSuite()
+    {
+        char *baseConfig = std::getenv("CONFIG_FILE");
+        Json::Value root;
+        if (baseConfig == nullptr || LocalCluster::LoadConfig(baseConfig, root) != 0) {
+            exit(1);
+        }
+        std::filesystem::remove_all(rootPath);
+        cluster = std::make_unique<LocalCluster>(rootPath, REBALANCE_UT_NODES, REBALANCE_UT_BASE_PORT);
+        auto configure = [](int, Json::Value &main) {
+            main["falcon_persist"] = false;
+            main["falcon_async"] = false;
+            main["falcon_is_inference"] = false;
+            main["falcon_to_local"] = false;
+            main["falcon_replicas"] = 1;
+            main["falcon_peer_fill"] = false;
+        };
+        if (cluster->Start(root, configure) != 0) {
+            exit(1);
+        }
+        clients = cluster->Clients();
+        if (clients.empty()) {
+            exit(1);
+        }
+    }
+    static void TearDownTestSuite()
+    {
+        clients.clear();
+        cluster->Stop();
+        std::filesystem::remove_all(rootPath);
+    }
+    void SetUp() override {}
+    void TearDown() override {}
+
+    static std::string Content(char c, size_t size) { return std::string(size, c); }
+    /* send the chunk [offset, offset + chunk) of data as a previous owner would */
+    static int Migrate(
+        int nodeId, uint64_t inodeId, const std::string &data, bool replica, size_t offset = 0, size_t chunk = 0)
+    {
+        chunk = chunk == 0 ? data.size() - offset : chunk;
+        butil::IOBuf buf;
+        buf.append(data.data() + offset, chunk);
+        uint32_t crc = IOBufCrc32c(buf);
+        uint32_t fingerprint = BlockChecksums::OfBuffer(data.data(), data.size()).Fingerprint();
+        bool last = offset + chunk >= data.size();
+        return clients[nodeId]->MigrateFile(
+            inodeId, inodeId, false, offset, data.size(), last, replica, crc, fingerprint, false, 0, buf);
+    }
+
+    static std::string rootPath;
+    static std::unique_ptr<LocalCluster> cluster;
+    static std::vector<std::shared_ptr<FalconIOClient>> clients;
+};
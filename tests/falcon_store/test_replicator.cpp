@@ -0,0 +1,98 @@
+#include "test_replicator.h"
+
+TEST_F(ReplicatorUT, CopyToEveryBackup)
+{
+    Start();
+    Replicator::GetInstance().Enqueue(1, 1, {2, 3});
+    WaitIdle();
+    ASSERT_EQ(pusher->copies.size(), 2);
+    EXPECT_EQ(pusher->copies[0].nodeId, 2);
+    EXPECT_EQ(pusher->copies[1].nodeId, 3);
+    EXPECT_EQ(pusher->copies[0].base, nullptr);
+}
+
+TEST_F(ReplicatorUT, FlushedWhileCopied)
+{
+    pusher->Hold();
+    Start();
+    Replicator::GetInstance().Enqueue(2, 2, {1});
+    pusher->WaitInFlight();
+    /* only the latest version is copied once more */
+    Replicator::GetInstance().Enqueue(2, 2, {1});
+    Replicator::GetInstance().Enqueue(2, 2, {1});
+    pusher->Release();
+    WaitIdle();
+    ASSERT_EQ(pusher->copies.size(), 2);
+    /* the second copy is a patch of the first */
+    ASSERT_NE(pusher->copies[1].base, nullptr);
+    EXPECT_EQ(pusher->copies[1].base->FileSize(), 1);
+}
+
+TEST_F(ReplicatorUT, FailedCopyIsSentWhole)
+{
+    Start();
+    Replicator::GetInstance().Enqueue(3, 3, {1, 2});
+    WaitIdle();
+    pusher->failures = 1;
+    Replicator::GetInstance().Enqueue(3, 3, {1, 2});
+    WaitIdle();
+    Replicator::GetInstance().Enqueue(3, 3, {1, 2});
+    WaitIdle();
+    ASSERT_EQ(pusher->copies.size(), 6);
+    EXPECT_NE(pusher->copies[2].base, nullptr);
+    EXPECT_NE(pusher->copies[3].base, nullptr);
+    /* node 1 failed the second copy and has no base any more, node 2 has the second version */
+    EXPECT_EQ(pusher->copies[4].base, nullptr);
+    ASSERT_NE(pusher->copies[5].base, nullptr);
+    EXPECT_EQ(pusher->copies[5].base->FileSize(), 3);
+}
+
+TEST_F(ReplicatorUT, CancelDropsQueuedAndBase)
+{
+    pusher->Hold();
+    Start();
+    Replicator::GetInstance().Enqueue(4, 4, {1});
+    Replicator::GetInstance().Enqueue(5, 5, {1});
+    pusher->WaitInFlight();
+    Replicator::GetInstance().Cancel(5);
+    EXPECT_EQ(Replicator::GetInstance().Pending(), 1);
+
+    /* the copy in flight is waited for */
+    std::thread releaser([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        pusher->Release();
+    });
+    Replicator::GetInstance().Cancel(4);
+    EXPECT_EQ(Replicator::GetInstance().Pending(), 0);
+    releaser.join();
+    ASSERT_EQ(pusher->copies.size(), 1);
+    EXPECT_EQ(pusher->copies[0].inodeId, 4);
+
+    /* the backups dropped their copy, the next one is whole */
+    Replicator::GetInstance().Enqueue(4, 4, {1});
+    WaitIdle();
+    ASSERT_EQ(pusher->copies.size(), 2);
+    EXPECT_EQ(pusher->copies[1].base, nullptr);
+}
+
+TEST_F(ReplicatorUT, BasesAreBounded)
+{
+    Start();
+    for (uint64_t inodeId = 0; inodeId <= REPLICATE_BASES_MAX; ++inodeId) {
+        Replicator::GetInstance().Enqueue(100 + inodeId, 0, {1});
+    }
+    WaitIdle();
+    /* the file copied first was forgotten, the last one not */
+    Replicator::GetInstance().Enqueue(100, 0, {1});
+    Replicator::GetInstance().Enqueue(100 + REPLICATE_BASES_MAX, 0, {1});
+    WaitIdle();
+    size_t copies = pusher->copies.size();
+    EXPECT_EQ(pusher->copies[copies - 2].base, nullptr);
+    EXPECT_NE(pusher->copies[copies - 1].base, nullptr);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/replicator.h"
+
+/* a copy the replicator asked for */
+struct FakeCopy {
+    uint64_t inodeId;
+    int nodeId;
+    /* the checksums the copy was based on, empty if it was whole */
+    std::shared_ptr<BlockChecksums> base;
+};
+
+/* records copies, failing the first failures of them, and holds them while held is set */
+struct FakePusher {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<FakeCopy> copies;
+    int failures = 0;
+    bool held = false;
+    int inFlight = 0;
+    /* the size of the file every copy reports, a new version for every copy */
+    uint64_t fileSize = 0;
+
+    int Push(uint64_t inodeId, int nodeId, const BlockChecksums *base, BlockChecksums &pushed)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        inFlight++;
+        cv.notify_all();
+        cv.wait(lock, [this]() { return !held; });
+        inFlight--;
+        copies.push_back({inodeId, nodeId, base == nullptr ? nullptr : std::make_shared<BlockChecksums>(*base)});
+        if (failures > 0) {
+            failures--;
+            return -EIO;
+        }
+        pushed = BlockChecksums(++fileSize);
+        return 0;
+    }
+    void Hold()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        held = true;
+    }
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        held = false;
+        cv.notify_all();
+    }
+    void WaitInFlight()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]() { return inFlight > 0; });
+    }
+};
+
+class ReplicatorUT : public testing::Test {
+  public:
+    void SetUp() override { pusher = std::make_shared<FakePusher>(); }
+    void TearDown() override
+    {
+        pusher->Release();
+        Replicator::GetInstance().Stop();
+    }
+    void Start(uint32_t threadNum = 1)
+    {
+        auto fake = pusher;
+        auto push = [fake](uint64_t inodeId, uint64_t, int nodeId, const BlockChecksums *base, BlockChecksums &pushed) {
+            return fake->Push(inodeId, nodeId, base, pushed);
+        };
+        ASSERT_EQ(Replicator::GetInstance().Start(threadNum, push), 0);
+    }
+    /* wait until every queued copy is over */
+    static void WaitIdle()
+    {
+        for (int i = 0; i < 5000 && Replicator::GetInstance().Pending() > 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_EQ(Replicator::GetInstance().Pending(), 0);
+    }
+
+    std::shared_ptr<FakePusher> pusher;
+};
@@ -0,0 +1,141 @@
+#include "test_storage.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <fstream>
+
+std::string StorageUT::rootPath;
+
+static std::string Pattern(size_t size)
+{
+    std::string data(size, 0);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = 'a' + i % 26;
+    }
+    return data;
+}
+
+/* put, ranged reads into a buffer and a file, copy and delete, the same on every backend */
+static void RoundTrip(Storage *storage, const std::string &scratch)
+{
+    std::string data = Pattern(3 * 1024 * 1024 + 7);
+    ASSERT_EQ(storage->PutBuffer("dir/object", data.data(), data.size(), 0), (ssize_t)data.size());
+
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("dir/object", 1024 * 1024 - 50, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(1024 * 1024 - 50, 100));
+
+    /* a ranged read into a file lands at the offsets it has in the object */
+    int fd = open(scratch.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    EXPECT_EQ(storage->ReadObject("dir/object", 2 * 1024 * 1024, 0, fd, nullptr),
+              (ssize_t)(data.size() - 2 * 1024 * 1024));
+    EXPECT_EQ(storage->ReadObject("dir/object", 0, 2 * 1024 * 1024, fd, nullptr), 2 * 1024 * 1024);
+    std::string file(data.size(), 0);
+    EXPECT_EQ(pread(fd, file.data(), file.size(), 0), (ssize_t)data.size());
+    EXPECT_EQ(file, data);
+    close(fd);
+
+    EXPECT_EQ(storage->PutFile("other", scratch), 0);
+    EXPECT_EQ(storage->CopyObject("other", "copy"), 0);
+    EXPECT_EQ(storage->ReadObject("copy", 0, 100, -1, buf.data()), 100);
+    EXPECT_EQ(buf, data.substr(0, 100));
+
+    EXPECT_EQ(storage->DeleteObject("copy"), 0);
+    EXPECT_EQ(storage->DeleteObject("copy"), 0);
+    EXPECT_LT(storage->ReadObject("copy", 0, 100, -1, buf.data()), 0);
+    EXPECT_NE(storage->CopyObject("copy", "again"), 0);
+}
+
+TEST_F(StorageUT, PosixRoundTrip)
+{
+    ASSERT_EQ(PosixStorage::GetInstance()->Init(), 0);
+    RoundTrip(PosixStorage::GetInstance(), rootPath + "/scratch");
+    /* no temporary files are left behind */
+    for (auto &entry : std::filesystem::recursive_directory_iterator(rootPath)) {
+        EXPECT_EQ(entry.path().string().find(".falcon_tmp."), std::string::npos) << entry.path();
+    }
+    struct statvfs vfs;
+    EXPECT_EQ(PosixStorage::GetInstance()->StatFs(&vfs), 0);
+}
+
+TEST_F(StorageUT, MockRoundTrip)
+{
+    ASSERT_EQ(PosixStorage::GetInstance()->Init(), 0);
+    ASSERT_EQ(MockStorage::GetInstance()->Init(), 0);
+    RoundTrip(MockStorage::GetInstance(), rootPath + "/mock_scratch");
+    EXPECT_EQ(MockStorage::GetInstance()->ObjectCount(), 2);
+    struct statvfs vfs;
+    EXPECT_EQ(MockStorage::GetInstance()->StatFs(&vfs), 0);
+    EXPECT_EQ(vfs.f_files, 2);
+}
+
+TEST_F(StorageUT, MockErrors)
+{
+    MockStorage *storage = MockStorage::GetInstance();
+    std::string data = Pattern(100);
+    storage->SetFaults(0, 0, 100);
+    EXPECT_LT(storage->PutBuffer("object", data.data(), data.size(), 0), 0);
+    EXPECT_EQ(storage->ObjectCount(), 0);
+
+    storage->SetFaults(0, 0, 0);
+    ASSERT_EQ(storage->PutBuffer("object", data.data(), data.size(), 0), 100);
+    storage->SetFaults(0, 0, 100);
+    std::string buf(100, 0);
+    EXPECT_LT(storage->ReadObject("object", 0, 100, -1, buf.data()), 0);
+    EXPECT_NE(storage->DeleteObject("object"), 0);
+
+    /* about half of the requests fail */
+    storage->SetFaults(0, 0, 50);
+    int failed = 0;
+    for (int i = 0; i < 1000; ++i) {
+        failed += storage->ReadObject("object", 0, 100, -1, buf.data()) < 0;
+    }
+    EXPECT_GT(failed, 300);
+    EXPECT_LT(failed, 700);
+}
+
+TEST_F(StorageUT, MockCountsGets)
+{
+    MockStorage *storage = MockStorage::GetInstance();
+    storage->SetFaults(0, 0, 0);
+    storage->DeleteInstance();
+    std::string data = Pattern(100);
+    ASSERT_EQ(storage->PutBuffer("object", data.data(), data.size(), 0), 100);
+    EXPECT_EQ(storage->Gets(), 0);
+
+    std::string buf(100, 0);
+    EXPECT_EQ(storage->ReadObject("object", 0, 100, -1, buf.data()), 100);
+    EXPECT_EQ(storage->ReadObject("object", 50, 50, -1, buf.data()), 50);
+    /* a read of a missing object is a request all the same */
+    EXPECT_LT(storage->ReadObject("missing", 0, 100, -1, buf.data()), 0);
+    EXPECT_EQ(storage->Gets(), 3);
+
+    storage->DeleteInstance();
+    EXPECT_EQ(storage->Gets(), 0);
+}
+
+TEST_F(StorageUT, MockLatencyAndBandwidth)
+{
+    MockStorage *storage = MockStorage::GetInstance();
+    std::string data = Pattern(1024 * 1024);
+    ASSERT_EQ(storage->PutBuffer("object", data.data(), data.size(), 0), (ssize_t)data.size());
+
+    storage->SetFaults(20000, 0, 0);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(storage->ReadObject("object", 0, 1, -1, data.data()), 1);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    /* 1MB at 10MB/s */
+    storage->SetFaults(0, 10, 0);
+    start = std::chrono::steady_clock::now();
+    EXPECT_EQ(storage->ReadObject("object", 0, 0, -1, data.data()), (ssize_t)data.size());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "storage/mock_storage.h"
+#include "storage/posix_storage.h"
+
+class StorageUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        rootPath = std::filesystem::temp_directory_path() / "falcon_storage_ut";
+        std::filesystem::remove_all(rootPath);
+        PosixStorage::GetInstance()->SetRootPath(rootPath);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(rootPath); }
+    void SetUp() override
+    {
+        MockStorage::GetInstance()->SetFaults(0, 0, 0);
+        MockStorage::GetInstance()->DeleteInstance();
+    }
+    void TearDown() override {}
+
+    static std::string rootPath;
+};
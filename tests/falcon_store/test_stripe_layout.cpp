@@ -0,0 +1,74 @@
+#include "test_stripe_layout.h"
+
+TEST_F(StripeLayoutUT, UnitsRoundRobin)
+{
+    uint64_t stripeOffset = 0;
+    EXPECT_EQ(layout.StripeOf(0, stripeOffset), 0);
+    EXPECT_EQ(stripeOffset, 0);
+    EXPECT_EQ(layout.StripeOf(TEST_UNIT_SIZE + 5, stripeOffset), 1);
+    EXPECT_EQ(stripeOffset, 5);
+    EXPECT_EQ(layout.StripeOf(3 * TEST_UNIT_SIZE - 1, stripeOffset), 2);
+    EXPECT_EQ(stripeOffset, TEST_UNIT_SIZE - 1);
+    /* the second round continues every stripe after its first unit */
+    EXPECT_EQ(layout.StripeOf(4 * TEST_UNIT_SIZE + 7, stripeOffset), 1);
+    EXPECT_EQ(stripeOffset, TEST_UNIT_SIZE + 7);
+}
+
+TEST_F(StripeLayoutUT, StripeSizes)
+{
+    /* two full rounds and a half unit of the third */
+    uint64_t fileSize = 7 * TEST_UNIT_SIZE + TEST_UNIT_SIZE / 2;
+    EXPECT_EQ(layout.StripeSize(fileSize, 0), 3 * TEST_UNIT_SIZE);
+    EXPECT_EQ(layout.StripeSize(fileSize, 1), 2 * TEST_UNIT_SIZE + TEST_UNIT_SIZE / 2);
+    EXPECT_EQ(layout.StripeSize(fileSize, 2), 2 * TEST_UNIT_SIZE);
+    uint64_t total = 0;
+    for (uint32_t stripe = 0; stripe < layout.width; ++stripe) {
+        total += layout.StripeSize(fileSize, stripe);
+    }
+    EXPECT_EQ(total, fileSize);
+    EXPECT_EQ(layout.StripeSize(10, 1), 0);
+}
+
+TEST_F(StripeLayoutUT, NodeIdRoundTrip)
+{
+    int nodeId = layout.ToNodeId();
+    EXPECT_TRUE(StripeLayout::IsStriped(nodeId));
+    StripeLayout decoded = StripeLayout::FromNodeId(nodeId);
+    EXPECT_EQ(decoded.width, 3);
+    EXPECT_EQ(decoded.unitSize, TEST_UNIT_SIZE);
+
+    /* real node ids and the unallocated one are not layouts */
+    EXPECT_FALSE(StripeLayout::IsStriped(-1));
+    EXPECT_FALSE(StripeLayout::IsStriped(0));
+    EXPECT_FALSE(StripeLayout::IsStriped(7));
+
+    /* the largest layout is still told apart from -1 */
+    StripeLayout largest = StripeLayout::Make(1000, UINT64_MAX / 2);
+    EXPECT_EQ(largest.width, STRIPE_MAX_WIDTH);
+    EXPECT_TRUE(StripeLayout::IsStriped(largest.ToNodeId()));
+    EXPECT_EQ(StripeLayout::FromNodeId(largest.ToNodeId()).unitSize, largest.unitSize);
+
+    /* unit sizes are rounded up to whole granules */
+    EXPECT_EQ(StripeLayout::Make(2, 1).unitSize, STRIPE_UNIT_GRANULE);
+    EXPECT_EQ(StripeLayout::Make(0, STRIPE_UNIT_GRANULE).width, 1);
+}
+
+TEST_F(StripeLayoutUT, StripeInodesAndPaths)
+{
+    uint64_t inodeId = (12345ULL << 12) | 3;
+    EXPECT_FALSE(StripeLayout::IsStripeInode(inodeId));
+    uint64_t first = StripeLayout::StripeInodeId(inodeId, 0);
+    uint64_t second = StripeLayout::StripeInodeId(inodeId, 1);
+    EXPECT_TRUE(StripeLayout::IsStripeInode(first));
+    EXPECT_NE(first, second);
+    EXPECT_NE(first, StripeLayout::StripeInodeId(inodeId + 1, 0));
+
+    EXPECT_EQ(StripeLayout::StripePath("/data/train/shard.bin", 2), "/data/train/.falcon_stripe.2.shard.bin");
+    EXPECT_EQ(StripeLayout::StripePath("/shard", 0), "/.falcon_stripe.0.shard");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "falcon_store/stripe_layout.h"
+
+#define TEST_UNIT_SIZE (STRIPE_UNIT_GRANULE * 2)
+
+class StripeLayoutUT : public testing::Test {
+  public:
+    /* 3 stripes of 128KB units */
+    void SetUp() override { layout = StripeLayout::Make(3, TEST_UNIT_SIZE); }
+
+    StripeLayout layout;
+};
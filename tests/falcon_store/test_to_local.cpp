@@ -0,0 +1,60 @@
+#include "test_to_local.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "buffer/open_instance.h"
+#include "falcon_store/falcon_store.h"
+
+/* enough files for some to be placed on node 1 */
+#define TO_LOCAL_UT_FILES 32
+
+std::string ToLocalUT::rootPath = "/tmp/falcon_to_local_ut";
+std::unique_ptr<LocalCluster> ToLocalUT::cluster;
+
+TEST_F(ToLocalUT, FilesStayOnTheWriterAcrossMembershipChanges)
+{
+    FalconStore *store = FalconStore::GetInstance();
+    std::vector<int> nodeIds;
+    for (uint64_t i = 0; i < TO_LOCAL_UT_FILES; ++i) {
+        std::string data = Content(i);
+        OpenInstance writer;
+        writer.inodeId = 1000 + i;
+        writer.path = "/to_local/" + std::to_string(i);
+        writer.oflags = O_WRONLY | O_CREAT;
+        writer.writeCnt++;
+        ASSERT_EQ(store->WriteFile(&writer, data.data(), data.size(), 0), 0);
+        ASSERT_EQ(store->CloseTmpFiles(&writer, true, true), 0);
+        ASSERT_EQ(store->CloseTmpFiles(&writer, false, false), 0);
+        nodeIds.push_back(writer.nodeId);
+    }
+
+    /* node 1 leaves and joins again, the placement of the files changes twice */
+    SetView(1);
+    SetView(TO_LOCAL_UT_NODES);
+    /* long enough for a rebalancer pass over a few small files */
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    /* nothing is persisted, a file moved away would be lost to the node that wrote it */
+    for (uint64_t i = 0; i < TO_LOCAL_UT_FILES; ++i) {
+        std::string data = Content(i);
+        OpenInstance reader;
+        reader.inodeId = 1000 + i;
+        reader.path = "/to_local/" + std::to_string(i);
+        reader.oflags = O_RDONLY;
+        reader.nodeId = nodeIds[i];
+        reader.originalSize = data.size();
+        reader.currentSize = data.size();
+        std::string buf(data.size(), '\0');
+        EXPECT_EQ(store->ReadFile(&reader, buf.data(), buf.size(), 0), (int)data.size()) << "inode " << reader.inodeId;
+        EXPECT_EQ(buf, data) << "inode " << reader.inodeId;
+        store->CloseTmpFiles(&reader, false, false);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
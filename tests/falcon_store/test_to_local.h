@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "connection/node.h"
+#include "local_cluster.h"
+
+#define TO_LOCAL_UT_BASE_PORT 57200
+#define TO_LOCAL_UT_NODES 2
+
+/* node 0 is this process, so files can be written on it and read back there */
+class ToLocalUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        char *baseConfig = std::getenv("CONFIG_FILE");
+        Json::Value root;
+        if (baseConfig == nullptr || LocalCluster::LoadConfig(baseConfig, root) != 0) {
+            exit(1);
+        }
+        std::filesystem::remove_all(rootPath);
+        cluster = std::make_unique<LocalCluster>(rootPath, TO_LOCAL_UT_NODES, TO_LOCAL_UT_BASE_PORT);
+        auto configure = [](int, Json::Value &main) {
+            main["falcon_persist"] = false;
+            main["falcon_async"] = false;
+            main["falcon_is_inference"] = false;
+            main["falcon_to_local"] = true;
+            main["falcon_replicas"] = 1;
+            main["falcon_peer_fill"] = false;
+        };
+        if (cluster->Start(root, configure, nullptr, 1) != 0) {
+            exit(1);
+        }
+        if (cluster->StartNode(0, cluster->WriteNodeConfig(root, 0, configure)) != 0) {
+            cluster->Stop();
+            exit(1);
+        }
+    }
+    static void TearDownTestSuite()
+    {
+        cluster->Stop();
+        std::filesystem::remove_all(rootPath);
+    }
+    void SetUp() override {}
+    void TearDown() override {}
+
+    static std::string Content(uint64_t i) { return std::string(4096 + i, (char)('a' + i % 26)); }
+    /* tell this node the cluster is nodes 0 to count - 1, as the cluster manager would */
+    static void SetView(int count)
+    {
+        std::unordered_map<int, std::string> view;
+        for (int i = 0; i < count; ++i) {
+            view[i] = cluster->Endpoint(i);
+        }
+        StoreNode::GetInstance()->UpdateNodeConfigByValue(view);
+    }
+
+    static std::string rootPath;
+    static std::unique_ptr<LocalCluster> cluster;
+};
@@ -0,0 +1,163 @@
+#include "test_write_back.h"
+
+#include <fstream>
+#include <thread>
+
+std::string WriteBackUT::rootPath = "/tmp/falcon_write_back_ut";
+
+TEST_F(WriteBackUT, UploadAndUnpin)
+{
+    DiskCache::GetInstance().InsertAndUpdate(1, 100, false);
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(1, "/a"), 0);
+    EXPECT_EQ(WriteBack::GetInstance().Wait(1), 0);
+    EXPECT_EQ(WriteBack::GetInstance().Pending(), 0);
+    ASSERT_EQ(uploader->uploads.size(), 1);
+    EXPECT_EQ(uploader->uploads[0], std::make_pair(uint64_t(1), std::string("/a")));
+    EXPECT_FALSE(Pinned(1));
+    EXPECT_FALSE(std::filesystem::exists(rootPath + "/writeback/1"));
+}
+
+TEST_F(WriteBackUT, NoCacheFile)
+{
+    Start();
+    EXPECT_EQ(WriteBack::GetInstance().Enqueue(999, "/missing"), -ENOENT);
+    EXPECT_EQ(WriteBack::GetInstance().Pending(), 0);
+    EXPECT_FALSE(std::filesystem::exists(rootPath + "/writeback/999"));
+}
+
+TEST_F(WriteBackUT, PinnedUntilUploaded)
+{
+    DiskCache::GetInstance().InsertAndUpdate(2, 100, false);
+    uploader->Hold();
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(2, "/b"), 0);
+    uploader->WaitInFlight();
+    EXPECT_TRUE(Pinned(2));
+    EXPECT_TRUE(std::filesystem::exists(rootPath + "/writeback/2"));
+    uploader->Release();
+    EXPECT_EQ(WriteBack::GetInstance().Wait(2), 0);
+    EXPECT_FALSE(Pinned(2));
+}
+
+TEST_F(WriteBackUT, RetryFailedUpload)
+{
+    DiskCache::GetInstance().InsertAndUpdate(3, 100, false);
+    uploader->failures = 2;
+    uploader->Hold();
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(3, "/c"), 0);
+    uploader->WaitInFlight();
+    std::thread releaser([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uploader->Release();
+    });
+    /* a waiter learns about the failure, the upload is retried anyway */
+    EXPECT_EQ(WriteBack::GetInstance().Wait(3), -EIO);
+    releaser.join();
+    EXPECT_EQ(WriteBack::GetInstance().Pending(), 1);
+    EXPECT_EQ(WriteBack::GetInstance().Wait(3), -EIO);
+    EXPECT_EQ(WriteBack::GetInstance().Wait(3), 0);
+    EXPECT_EQ(uploader->uploads.size(), 1);
+    EXPECT_FALSE(Pinned(3));
+}
+
+TEST_F(WriteBackUT, ReplayJournal)
+{
+    DiskCache::GetInstance().InsertAndUpdate(4, 100, false);
+    uploader->failures = 1000;
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(4, "/d"), 0);
+    EXPECT_EQ(WriteBack::GetInstance().Wait(4), -EIO);
+    WriteBack::GetInstance().Stop();
+    EXPECT_FALSE(Pinned(4));
+
+    /* as after a restart, a half written entry is dropped */
+    std::ofstream(rootPath + "/writeback/5.tmp.0") << "/e";
+    uploader->failures = 0;
+    Start();
+    EXPECT_TRUE(Pinned(4));
+    EXPECT_EQ(WriteBack::GetInstance().Wait(4), 0);
+    ASSERT_EQ(uploader->uploads.size(), 1);
+    EXPECT_EQ(uploader->uploads[0].second, "/d");
+    EXPECT_FALSE(std::filesystem::exists(rootPath + "/writeback/5.tmp.0"));
+}
+
+TEST_F(WriteBackUT, RewrittenWhileUploading)
+{
+    DiskCache::GetInstance().InsertAndUpdate(6, 100, false);
+    uploader->Hold();
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(6, "/f"), 0);
+    uploader->WaitInFlight();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(6, "/f"), 0);
+    uploader->Release();
+    EXPECT_EQ(WriteBack::GetInstance().Wait(6), 0);
+    EXPECT_EQ(uploader->uploads.size(), 2);
+    EXPECT_FALSE(Pinned(6));
+}
+
+TEST_F(WriteBackUT, WaiterGoesFirst)
+{
+    for (uint64_t inodeId = 10; inodeId <= 13; ++inodeId) {
+        DiskCache::GetInstance().InsertAndUpdate(inodeId, 100, false);
+    }
+    uploader->Hold();
+    Start();
+    for (uint64_t inodeId = 10; inodeId <= 13; ++inodeId) {
+        ASSERT_EQ(WriteBack::GetInstance().Enqueue(inodeId, "/g" + std::to_string(inodeId)), 0);
+    }
+    uploader->WaitInFlight();
+    std::thread waiter([]() { EXPECT_EQ(WriteBack::GetInstance().WaitPath("/g13"), 0); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uploader->Release();
+    waiter.join();
+    EXPECT_EQ(WriteBack::GetInstance().Wait(12), 0);
+    std::vector<uint64_t> order;
+    for (auto &upload : uploader->uploads) {
+        order.push_back(upload.first);
+    }
+    EXPECT_EQ(order, std::vector<uint64_t>({10, 13, 11, 12}));
+}
+
+TEST_F(WriteBackUT, Cancel)
+{
+    DiskCache::GetInstance().InsertAndUpdate(20, 100, false);
+    DiskCache::GetInstance().InsertAndUpdate(21, 100, false);
+    uploader->Hold();
+    Start();
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(20, "/h"), 0);
+    ASSERT_EQ(WriteBack::GetInstance().Enqueue(21, "/i"), 0);
+    uploader->WaitInFlight();
+    WriteBack::GetInstance().Cancel(21);
+    EXPECT_FALSE(Pinned(21));
+    EXPECT_FALSE(std::filesystem::exists(rootPath + "/writeback/21"));
+    uploader->Release();
+    WriteBack::GetInstance().Cancel(20);
+    EXPECT_EQ(WriteBack::GetInstance().Pending(), 0);
+    for (auto &upload : uploader->uploads) {
+        EXPECT_NE(upload.first, 21);
+    }
+}
+
+TEST_F(WriteBackUT, JournalOutlivesOlderUpload)
+{
+    DiskCache::GetInstance().InsertAndUpdate(30, 100, false);
+    Start();
+    std::string journal = rootPath + "/writeback/30";
+    for (int i = 0; i < 200; ++i) {
+        ASSERT_EQ(WriteBack::GetInstance().Enqueue(30, "/j"), 0);
+        /* an upload of an older version that finished meanwhile must not take the journal along */
+        bool journaled = std::filesystem::exists(journal);
+        bool queued = WriteBack::GetInstance().Queued(30);
+        EXPECT_TRUE(journaled || !queued);
+    }
+    EXPECT_EQ(WriteBack::GetInstance().Wait(30), 0);
+    EXPECT_FALSE(std::filesystem::exists(journal));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "disk_cache/disk_cache.h"
+#include "falcon_store/write_back.h"
+
+/* records uploads, failing the first failures of them, and holds them while held is set */
+struct FakeUploader {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::pair<uint64_t, std::string>> uploads;
+    int failures = 0;
+    bool held = false;
+    int inFlight = 0;
+
+    int Upload(uint64_t inodeId, const std::string &path)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        inFlight++;
+        cv.notify_all();
+        cv.wait(lock, [this]() { return !held; });
+        inFlight--;
+        if (failures > 0) {
+            failures--;
+            return -EIO;
+        }
+        uploads.emplace_back(inodeId, path);
+        return 0;
+    }
+    void Hold()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        held = true;
+    }
+    void Release()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        held = false;
+        cv.notify_all();
+    }
+    void WaitInFlight()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]() { return inFlight > 0; });
+    }
+};
+
+class WriteBackUT : public testing::Test {
+  public:
+    static void SetUpTestSuite()
+    {
+        std::filesystem::remove_all(rootPath);
+        std::filesystem::create_directories(rootPath);
+    }
+    static void TearDownTestSuite() { std::filesystem::remove_all(rootPath); }
+    void SetUp() override { uploader = std::make_shared<FakeUploader>(); }
+    void TearDown() override
+    {
+        uploader->Release();
+        WriteBack::GetInstance().Stop();
+        std::filesystem::remove_all(rootPath + "/writeback");
+    }
+    void Start(uint32_t threadNum = 1)
+    {
+        auto fake = uploader;
+        auto upload = [fake](uint64_t inodeId, const std::string &path) { return fake->Upload(inodeId, path); };
+        ASSERT_EQ(WriteBack::GetInstance().Start(rootPath, threadNum, upload), 0);
+    }
+    /* a cache file only write back can have pinned */
+    static bool Pinned(uint64_t inodeId)
+    {
+        if (DiskCache::GetInstance().TryPinIdle(inodeId)) {
+            DiskCache::GetInstance().Unpin(inodeId);
+            return false;
+        }
+        return true;
+    }
+
+    static std::string rootPath;
+    std::shared_ptr<FakeUploader> uploader;
+};